@@ -0,0 +1,70 @@
+#include "atrous.h"
+#include <math.h>
+#include <stdlib.h>
+
+const float ATROUS_B3[ATROUS_TAPS] = {1.0f/16, 4.0f/16, 6.0f/16, 4.0f/16, 1.0f/16};
+
+long atrous_mirror(long i, long n){
+  if(n == 1){
+    return 0;
+  }
+  /* reflections repeat every 2n-2 pixels */
+  const long period = 2*n - 2;
+  i = labs(i) % period;
+  return i < n ? i : period - i;
+}
+
+static uint8_t round_byte(float value){
+  const float rounded = nearbyintf(value);
+  return rounded < 0.0f ? 0 : rounded > 255.0f ? 255 : (uint8_t)rounded;
+}
+
+/* smooth a plane along lines of length pixels along apart, the lines across
+ * apart, with the taps step pixels apart. same order of summation as atrous.cl
+ */
+static void smooth(const float *src, float *dst, long length, long lines, long along, long across, long step){
+  for(long line = 0; line < lines; ++line){
+    for(long x = 0; x < length; ++x){
+      float sum = 0.0f;
+      for(long k = 0; k < ATROUS_TAPS; ++k){
+        sum += ATROUS_B3[k]*src[line*across + atrous_mirror(x + (k - ATROUS_TAPS/2)*step,length)*along];
+      }
+      dst[line*across + x*along] = sum;
+    }
+  }
+}
+
+int atrous_decompose(const uint8_t *image, size_t image_width, size_t image_height, unsigned int levels, uint8_t *planes){
+  if(levels == 0 || levels > ATROUS_MAX_LEVELS){
+    return 1;
+  }
+  const size_t image_size = image_width*image_height;
+  float *fine = malloc(sizeof(float)*image_size);
+  float *coarse = malloc(sizeof(float)*image_size);
+  float *rows = malloc(sizeof(float)*image_size);
+  for(size_t i = 0; i < image_size; ++i){
+    fine[i] = image[i];
+  }
+
+  long step = 1;
+  for(unsigned int level = 0; level < levels; ++level){
+    smooth(fine,rows,image_width,image_height,1,image_width,step);
+    smooth(rows,coarse,image_height,image_width,image_width,1,step);
+    uint8_t *detail = &planes[level*image_size];
+    for(size_t i = 0; i < image_size; ++i){
+      detail[i] = round_byte(fine[i] - coarse[i] + ATROUS_DETAIL_OFFSET);
+    }
+    float *swap = fine;
+    fine = coarse;
+    coarse = swap;
+    step *= 2;
+  }
+  for(size_t i = 0; i < image_size; ++i){
+    planes[levels*image_size + i] = round_byte(fine[i]);
+  }
+
+  free(fine);
+  free(coarse);
+  free(rows);
+  return 0;
+}
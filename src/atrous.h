@@ -0,0 +1,36 @@
+/* à trous wavelet decomposition
+ * the undecimated wavelet transform smooths the image again and again with
+ * the B3 spline (1,4,6,4,1)/16 along rows and then columns, the taps of
+ * level j being 2^(j-1) pixels apart, and keeps the difference between one
+ * smoothing and the next as the detail of a level. every level takes the
+ * same 10 taps per pixel whatever its scale, and the smoothings stay at
+ * full resolution. pixels outside the image mirror those inside it
+ */
+
+#ifndef GIMC_ATROUS_H
+#define GIMC_ATROUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ATROUS_TAPS 5
+extern const float ATROUS_B3[ATROUS_TAPS];
+
+/* the taps of the last level are 2^(ATROUS_MAX_LEVELS-1) apart */
+#define ATROUS_MAX_LEVELS 12
+
+/* details are signed, planes hold them plus this */
+#define ATROUS_DETAIL_OFFSET 128
+
+/* index of position i of a line of n pixels, reflected about its ends */
+extern long atrous_mirror(long i,long n);
+
+/* decompose an image into levels+1 planes of image_width*image_height
+ * pixels, the details of levels 1 to levels plus ATROUS_DETAIL_OFFSET and
+ * then the residual smoothing, rounded to the nearest. without the offsets
+ * and rounding the planes add up to the image
+ * returns nonzero unless levels is 1 to ATROUS_MAX_LEVELS
+ */
+extern int atrous_decompose(const uint8_t *image,size_t image_width,size_t image_height,unsigned int levels,uint8_t *planes);
+
+#endif
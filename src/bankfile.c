@@ -0,0 +1,167 @@
+#define _DEFAULT_SOURCE
+#include "bankfile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "filter.h"
+
+#define HEADER_SIZE 16
+
+size_t bankfile_record_weights(const struct bankfile_record *record){
+  return record->flags & BANKFILE_SEPARABLE ? (size_t)record->width + record->height : (size_t)record->width*record->height;
+}
+
+unsigned int bankfile_width(const struct bankfile_record *record){
+  return record->width | 1;
+}
+
+unsigned int bankfile_height(const struct bankfile_record *record){
+  return record->height | 1;
+}
+
+unsigned int bankfile_widths(const struct bankfile *file, unsigned int *widths, unsigned int *heights){
+  unsigned int widest = 1;
+  for(uint32_t f = 0; f < file->num_filters; ++f){
+    widths[f] = bankfile_width(&file->records[f]);
+    heights[f] = bankfile_height(&file->records[f]);
+    widest = widths[f] > widest ? widths[f] : widest;
+    widest = heights[f] > widest ? heights[f] : widest;
+  }
+  return widest;
+}
+
+int bankfile_open(struct bankfile *file, const char *path){
+  int fd = open(path,O_RDONLY);
+  if(fd < 0){
+    perror(path);
+    return 1;
+  }
+  struct stat st;
+  if(fstat(fd,&st) != 0 || (size_t)st.st_size < HEADER_SIZE){
+    fprintf(stderr,"%s is not a bank file\n",path);
+    close(fd);
+    return 1;
+  }
+  file->size = st.st_size;
+  file->mapping = mmap(NULL,file->size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(file->mapping == MAP_FAILED){
+    perror(path);
+    return 1;
+  }
+
+  const uint8_t *bytes = file->mapping;
+  memcpy(&file->num_filters,bytes + 8,sizeof(uint32_t));
+  const size_t records_end = HEADER_SIZE + (size_t)file->num_filters*sizeof(struct bankfile_record);
+  int valid = memcmp(bytes,BANKFILE_MAGIC,8) == 0 && file->num_filters > 0 && records_end <= file->size &&
+    (file->size - records_end) % sizeof(float) == 0;
+  if(valid){
+    file->records = (const struct bankfile_record *)(bytes + HEADER_SIZE);
+    file->weights = (const float *)(bytes + records_end);
+    file->num_weights = (file->size - records_end)/sizeof(float);
+  }
+  for(uint32_t f = 0; f < file->num_filters && valid; ++f){
+    const struct bankfile_record *record = &file->records[f];
+    valid = record->width >= 1 && record->width <= BANKFILE_MAX_SIDE && record->height >= 1 &&
+      record->height <= BANKFILE_MAX_SIDE &&
+      (record->flags & ~(BANKFILE_SEPARABLE | BANKFILE_ZERO_MEAN | BANKFILE_NORMALIZE)) == 0 &&
+      record->offset <= file->num_weights && bankfile_record_weights(record) <= file->num_weights - record->offset;
+    if(!valid){
+      fprintf(stderr,"%s: filter %u is not valid\n",path,f);
+    }
+  }
+  if(!valid){
+    fprintf(stderr,"%s is not a bank file\n",path);
+    munmap(file->mapping,file->size);
+    return 1;
+  }
+  return 0;
+}
+
+void bankfile_close(struct bankfile *file){
+  munmap(file->mapping,file->size);
+}
+
+/* a filter with its flags applied in the center of a square of side */
+static void filter_square(const struct bankfile *file, uint32_t filter, float *square, unsigned int side){
+  const struct bankfile_record *record = &file->records[filter];
+  const float *weights = &file->weights[record->offset];
+  const unsigned int left = (side - record->width)/2;
+  const unsigned int top = (side - record->height)/2;
+  memset(square,0,sizeof(float)*side*side);
+  double sum = 0.0;
+  for(unsigned int y = 0; y < record->height; ++y){
+    for(unsigned int x = 0; x < record->width; ++x){
+      const float weight = record->flags & BANKFILE_SEPARABLE ?
+        weights[x]*weights[record->width + y] : weights[y*record->width + x];
+      square[(top + y)*side + left + x] = weight;
+      sum += weight;
+    }
+  }
+  const double mean = record->flags & BANKFILE_ZERO_MEAN ? sum/((double)record->width*record->height) : 0.0;
+  if(record->flags & BANKFILE_ZERO_MEAN){
+    /* which sums to zero, so it is normalized by its absolute weights */
+    sum = 0.0;
+    for(unsigned int y = 0; y < record->height; ++y){
+      for(unsigned int x = 0; x < record->width; ++x){
+        sum += fabs(square[(top + y)*side + left + x] - mean);
+      }
+    }
+  }
+  const double scale = (record->flags & BANKFILE_NORMALIZE) && sum != 0.0 ? 1.0/sum : 1.0;
+  for(unsigned int y = 0; y < record->height; ++y){
+    for(unsigned int x = 0; x < record->width; ++x){
+      float *weight = &square[(top + y)*side + left + x];
+      *weight = (float)((*weight - mean)*scale);
+    }
+  }
+}
+
+void bankfile_bank(const struct bankfile *file, float *bank, unsigned int filter_width){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  float *square = malloc(sizeof(float)*filter_len);
+  for(uint32_t f = 0; f < file->num_filters; ++f){
+    /* the rectangle is centered in the square of its larger side */
+    const unsigned int width = bankfile_width(&file->records[f]);
+    const unsigned int height = bankfile_height(&file->records[f]);
+    const unsigned int side = width > height ? width : height;
+    filter_square(file,f,square,side);
+    filter_dilate_bank(&bank[f*filter_len],filter_width,square,NULL,1,side);
+  }
+  free(square);
+}
+
+int bankfile_write(const char *path, const struct bankfile_record *records, unsigned int num_filters, const float *weights){
+  FILE *out = fopen(path,"wb");
+  if(out == NULL){
+    perror(path);
+    return 1;
+  }
+  uint8_t header[HEADER_SIZE] = {0};
+  const uint32_t count = num_filters;
+  memcpy(header,BANKFILE_MAGIC,8);
+  memcpy(header + 8,&count,sizeof(count));
+  int failed = fwrite(header,HEADER_SIZE,1,out) != 1;
+  size_t offset = 0;
+  for(unsigned int f = 0; f < num_filters && !failed; ++f){
+    struct bankfile_record record = records[f];
+    record.offset = offset;
+    failed = fwrite(&record,sizeof(record),1,out) != 1;
+    offset += bankfile_record_weights(&record);
+  }
+  if(!failed && offset){
+    failed = fwrite(weights,sizeof(float),offset,out) != offset;
+  }
+  failed |= fclose(out) != 0;
+  if(failed){
+    fprintf(stderr,"Could not write %s\n",path);
+  }
+  return failed;
+}
@@ -0,0 +1,79 @@
+/* filter bank files
+ * a bank of filters of any width and height, mapped rather than read. a
+ * file is a 16 byte header, the magic BANKFILE_MAGIC, the number of
+ * filters and 4 zero bytes, then a record per filter and then the weights
+ * as 32 bit floats. the weights of a filter are height rows of width, or
+ * with BANKFILE_SEPARABLE a row factor of width and then a column factor
+ * of height whose outer product is the filter. fields are little endian.
+ * engines run a filter in the rectangle of bankfile_width by
+ * bankfile_height, centered, so a bank of mixed sizes is loaded with
+ * gimc_bank_adaptive and runs a launch per shape instead of padding every
+ * filter to the square of the largest side
+ */
+
+#ifndef GIMC_BANKFILE_H
+#define GIMC_BANKFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BANKFILE_MAGIC "GIMCBNK1"
+
+/* sides of a filter are at most this */
+#define BANKFILE_MAX_SIDE 1023
+
+/* flags of a filter, applied to the weights as they are loaded */
+#define BANKFILE_SEPARABLE 1u /* the weights are a row and a column factor */
+#define BANKFILE_ZERO_MEAN 2u /* the mean is taken off, for derivative filters */
+/* scaled to sum to 1, or with BANKFILE_ZERO_MEAN, once the mean is taken
+ * off, for the absolute weights to sum to 1
+ */
+#define BANKFILE_NORMALIZE 4u
+
+struct bankfile_record{
+  uint32_t width;
+  uint32_t height;
+  uint32_t flags;
+  uint32_t offset; /* of the first weight, in floats from the first of the file */
+};
+
+/* a mapped bank file */
+struct bankfile{
+  void *mapping;
+  size_t size;
+  uint32_t num_filters;
+  const struct bankfile_record *records;
+  const float *weights;
+  size_t num_weights;
+};
+
+/* map a bank file, returns nonzero if it can't be read or is not valid */
+extern int bankfile_open(struct bankfile *file,const char *path);
+
+/* unmap a bank file */
+extern void bankfile_close(struct bankfile *file);
+
+/* weights a record takes in the file */
+extern size_t bankfile_record_weights(const struct bankfile_record *record);
+
+/* width and height of the rectangle a filter runs in, its sides made odd */
+extern unsigned int bankfile_width(const struct bankfile_record *record);
+extern unsigned int bankfile_height(const struct bankfile_record *record);
+
+/* widths and heights of the filters of a file, returns the largest side */
+extern unsigned int bankfile_widths(const struct bankfile *file,unsigned int *widths,unsigned int *heights);
+
+/* the filters of a file with their flags applied, each in the center of
+ * its own rectangle and that in the center of filter_width*filter_width,
+ * laid out as in filter_Gauss2dbank
+ */
+extern void bankfile_bank(const struct bankfile *file,float *bank,unsigned int filter_width);
+
+/* write a bank file of num_filters records and their weights, the offsets
+ * of the records are ignored and the weights follow one another
+ * returns nonzero if it could not be written
+ */
+extern int bankfile_write(const char *path,const struct bankfile_record *records,unsigned int num_filters,
+  const float *weights);
+
+#endif
@@ -0,0 +1,51 @@
+/* writes the Gaussians of filter_Gauss2dbank to a bank file, see
+ * bankfile.h, each as separable factors as wide as filter_adaptive_widths
+ * gives it and normalized as it is loaded
+ */
+
+/* standard headers */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* project headers */
+#include "bankfile.h"
+#include "filter.h"
+
+int main(int argc, char **argv){
+  if(argc < 4){
+    printf("Usage: %s [Bank File] [Number of Filters] [Size of Filters]\n",argv[0]);
+    printf("  the size of filters caps their widths, 0 for none\n");
+    return -1;
+  }
+  const unsigned int num_filters = atoi(argv[2]);
+  if(num_filters == 0){
+    fprintf(stderr,"A bank needs a filter\n");
+    return -1;
+  }
+  unsigned int *widths = malloc(sizeof(unsigned int)*num_filters);
+  const unsigned int widest = filter_adaptive_widths(widths,num_filters,FILTER_ADAPTIVE_EPSILON,atoi(argv[3]));
+
+  struct bankfile_record *records = malloc(sizeof(struct bankfile_record)*num_filters);
+  float *weights = malloc(sizeof(float)*2*widest*num_filters);
+  size_t offset = 0;
+  for(unsigned int f = 0; f < num_filters; ++f){
+    const float sigma = filter_Gauss2dbank_sigma(f,num_filters);
+    const int radius = (widths[f] - 1)/2;
+    records[f].width = widths[f];
+    records[f].height = widths[f];
+    records[f].flags = BANKFILE_SEPARABLE | BANKFILE_NORMALIZE;
+    /* the row factor then the same column factor */
+    for(int i = 0; i < (int)widths[f]; ++i){
+      const float x = i - radius;
+      weights[offset + i] = expf(-x*x/(2*sigma*sigma));
+      weights[offset + widths[f] + i] = weights[offset + i];
+    }
+    offset += 2*widths[f];
+  }
+  const int failed = bankfile_write(argv[1],records,num_filters,weights);
+  free(widths);
+  free(records);
+  free(weights);
+  return failed ? EXIT_FAILURE : 0;
+}
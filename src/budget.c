@@ -0,0 +1,109 @@
+#define _DEFAULT_SOURCE /* _SC_PHYS_PAGES */
+#include "budget.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+size_t budget_env_megabytes(void){
+  const char *megabytes = getenv("GIMC_MEMORY_BUDGET");
+  return megabytes ? (size_t)atol(megabytes) : 0;
+}
+
+size_t budget_host_bytes(void){
+  const long pages = sysconf(_SC_PHYS_PAGES);
+  const long page_size = sysconf(_SC_PAGESIZE);
+  if(pages <= 0 || page_size <= 0){
+    return (size_t)1 << 30;
+  }
+  return (size_t)pages*(size_t)page_size/2;
+}
+
+void budget_limit(struct gimc_budget *budget, size_t megabytes){
+  const size_t bytes = megabytes << 20;
+  if(megabytes == 0){
+    return;
+  }
+  if(budget->device_bytes > bytes){
+    budget->device_bytes = bytes;
+  }
+  if(budget->max_alloc > bytes){
+    budget->max_alloc = bytes;
+  }
+  if(budget->host_bytes > bytes){
+    budget->host_bytes = bytes;
+  }
+}
+
+static size_t min_size(size_t a, size_t b){
+  return a < b ? a : b;
+}
+
+int budget_plan(const struct gimc_budget *budget, size_t width, size_t height, unsigned int num_filters,
+  unsigned int filter_width, int split_bank, int split_rows, struct budget_plan *plan){
+  const size_t plane = width*height;
+  const size_t filter_bytes = sizeof(float)*filter_width*filter_width;
+  const size_t halo = (filter_width - 1)/2;
+  if(plane == 0 || num_filters == 0 || plane > budget->max_alloc){
+    return 1;
+  }
+
+  /* host memory only depends on the chunks, a single chunk isn't double buffered */
+  const int whole_on_host = (size_t)num_filters*plane <= budget->host_bytes;
+  const size_t host_filters = budget->host_bytes/(2*plane);
+  if(!whole_on_host && (host_filters == 0 || !split_bank)){
+    return 1;
+  }
+
+  /* halve the bands until a chunk fits on the device */
+  size_t rows = height;
+  for(;;){
+    const size_t band_height = rows == height ? height : min_size(height,rows + 2*halo);
+    const size_t band_bytes = band_height*width;
+    const size_t fixed = plane + num_filters*filter_bytes + (rows < height ? band_bytes : 0);
+    size_t filters = 0;
+    if(fixed < budget->device_bytes){
+      filters = (budget->device_bytes - fixed)/(band_bytes + filter_bytes);
+      filters = min_size(filters,budget->max_alloc/band_bytes);
+      filters = min_size(filters,num_filters);
+      if(filters < num_filters || !whole_on_host){
+        filters = min_size(filters,host_filters);
+      }
+    }
+    if(!split_bank && filters < num_filters){
+      filters = 0;
+    }
+
+    if(filters > 0){
+      plan->num_chunks = (num_filters + filters - 1)/filters;
+      /* even out the chunks */
+      plan->chunk_filters = (num_filters + plan->num_chunks - 1)/plan->num_chunks;
+      plan->num_bands = (height + rows - 1)/rows;
+      plan->band_rows = (height + plan->num_bands - 1)/plan->num_bands;
+      plan->halo = plan->num_bands > 1 ? halo : 0;
+      return 0;
+    }
+    if(!split_rows || rows == 1){
+      return 1;
+    }
+    rows = (rows + 1)/2;
+  }
+}
+
+size_t budget_scratch(const struct gimc_budget *budget, const struct budget_plan *plan, size_t width, size_t height,
+  unsigned int num_filters, unsigned int filter_width){
+  /* the image, the bank, a band of the image, a chunk of the bank and a band of its results */
+  const size_t filter_bytes = sizeof(float)*filter_width*filter_width;
+  const size_t band_height = plan->num_bands > 1 ? min_size(height,plan->band_rows + 2*plan->halo) : height;
+  const size_t band_bytes = band_height*width;
+  size_t used = width*height + num_filters*filter_bytes + plan->chunk_filters*band_bytes;
+  used += plan->num_bands > 1 ? band_bytes : 0;
+  used += plan->num_chunks > 1 ? plan->chunk_filters*filter_bytes : 0;
+  return min_size(budget->device_bytes > used ? budget->device_bytes - used : 0,budget->max_alloc);
+}
+
+void budget_band(const struct budget_plan *plan, size_t height, size_t band, size_t *first, size_t *count,
+  size_t *convolved, size_t *convolved_count){
+  *first = band*plan->band_rows;
+  *count = min_size(plan->band_rows,height - *first);
+  *convolved = *first > plan->halo ? *first - plan->halo : 0;
+  *convolved_count = min_size(height,*first + *count + plan->halo) - *convolved;
+}
@@ -0,0 +1,74 @@
+/* memory budgets
+ * a result takes a plane of the image per filter, so a large image and bank
+ * may not fit on the device or the host at once. the tools split the bank
+ * into chunks of filters and the image into bands of rows which fit a
+ * budget, and write out the planes of a chunk while the next is computed.
+ * a band is convolved with the rows its filters reach above and below, so
+ * the rows it keeps are exact for engines which reach no further than the
+ * filter radius. needs no OpenCL, gimc_budget_device in engine.h fills a
+ * budget from the device
+ */
+
+#ifndef GIMC_BUDGET_H
+#define GIMC_BUDGET_H
+
+#include <stddef.h>
+
+/* share of the device global memory the tools plan for, the rest is left
+ * to the scratch buffers of the engines
+ */
+#define BUDGET_DEVICE_SHARE 0.75
+
+/* bytes the results, image and filters may take */
+struct gimc_budget{
+  size_t device_bytes; /* on the device */
+  size_t max_alloc; /* in a single device buffer */
+  size_t host_bytes; /* on the host, for results being read back and written */
+};
+
+/* how a result is computed within a budget, chunk by chunk and within
+ * each chunk band by band
+ */
+struct budget_plan{
+  unsigned int chunk_filters; /* filters per chunk, the last may have fewer */
+  unsigned int num_chunks;
+  size_t band_rows; /* rows kept per band, the last may have fewer */
+  size_t num_bands;
+  size_t halo; /* rows convolved above and below a band but not kept */
+};
+
+/* megabytes of GIMC_MEMORY_BUDGET, 0 if it isn't set */
+extern size_t budget_env_megabytes(void);
+
+/* half of the physical memory of the host */
+extern size_t budget_host_bytes(void);
+
+/* limit every field of budget to megabytes MiB, 0 leaves it as it is */
+extern void budget_limit(struct gimc_budget *budget,size_t megabytes);
+
+/* plan num_filters filters of filter_width on a width*height image
+ * results are double buffered on the host when there is more than one
+ * chunk, so one chunk is written while the next is computed. the device
+ * keeps the whole image, the bank, a chunk of it and a band of results.
+ * split_bank and split_rows allow more than one chunk and band, epilogues
+ * which combine filters need the whole bank and engines which reach past
+ * the filter radius need whole columns.
+ * prefers whole images and the largest chunks. returns nonzero if not
+ * even a single filter fits
+ */
+extern int budget_plan(const struct gimc_budget *budget,size_t width,size_t height,unsigned int num_filters,
+  unsigned int filter_width,int split_bank,int split_rows,struct budget_plan *plan);
+
+/* device bytes the budget leaves to the scratch buffers of the engines
+ * once the buffers of a plan are taken, at most its largest allocation
+ */
+extern size_t budget_scratch(const struct gimc_budget *budget,const struct budget_plan *plan,size_t width,size_t height,
+  unsigned int num_filters,unsigned int filter_width);
+
+/* rows first to first+count of band, and the rows around them which are
+ * convolved, from convolved to convolved+convolved_count
+ */
+extern void budget_band(const struct budget_plan *plan,size_t height,size_t band,size_t *first,size_t *count,
+  size_t *convolved,size_t *convolved_count);
+
+#endif
@@ -0,0 +1,134 @@
+/* dilated convolution and the à trous wavelet decomposition, see atrous.h
+ * dilated is built with the specialization of lwfilter.cl
+ */
+#ifdef FILTER_W
+#define UNROLL_FILTER _Pragma("unroll")
+#else
+#define UNROLL_FILTER
+#define FILTER_W filter_width
+#endif
+#ifndef IMAGE_W
+#define IMAGE_W image_width
+#endif
+#ifndef IMAGE_H
+#define IMAGE_H image_height
+#endif
+#ifndef NUM_FILTERS
+#define NUM_FILTERS num_filters
+#endif
+
+/* convolves an image with every filter of a bank, the taps of filter fid
+ * dilations[fid] pixels apart. otherwise as convolve2d of lwfilter.cl
+ * launched over {width*height, num_filters}
+ */
+__kernel
+void dilated(__global const unsigned char *image,
+  __global const float *filters,
+  __global const unsigned int *dilations,
+  __global unsigned char *result,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned int filter_width,
+  unsigned int num_filters)
+{
+  const int pixel = get_global_id(0);
+  const int fid = get_global_id(1);
+  if(pixel >= IMAGE_W*IMAGE_H || fid >= NUM_FILTERS){
+    return;
+  }
+  const int px = pixel % IMAGE_W;
+  const int py = pixel / IMAGE_W;
+  const int step = dilations[fid];
+  const int reach = (FILTER_W - 1)/2*step;
+  const unsigned int filter_len = FILTER_W*FILTER_W;
+  /* convolution uses the filter backwards, so index it from its last cell */
+  const unsigned int last = (fid + 1)*filter_len - 1;
+
+  float sum = 0;
+  UNROLL_FILTER
+  for(int fy = 0; fy < FILTER_W; ++fy){
+    const int row = py - reach + fy*step;
+    UNROLL_FILTER
+    for(int fx = 0; fx < FILTER_W; ++fx){
+      const int col = px - reach + fx*step;
+      if(row >= 0 && row < IMAGE_H && col >= 0 && col < IMAGE_W){
+        sum += image[row*IMAGE_W + col]*filters[last - (fy*FILTER_W + fx)];
+      }
+    }
+  }
+  result[fid*IMAGE_W*IMAGE_H + pixel] = convert_uchar_sat(sum);
+}
+
+/* must match atrous.h */
+#define ATROUS_TAPS 5
+#define ATROUS_DETAIL_OFFSET 128
+__constant float ATROUS_B3[ATROUS_TAPS] = {1.0f/16, 4.0f/16, 6.0f/16, 4.0f/16, 1.0f/16};
+
+long atrous_mirror(long i, long n)
+{
+  if(n == 1){
+    return 0;
+  }
+  const long period = 2*n - 2;
+  i = abs(i) % period;
+  return i < n ? i : period - i;
+}
+
+/* the pixels of an image as the first smoothing
+ * launched over {width*height}
+ */
+__kernel
+void atrous_load(__global const unsigned char *image,
+  __global float *smooth,
+  unsigned long image_size)
+{
+  const size_t i = get_global_id(0);
+  if(i < image_size){
+    smooth[i] = image[i];
+  }
+}
+
+/* smooths a plane along lines of length pixels along apart, the lines
+ * across apart, with the taps of the B3 spline step pixels apart
+ * launched over {length, lines}
+ */
+__kernel
+void atrous_smooth(__global const float *src,
+  __global float *dst,
+  unsigned long length,
+  unsigned long lines,
+  unsigned long along,
+  unsigned long across,
+  unsigned long step)
+{
+  const long x = get_global_id(0);
+  const long line = get_global_id(1);
+  if(x >= length || line >= lines){
+    return;
+  }
+  __global const float *source = src + line*across;
+  float sum = 0.0f;
+  for(long k = 0; k < ATROUS_TAPS; ++k){
+    sum += ATROUS_B3[k]*source[atrous_mirror(x + (k - ATROUS_TAPS/2)*(long)step,length)*along];
+  }
+  dst[line*across + x*along] = sum;
+}
+
+/* the detail between two smoothings into a plane of result, or the
+ * coarse smoothing itself for the residual
+ * launched over {width*height}
+ */
+__kernel
+void atrous_detail(__global const float *fine,
+  __global const float *coarse,
+  __global unsigned char *result,
+  unsigned long image_size,
+  unsigned long offset,
+  unsigned int residual)
+{
+  const size_t i = get_global_id(0);
+  if(i < image_size){
+    const float value = residual ? coarse[i] : fine[i] - coarse[i] + ATROUS_DETAIL_OFFSET;
+    result[offset + i] = convert_uchar_sat_rte(value);
+  }
+}
@@ -1,5 +1,30 @@
+/* compile time specialization
+ * the host may build this source with -DFILTER_W, -DFILTER_H, -DIMAGE_W,
+ * -DIMAGE_H and -DNUM_FILTERS, in which case the loops over the filter can be unrolled
+ * and the index arithmetic folds into constants.
+ * otherwise the names fall back to the kernel arguments.
+ */
+#ifdef FILTER_W
+#define UNROLL_FILTER _Pragma("unroll")
+#else
+#define UNROLL_FILTER
+#define FILTER_W filter_width
+#endif
+#ifndef FILTER_H
+#define FILTER_H filter_height
+#endif
+#ifndef IMAGE_W
+#define IMAGE_W image_width
+#endif
+#ifndef IMAGE_H
+#define IMAGE_H image_height
+#endif
+#ifndef NUM_FILTERS
+#define NUM_FILTERS num_filters
+#endif
+
 /* convolves an image with many filters
- * for simplicity all filters have the same size and are square
+ * all filters have the same size, odd but not necessarily square
  * image and result are assumed to be grayscale with a depth of 8 bits.
  */
 __kernel
@@ -15,37 +40,40 @@ void convolve2d(__constant unsigned char *image,
   int pixel = get_global_id(0); /* current pixel */
   int fid = get_global_id(1); /* index of filter */
 
-  if(pixel < (image_width*image_height) && fid < num_filters){
+  if(pixel < (IMAGE_W*IMAGE_H) && fid < NUM_FILTERS){
 
-    const int px = pixel % image_width;
-    const int py = ((pixel - px)/image_width);
-    const unsigned int image_size = image_width * image_height;
-    const unsigned long filter_len = filter_width * filter_height;
-    const int offset = (filter_len - 1)/2;
+    const int px = pixel % IMAGE_W;
+    const int py = pixel / IMAGE_W;
+    const unsigned int image_size = IMAGE_W * IMAGE_H;
+    const unsigned int filter_len = FILTER_W * FILTER_H;
     /* top left corner of filter window on image */
-    const int cornerx = px - offset;
-    const int cornery = py - offset;
+    const int cornerx = px - (FILTER_W - 1)/2;
+    const int cornery = py - (FILTER_H - 1)/2;
+
+    /* convolution uses the filter backwards, so index it from its last cell */
+    const unsigned int last = (fid + 1)*filter_len - 1;
 
     float sum = 0;
 
     /* iterate over the filter */
-    for(unsigned int i = 0; i < filter_len; ++i){
-      int col = (cornerx) + (i % filter_width);
-      int row = (cornery) + ((i -(i%filter_width))/filter_width);
-
-      /* zero the pixels if they are out of bounds */
-      float source;
-      if(row < 0 || row > image_height || col < 0 || col > image_width){
-        source = 0;
-      }else{
-        source = image[row*image_width + col];
-      }
+    UNROLL_FILTER
+    for(int fy = 0; fy < FILTER_H; ++fy){
+      const int row = cornery + fy;
+      UNROLL_FILTER
+      for(int fx = 0; fx < FILTER_W; ++fx){
+        const int col = cornerx + fx;
+
+        /* zero the pixels if they are out of bounds */
+        float source;
+        if(row < 0 || row >= IMAGE_H || col < 0 || col >= IMAGE_W){
+          source = 0;
+        }else{
+          source = image[row*IMAGE_W + col];
+        }
 
-      /* convolution uses the filter backwards */
-      const unsigned int findex = filter_len - i - 1 + fid*filter_len;
-      const float weight = filter[findex];
-      sum += source*weight;
+        sum += source*filter[last - (fy*FILTER_W + fx)];
+      }
     }
-    result[py*image_width + px + fid*image_size] = sum;
+    result[py*IMAGE_W + px + fid*image_size] = convert_uchar_sat(sum);
   }
 }
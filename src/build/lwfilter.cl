@@ -1,11 +1,82 @@
+/* compile time specialization
+ * the host may build this source with -DFILTER_W, -DFILTER_H, -DIMAGE_W,
+ * -DIMAGE_H and -DNUM_FILTERS, in which case the loops over the filter can be unrolled
+ * and the index arithmetic folds into constants.
+ * otherwise the names fall back to the kernel arguments.
+ */
+#ifdef FILTER_W
+#define UNROLL_FILTER _Pragma("unroll")
+#else
+#define UNROLL_FILTER
+#define FILTER_W filter_width
+#endif
+#ifndef FILTER_H
+#define FILTER_H filter_height
+#endif
+#ifndef IMAGE_W
+#define IMAGE_W image_width
+#endif
+#ifndef IMAGE_H
+#define IMAGE_H image_height
+#endif
+#ifndef NUM_FILTERS
+#define NUM_FILTERS num_filters
+#endif
+
+/* convolve the pixel at px,py with filter fid
+ * shared by the kernels below, the sizes are named as the kernel
+ * arguments so the specialization macros apply
+ */
+float convolve_pixel(__global unsigned char *image,
+  __global float *filter,
+  int px,
+  int py,
+  unsigned int fid,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned int filter_width,
+  unsigned int filter_height)
+{
+  const unsigned int filter_len = FILTER_W * FILTER_H;
+  /* top left corner of filter window on image */
+  const int cornerx = px - (FILTER_W - 1)/2;
+  const int cornery = py - (FILTER_H - 1)/2;
+
+  /* convolution uses the filter backwards, so index it from its last cell */
+  const unsigned int last = (fid + 1)*filter_len - 1;
+
+  float sum = 0;
+
+  /* iterate over the filter */
+  UNROLL_FILTER
+  for(int fy = 0; fy < FILTER_H; ++fy){
+    const int row = cornery + fy;
+    UNROLL_FILTER
+    for(int fx = 0; fx < FILTER_W; ++fx){
+      const int col = cornerx + fx;
+
+      /* zero the pixels if they are out of bounds */
+      float source;
+      if(row < 0 || row >= IMAGE_H || col < 0 || col >= IMAGE_W){
+        source = 0;
+      }else{
+        source = image[row*IMAGE_W + col];
+      }
+
+      sum += source*filter[last - (fy*FILTER_W + fx)];
+    }
+  }
+  return sum;
+}
+
 /* 1st kernel: convolves an image with many filters
- * for simplicity all filters have the same size and are square
- * image and result are assumed to be grayscale with a depth of 8 bits
+ * all filters have the same size, odd but not necessarily square
+ * image and result are assumed to be grayscale with a depth of 8 bits,
+ * sums are truncated and saturated as in native_convolve2d
  * image: buffer containing image to perform convolution on
  * filter: buffer containing bank of filters
  * result: buffer where resulting images are created
- * scratch: local workspace
- * image_width/height, filter_width: sizes of image and filters
+ * image_width/height, filter_width/height: sizes of image and filters
  * num_filters: number of filters in bank.
  */
  __kernel
@@ -15,46 +86,128 @@
    unsigned long image_width,
    unsigned long image_height,
    unsigned int filter_width,
+   unsigned int filter_height,
    unsigned int num_filters)
  {
    int pixel = get_global_id(0); /* current pixel */
    int fid = get_global_id(1); /* index of filter */
 
-   if(pixel < (image_width*image_height) && fid < num_filters){
+   if(pixel < (IMAGE_W*IMAGE_H) && fid < NUM_FILTERS){
+     const int px = pixel % IMAGE_W;
+     const int py = pixel / IMAGE_W;
+     const unsigned int image_size = IMAGE_W * IMAGE_H;
+     result[py*IMAGE_W + px + fid*image_size] =
+       convert_uchar_sat(convolve_pixel(image,filter,px,py,fid,image_width,image_height,filter_width,filter_height));
+   }
+ }
 
-     const int px = pixel % image_width;
-     const int py = ((pixel - px)/image_width);
-     const unsigned int image_size = image_width * image_height;
-     const unsigned long filter_len = filter_width * filter_width;
-     const int offset = (filter_len - 1)/2;
-     /* top left corner of filter window on image */
-     const int cornerx = px - offset;
-     const int cornery = py - offset;
+/* convolves a rectangle of an image with many filters
+ * same arguments as convolve2d for square filters, without filter_height, launched over {width, height, num_filters}
+ * of the rectangle with its top left corner as the global offset, so
+ * parts of a result can be recomputed
+ */
+ __kernel
+ void convolve2d_rect(__global unsigned char *image,
+   __global float *filter,
+   __global unsigned char *result,
+   unsigned long image_width,
+   unsigned long image_height,
+   unsigned int filter_width,
+   unsigned int num_filters)
+ {
+   const int px = get_global_id(0);
+   const int py = get_global_id(1);
+   const int fid = get_global_id(2);
 
-     float sum = 0;
+   if(px < IMAGE_W && py < IMAGE_H && fid < NUM_FILTERS){
+     const unsigned int image_size = IMAGE_W * IMAGE_H;
+     result[py*IMAGE_W + px + fid*image_size] =
+       convert_uchar_sat(convolve_pixel(image,filter,px,py,fid,image_width,image_height,filter_width,filter_width));
+   }
+ }
 
-     /* iterate over the filter */
-     for(unsigned int i = 0; i < filter_len; ++i){
-       int col = (cornerx) + (i % filter_width);
-       int row = (cornery) + ((i -(i%filter_width))/filter_width);
-
-       /* zero the pixels if they are out of bounds */
-       float source;
-       if(row < 0 || row > image_height || col < 0 || col > image_width){
-         source = 0;
-       }else{
-         source = image[row*image_width + col];
+
+/* epilogue reductions, enum epilogue_reduce in epilogue.h */
+#define EPILOGUE_KEEP 0
+#define EPILOGUE_MAX 1
+#define EPILOGUE_MIN 2
+#define EPILOGUE_ARGMAX 3
+
+/* the last stages of an epilogue, scale and offset then a threshold or a
+ * saturating conversion
+ */
+unsigned char epilogue_output(float value,
+  float scale,
+  float offset,
+  unsigned int thresholded,
+  float threshold,
+  unsigned int round)
+{
+  value = scale*value + offset;
+  if(thresholded){
+    return value >= threshold ? 255 : 0;
+  }
+  return round ? convert_uchar_sat_rte(value) : convert_uchar_sat(value);
+}
+
+/* convolves a pixel with every filter and applies an epilogue to the sums
+ * same arguments as convolve2d followed by the fields of gimc_epilogue,
+ * launched over the pixels. result receives the planes the epilogue leaves
+ */
+ __kernel
+ void convolve2d_epilogue(__global unsigned char *image,
+   __global float *filter,
+   __global unsigned char *result,
+   unsigned long image_width,
+   unsigned long image_height,
+   unsigned int filter_width,
+   unsigned int num_filters,
+   unsigned int difference,
+   unsigned int reduce,
+   float scale,
+   float offset,
+   unsigned int thresholded,
+   float threshold,
+   unsigned int round)
+ {
+   const int pixel = get_global_id(0);
+   if(pixel >= IMAGE_W*IMAGE_H){
+     return;
+   }
+   const int px = pixel % IMAGE_W;
+   const int py = pixel / IMAGE_W;
+   const unsigned int image_size = IMAGE_W * IMAGE_H;
+
+   /* differences lag a filter behind */
+   float previous = 0.0f;
+   float best = 0.0f;
+   unsigned int best_plane = 0;
+   unsigned int plane = 0;
+   for(unsigned int fid = 0; fid < NUM_FILTERS; ++fid){
+     const float sum = convolve_pixel(image,filter,px,py,fid,image_width,image_height,filter_width,filter_width);
+     float value = sum;
+     if(difference){
+       value = previous - sum;
+       previous = sum;
+       if(fid == 0){
+         continue;
        }
+     }
 
-       /* convolution uses the filter backwards */
-       const unsigned int findex = filter_len - i - 1 + fid*filter_len;
-       const float weight = filter[findex];
-       sum += source*weight;
+     if(reduce == EPILOGUE_KEEP){
+       result[plane*image_size + pixel] = epilogue_output(value,scale,offset,thresholded,threshold,round);
+     }else if(plane == 0 || (reduce == EPILOGUE_MIN ? value < best : value > best)){
+       best = value;
+       best_plane = plane;
      }
-     result[py*image_width + px + fid*image_size] = sum;
+     ++plane;
    }
- }
 
+   if(plane > 0 && reduce != EPILOGUE_KEEP){
+     result[pixel] = epilogue_output(reduce == EPILOGUE_ARGMAX ? (float)best_plane : best,
+       scale,offset,thresholded,threshold,round);
+   }
+ }
 
  /* create a gaussian filter bank in the bank buffer
   * bank: buffer to create bank in
@@ -73,7 +226,8 @@
 
    const unsigned long filter_len = filter_width*filter_width;
    if(filter < num_filters && cell < filter_len){
-     const float sigma = (filter + 1) * 25.0/num_filters;
+     /* same schedule as filter_Gauss2dbank in filter.c */
+     const float sigma = (filter + 1) * 25.0f/num_filters;
      const int offset = (filter_width - 1)/2;
      int y = (cell % filter_width);
      int x = ((cell - y)/filter_width);
@@ -81,7 +235,7 @@
      x -= offset;
 
 
-     const float value = (1.0/(2*M_PI_F*sigma*sigma)) * (exp(-(x*x + y*y)/(2.0*sigma*sigma)));
+     const float value = (1.0f/(2*M_PI_F*sigma*sigma)) * (exp(-(x*x + y*y)/(2.0f*sigma*sigma)));
 
      bank[filter_len*filter + cell] = value;
    }
@@ -0,0 +1,175 @@
+/* compile time specialization
+ * the host may build this source with -DFILTER_W, -DIMAGE_W, -DIMAGE_H and
+ * -DNUM_FILTERS, in which case the index arithmetic folds into constants.
+ * taps are split across work items, so no loop has a fixed trip count to
+ * unroll. otherwise the names fall back to the kernel arguments.
+ */
+#ifndef FILTER_W
+#define FILTER_W filter_width
+#endif
+#ifndef IMAGE_W
+#define IMAGE_W image_width
+#endif
+#ifndef IMAGE_H
+#define IMAGE_H image_height
+#endif
+#ifndef NUM_FILTERS
+#define NUM_FILTERS num_filters
+#endif
+
+/* 1st kernel: convolves an image with many filters in a single pass
+ * for simplicity all filters have the same size and are square
+ * image and result are assumed to be grayscale with a depth of 8 bits
+ * a work group covers a small block of pixels of one filter. the taps of
+ * each pixel are split across the lanes of the first dimension and the
+ * partial sums are reduced in local memory, so the final value is written
+ * straight to the result without a second kernel.
+ * the number of lanes has to be a power of two
+ * image: buffer containing image to perform convolution on
+ * filter: buffer containing bank of filters
+ * result: buffer where resulting images are created
+ * scratch: local workspace, one float per work item
+ * fwork: local copy of the filter, filter_width*filter_width floats
+ * image_width/height, filter_width: sizes of image and filters
+ * num_filters: number of filters in bank.
+ */
+__kernel
+void convolve2d(__global unsigned char *image,
+  __global float *filter,
+  __global unsigned char *result,
+  __local float *scratch,
+  __local float *fwork,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned int filter_width,
+  unsigned int num_filters)
+{
+  const unsigned int lane = get_local_id(0); /* lane splitting the taps */
+  const unsigned int lanes = get_local_size(0);
+  const unsigned int pixel = get_global_id(1); /* current pixel */
+  const unsigned int fid = get_global_id(2); /* index of filter in bank */
+
+  const unsigned int lid = get_local_id(1)*lanes + lane;
+  const unsigned int group_size = lanes*get_local_size(1);
+
+  const unsigned int filter_len = FILTER_W * FILTER_W;
+  const unsigned int image_size = IMAGE_W * IMAGE_H;
+
+  /* the whole group shares one filter, load it into local memory */
+  for(unsigned int i = lid; i < filter_len; i += group_size){
+    fwork[i] = filter[i + fid*filter_len];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  float sum = 0.0f;
+  if(pixel < image_size && fid < NUM_FILTERS){
+    const int px = pixel % IMAGE_W;
+    const int py = pixel / IMAGE_W;
+    const int radius = (FILTER_W - 1)/2;
+    /* top left corner of filter window on image */
+    const int cornerx = px - radius;
+    const int cornery = py - radius;
+
+    /* each lane visits every lanes'th tap, adjacent lanes read adjacent pixels */
+    int fx = lane % FILTER_W;
+    int fy = lane / FILTER_W;
+    const int step_x = lanes % FILTER_W;
+    const int step_y = lanes / FILTER_W;
+
+    for(unsigned int i = lane; i < filter_len; i += lanes){
+      const int col = cornerx + fx;
+      const int row = cornery + fy;
+
+      /* zero the pixels if they are out of bounds */
+      float source;
+      if(row < 0 || row >= IMAGE_H || col < 0 || col >= IMAGE_W){
+        source = 0.0f;
+      }else{
+        source = image[row*IMAGE_W + col];
+      }
+
+      /* convolution uses the filter backwards */
+      sum += source*fwork[filter_len - i - 1];
+
+      fx += step_x;
+      fy += step_y;
+      if(fx >= FILTER_W){
+        fx -= FILTER_W;
+        ++fy;
+      }
+    }
+  }
+  scratch[lid] = sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  /* perform commutative reduction across the lanes of each pixel */
+  for(unsigned int offset = lanes / 2; offset > 0; offset >>= 1){
+    if(lane < offset){
+      scratch[lid] += scratch[lid + offset];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  /* first lane writes the final value of its pixel */
+  if(lane == 0 && pixel < image_size){
+    result[pixel + fid*image_size] = convert_uchar_sat(scratch[lid]);
+  }
+}
+
+
+/* create a gaussian filter bank in the bank buffer
+ * bank: buffer to create bank in
+ * num_filters: number of filters to create
+ * filter_wiwdth: size of filters
+ * 2 dimensional, first dimension is the filter
+ * second dimension is the cell of that filter
+ */
+__kernel
+void filter_Gauss2dbank(__global float *bank,
+  unsigned int num_filters,
+  unsigned int filter_width)
+{
+  const unsigned int filter = get_global_id(0);
+  const unsigned int cell = get_global_id(1);
+
+  const unsigned long filter_len = filter_width*filter_width;
+  if(filter < num_filters && cell < filter_len){
+    /* same schedule as filter_Gauss2dbank in filter.c */
+    const float sigma = (filter + 1) * 25.0f/num_filters;
+    const int offset = (filter_width - 1)/2;
+    int y = (cell % filter_width);
+    int x = ((cell - y)/filter_width);
+    y -= offset;
+    x -= offset;
+
+
+    const float value = (1.0f/(2*M_PI_F*sigma*sigma)) * (exp(-(x*x + y*y)/(2.0f*sigma*sigma)));
+
+    bank[filter_len*filter + cell] = value;
+  }
+}
+
+/* normalize a filter so that all values sum up to 1
+ * bank: buffer which filters reside in
+ * num_filters: maximum number of filters in bank
+ * filter_width: side lengths of filters
+ */
+__kernel
+void filter_normalize(__global float *bank,
+  unsigned int num_filters,
+  unsigned int filter_width)
+{
+  const unsigned int filter = get_global_id(0);
+  const unsigned int filter_len = filter_width*filter_width;
+
+  if(filter < num_filters){
+    float sum = 0;
+    for(unsigned int i = 0; i < filter_len; ++i){
+      sum += bank[filter_len*filter+i];
+    }
+
+    for(unsigned int i = 0; i < filter_len; ++i){
+      bank[filter_len*filter+i] = bank[filter_len*filter+i] / sum;
+    }
+  }
+}
@@ -1,3 +1,22 @@
+/* compile time specialization
+ * the host may build this source with -DFILTER_W, -DIMAGE_W, -DIMAGE_H and
+ * -DNUM_FILTERS, in which case the index arithmetic folds into constants.
+ * taps are split across work items, so no loop has a fixed trip count to
+ * unroll. otherwise the names fall back to the kernel arguments.
+ */
+#ifndef FILTER_W
+#define FILTER_W filter_width
+#endif
+#ifndef IMAGE_W
+#define IMAGE_W image_width
+#endif
+#ifndef IMAGE_H
+#define IMAGE_H image_height
+#endif
+#ifndef NUM_FILTERS
+#define NUM_FILTERS num_filters
+#endif
+
 /* 1st kernel: convolves an image with many filters
  * for simplicity all filters have the same size and are square
  * image and result are assumed to be grayscale with a depth of 8 bits
@@ -28,8 +47,8 @@ void convolve2d(__global unsigned char *image,
   const unsigned int lid = get_local_id(2);
   const unsigned int local_size = get_local_size(2);
 
-  const unsigned int filter_len = filter_width * filter_width;
-  const unsigned int image_size = image_width * image_height;
+  const unsigned int filter_len = FILTER_W * FILTER_W;
+  const unsigned int image_size = IMAGE_W * IMAGE_H;
   const unsigned int chunk_size = filter_len < local_size ? filter_len : filter_len/local_size;
 
   /* get work size */
@@ -48,34 +67,45 @@ void convolve2d(__global unsigned char *image,
   }
   barrier(CLK_LOCAL_MEM_FENCE);
 
-  if(pixel < (image_width*image_height) && fid < num_filters){
+  if(pixel < (IMAGE_W*IMAGE_H) && fid < NUM_FILTERS){
 
-    const int px = pixel % image_width;
-    const int py = ((pixel - px)/image_width);
-    const int offset = (filter_len - 1)/2;
+    const int px = pixel % IMAGE_W;
+    const int py = pixel / IMAGE_W;
+    const int radius = (FILTER_W - 1)/2;
     /* top left corner of filter window on image */
-    const int cornerx = px - offset;
-    const int cornery = py - offset;
+    const int cornerx = px - radius;
+    const int cornery = py - radius;
 
     float sum = 0.0f;
 
+    /* position of the first cell of this chunk in the filter, stepped
+     * incrementally so the loop carries no division or modulo
+     */
+    int fx = start % FILTER_W;
+    int fy = start / FILTER_W;
+
     /* iterate over the filter */
     for(unsigned int i = start; i < end && i < filter_len; ++i){
-      int col = (cornerx) + (i % filter_width);
-      int row = (cornery) + ((i -(i%filter_width))/filter_width);
+      const int col = cornerx + fx;
+      const int row = cornery + fy;
 
       /* zero the pixels if they are out of bounds */
       float source;
-      if(row < 0 || row > image_height || col < 0 || col > image_width){
+      if(row < 0 || row >= IMAGE_H || col < 0 || col >= IMAGE_W){
         source = 0.0f;
-        }else{
-          source = image[row*image_width + col];
-        }
-
-        /* convolution uses the filter backwards */
-        const unsigned int findex = filter_len - i - 1;
-        const float weight = fwork[findex];
-        sum += source*weight;
+      }else{
+        source = image[row*IMAGE_W + col];
+      }
+
+      /* convolution uses the filter backwards */
+      const unsigned int findex = filter_len - i - 1;
+      const float weight = fwork[findex];
+      sum += source*weight;
+
+      if(++fx == FILTER_W){
+        fx = 0;
+        ++fy;
+      }
     }
     scratch[lid] = sum;
   }
@@ -92,7 +122,7 @@ void convolve2d(__global unsigned char *image,
 
   /* send final result up */
   if(lid == 0){
-    result[pixel + fid*image_size] = scratch[0];
+    result[pixel + fid*image_size] = convert_uchar_sat(scratch[0]);
   }
 }
 
@@ -114,7 +144,8 @@ void filter_Gauss2dbank(__global float *bank,
 
   const unsigned long filter_len = filter_width*filter_width;
   if(filter < num_filters && cell < filter_len){
-    const float sigma = (filter + 1) * 25.0/num_filters;
+    /* same schedule as filter_Gauss2dbank in filter.c */
+    const float sigma = (filter + 1) * 25.0f/num_filters;
     const int offset = (filter_width - 1)/2;
     int y = (cell % filter_width);
     int x = ((cell - y)/filter_width);
@@ -122,7 +153,7 @@ void filter_Gauss2dbank(__global float *bank,
     x -= offset;
 
 
-    const float value = (1.0/(2*M_PI_F*sigma*sigma)) * (exp(-(x*x + y*y)/(2.0*sigma*sigma)));
+    const float value = (1.0f/(2*M_PI_F*sigma*sigma)) * (exp(-(x*x + y*y)/(2.0f*sigma*sigma)));
 
     bank[filter_len*filter + cell] = value;
   }
@@ -1,3 +1,22 @@
+/* compile time specialization
+ * the host may build this source with -DFILTER_W, -DIMAGE_W, -DIMAGE_H and
+ * -DNUM_FILTERS, in which case the index arithmetic folds into constants.
+ * taps are split across work items, so no loop has a fixed trip count to
+ * unroll. otherwise the names fall back to the kernel arguments.
+ */
+#ifndef FILTER_W
+#define FILTER_W filter_width
+#endif
+#ifndef IMAGE_W
+#define IMAGE_W image_width
+#endif
+#ifndef IMAGE_H
+#define IMAGE_H image_height
+#endif
+#ifndef NUM_FILTERS
+#define NUM_FILTERS num_filters
+#endif
+
 /* 1st kernel: convolves an image with many filters
  * for simplicity all filters have the same size and are square
  * image and result are assumed to be grayscale with a depth of 8 bits
@@ -28,29 +47,29 @@ void convolve2d(__global unsigned char *image,
   const unsigned int lf = get_local_id(1);
   const unsigned int lc = get_local_id(2);
 
-  const unsigned int filter_len = filter_width * filter_height;
-  const unsigned int image_size = image_width * image_height;
+  const unsigned int filter_len = FILTER_W * FILTER_W;
+  const unsigned int image_size = IMAGE_W * IMAGE_H;
 
   scratch[lc] = 0.0;
   barrier(CLK_LOCAL_MEM_FENCE);
 
-  if(pixel < image_size && fid < num_filters && fcell < filter_len){
-    const int px = pixel % image_width;
-    const int py = ((pixel - px)/image_width);
-    const int offset = (filter_len - 1)/2;
+  if(pixel < image_size && fid < NUM_FILTERS && fcell < filter_len){
+    const int px = pixel % IMAGE_W;
+    const int py = pixel / IMAGE_W;
+    const int radius = (FILTER_W - 1)/2;
     /* top left corner of filter window on image */
-    const int cornerx = px - offset;
-    const int cornery = py - offset;
+    const int cornerx = px - radius;
+    const int cornery = py - radius;
 
-    const int col = (cornerx) + (fcell % filter_width);
-    const int row = (cornery) + ((fcell - (fcell %filter_width))/filter_width);
+    const int col = cornerx + (fcell % FILTER_W);
+    const int row = cornery + (fcell / FILTER_W);
 
     /* zero the pixels if they are out of bounds */
     float source;
-    if(row < 0 || row > image_height || col < 0 || col > image_width){
+    if(row < 0 || row >= IMAGE_H || col < 0 || col >= IMAGE_W){
       source = 0;
     }else{
-      source = image[row*image_width+col];
+      source = image[row*IMAGE_W+col];
     }
     const unsigned int findex = filter_len - fcell - 1 + fid*filter_len;
     const float weight = filter[findex];
@@ -67,9 +86,12 @@ void convolve2d(__global unsigned char *image,
     barrier(CLK_LOCAL_MEM_FENCE);
   }
 
-  /* first thread in workgroup sends partial sum up */
+  /* first thread in workgroup sends partial sum up
+   * partial sums are grouped by pixel of the workload, then filter
+   */
   if(lc == 0){
-    psum[pixel - get_global_offset(0) + get_group_id(2)] = scratch[0];
+    const unsigned int local_pixel = pixel - get_global_offset(0);
+    psum[(local_pixel*get_global_size(1) + fid)*get_num_groups(2) + get_group_id(2)] = scratch[0];
   }
 }
 
@@ -78,7 +100,7 @@ void convolve2d(__global unsigned char *image,
  * psum: buffer of partial sums from first kernel
  * result: buffer to put result of convolution into
  * image_width, image_height: dimensions of image
- * psum_per_pixel: amount of partial sums which correspond to each pixel in result
+ * psum_per_pixel: amount of partial sums which correspond to each pixel of each filter in result
  */
 __kernel
 void convolve2d_reduce(__global float *psum,
@@ -94,11 +116,13 @@ void convolve2d_reduce(__global float *psum,
 
   if(pixel < image_size){
     float sum = 0.0;
+    /* partial sums of this pixel and filter, laid out as in convolve2d */
+    const unsigned long first = (offset*get_global_size(1) + fid)*psum_per_pixel;
     for(unsigned int i = 0; i < psum_per_pixel; ++i){
-      sum += psum[offset*psum_per_pixel + i];
+      sum += psum[first + i];
     }
     //printf("%u %u\n",pixel,fid*image_size);
-    result[pixel + fid*image_size] = sum;
+    result[pixel + fid*image_size] = convert_uchar_sat(sum);
   }
 }
 
@@ -120,14 +144,15 @@ void filter_Gauss2dbank(__global float *bank,
 
   const unsigned long filter_len = filter_width*filter_width;
   if(filter < num_filters && cell < filter_len){
-    const float sigma = (filter + 1) * 25.0/num_filters;
+    /* same schedule as filter_Gauss2dbank in filter.c */
+    const float sigma = (filter + 1) * 25.0f/num_filters;
     const int offset = (filter_width - 1)/2;
     int y = (cell % filter_width);
     int x = ((cell - y)/filter_width);
     y -= offset;
     x -= offset;
 
-    const float value = (1.0/(2*M_PI_F*sigma*sigma)) * (exp(-(x*x + y*y)/(2.0*sigma*sigma)));
+    const float value = (1.0f/(2*M_PI_F*sigma*sigma)) * (exp(-(x*x + y*y)/(2.0f*sigma*sigma)));
 
     bank[filter_len*filter + cell] = value;
   }
@@ -0,0 +1,138 @@
+/* multi-rate convolution
+ * levels are float planes of the image filtered and decimated by 2 as
+ * often as needed, with (1,3,3,1)/8 along each axis, which keeps where
+ * the mass of every pixel is. pixels outside the image are zero, the
+ * taps reach LEVEL_MARGIN cells past a level's width*height, so levels
+ * are stored with that margin on every side. a shrunken filter is
+ * applied to a level with one cell of margin around it, so results can
+ * be interpolated up to the borders of the image. see multirate.h
+ */
+#define LEVEL_MARGIN 2
+
+/* level of factor 1, the image as floats
+ * launched over {image_width+2*LEVEL_MARGIN, image_height+2*LEVEL_MARGIN}
+ */
+__kernel
+void level_from_image(__global unsigned char *image,
+  __global float *level,
+  unsigned long image_width,
+  unsigned long image_height)
+{
+  const size_t x = get_global_id(0);
+  const size_t y = get_global_id(1);
+  const size_t level_width = image_width + 2*LEVEL_MARGIN;
+  if(x < level_width && y < image_height + 2*LEVEL_MARGIN){
+    const long px = (long)x - LEVEL_MARGIN;
+    const long py = (long)y - LEVEL_MARGIN;
+    const int inside = px >= 0 && py >= 0 && px < image_width && py < image_height;
+    level[y*level_width + x] = inside ? image[py*image_width + px] : 0.0f;
+  }
+}
+
+/* cell x,y of a level of width*height cells, zero outside of its margin */
+float level_at(__global float *level, long width, long height, long x, long y)
+{
+  if(x < -LEVEL_MARGIN || y < -LEVEL_MARGIN || x >= width + LEVEL_MARGIN || y >= height + LEVEL_MARGIN){
+    return 0.0f;
+  }
+  return level[(y + LEVEL_MARGIN)*(width + 2*LEVEL_MARGIN) + x + LEVEL_MARGIN];
+}
+
+/* the next level, cell i,j is the (1,3,3,1)/8 weighted sum of cells
+ * 2i-1..2i+2, 2j-1..2j+2 of fine
+ * launched over the coarse level with its margin, coarse sizes are half
+ * the fine ones rounded up
+ */
+__kernel
+void decimate(__global float *fine,
+  __global float *coarse,
+  unsigned long fine_width,
+  unsigned long fine_height,
+  unsigned long coarse_width,
+  unsigned long coarse_height)
+{
+  const size_t x = get_global_id(0);
+  const size_t y = get_global_id(1);
+  const size_t stored_width = coarse_width + 2*LEVEL_MARGIN;
+  if(x < stored_width && y < coarse_height + 2*LEVEL_MARGIN){
+    const float taps[4] = {0.125f, 0.375f, 0.375f, 0.125f};
+    const long i = (long)x - LEVEL_MARGIN;
+    const long j = (long)y - LEVEL_MARGIN;
+    float sum = 0.0f;
+    for(int b = 0; b < 4; ++b){
+      float row = 0.0f;
+      for(int a = 0; a < 4; ++a){
+        row += taps[a]*level_at(fine,fine_width,fine_height,2*i - 1 + a,2*j - 1 + b);
+      }
+      sum += taps[b]*row;
+    }
+    coarse[y*stored_width + x] = sum;
+  }
+}
+
+/* a shrunken filter over a level, launched over {level_width+2, level_height+2}
+ * cell x,y of filtered is centered on x-1,y-1 of the level
+ * weights: filter_width*filter_width from weights_offset, not backwards
+ */
+__kernel
+void convolve_level(__global float *level,
+  __global float *weights,
+  __global float *filtered,
+  unsigned long level_width,
+  unsigned long level_height,
+  unsigned int filter_width,
+  unsigned int weights_offset)
+{
+  const size_t x = get_global_id(0);
+  const size_t y = get_global_id(1);
+  const size_t filtered_width = level_width + 2;
+  if(x < filtered_width && y < level_height + 2){
+    const long radius = (filter_width - 1)/2;
+    const long cx = (long)x - 1 - radius;
+    const long cy = (long)y - 1 - radius;
+    __global float *filter = weights + weights_offset;
+
+    float sum = 0.0f;
+    for(long v = 0; v < filter_width; ++v){
+      for(long u = 0; u < filter_width; ++u){
+        sum += filter[v*filter_width + u]*level_at(level,level_width,level_height,cx + u,cy + v);
+      }
+    }
+    filtered[y*filtered_width + x] = sum;
+  }
+}
+
+/* interpolate filtered bilinearly to the plane of filter fid in result
+ * launched over {image_width, image_height}, the center of level cell i
+ * is at pixel i*factor + (factor-1)/2
+ */
+__kernel
+void upsample(__global float *filtered,
+  __global unsigned char *result,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned long level_width,
+  unsigned int factor,
+  unsigned int fid)
+{
+  const size_t px = get_global_id(0);
+  const size_t py = get_global_id(1);
+  if(px < image_width && py < image_height){
+    const float tx = (px + 0.5f)/factor - 0.5f;
+    const float ty = (py + 0.5f)/factor - 0.5f;
+    const float fx = floor(tx);
+    const float fy = floor(ty);
+    const float ax = tx - fx;
+    const float ay = ty - fy;
+
+    /* cell i of the level is cell i+1 of filtered */
+    const size_t filtered_width = level_width + 2;
+    const size_t i = (long)fx + 1;
+    const size_t j = (long)fy + 1;
+    const float top = (1.0f - ax)*filtered[j*filtered_width + i] + ax*filtered[j*filtered_width + i + 1];
+    const float bottom = (1.0f - ax)*filtered[(j + 1)*filtered_width + i] + ax*filtered[(j + 1)*filtered_width + i + 1];
+
+    const size_t image_size = image_width*image_height;
+    result[py*image_width + px + fid*image_size] = convert_uchar_sat((1.0f - ay)*top + ay*bottom);
+  }
+}
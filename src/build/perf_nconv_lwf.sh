@@ -15,3 +15,28 @@ for i in {1..49..4}
 do
   /usr/bin/time -f "%e" ./Nconv_lwf ../Black-Star-hen.jpg 1 $i 49 2>> gvf_lwf.txt
 done
+
+#gpu vary width, fused reduction
+>gvw_lwf_f.txt
+for i in {3..49..2}
+do
+  /usr/bin/time -f "%e" ./Nconv_lwf_f ../Black-Star-hen.jpg 1 1 $i 2>> gvw_lwf_f.txt
+done
+
+#gpu vary number of filters, fused reduction
+>gvf_lwf_f.txt
+for i in {1..49..4}
+do
+  /usr/bin/time -f "%e" ./Nconv_lwf_f ../Black-Star-hen.jpg 1 $i 49 2>> gvf_lwf_f.txt
+done
+
+#gpu vary number of small filters, minimal filtering against lwf
+>gvf_winograd.txt
+for w in 3 5
+do
+  for i in {1..49..4}
+  do
+    /usr/bin/time -f "%e" ./Nconv_winograd ../Black-Star-hen.jpg 1 $i $w 2>> gvf_winograd.txt
+    /usr/bin/time -f "%e" ./Nconv_lwf ../Black-Star-hen.jpg 1 $i $w 2>> gvf_winograd.txt
+  done
+done
@@ -0,0 +1,17 @@
+#/bin/sh
+# place every engine on a roofline for a sweep of filter widths
+# we reset the file before taking measurements
+
+#gpu vary width
+>roofline_gvw.txt
+for i in {3..49..2}
+do
+  ./Roofline ../Black-Star-hen.jpg 1 1 $i >> roofline_gvw.txt
+done
+
+#gpu vary number of filters
+>roofline_gvf.txt
+for i in {1..49..4}
+do
+  ./Roofline ../Black-Star-hen.jpg 1 $i 49 >> roofline_gvf.txt
+done
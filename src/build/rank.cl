@@ -0,0 +1,182 @@
+/* rank filters, see rank.h
+ * minimum and maximum are two passes of van Herk/Gil-Werman along the rows
+ * and then the columns, the median one pass of sliding histograms over
+ * strips of the image
+ */
+
+/* must match enum rank_op in rank.h */
+#define RANK_MIN 0
+#define RANK_MAX 1
+
+unsigned char rank_pick(unsigned char a, unsigned char b, unsigned int op)
+{
+  return op == RANK_MAX ? max(a,b) : min(a,b);
+}
+
+/* value at padded position p of a line, the identity of op outside it */
+unsigned char rank_padded(__global const unsigned char *line,
+  long p,
+  ulong length,
+  ulong along,
+  unsigned int radius,
+  unsigned int op)
+{
+  const long x = p - (long)radius;
+  if(x < 0 || x >= (long)length){
+    return op == RANK_MAX ? 0 : 255;
+  }
+  return line[x*along];
+}
+
+/* running extremes from both ends of a block of a line
+ * src: lines of length pixels along apart, the lines across apart
+ * prefix, suffix: length+2*radius per line
+ * launched over {blocks per padded line, lines}
+ */
+__kernel
+void vhgw_blocks(__global const unsigned char *src,
+  __global unsigned char *prefix,
+  __global unsigned char *suffix,
+  ulong length,
+  ulong lines,
+  ulong along,
+  ulong across,
+  unsigned int radius,
+  unsigned int op)
+{
+  const ulong window = 2*radius + 1;
+  const ulong padded = length + 2*radius;
+  const ulong start = get_global_id(0)*window;
+  const ulong line = get_global_id(1);
+  if(start >= padded || line >= lines){
+    return;
+  }
+  const ulong end = min(start + window,padded);
+  __global const unsigned char *source = src + line*across;
+  __global unsigned char *first = prefix + line*padded;
+  __global unsigned char *last = suffix + line*padded;
+
+  unsigned char extreme = rank_padded(source,start,length,along,radius,op);
+  first[start] = extreme;
+  for(ulong p = start + 1; p < end; ++p){
+    extreme = rank_pick(extreme,rank_padded(source,p,length,along,radius,op),op);
+    first[p] = extreme;
+  }
+  extreme = rank_padded(source,end - 1,length,along,radius,op);
+  last[end - 1] = extreme;
+  for(ulong p = end - 1; p-- > start;){
+    extreme = rank_pick(extreme,rank_padded(source,p,length,along,radius,op),op);
+    last[p] = extreme;
+  }
+}
+
+/* every window of a line from the two extremes which meet in it
+ * dst: offset, then lines as src of vhgw_blocks
+ * launched over {length, lines}
+ */
+__kernel
+void vhgw_window(__global const unsigned char *prefix,
+  __global const unsigned char *suffix,
+  __global unsigned char *dst,
+  ulong length,
+  ulong lines,
+  ulong along,
+  ulong across,
+  unsigned int radius,
+  unsigned int op,
+  ulong offset)
+{
+  const ulong x = get_global_id(0);
+  const ulong line = get_global_id(1);
+  if(x >= length || line >= lines){
+    return;
+  }
+  const ulong padded = length + 2*radius;
+  dst[offset + line*across + x*along] = rank_pick(suffix[line*padded + x],prefix[line*padded + x + 2*radius],op);
+}
+
+/* lower median of the window of every pixel of a strip
+ * columns: per work item, a histogram of bytes for each of the
+ * strip+2*radius columns the strip's windows cover
+ * window: per work item, the histogram of a window
+ * result: offset, then a plane
+ * launched over {strips across, strips down}, strips are strip pixels wide
+ * and band pixels high
+ */
+__kernel
+void median_strips(__global const unsigned char *image,
+  __global unsigned char *result,
+  __global unsigned char *columns,
+  __global unsigned int *window,
+  ulong image_width,
+  ulong image_height,
+  unsigned int radius,
+  unsigned int strip,
+  unsigned int band,
+  ulong offset)
+{
+  const long sx = get_global_id(0)*strip;
+  const long sy = get_global_id(1)*band;
+  const long width = image_width;
+  const long height = image_height;
+  if(sx >= width || sy >= height){
+    return;
+  }
+  const long r = radius;
+  const long covered = strip + 2*radius;
+  const size_t item = get_global_id(1)*get_global_size(0) + get_global_id(0);
+  __global unsigned char *hist = columns + item*covered*256;
+  __global unsigned int *counts = window + item*256;
+  const long x0 = sx - r; /* image column of the first histogram */
+  const long x_end = min(sx + (long)strip,width);
+  const long y_end = min(sy + (long)band,height);
+
+  for(long i = 0; i < covered*256; ++i){
+    hist[i] = 0;
+  }
+  for(long y = sy; y < y_end; ++y){
+    /* slide the column histograms down to rows y-r to y+r */
+    const long first_row = y == sy ? max(sy - r,0L) : y + r;
+    const long last_row = min(y + r,height - 1);
+    for(long c = 0; c < covered; ++c){
+      const long x = x0 + c;
+      if(x < 0 || x >= width){
+        continue;
+      }
+      if(y > sy && y - r - 1 >= 0){
+        --hist[c*256 + image[(y - r - 1)*width + x]];
+      }
+      for(long row = first_row; row <= last_row; ++row){
+        ++hist[c*256 + image[row*width + x]];
+      }
+    }
+    const long rows = last_row - max(y - r,0L) + 1;
+
+    /* then the window along the row, from the histograms of columns sx-r to sx+r */
+    for(int v = 0; v < 256; ++v){
+      unsigned int count = 0;
+      for(long c = 0; c <= 2*r; ++c){
+        count += hist[c*256 + v];
+      }
+      counts[v] = count;
+    }
+    for(long x = sx; x < x_end; ++x){
+      if(x > sx){
+        /* columns x-r-1 and x+r are histograms x-sx-1 and x-sx+2r */
+        __global const unsigned char *removed = hist + (x - sx - 1)*256;
+        __global const unsigned char *added = hist + (x - sx + 2*r)*256;
+        for(int v = 0; v < 256; ++v){
+          counts[v] += added[v] - removed[v];
+        }
+      }
+      const long cols = min(x + r,width - 1) - max(x - r,0L) + 1;
+      const unsigned int rank = (unsigned int)(rows*cols - 1)/2;
+      unsigned int seen = 0;
+      int v = 0;
+      while((seen += counts[v]) <= rank){
+        ++v;
+      }
+      result[offset + y*width + x] = v;
+    }
+  }
+}
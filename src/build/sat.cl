@@ -0,0 +1,156 @@
+/* summed area tables
+ * a table holds at each pixel the sum of every pixel above and to the
+ * left of it, inclusive, so any rectangle sums with four lookups.
+ * sums are fixed point with SAT_FRACTION fractional bits in 64 bit
+ * integers, exact for 8 bit images up to 2^47 pixels, and the
+ * intermediate planes of repeated passes keep SAT_FRACTION bits too and
+ * extend past the image by the reach of the passes after them, so pixels
+ * outside the image are zero before the first pass rather than before
+ * each. see sat.h for how the engine plans its passes
+ */
+#define SAT_FRACTION 8
+#define SAT_ONE (1 << SAT_FRACTION)
+
+/* prefix sums along each row of an 8 bit image, one work item per row */
+__kernel
+void integral_rows(__global unsigned char *image,
+  __global long *sat,
+  unsigned long image_width,
+  unsigned long image_height)
+{
+  const size_t y = get_global_id(0);
+  if(y < image_height){
+    long sum = 0;
+    for(size_t x = 0; x < image_width; ++x){
+      sum += (long)image[y*image_width + x] << SAT_FRACTION;
+      sat[y*image_width + x] = sum;
+    }
+  }
+}
+
+/* integral_rows of a plane left by box_pass */
+__kernel
+void integral_rows_plane(__global float *plane,
+  __global long *sat,
+  unsigned long image_width,
+  unsigned long image_height)
+{
+  const size_t y = get_global_id(0);
+  if(y < image_height){
+    long sum = 0;
+    for(size_t x = 0; x < image_width; ++x){
+      sum += (long)round(plane[y*image_width + x]*SAT_ONE);
+      sat[y*image_width + x] = sum;
+    }
+  }
+}
+
+/* prefix sums down each column in place, one work item per column so
+ * neighbouring work items read neighbouring words
+ */
+__kernel
+void integral_cols(__global long *sat,
+  unsigned long image_width,
+  unsigned long image_height)
+{
+  const size_t x = get_global_id(0);
+  if(x < image_width){
+    long sum = 0;
+    for(size_t y = 0; y < image_height; ++y){
+      sum += sat[y*image_width + x];
+      sat[y*image_width + x] = sum;
+    }
+  }
+}
+
+/* sum of the pixels in x0..x1, y0..y1 inclusive, pixels outside the image are zero */
+long rect_sum(__global long *sat, long sat_width, long sat_height, long x0, long y0, long x1, long y1)
+{
+  x0 = max(x0,0L);
+  y0 = max(y0,0L);
+  x1 = min(x1,sat_width - 1);
+  y1 = min(y1,sat_height - 1);
+  if(x0 > x1 || y0 > y1){
+    return 0;
+  }
+
+  long sum = sat[y1*sat_width + x1];
+  if(x0 > 0){
+    sum -= sat[y1*sat_width + x0 - 1];
+  }
+  if(y0 > 0){
+    sum -= sat[(y0 - 1)*sat_width + x1];
+  }
+  if(x0 > 0 && y0 > 0){
+    sum += sat[(y0 - 1)*sat_width + x0 - 1];
+  }
+  return sum;
+}
+
+/* the extended box of the given radius and weights centered on px,py of the table */
+float extended_box(__global long *sat, long sat_width, long sat_height, long px, long py,
+  long radius, float inner, float edge, float corner)
+{
+  const long square = rect_sum(sat,sat_width,sat_height,px - radius,py - radius,px + radius,py + radius);
+  float sum = inner*square;
+
+  /* plain boxes have no outer cells */
+  if(edge != 0.0f || corner != 0.0f){
+    const long wide = rect_sum(sat,sat_width,sat_height,px - radius - 1,py - radius,px + radius + 1,py + radius);
+    const long tall = rect_sum(sat,sat_width,sat_height,px - radius,py - radius - 1,px + radius,py + radius + 1);
+    const long full = rect_sum(sat,sat_width,sat_height,px - radius - 1,py - radius - 1,px + radius + 1,py + radius + 1);
+    sum += edge*(wide + tall - 2*square) + corner*(full - wide - tall + square);
+  }
+  return sum/SAT_ONE;
+}
+
+/* a pass of a box over the table into a plane for the next pass
+ * launched over {plane_width, plane_height}, pixel x,y of the plane is
+ * centered on x+offset,y+offset of the table
+ */
+__kernel
+void box_pass(__global long *sat,
+  __global float *plane,
+  unsigned long sat_width,
+  unsigned long sat_height,
+  unsigned long plane_width,
+  unsigned long plane_height,
+  long offset,
+  unsigned int radius,
+  float inner,
+  float edge,
+  float corner)
+{
+  const size_t x = get_global_id(0);
+  const size_t y = get_global_id(1);
+  if(x < plane_width && y < plane_height){
+    plane[y*plane_width + x] =
+      extended_box(sat,sat_width,sat_height,(long)x + offset,(long)y + offset,radius,inner,edge,corner);
+  }
+}
+
+/* the last pass, truncated to 8 bits into the plane of filter fid in result
+ * launched over {image_width, image_height}, offset as in box_pass
+ */
+__kernel
+void box_result(__global long *sat,
+  __global unsigned char *result,
+  unsigned long sat_width,
+  unsigned long sat_height,
+  unsigned long image_width,
+  unsigned long image_height,
+  long offset,
+  unsigned int radius,
+  float inner,
+  float edge,
+  float corner,
+  unsigned int fid)
+{
+  const size_t px = get_global_id(0);
+  const size_t py = get_global_id(1);
+  if(px < image_width && py < image_height){
+    const size_t image_size = image_width*image_height;
+    result[py*image_width + px + fid*image_size] =
+      convert_uchar_sat(extended_box(sat,sat_width,sat_height,(long)px + offset,(long)py + offset,radius,inner,edge,corner));
+  }
+}
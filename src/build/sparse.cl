@@ -0,0 +1,56 @@
+/* convolution with the kept taps of every filter, see sparse.h
+ * built with the specialization of lwfilter.cl
+ */
+#ifndef IMAGE_W
+#define IMAGE_W image_width
+#endif
+#ifndef IMAGE_H
+#define IMAGE_H image_height
+#endif
+#ifndef NUM_FILTERS
+#define NUM_FILTERS num_filters
+#endif
+
+/* must match sparse.h */
+struct sparse_tap{
+  int dy;
+  int dx;
+  float weight;
+};
+
+/* convolves an image with every filter of a sparse bank
+ * starts: num_filters+1, the taps of filter fid are starts[fid] to starts[fid+1]
+ * taps: in row order, so neighbouring taps read neighbouring pixels
+ * otherwise as convolve2d of lwfilter.cl, in the same order of summation
+ * launched over {width*height, num_filters}
+ */
+__kernel
+void sparse(__global const unsigned char *image,
+  __global const unsigned int *starts,
+  __global const struct sparse_tap *taps,
+  __global unsigned char *result,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned int num_filters)
+{
+  const int pixel = get_global_id(0);
+  const int fid = get_global_id(1);
+  if(pixel >= IMAGE_W*IMAGE_H || fid >= NUM_FILTERS){
+    return;
+  }
+  const int px = pixel % IMAGE_W;
+  const int py = pixel / IMAGE_W;
+  const unsigned int end = starts[fid + 1];
+
+  float sum = 0;
+  for(unsigned int t = starts[fid]; t < end; ++t){
+    const struct sparse_tap tap = taps[t];
+    const int row = py + tap.dy;
+    const int col = px + tap.dx;
+    if(row >= 0 && row < IMAGE_H && col >= 0 && col < IMAGE_W){
+      sum += image[row*IMAGE_W + col]*tap.weight;
+    }
+  }
+  /* truncated and clamped as native_convolve2d, derivative filters go negative */
+  result[fid*IMAGE_W*IMAGE_H + pixel] = convert_uchar_sat(sum);
+}
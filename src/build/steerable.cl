@@ -0,0 +1,125 @@
+/* steerable filter banks
+ * derivatives of Gaussian at any orientation are linear combinations of
+ * the separable basis G, Gx, Gy, Gxx, Gxy and Gyy. the image is filtered
+ * along rows with the 1d kernels of every order, then along columns into
+ * the basis, and each filter of the bank is a weighted sum of the basis at
+ * the pixel. kernels are applied backwards and pixels outside the image are
+ * zero, as in convolve2d. see filter_steerable_bank in filter.c
+ */
+#define STEER_ORDERS 3
+#define STEER_BASIS 6
+
+/* orders along x and y of basis filter b, FILTER_BASIS_X and FILTER_BASIS_Y */
+__constant unsigned int basis_x[STEER_BASIS] = {0, 1, 0, 2, 1, 0};
+__constant unsigned int basis_y[STEER_BASIS] = {0, 0, 1, 0, 1, 2};
+
+/* plane o of rows is the image filtered along x with the kernel of order o
+ * kernels: num_orders kernels of filter_width taps from kernels_offset
+ */
+__kernel
+void steer_rows(__global unsigned char *image,
+  __global float *kernels,
+  __global float *rows,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned int filter_width,
+  unsigned int kernels_offset,
+  unsigned int num_orders)
+{
+  const size_t px = get_global_id(0);
+  const size_t py = get_global_id(1);
+  if(px >= image_width || py >= image_height){
+    return;
+  }
+  const long radius = (filter_width - 1)/2;
+  kernels += kernels_offset;
+
+  float sums[STEER_ORDERS] = {0.0f, 0.0f, 0.0f};
+  for(long d = -radius; d <= radius; ++d){
+    const long col = (long)px + d;
+    if(col < 0 || col >= (long)image_width){
+      continue;
+    }
+    const float source = image[py*image_width + col];
+    for(unsigned int o = 0; o < num_orders; ++o){
+      sums[o] += source*kernels[o*filter_width + radius - d];
+    }
+  }
+  const size_t image_size = image_width*image_height;
+  for(unsigned int o = 0; o < num_orders; ++o){
+    rows[o*image_size + py*image_width + px] = sums[o];
+  }
+}
+
+/* plane b of basis is plane basis_x[b] of rows filtered along y with the
+ * kernel of order basis_y[b], for the first num_basis filters
+ * kernels: as in steer_rows
+ */
+__kernel
+void steer_columns(__global float *rows,
+  __global float *kernels,
+  __global float *basis,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned int filter_width,
+  unsigned int kernels_offset,
+  unsigned int num_basis)
+{
+  const size_t px = get_global_id(0);
+  const size_t py = get_global_id(1);
+  if(px >= image_width || py >= image_height){
+    return;
+  }
+  const long radius = (filter_width - 1)/2;
+  const size_t image_size = image_width*image_height;
+  kernels += kernels_offset;
+
+  float sums[STEER_BASIS] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+  for(long d = -radius; d <= radius; ++d){
+    const long row = (long)py + d;
+    if(row < 0 || row >= (long)image_height){
+      continue;
+    }
+    const size_t pixel = row*image_width + px;
+    for(unsigned int b = 0; b < num_basis; ++b){
+      sums[b] += rows[basis_x[b]*image_size + pixel]*kernels[basis_y[b]*filter_width + radius - d];
+    }
+  }
+  for(unsigned int b = 0; b < num_basis; ++b){
+    basis[b*image_size + py*image_width + px] = sums[b];
+  }
+}
+
+/* num_filters filters from the basis, written to planes first_filter on
+ * coefficients: STEER_BASIS weights per filter
+ */
+__kernel
+void steer(__global float *basis,
+  __global float *coefficients,
+  __global unsigned char *result,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned int num_basis,
+  unsigned int num_filters,
+  unsigned int first_filter)
+{
+  const size_t px = get_global_id(0);
+  const size_t py = get_global_id(1);
+  if(px >= image_width || py >= image_height){
+    return;
+  }
+  const size_t image_size = image_width*image_height;
+  const size_t pixel = py*image_width + px;
+
+  float responses[STEER_BASIS];
+  for(unsigned int b = 0; b < num_basis; ++b){
+    responses[b] = basis[b*image_size + pixel];
+  }
+  for(unsigned int f = 0; f < num_filters; ++f){
+    float sum = 0.0f;
+    for(unsigned int b = 0; b < num_basis; ++b){
+      sum += coefficients[f*STEER_BASIS + b]*responses[b];
+    }
+    result[(first_filter + f)*image_size + pixel] = convert_uchar_sat(sum);
+  }
+}
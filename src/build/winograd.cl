@@ -0,0 +1,125 @@
+/* Winograd minimal filtering, see winograd.h
+ * built with the specialization of lwfilter.cl, FILTER_W fixes the tile
+ * so the transforms unroll
+ */
+#ifdef FILTER_W
+#define UNROLL_TILE _Pragma("unroll")
+#else
+#define UNROLL_TILE
+#define FILTER_W filter_width
+#endif
+#ifndef IMAGE_W
+#define IMAGE_W image_width
+#endif
+#ifndef IMAGE_H
+#define IMAGE_H image_height
+#endif
+#ifndef NUM_FILTERS
+#define NUM_FILTERS num_filters
+#endif
+
+/* must match winograd.h */
+#define WINOGRAD_M 4
+#define WINOGRAD_MAX_TILE 8
+
+/* convolves a block of WINOGRAD_M x WINOGRAD_M pixels with every filter
+ * image: pixels of the image
+ * filters: the n*n cells of every filter from winograd_filter
+ * transforms: B^T, n*n, followed by A^T, WINOGRAD_M*n
+ * result: a plane per filter
+ * launched over the blocks, {ceil(width/m), ceil(height/m)}
+ */
+__kernel
+void winograd(__global const unsigned char *image,
+  __global const float *filters,
+  __constant float *transforms,
+  __global unsigned char *result,
+  unsigned long image_width,
+  unsigned long image_height,
+  unsigned int filter_width,
+  unsigned int num_filters)
+{
+  const int bx = get_global_id(0)*WINOGRAD_M;
+  const int by = get_global_id(1)*WINOGRAD_M;
+  if(bx >= IMAGE_W || by >= IMAGE_H){
+    return;
+  }
+  const int n = WINOGRAD_M + FILTER_W - 1;
+  const int radius = (FILTER_W - 1)/2;
+  const unsigned int image_size = IMAGE_W*IMAGE_H;
+  __constant float *bt = transforms;
+  __constant float *at = transforms + n*n;
+
+  /* the tile, zero outside the image */
+  float tile[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  UNROLL_TILE
+  for(int y = 0; y < n; ++y){
+    const int row = by - radius + y;
+    UNROLL_TILE
+    for(int x = 0; x < n; ++x){
+      const int col = bx - radius + x;
+      tile[y*n + x] = (row < 0 || row >= IMAGE_H || col < 0 || col >= IMAGE_W) ? 0.0f : image[row*IMAGE_W + col];
+    }
+  }
+
+  /* B^T d B once for the bank */
+  float half[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  float transformed[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  UNROLL_TILE
+  for(int i = 0; i < n; ++i){
+    UNROLL_TILE
+    for(int x = 0; x < n; ++x){
+      float sum = 0.0f;
+      UNROLL_TILE
+      for(int y = 0; y < n; ++y){
+        sum += bt[i*n + y]*tile[y*n + x];
+      }
+      half[i*n + x] = sum;
+    }
+  }
+  UNROLL_TILE
+  for(int i = 0; i < n; ++i){
+    UNROLL_TILE
+    for(int j = 0; j < n; ++j){
+      float sum = 0.0f;
+      UNROLL_TILE
+      for(int x = 0; x < n; ++x){
+        sum += half[i*n + x]*bt[j*n + x];
+      }
+      transformed[i*n + j] = sum;
+    }
+  }
+
+  for(unsigned int fid = 0; fid < NUM_FILTERS; ++fid){
+    __global const float *cells = filters + fid*n*n;
+
+    /* A^T (U . V) A, the cellwise product folded into the first pass */
+    UNROLL_TILE
+    for(int i = 0; i < WINOGRAD_M; ++i){
+      UNROLL_TILE
+      for(int x = 0; x < n; ++x){
+        float sum = 0.0f;
+        UNROLL_TILE
+        for(int y = 0; y < n; ++y){
+          sum += at[i*n + y]*(cells[y*n + x]*transformed[y*n + x]);
+        }
+        half[i*n + x] = sum;
+      }
+    }
+    UNROLL_TILE
+    for(int i = 0; i < WINOGRAD_M; ++i){
+      UNROLL_TILE
+      for(int j = 0; j < WINOGRAD_M; ++j){
+        if(by + i < IMAGE_H && bx + j < IMAGE_W){
+          float sum = 0.0f;
+          UNROLL_TILE
+          for(int x = 0; x < n; ++x){
+            sum += half[i*n + x]*at[j*n + x];
+          }
+          /* derivative filters go negative */
+          result[fid*image_size + (by + i)*IMAGE_W + bx + j] = convert_uchar_sat(sum);
+        }
+      }
+    }
+  }
+}
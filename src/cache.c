@@ -0,0 +1,194 @@
+#define _DEFAULT_SOURCE
+#include "cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hash.h"
+
+#define CACHE_MAGIC "GIMCRES1"
+#define CACHE_SUFFIX ".gres"
+#define HEADER_SIZE 64
+
+struct result_cache{
+  char *directory;
+  size_t max_bytes;
+};
+
+/* the header of a cache file, the key is kept to rule out collisions */
+struct cache_header{
+  char magic[8];
+  struct result_key key;
+};
+
+/* a cache file while evicting */
+struct cache_entry{
+  char *path;
+  size_t size;
+  time_t used;
+};
+
+static size_t result_size(const struct result_key *key){
+  return key->width*key->height*key->num_filters;
+}
+
+/* path of the file for a key */
+static void key_path(const struct result_cache *cache, const struct result_key *key, char *path, size_t len){
+  /* hash the fields one by one, the struct may have padding */
+  uint64_t hash = gimc_hash64(&key->image,sizeof(key->image),0);
+  hash = gimc_hash64(&key->bank,sizeof(key->bank),hash);
+  hash = gimc_hash64(&key->width,sizeof(key->width),hash);
+  hash = gimc_hash64(&key->height,sizeof(key->height),hash);
+  const uint32_t small[5] = {key->num_filters, key->filter_width, key->border, key->output, key->top_down};
+  hash = gimc_hash64(small,sizeof(small),hash);
+  snprintf(path,len,"%s/%016llx" CACHE_SUFFIX,cache->directory,(unsigned long long)hash);
+}
+
+static int same_key(const struct result_key *a, const struct result_key *b){
+  return a->image == b->image && a->bank == b->bank && a->width == b->width && a->height == b->height &&
+    a->num_filters == b->num_filters && a->filter_width == b->filter_width && a->border == b->border &&
+    a->output == b->output && a->top_down == b->top_down;
+}
+
+struct result_cache *result_cache_open(const char *directory, size_t max_bytes){
+  if(mkdir(directory,0755) != 0 && errno != EEXIST){
+    perror(directory);
+    return NULL;
+  }
+  struct result_cache *cache = malloc(sizeof(struct result_cache));
+  cache->directory = strdup(directory);
+  cache->max_bytes = max_bytes;
+  return cache;
+}
+
+int result_cache_lookup(struct result_cache *cache, const struct result_key *key, struct cached_result *result){
+  char path[4096];
+  key_path(cache,key,path,sizeof(path));
+  int fd = open(path,O_RDONLY);
+  if(fd < 0){
+    return 1;
+  }
+
+  struct stat st;
+  const size_t size = HEADER_SIZE + result_size(key);
+  if(fstat(fd,&st) != 0 || (size_t)st.st_size != size){
+    close(fd);
+    return 1;
+  }
+  void *mapping = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+  /* the modification time orders files for eviction */
+  futimens(fd,NULL);
+  close(fd);
+  if(mapping == MAP_FAILED){
+    return 1;
+  }
+
+  struct cache_header header;
+  memcpy(&header,mapping,sizeof(header));
+  if(memcmp(header.magic,CACHE_MAGIC,8) != 0 || !same_key(&header.key,key)){
+    munmap(mapping,size);
+    return 1;
+  }
+
+  result->mapping = mapping;
+  result->size = size;
+  result->planes = (const uint8_t *)mapping + HEADER_SIZE;
+  return 0;
+}
+
+void result_cache_release(struct cached_result *result){
+  munmap(result->mapping,result->size);
+}
+
+static int older(const void *a, const void *b){
+  const struct cache_entry *x = a, *y = b;
+  return (x->used > y->used) - (x->used < y->used);
+}
+
+/* remove the least recently used files until the cache fits in max_bytes */
+static void evict(struct result_cache *cache){
+  DIR *dir = opendir(cache->directory);
+  if(dir == NULL){
+    return;
+  }
+
+  struct cache_entry *entries = NULL;
+  size_t num_entries = 0, max_entries = 0, total = 0;
+  struct dirent *ent;
+  while((ent = readdir(dir)) != NULL){
+    const size_t len = strlen(ent->d_name);
+    if(len < strlen(CACHE_SUFFIX) || strcmp(ent->d_name + len - strlen(CACHE_SUFFIX),CACHE_SUFFIX) != 0){
+      continue;
+    }
+    char path[4096];
+    snprintf(path,sizeof(path),"%s/%s",cache->directory,ent->d_name);
+    struct stat st;
+    if(stat(path,&st) != 0){
+      continue;
+    }
+    if(num_entries == max_entries){
+      max_entries = max_entries ? 2*max_entries : 64;
+      entries = realloc(entries,sizeof(struct cache_entry)*max_entries);
+    }
+    entries[num_entries].path = strdup(path);
+    entries[num_entries].size = st.st_size;
+    entries[num_entries].used = st.st_mtime;
+    total += st.st_size;
+    ++num_entries;
+  }
+  closedir(dir);
+
+  qsort(entries,num_entries,sizeof(struct cache_entry),older);
+  for(size_t i = 0; i < num_entries; ++i){
+    if(total > cache->max_bytes && unlink(entries[i].path) == 0){
+      total -= entries[i].size;
+    }
+    free(entries[i].path);
+  }
+  free(entries);
+}
+
+int result_cache_store(struct result_cache *cache, const struct result_key *key, const uint8_t *planes){
+  const size_t size = result_size(key);
+  if(HEADER_SIZE + size > cache->max_bytes){
+    return 1;
+  }
+
+  /* write to a temporary file and rename it, so readers never see part of a result */
+  char path[4096], temporary[4200];
+  key_path(cache,key,path,sizeof(path));
+  snprintf(temporary,sizeof(temporary),"%s.%ld.tmp",path,(long)getpid());
+  FILE *file = fopen(temporary,"wb");
+  if(file == NULL){
+    perror(temporary);
+    return 1;
+  }
+
+  unsigned char header[HEADER_SIZE] = {0};
+  struct cache_header fields;
+  memset(&fields,0,sizeof(fields));
+  memcpy(fields.magic,CACHE_MAGIC,8);
+  fields.key = *key;
+  memcpy(header,&fields,sizeof(fields));
+  const int failed = fwrite(header,1,HEADER_SIZE,file) != HEADER_SIZE || fwrite(planes,1,size,file) != size;
+  if(fclose(file) != 0 || failed || rename(temporary,path) != 0){
+    perror(path);
+    unlink(temporary);
+    return 1;
+  }
+
+  evict(cache);
+  return 0;
+}
+
+void result_cache_close(struct result_cache *cache){
+  free(cache->directory);
+  free(cache);
+}
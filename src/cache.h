@@ -0,0 +1,65 @@
+/* on disk cache of convolution results
+ * results are stored under a hash of everything they depend on, so
+ * convolving an image again with the same bank maps the stored planes
+ * instead of running on the device. files are a 64 byte header followed
+ * by the planes and are evicted least recently used first once the cache
+ * grows past its size
+ */
+
+#ifndef GIMC_CACHE_H
+#define GIMC_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* border modes, pixels outside the image are zero in every engine */
+#define CACHE_BORDER_ZERO 0
+
+/* result types, sums truncated to 8 bits or reduced by an epilogue,
+ * which is hashed into the bank
+ */
+#define CACHE_OUTPUT_U8 0
+#define CACHE_OUTPUT_EPILOGUE 1
+
+/* what a result depends on */
+struct result_key{
+  uint64_t image; /* gimc_hash64 of the pixels */
+  uint64_t bank; /* gimc_hash64 of the coefficients or of how they are generated */
+  uint64_t width;
+  uint64_t height;
+  uint32_t num_filters;
+  uint32_t filter_width;
+  uint32_t border;
+  uint32_t output;
+  uint32_t top_down; /* row order of the planes, see gimc_image */
+};
+
+/* a result mapped from the cache */
+struct cached_result{
+  void *mapping;
+  size_t size;
+  const uint8_t *planes; /* num_filters planes of width*height */
+};
+
+struct result_cache;
+
+/* open the cache in directory, creating it if needed
+ * max_bytes: size above which old results are evicted
+ * returns NULL if the directory can't be used
+ */
+extern struct result_cache *result_cache_open(const char *directory,size_t max_bytes);
+
+/* map the result for key, returns nonzero on a miss */
+extern int result_cache_lookup(struct result_cache *cache,const struct result_key *key,struct cached_result *result);
+
+/* unmap a result returned by result_cache_lookup */
+extern void result_cache_release(struct cached_result *result);
+
+/* store the planes of a result, evicting old ones to stay within the size
+ * returns nonzero if it could not be stored
+ */
+extern int result_cache_store(struct result_cache *cache,const struct result_key *key,const uint8_t *planes);
+
+extern void result_cache_close(struct result_cache *cache);
+
+#endif
@@ -0,0 +1,235 @@
+#include "choose.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "epilogue.h"
+#include "metrics.h"
+#include "sparse.h"
+#include "winograd.h"
+
+/* a line of tuning data, as in tests/perf_baseline.txt */
+#define LINE_LEN 256
+#define MAX_LINES 1024
+
+static const char *source_names[] = {"nothing", "tuning data", "a benchmark", "the roofline model"};
+
+unsigned int choose_candidates(struct gimc_cl *cl, size_t width, size_t height, const struct gimc_bank *bank,
+  const struct gimc_epilogue *epilogue, enum engine_id *candidates){
+  unsigned int count = 0;
+  if(epilogue && !epilogue_is_identity(epilogue)){
+    candidates[count++] = ENGINE_LWF;
+    return count;
+  }
+  /* base.cl takes the image and the bank as __constant, which the device
+   * only holds up to its constant buffer size
+   */
+  cl_ulong max_constant = 0;
+  clGetDeviceInfo(cl->device,CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE,sizeof(cl_ulong),&max_constant,NULL);
+  const double constant_bytes = (double)width*height*sizeof(uint8_t) +
+    (double)bank->width*bank->width*bank->num_filters*sizeof(float);
+  if(constant_bytes <= max_constant){
+    candidates[count++] = ENGINE_BASE;
+  }
+  /* sat and multirate approximate and the rank engines don't convolve */
+  const enum engine_id exact[] = {ENGINE_LWF, ENGINE_LWF_LOCAL, ENGINE_LWF_PARTIALS, ENGINE_LWF_FUSED, ENGINE_BAKED};
+  for(size_t i = 0; i < sizeof(exact)/sizeof(exact[0]); ++i){
+    candidates[count++] = exact[i];
+  }
+  /* the others run these banks as lwf */
+  struct winograd_transform transform;
+  if(winograd_transform(bank->width,&transform) == 0){
+    candidates[count++] = ENGINE_WINOGRAD;
+  }
+  if(bank->steerable.num_sigmas){
+    candidates[count++] = ENGINE_STEERABLE;
+  }
+  if(bank->dilations){
+    candidates[count++] = ENGINE_ATROUS;
+  }
+  /* unless it drops more than zeros */
+  if(sparse_threshold() == 0.0){
+    candidates[count++] = ENGINE_SPARSE;
+  }
+  return count;
+}
+
+/* throughput in Mpix/s of an engine at a width on a device, 0 if the
+ * tuning data has none
+ */
+static double tuning_lookup(char lines[][LINE_LEN], int num_lines, const char *device, enum engine_id engine,
+  unsigned int filter_width){
+  for(int i = 0; i < num_lines; ++i){
+    char name[32], line_device[LINE_LEN];
+    unsigned int width;
+    double throughput;
+    if(sscanf(lines[i],"%31s %u %lf %255[^\n]",name,&width,&throughput,line_device) == 4 &&
+      strcmp(name,engine_name(engine)) == 0 && width == filter_width && strcmp(line_device,device) == 0){
+      return throughput;
+    }
+  }
+  return 0;
+}
+
+/* read tuning data, returns its number of lines */
+static int tuning_read(const char *path, char lines[][LINE_LEN], int max_lines){
+  int num_lines = 0;
+  FILE *tuning = path ? fopen(path,"r") : NULL;
+  if(tuning){
+    while(num_lines < max_lines && fgets(lines[num_lines],LINE_LEN,tuning)){
+      lines[num_lines][strcspn(lines[num_lines],"\n")] = '\0';
+      ++num_lines;
+    }
+    fclose(tuning);
+  }
+  return num_lines;
+}
+
+/* time every candidate on the first rows of the image, an engine which
+ * fails is left out. returns the number of candidates left
+ */
+static unsigned int benchmark_candidates(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, struct engine_choice *choice){
+  const double taps = (double)bank->width*bank->width*bank->num_filters;
+  size_t rows = (size_t)(CHOOSE_BENCH_TAPS/(taps*width));
+  rows = rows < CHOOSE_BENCH_MIN_ROWS ? CHOOSE_BENCH_MIN_ROWS : rows;
+  rows = rows > height ? height : rows;
+  choice->bench_rows = rows;
+
+  cl_int err;
+  cl_mem result = clCreateBuffer(cl->context,CL_MEM_WRITE_ONLY,sizeof(uint8_t)*width*rows*bank->num_filters,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() benchmark",err);
+    return 0;
+  }
+  unsigned int kept = 0;
+  for(unsigned int c = 0; c < choice->num_candidates; ++c){
+    const enum engine_id engine = choice->candidates[c].engine;
+    /* the first run builds the program and is not counted */
+    err = engine_convolve(cl,engine,image,width,rows,bank,result,NULL);
+    struct engine_timing timing = {0.0,0};
+    for(unsigned int r = 0; r < CHOOSE_BENCH_REPEATS && !err; ++r){
+      err = engine_convolve(cl,engine,image,width,rows,bank,result,&timing);
+    }
+    clFinish(cl->commands);
+    if(err){
+      fprintf(stderr,"engine auto: %s failed the benchmark with error %d, left out\n",engine_name(engine),err);
+    }else{
+      choice->candidates[kept].engine = engine;
+      choice->candidates[kept].seconds = timing.seconds/CHOOSE_BENCH_REPEATS*height/rows;
+      ++kept;
+    }
+  }
+  clReleaseMemObject(result);
+  return kept;
+}
+
+/* append the throughput of every candidate to the tuning data */
+static void tuning_append(const char *path, const char *device, size_t width, size_t height,
+  const struct gimc_bank *bank, const struct engine_choice *choice){
+  FILE *tuning = fopen(path,"a");
+  if(tuning == NULL){
+    perror(path);
+    return;
+  }
+  const double outputs = (double)width*height*bank->num_filters;
+  for(unsigned int c = 0; c < choice->num_candidates; ++c){
+    fprintf(tuning,"%s %u %.2f %s\n",engine_name(choice->candidates[c].engine),bank->width,
+      outputs/choice->candidates[c].seconds*1e-6,device);
+  }
+  fclose(tuning);
+}
+
+/* fastest first, then lwf, then in the order of enum engine_id */
+static int compare_estimates(const void *a, const void *b){
+  const struct engine_estimate *x = a;
+  const struct engine_estimate *y = b;
+  if(x->seconds != y->seconds){
+    return (x->seconds > y->seconds) - (x->seconds < y->seconds);
+  }
+  const int px = x->engine == ENGINE_LWF ? -1 : (int)x->engine;
+  const int py = y->engine == ENGINE_LWF ? -1 : (int)y->engine;
+  return (px > py) - (px < py);
+}
+
+cl_int choose_engine(struct gimc_cl *cl, cl_mem image, size_t width, size_t height, const struct gimc_bank *bank,
+  const struct gimc_epilogue *epilogue, const char *tuning_path, int benchmark, struct engine_choice *choice){
+  enum engine_id candidates[NUM_ENGINES];
+  choice->num_candidates = choose_candidates(cl,width,height,bank,epilogue,candidates);
+  choice->bench_rows = 0;
+  choice->ties = 0;
+  for(unsigned int c = 0; c < choice->num_candidates; ++c){
+    choice->candidates[c].engine = candidates[c];
+    choice->candidates[c].seconds = 0;
+  }
+  choice->engine = candidates[0];
+  if(choice->num_candidates == 1){
+    choice->source = CHOOSE_ONLY;
+    return CL_SUCCESS;
+  }
+
+  char device[LINE_LEN];
+  clGetDeviceInfo(cl->device,CL_DEVICE_NAME,sizeof(device),device,NULL);
+  static char lines[MAX_LINES][LINE_LEN];
+  const int num_lines = tuning_read(tuning_path,lines,MAX_LINES);
+  const double outputs = (double)width*height*bank->num_filters;
+
+  /* tuning data only counts if it holds every candidate */
+  choice->source = CHOOSE_TUNING;
+  for(unsigned int c = 0; c < choice->num_candidates && choice->source == CHOOSE_TUNING; ++c){
+    const double throughput = tuning_lookup(lines,num_lines,device,choice->candidates[c].engine,bank->width);
+    if(throughput > 0){
+      choice->candidates[c].seconds = outputs/(throughput*1e6);
+    }else{
+      choice->source = benchmark ? CHOOSE_BENCHMARK : CHOOSE_MODEL;
+    }
+  }
+
+  if(choice->source == CHOOSE_BENCHMARK){
+    choice->num_candidates = benchmark_candidates(cl,image,width,height,bank,choice);
+    if(choice->num_candidates == 0){
+      fprintf(stderr,"No engine ran the bank of %u filters of width %u\n",bank->num_filters,bank->width);
+      return CL_INVALID_OPERATION;
+    }
+    if(tuning_path){
+      tuning_append(tuning_path,device,width,height,bank,choice);
+    }
+  }else if(choice->source == CHOOSE_MODEL){
+    struct device_peaks peaks;
+    metrics_device_peaks(cl,&peaks);
+    for(unsigned int c = 0; c < choice->num_candidates; ++c){
+      struct engine_work work;
+      metrics_engine_work(choice->candidates[c].engine,width,height,bank,&work);
+      const double compute = work.flops/(peaks.gflops*1e9);
+      const double memory = work.bytes/(peaks.gbps*1e9);
+      choice->candidates[c].seconds = compute > memory ? compute : memory;
+    }
+  }
+
+  qsort(choice->candidates,choice->num_candidates,sizeof(struct engine_estimate),compare_estimates);
+  choice->engine = choice->candidates[0].engine;
+  while(choice->ties + 1 < choice->num_candidates &&
+    choice->candidates[choice->ties + 1].seconds == choice->candidates[0].seconds){
+    ++choice->ties;
+  }
+  return CL_SUCCESS;
+}
+
+void choose_log(FILE *out, const struct engine_choice *choice){
+  if(choice->source == CHOOSE_ONLY){
+    fprintf(out,"engine auto: %s, the only engine for the bank and epilogue\n",engine_name(choice->engine));
+    return;
+  }
+  fprintf(out,"engine auto: %s, predicted by %s",engine_name(choice->engine),source_names[choice->source]);
+  if(choice->source == CHOOSE_BENCHMARK){
+    fprintf(out," of %zu rows",choice->bench_rows);
+  }
+  if(choice->ties){
+    fprintf(out," tied with %u other%s",choice->ties,choice->ties == 1 ? "" : "s");
+  }
+  /* every candidate with its predicted time, fastest first */
+  for(unsigned int c = 0; c < choice->num_candidates; ++c){
+    fprintf(out,"%s %s %.2f ms",c == 0 ? ":" : ",",engine_name(choice->candidates[c].engine),
+      choice->candidates[c].seconds*1e3);
+  }
+  fprintf(out,"\n");
+}
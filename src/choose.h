@@ -0,0 +1,68 @@
+/* choosing the fastest engine for an image, bank and device
+ * the candidates are the engines which give the results of lwf for the
+ * bank, whatever the sign of its weights as every engine saturates. their times are predicted, in order of preference, from tuning
+ * data (lines of "engine filter_width Mpix/s device" as TestPerf records
+ * them) holding every candidate at the bank's width on the device, from a
+ * benchmark of every candidate on the first rows of the image, scaled to
+ * the whole image, or from the roofline of metrics.h. a benchmark is
+ * appended to the tuning data so later runs skip it. the roofline gives
+ * engines which read the same taps the same time, such ties go to lwf
+ */
+
+#ifndef GIMC_CHOOSE_H
+#define GIMC_CHOOSE_H
+
+#include <stdio.h>
+
+#include "engine.h"
+
+/* multiply-adds a benchmark run of one engine takes at most, whatever the
+ * bank, and rows it takes at least
+ */
+#define CHOOSE_BENCH_TAPS (1 << 26)
+#define CHOOSE_BENCH_MIN_ROWS 8
+
+/* runs of each candidate in a benchmark after the one which builds it */
+#define CHOOSE_BENCH_REPEATS 2
+
+enum choose_source{
+  CHOOSE_ONLY, /* a single candidate */
+  CHOOSE_TUNING,
+  CHOOSE_BENCHMARK,
+  CHOOSE_MODEL
+};
+
+struct engine_estimate{
+  enum engine_id engine;
+  double seconds; /* predicted for the whole image and bank */
+};
+
+struct engine_choice{
+  enum engine_id engine;
+  enum choose_source source;
+  size_t bench_rows; /* rows of a benchmark */
+  unsigned int num_candidates;
+  unsigned int ties; /* candidates predicted as fast as the chosen one */
+  struct engine_estimate candidates[NUM_ENGINES]; /* fastest first */
+};
+
+struct gimc_epilogue;
+
+/* engines which give the results of lwf for bank on the width*height
+ * image, only lwf fuses an epilogue, and base only runs if the image and
+ * bank fit in the constant memory of the device. returns their number
+ */
+extern unsigned int choose_candidates(struct gimc_cl *cl,size_t width,size_t height,const struct gimc_bank *bank,
+  const struct gimc_epilogue *epilogue,enum engine_id *candidates);
+
+/* choose the engine for the width*height image in image. tuning_path may
+ * be NULL, benchmark zero to predict from the roofline without tuning
+ * data. the queue of cl has to have profiling enabled
+ */
+extern cl_int choose_engine(struct gimc_cl *cl,cl_mem image,size_t width,size_t height,const struct gimc_bank *bank,
+  const struct gimc_epilogue *epilogue,const char *tuning_path,int benchmark,struct engine_choice *choice);
+
+/* say which engine was chosen and why */
+extern void choose_log(FILE *out,const struct engine_choice *choice);
+
+#endif
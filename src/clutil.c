@@ -1,6 +1,8 @@
 #include "clutil.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 void print_error(const char *function, cl_int error){
   fprintf(stderr,"Error when calling %s, code: %d\n",function,error);
@@ -36,3 +38,179 @@ int next_multiple(int val, int multiple){
   for(i = multiple; i < val; i+=multiple);
   return i;
 }
+
+int kernel_spec_options(const struct kernel_spec *spec, char *options, size_t len){
+  options[0] = '\0';
+  if(spec == NULL || spec->filter_width % 2 == 0 || spec->filter_height % 2 == 0 ||
+    spec->filter_width < SPEC_MIN_WIDTH || spec->filter_width > SPEC_MAX_WIDTH ||
+    spec->filter_height < SPEC_MIN_WIDTH || spec->filter_height > SPEC_MAX_WIDTH){
+    return 0;
+  }
+
+  snprintf(options,len,"-DFILTER_W=%uu -DFILTER_H=%uu -DIMAGE_W=%luul -DIMAGE_H=%luul -DNUM_FILTERS=%uu",
+    spec->filter_width,spec->filter_height,(unsigned long)spec->image_width,
+    (unsigned long)spec->image_height,spec->num_filters);
+  return 1;
+}
+
+/* programs are kept in a singly linked list, caches are small enough
+ * that a linear search is fine. so are the kernels of each program
+ */
+struct kernel_entry{
+  char *name;
+  cl_kernel kernel;
+  struct kernel_entry *next;
+};
+
+struct program_entry{
+  char *name;
+  char *options;
+  cl_program program;
+  struct kernel_entry *kernels;
+  struct program_entry *next;
+};
+
+struct program_cache{
+  cl_context context;
+  cl_device_id device;
+  struct program_entry *entries;
+};
+
+struct program_cache *program_cache_create(cl_context context, cl_device_id device){
+  struct program_cache *cache = malloc(sizeof(struct program_cache));
+  cache->context = context;
+  cache->device = device;
+  cache->entries = NULL;
+  return cache;
+}
+
+static char *copy_string(const char *str){
+  char *copy = malloc(strlen(str)+1);
+  strcpy(copy,str);
+  return copy;
+}
+
+/* find a program previously built under name with options */
+static cl_program program_cache_find(struct program_cache *cache, const char *name, const char *options){
+  for(struct program_entry *entry = cache->entries; entry != NULL; entry = entry->next){
+    if(strcmp(entry->name,name) == 0 && strcmp(entry->options,options) == 0){
+      return entry->program;
+    }
+  }
+  return NULL;
+}
+
+/* build source with options and add it to the cache under name */
+static cl_program program_cache_add(struct program_cache *cache, const char *name, const char *source, const char *options){
+  cl_int err;
+  cl_program program = clCreateProgramWithSource(cache->context,1,&source,NULL,&err);
+  if(err){
+    print_error("clCreateProgramWithSource()",err);
+    return NULL;
+  }
+
+  trace_begin(name);
+  err = clBuildProgram(program,1,&cache->device,options,NULL,NULL);
+  trace_end();
+  if(err){
+    size_t len;
+    char buffer[2048];
+    clGetProgramBuildInfo(program,cache->device,CL_PROGRAM_BUILD_LOG,sizeof(buffer),buffer,&len);
+    fprintf(stderr,"Failed to build %s with options \"%s\"\n%s\n",name,options,buffer);
+    clReleaseProgram(program);
+    return NULL;
+  }
+
+  struct program_entry *entry = malloc(sizeof(struct program_entry));
+  entry->name = copy_string(name);
+  entry->options = copy_string(options);
+  entry->program = program;
+  entry->kernels = NULL;
+  entry->next = cache->entries;
+  cache->entries = entry;
+  return program;
+}
+
+/* look up or build a single program with the exact options given */
+static cl_program program_cache_get(struct program_cache *cache, const char *filename, const char *options){
+  cl_program program = program_cache_find(cache,filename,options);
+  if(program != NULL){
+    return program;
+  }
+
+  char *source = NULL;
+  read_cl_source(filename,&source);
+  program = program_cache_add(cache,filename,source,options);
+  free_cl_source(source);
+  return program;
+}
+
+cl_program program_cache_build(struct program_cache *cache, const char *filename, const struct kernel_spec *spec){
+  char options[256];
+  if(kernel_spec_options(spec,options,sizeof(options))){
+    cl_program program = program_cache_get(cache,filename,options);
+    if(program != NULL){
+      return program;
+    }
+    fprintf(stderr,"Falling back to generic build of %s\n",filename);
+  }
+  return program_cache_get(cache,filename,"");
+}
+
+cl_program program_cache_build_source(struct program_cache *cache, const char *name, const char *source){
+  cl_program program = program_cache_find(cache,name,"");
+  if(program != NULL){
+    return program;
+  }
+  return program_cache_add(cache,name,source,"");
+}
+
+cl_kernel program_cache_kernel(struct program_cache *cache, cl_program program, const char *name, cl_int *err){
+  struct program_entry *entry = cache->entries;
+  while(entry != NULL && entry->program != program){
+    entry = entry->next;
+  }
+  if(entry == NULL){
+    return clCreateKernel(program,name,err);
+  }
+  for(struct kernel_entry *kernel = entry->kernels; kernel != NULL; kernel = kernel->next){
+    if(strcmp(kernel->name,name) == 0){
+      *err = clRetainKernel(kernel->kernel);
+      return kernel->kernel;
+    }
+  }
+
+  cl_kernel created = clCreateKernel(program,name,err);
+  if(*err){
+    return created;
+  }
+  struct kernel_entry *kernel = malloc(sizeof(struct kernel_entry));
+  kernel->name = copy_string(name);
+  kernel->kernel = created;
+  kernel->next = entry->kernels;
+  entry->kernels = kernel;
+  /* one reference for the cache and one for the caller */
+  *err = clRetainKernel(created);
+  return created;
+}
+
+void program_cache_release(struct program_cache *cache){
+  struct program_entry *entry = cache->entries;
+  while(entry != NULL){
+    struct program_entry *next = entry->next;
+    struct kernel_entry *kernel = entry->kernels;
+    while(kernel != NULL){
+      struct kernel_entry *next_kernel = kernel->next;
+      clReleaseKernel(kernel->kernel);
+      free(kernel->name);
+      free(kernel);
+      kernel = next_kernel;
+    }
+    clReleaseProgram(entry->program);
+    free(entry->name);
+    free(entry->options);
+    free(entry);
+    entry = next;
+  }
+  free(cache);
+}
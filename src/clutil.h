@@ -20,4 +20,54 @@ extern void free_cl_source(char *source);
  */
 extern int next_multiple(int val,int multiple);
 
+/* compile time constants a kernel source can be specialized on
+ * filter sides outside of the common range are built generically
+ */
+struct kernel_spec{
+  unsigned int filter_width;
+  unsigned int filter_height;
+  size_t image_width;
+  size_t image_height;
+  unsigned int num_filters;
+};
+
+/* smallest and largest filter widths which get a specialized build */
+#define SPEC_MIN_WIDTH 3
+#define SPEC_MAX_WIDTH 49
+
+/* write the build options for spec into options
+ * returns 0 if the spec is too rare to specialize, options is then empty
+ */
+extern int kernel_spec_options(const struct kernel_spec *spec,char *options,size_t len);
+
+/* cache of built programs belonging to one context
+ * programs are keyed by their source file and build options
+ */
+struct program_cache;
+
+/* create an empty cache for programs built on context for device */
+extern struct program_cache *program_cache_create(cl_context context,cl_device_id device);
+
+/* get the program for filename specialized on spec, building it on a miss
+ * spec may be NULL for a generic build. if a specialized build fails the
+ * generic build is used instead. returns NULL if no build succeeds.
+ * the program is owned by the cache
+ */
+extern cl_program program_cache_build(struct program_cache *cache,const char *filename,const struct kernel_spec *spec);
+
+/* get the program built from source held in memory, such as generated code
+ * name is the cache key and must identify the source uniquely
+ */
+extern cl_program program_cache_build_source(struct program_cache *cache,const char *name,const char *source);
+
+/* a kernel of a program of the cache, created once and kept for as long
+ * as the cache, so launches don't create their kernels again. the kernel
+ * is retained for the caller, who releases it as one from clCreateKernel.
+ * its arguments are those last set, so they are set before every launch
+ */
+extern cl_kernel program_cache_kernel(struct program_cache *cache,cl_program program,const char *name,cl_int *err);
+
+/* release every program in the cache and the cache itself */
+extern void program_cache_release(struct program_cache *cache);
+
 #endif
@@ -0,0 +1,111 @@
+#include "cpu.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* an instance convolves the padded image with the filter whose last cell
+ * is last. padded: row y+fy, column x+fx is the tap fy,fx of pixel x,y
+ */
+#define CPU_ARGS const uint8_t *restrict padded, size_t padded_width, size_t image_width, size_t image_height, \
+  const float *last, unsigned int filter_width, uint8_t *restrict result
+
+typedef void (*cpu_kernel)(CPU_ARGS);
+
+/* the loops of every instance, taps in the order of native_convolve2d so
+ * float sums agree with it. a tile may read past the row into the padding
+ */
+#define CPU_CONVOLVE(acc, width, tile) \
+  (void)filter_width; \
+  for(size_t y = 0; y < image_height; ++y){ \
+    for(size_t x0 = 0; x0 < image_width; x0 += (tile)){ \
+      acc sums[(tile)]; \
+      for(unsigned int i = 0; i < (tile); ++i){ \
+        sums[i] = 0; \
+      } \
+      for(unsigned int fy = 0; fy < (width); ++fy){ \
+        const uint8_t *row = &padded[(y + fy)*padded_width + x0]; \
+        for(unsigned int fx = 0; fx < (width); ++fx){ \
+          const acc weight = last[-(long)(fy*(width) + fx)]; \
+          for(unsigned int i = 0; i < (tile); ++i){ \
+            sums[i] += row[fx + i]*weight; \
+          } \
+        } \
+      } \
+      const size_t count = image_width - x0 < (tile) ? image_width - x0 : (tile); \
+      for(size_t i = 0; i < count; ++i){ \
+        /* derivative filters go negative */ \
+        result[y*image_width + x0 + i] = sums[i] <= 0 ? 0 : sums[i] >= 255 ? 255 : (uint8_t)sums[i]; \
+      } \
+    } \
+  }
+
+/* the widths with an instance, CPU_MIN_WIDTH to CPU_MAX_WIDTH */
+#define CPU_WIDTHS(X) X(3) X(5) X(7) X(9) X(11) X(13) X(15) X(17) X(19) X(21) X(23) X(25) \
+  X(27) X(29) X(31) X(33) X(35) X(37) X(39) X(41) X(43) X(45) X(47) X(49)
+
+/* the tiles of every width, in the order of enum cpu_tile */
+#define CPU_TILES(X, width) X(width,narrow,CPU_TILE_NARROW) X(width,wide,CPU_TILE_WIDE)
+
+enum cpu_tile{
+  CPU_NARROW,
+  CPU_WIDE,
+  NUM_CPU_TILES
+};
+
+#define CPU_TILE_INSTANCE(width, tile_name, tile) \
+  static void cpu_float_##tile_name##_##width(CPU_ARGS){ CPU_CONVOLVE(float,width,tile) } \
+  static void cpu_double_##tile_name##_##width(CPU_ARGS){ CPU_CONVOLVE(double,width,tile) }
+#define CPU_INSTANCE(width) CPU_TILES(CPU_TILE_INSTANCE,width)
+
+CPU_WIDTHS(CPU_INSTANCE)
+
+/* other widths read theirs at run time */
+#define CPU_GENERIC(unused, tile_name, tile) \
+  static void cpu_float_##tile_name##_generic(CPU_ARGS){ CPU_CONVOLVE(float,filter_width,tile) } \
+  static void cpu_double_##tile_name##_generic(CPU_ARGS){ CPU_CONVOLVE(double,filter_width,tile) }
+
+CPU_TILES(CPU_GENERIC,)
+
+/* instances by (width - CPU_MIN_WIDTH)/2, then tile, then accumulator */
+#define CPU_TILE_ENTRY(width, tile_name, tile) {cpu_float_##tile_name##_##width, cpu_double_##tile_name##_##width},
+#define CPU_ENTRY(width) {CPU_TILES(CPU_TILE_ENTRY,width)},
+
+static const cpu_kernel cpu_kernels[][NUM_CPU_TILES][NUM_CPU_ACCUMULATORS] = {
+  CPU_WIDTHS(CPU_ENTRY)
+};
+
+static const cpu_kernel cpu_generic[NUM_CPU_TILES][NUM_CPU_ACCUMULATORS] = {
+  CPU_TILES(CPU_TILE_ENTRY,generic)
+};
+
+int cpu_is_specialized(unsigned int filter_width){
+  return filter_width >= CPU_MIN_WIDTH && filter_width <= CPU_MAX_WIDTH && filter_width % 2 == 1;
+}
+
+void cpu_convolve2d(const uint8_t *image, size_t image_width, size_t image_height,
+  const float *bank, unsigned int num_filters, unsigned int filter_width, uint8_t *result){
+  cpu_convolve2d_accumulate(CPU_ACCUMULATE_FLOAT,image,image_width,image_height,bank,num_filters,filter_width,result);
+}
+
+void cpu_convolve2d_accumulate(enum cpu_accumulator accumulator, const uint8_t *image, size_t image_width,
+  size_t image_height, const float *bank, unsigned int num_filters, unsigned int filter_width, uint8_t *result){
+  const size_t image_size = image_width*image_height;
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  const enum cpu_tile tile = image_width < CPU_TILE_WIDE ? CPU_NARROW : CPU_WIDE;
+  const cpu_kernel kernel = cpu_is_specialized(filter_width) ?
+    cpu_kernels[(filter_width - CPU_MIN_WIDTH)/2][tile][accumulator] : cpu_generic[tile][accumulator];
+
+  /* zeros around the image as the kernels have, and a tile past its right edge */
+  const size_t radius = (filter_width - 1)/2;
+  const size_t padded_width = image_width + filter_width - 1 + (tile == CPU_WIDE ? CPU_TILE_WIDE : CPU_TILE_NARROW);
+  const size_t padded_height = image_height + filter_width - 1;
+  uint8_t *padded = calloc(padded_width*padded_height,sizeof(uint8_t));
+  for(size_t y = 0; y < image_height; ++y){
+    memcpy(&padded[(y + radius)*padded_width + radius],&image[y*image_width],image_width);
+  }
+
+  for(unsigned int fid = 0; fid < num_filters; ++fid){
+    /* convolution uses the filter backwards, so index it from its last cell */
+    kernel(padded,padded_width,image_width,image_height,&bank[(fid + 1)*filter_len - 1],filter_width,&result[fid*image_size]);
+  }
+  free(padded);
+}
@@ -0,0 +1,48 @@
+/* width specialized convolution on the host CPU
+ * the conventions and results of native_convolve2d, but every odd width
+ * from CPU_MIN_WIDTH to CPU_MAX_WIDTH has its own instances of the loops
+ * with the width, tile and accumulator fixed at compile time, so the
+ * compiler unrolls the taps and vectorizes the tile. the image is zero
+ * padded once per bank so no tap checks the borders. other widths run a
+ * generic instance with the width read at run time
+ */
+
+#ifndef GIMC_CPU_H
+#define GIMC_CPU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* the widths with an instance of their own, the sweep of perf_roofline.sh */
+#define CPU_MIN_WIDTH 3
+#define CPU_MAX_WIDTH 49
+
+/* pixels of a row summed together, one accumulator each. images
+ * narrower than the wide tile take the narrow one, which leaves fewer
+ * accumulators past the end of a row
+ */
+#define CPU_TILE_NARROW 8
+#define CPU_TILE_WIDE 32
+
+enum cpu_accumulator{
+  CPU_ACCUMULATE_FLOAT, /* sums as native_convolve2d and the kernels */
+  CPU_ACCUMULATE_DOUBLE, /* exact products, may differ from float by a level */
+  NUM_CPU_ACCUMULATORS
+};
+
+/* nonzero if a width has an instance of its own */
+extern int cpu_is_specialized(unsigned int filter_width);
+
+/* cpu_convolve2d_accumulate with float sums */
+extern void cpu_convolve2d(const uint8_t *image,size_t image_width,size_t image_height,
+  const float *bank,unsigned int num_filters,unsigned int filter_width,uint8_t *result);
+
+/* convolve a grayscale image with every filter of a bank
+ * image: image_width*image_height pixels
+ * bank: filters laid out as in filter_Gauss2dbank
+ * result: num_filters planes of image_width*image_height pixels
+ */
+extern void cpu_convolve2d_accumulate(enum cpu_accumulator accumulator,const uint8_t *image,size_t image_width,
+  size_t image_height,const float *bank,unsigned int num_filters,unsigned int filter_width,uint8_t *result);
+
+#endif
@@ -0,0 +1,1817 @@
+#include "engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atrous.h"
+#include "budget.h"
+#include "epilogue.h"
+#include "hash.h"
+#include "image.h"
+#include "kgen.h"
+#include "multirate.h"
+#include "rank.h"
+#include "sat.h"
+#include "sparse.h"
+#include "trace.h"
+#include "winograd.h"
+
+/* a scratch buffer of an engine, see scratch_buffer */
+struct engine_scratch{
+  const char *name;
+  unsigned int index;
+  size_t bytes;
+  cl_mem buffer;
+  struct engine_scratch *next;
+};
+
+/* plans of a bank, see gimc_bank. those following an accuracy setting are
+ * made again when the setting changes
+ */
+struct engine_plans{
+  struct sat_plan *sat;
+  unsigned int sat_passes;
+  /* the shrunken weights of every filter go in one buffer, at offsets */
+  struct multirate_plan *multirate;
+  cl_uint *multirate_offsets;
+  cl_mem multirate_weights;
+  double multirate_target;
+  cl_mem sparse_starts;
+  cl_mem sparse_taps;
+  double sparse_threshold;
+  cl_mem steer_kernels;
+  cl_mem steer_coefficients;
+  cl_mem winograd_filters;
+  cl_mem winograd_transforms;
+  cl_mem dilations;
+  struct gimc_bank *dense; /* of a dilated bank, for the engines which don't space out taps */
+};
+
+static void release_buffer(cl_mem buffer){
+  if(buffer){
+    clReleaseMemObject(buffer);
+  }
+}
+
+void gimc_cl_init(struct gimc_cl *cl, cl_device_type device_type, cl_command_queue_properties properties){
+  cl_platform_id *platform_ids;
+  cl_uint num_platforms;
+  cl_uint num_devices;
+  cl_int err;
+
+  /* get all of the platforms */
+  clGetPlatformIDs(0,NULL,&num_platforms);
+  platform_ids = malloc(sizeof(cl_platform_id) * num_platforms);
+  err = clGetPlatformIDs(num_platforms,platform_ids,&num_platforms);
+  if(err){
+    print_error("clGetPlatformIDs()",err);
+    exit(EXIT_FAILURE);
+  }
+
+  /* get a device on the platforms which corresponds to the device type specified */
+  cl->device = NULL;
+  for(unsigned int i = 0; i < num_platforms; ++i){
+    num_devices = 0;
+    clGetDeviceIDs(platform_ids[i],device_type,0,NULL,&num_devices);
+    if(num_devices > 0){
+      err = clGetDeviceIDs(platform_ids[i],device_type,1,&cl->device,&num_devices);
+      if(err != CL_SUCCESS && err != CL_DEVICE_NOT_FOUND){
+        print_error("clGetDeviceIDs()",err);
+        exit(EXIT_FAILURE);
+      }
+      cl->platform = platform_ids[i];
+      break;
+    }
+  }
+  free(platform_ids);
+  if(cl->device == NULL){
+    fprintf(stderr,"No OpenCL device of the requested type\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* create context */
+  cl->context = clCreateContext(NULL,1,&cl->device,NULL,NULL,&err);
+  if(err){
+    print_error("clCreateContext()",err);
+    exit(EXIT_FAILURE);
+  }
+
+  /* create command queue */
+  cl->commands = clCreateCommandQueue(cl->context,cl->device,properties | trace_queue_properties(),&err);
+  if(err){
+    print_error("clCreateCommandQueue()",err);
+    exit(EXIT_FAILURE);
+  }
+
+  cl->programs = program_cache_create(cl->context,cl->device);
+  cl->scratch_bytes = 0;
+  cl->scratch = NULL;
+}
+
+void gimc_cl_release(struct gimc_cl *cl){
+  while(cl->scratch){
+    struct engine_scratch *next = cl->scratch->next;
+    release_buffer(cl->scratch->buffer);
+    free(cl->scratch);
+    cl->scratch = next;
+  }
+  program_cache_release(cl->programs);
+  clReleaseCommandQueue(cl->commands);
+  clReleaseContext(cl->context);
+}
+
+void gimc_budget_device(struct gimc_cl *cl, size_t megabytes, struct gimc_budget *budget){
+  cl_ulong global_mem = 0;
+  cl_ulong max_alloc = 0;
+  clGetDeviceInfo(cl->device,CL_DEVICE_GLOBAL_MEM_SIZE,sizeof(cl_ulong),&global_mem,NULL);
+  clGetDeviceInfo(cl->device,CL_DEVICE_MAX_MEM_ALLOC_SIZE,sizeof(cl_ulong),&max_alloc,NULL);
+  budget->device_bytes = (size_t)(global_mem*BUDGET_DEVICE_SHARE);
+  budget->max_alloc = max_alloc;
+  budget->host_bytes = budget_host_bytes();
+  budget_limit(budget,megabytes ? megabytes : budget_env_megabytes());
+}
+
+cl_device_type gimc_device_type(const char *option){
+  switch(atoi(option)){
+  case 0:
+    return CL_DEVICE_TYPE_CPU;
+  case 1:
+  default:
+    return CL_DEVICE_TYPE_GPU;
+  }
+}
+
+cl_mem gimc_image_buffer(struct gimc_cl *cl, const struct gimc_image *image, cl_int *err){
+  const size_t image_size = image->width*image->height;
+  if(image->mapping){
+    /* the mapping is read only, which CL_MEM_READ_ONLY promises to respect */
+    cl_mem buffer = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,image_size,image->bits,err);
+    if(*err){
+      print_error("clCreateBuffer() image",*err);
+    }
+    return buffer;
+  }
+
+  cl_mem buffer = clCreateBuffer(cl->context,CL_MEM_READ_ONLY,image_size,NULL,err);
+  if(*err){
+    print_error("clCreateBuffer() image",*err);
+    return buffer;
+  }
+  *err = clEnqueueWriteBuffer(cl->commands,buffer,CL_FALSE,0,image_size,image->bits,0,NULL,trace_event("write image"));
+  if(*err){
+    print_error("clEnqueueWriteBuffer() image",*err);
+  }
+  return buffer;
+}
+
+/* gimc_bank_upload of filters of width*height */
+static cl_int bank_upload(struct gimc_cl *cl, struct gimc_bank *bank, const float *weights, unsigned int num_filters,
+  unsigned int width, unsigned int height){
+  cl_int err;
+  const size_t bank_len = (size_t)width*height*num_filters;
+  bank->num_filters = num_filters;
+  bank->width = width;
+  bank->height = height;
+  memset(&bank->steerable,0,sizeof(struct filter_steerable));
+  bank->dilations = NULL;
+  bank->widths = NULL;
+  bank->heights = NULL;
+  bank->buckets = NULL;
+  bank->num_buckets = 0;
+  bank->plans = calloc(1,sizeof(struct engine_plans));
+  bank->weights = malloc(sizeof(float)*bank_len);
+  memcpy(bank->weights,weights,sizeof(float)*bank_len);
+  bank->filters = clCreateBuffer(cl->context,CL_MEM_READ_ONLY,sizeof(float)*bank_len,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() bank",err);
+    return err;
+  }
+  return clEnqueueWriteBuffer(cl->commands,bank->filters,CL_TRUE,0,sizeof(float)*bank_len,bank->weights,0,NULL,trace_event("write filter"));
+}
+
+cl_int gimc_bank_upload(struct gimc_cl *cl, struct gimc_bank *bank, const float *weights, unsigned int num_filters, unsigned int width){
+  return bank_upload(cl,bank,weights,num_filters,width,width);
+}
+
+cl_int gimc_bank_Gauss2d(struct gimc_cl *cl, struct gimc_bank *bank, unsigned int num_filters, unsigned int width){
+  cl_int err;
+  const size_t filter_len = (size_t)width*width;
+  bank->num_filters = num_filters;
+  bank->width = width;
+  bank->height = width;
+  memset(&bank->steerable,0,sizeof(struct filter_steerable));
+  bank->dilations = NULL;
+  bank->widths = NULL;
+  bank->heights = NULL;
+  bank->buckets = NULL;
+  bank->num_buckets = 0;
+  bank->plans = calloc(1,sizeof(struct engine_plans));
+  bank->weights = malloc(sizeof(float)*filter_len*num_filters);
+  bank->filters = clCreateBuffer(cl->context,CL_MEM_READ_WRITE,sizeof(float)*filter_len*num_filters,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() bank",err);
+    return err;
+  }
+
+  cl_program program = program_cache_build(cl->programs,"lwfilter.cl",NULL);
+  if(program == NULL){
+    return CL_BUILD_PROGRAM_FAILURE;
+  }
+
+  /* populate filters with opencl */
+  cl_kernel kernel_bank = clCreateKernel(program,"filter_Gauss2dbank",&err);
+  if(err){
+    print_error("clCreateKernel() filter_Gauss2dbank",err);
+    return err;
+  }
+
+  err = clSetKernelArg(kernel_bank,0,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(kernel_bank,1,sizeof(unsigned int),&num_filters);
+  err |= clSetKernelArg(kernel_bank,2,sizeof(unsigned int),&width);
+
+  const size_t bank_global[2] = {num_filters,filter_len};
+  err = clEnqueueNDRangeKernel(cl->commands,kernel_bank,2,NULL,bank_global,NULL,0,NULL,trace_event("filter_Gauss2dbank"));
+  clReleaseKernel(kernel_bank);
+  if(err){
+    print_error("clEnqueueNDRangeKernel() filter_Gauss2dbank",err);
+    return err;
+  }
+
+  /* gaussians are normalized filters, have to execute a normalizing
+   * kernel so that there is an implicit barrier
+   */
+  cl_kernel kernel_normalize = clCreateKernel(program,"filter_normalize",&err);
+  if(err){
+    print_error("clCreateKernel() filter_normalize",err);
+    return err;
+  }
+
+  err = clSetKernelArg(kernel_normalize,0,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(kernel_normalize,1,sizeof(unsigned int),&num_filters);
+  err |= clSetKernelArg(kernel_normalize,2,sizeof(unsigned int),&width);
+
+  const size_t normalize_global[1] = {num_filters};
+  err = clEnqueueNDRangeKernel(cl->commands,kernel_normalize,1,NULL,normalize_global,NULL,0,NULL,trace_event("filter_normalize"));
+  clReleaseKernel(kernel_normalize);
+  if(err){
+    print_error("clEnqueueNDRangeKernel() filter_normalize",err);
+    return err;
+  }
+
+  /* keep a host copy for engines which need the weights on the host */
+  return clEnqueueReadBuffer(cl->commands,bank->filters,CL_TRUE,0,sizeof(float)*filter_len*num_filters,bank->weights,0,NULL,trace_event("read filter"));
+}
+
+cl_int gimc_bank_steerable(struct gimc_cl *cl, struct gimc_bank *bank, const struct filter_steerable *steer, unsigned int width){
+  const unsigned int num_filters = filter_steerable_count(steer);
+  float *weights = malloc(sizeof(float)*width*width*num_filters);
+  filter_steerable_bank(weights,steer,width);
+  cl_int err = gimc_bank_upload(cl,bank,weights,num_filters,width);
+  bank->steerable = *steer;
+  free(weights);
+  return err;
+}
+
+cl_int gimc_bank_dilated(struct gimc_cl *cl, struct gimc_bank *bank, const float *weights, const unsigned int *dilations,
+  unsigned int num_filters, unsigned int width){
+  cl_int err = gimc_bank_upload(cl,bank,weights,num_filters,width);
+  bank->dilations = malloc(sizeof(unsigned int)*num_filters);
+  memcpy(bank->dilations,dilations,sizeof(unsigned int)*num_filters);
+  return err;
+}
+
+cl_int gimc_bank_adaptive(struct gimc_cl *cl, struct gimc_bank *bank, const float *weights, const unsigned int *widths,
+  const unsigned int *heights, unsigned int num_filters, unsigned int width){
+  cl_int err = gimc_bank_upload(cl,bank,weights,num_filters,width);
+  bank->widths = malloc(sizeof(unsigned int)*num_filters);
+  memcpy(bank->widths,widths,sizeof(unsigned int)*num_filters);
+  bank->heights = malloc(sizeof(unsigned int)*num_filters);
+  memcpy(bank->heights,heights ? heights : widths,sizeof(unsigned int)*num_filters);
+  bank->buckets = malloc(sizeof(struct gimc_bucket)*num_filters);
+
+  size_t *offsets = malloc(sizeof(size_t)*num_filters);
+  float *packed = malloc(sizeof(float)*width*width*num_filters);
+  float *cropped = malloc(sizeof(float)*width*width*num_filters);
+  filter_pack_bank(packed,offsets,weights,bank->widths,bank->heights,num_filters,width);
+  for(unsigned int f = 0; f < num_filters && !err; ++f){
+    int seen = 0;
+    for(unsigned int b = 0; b < bank->num_buckets; ++b){
+      seen |= bank->buckets[b].bank.width == widths[f] && bank->buckets[b].bank.height == bank->heights[f];
+    }
+    if(seen){
+      continue;
+    }
+    struct gimc_bucket *bucket = &bank->buckets[bank->num_buckets];
+    const size_t filter_len = (size_t)widths[f]*bank->heights[f];
+    unsigned int count = 0;
+    bucket->filters = malloc(sizeof(unsigned int)*num_filters);
+    for(unsigned int g = f; g < num_filters; ++g){
+      if(widths[g] == widths[f] && bank->heights[g] == bank->heights[f]){
+        memcpy(&cropped[count*filter_len],&packed[offsets[g]],sizeof(float)*filter_len);
+        bucket->filters[count++] = g;
+      }
+    }
+    err = bank_upload(cl,&bucket->bank,cropped,count,widths[f],bank->heights[f]);
+    if(!err && widths[f] != bank->heights[f]){
+      const unsigned int side = widths[f] > bank->heights[f] ? widths[f] : bank->heights[f];
+      size_t offset;
+      for(unsigned int i = 0; i < count; ++i){
+        filter_pack_bank(&cropped[i*side*side],&offset,&weights[(size_t)bucket->filters[i]*width*width],&side,NULL,1,width);
+      }
+      err = gimc_bank_upload(cl,&bucket->square,cropped,count,side);
+    }
+    ++bank->num_buckets;
+  }
+  free(offsets);
+  free(packed);
+  free(cropped);
+  return err;
+}
+
+/* release the multirate plans of the num_filters filters of a bank */
+static void multirate_release(struct engine_plans *plans, unsigned int num_filters){
+  if(plans->multirate){
+    for(unsigned int f = 0; f < num_filters; ++f){
+      multirate_plan_release(&plans->multirate[f]);
+    }
+  }
+  free(plans->multirate);
+  free(plans->multirate_offsets);
+  release_buffer(plans->multirate_weights);
+  plans->multirate = NULL;
+  plans->multirate_offsets = NULL;
+  plans->multirate_weights = NULL;
+}
+
+static void plans_release(struct engine_plans *plans, unsigned int num_filters){
+  free(plans->sat);
+  multirate_release(plans,num_filters);
+  cl_mem buffers[7] = {plans->sparse_starts, plans->sparse_taps, plans->steer_kernels, plans->steer_coefficients,
+    plans->winograd_filters, plans->winograd_transforms, plans->dilations};
+  for(int i = 0; i < 7; ++i){
+    release_buffer(buffers[i]);
+  }
+  if(plans->dense){
+    gimc_bank_release(plans->dense);
+    free(plans->dense);
+  }
+  free(plans);
+}
+
+void gimc_bank_release(struct gimc_bank *bank){
+  clReleaseMemObject(bank->filters);
+  plans_release(bank->plans,bank->num_filters);
+  free(bank->weights);
+  free(bank->dilations);
+  free(bank->widths);
+  free(bank->heights);
+  for(unsigned int b = 0; b < bank->num_buckets; ++b){
+    gimc_bank_release(&bank->buckets[b].bank);
+    if(bank->buckets[b].bank.width != bank->buckets[b].bank.height){
+      gimc_bank_release(&bank->buckets[b].square);
+    }
+    free(bank->buckets[b].filters);
+  }
+  free(bank->buckets);
+}
+
+static const char *engine_names[NUM_ENGINES] = {
+  "base",
+  "lwf",
+  "lwf_local",
+  "lwf_partials",
+  "lwf_fused",
+  "baked",
+  "sat",
+  "multirate",
+  "steerable",
+  "winograd",
+  "atrous",
+  "sparse",
+  "erode",
+  "dilate",
+  "median"
+};
+
+const char *engine_name(enum engine_id engine){
+  return engine < NUM_ENGINES ? engine_names[engine] : "unknown";
+}
+
+int engine_is_linear(enum engine_id engine){
+  return engine != ENGINE_ERODE && engine != ENGINE_DILATE && engine != ENGINE_MEDIAN;
+}
+
+const struct gimc_bank *gimc_bucket_bank(const struct gimc_bucket *bucket, enum engine_id engine){
+  if(bucket->bank.width == bucket->bank.height || engine == ENGINE_BASE || engine == ENGINE_LWF){
+    return &bucket->bank;
+  }
+  return &bucket->square;
+}
+
+enum engine_id engine_from_name(const char *name){
+  for(int i = 0; i < NUM_ENGINES; ++i){
+    if(strcmp(name,engine_names[i]) == 0){
+      return i;
+    }
+  }
+  return NUM_ENGINES;
+}
+
+/* enqueue a kernel, timing it if asked to and tracing it otherwise */
+static cl_int enqueue_kernel(struct gimc_cl *cl, cl_kernel kernel, const char *name, cl_uint dims,
+  const size_t *offset, const size_t *global, const size_t *local, struct engine_timing *timing){
+  cl_event event;
+  cl_int err = clEnqueueNDRangeKernel(cl->commands,kernel,dims,offset,global,local,0,NULL,
+    timing ? &event : trace_event(name));
+  if(err){
+    fprintf(stderr,"Error when calling clEnqueueNDRangeKernel() %s, code: %d\n",name,err);
+    return err;
+  }
+
+  if(timing){
+    cl_ulong start, end;
+    clWaitForEvents(1,&event);
+    clGetEventProfilingInfo(event,CL_PROFILING_COMMAND_START,sizeof(cl_ulong),&start,NULL);
+    clGetEventProfilingInfo(event,CL_PROFILING_COMMAND_END,sizeof(cl_ulong),&end,NULL);
+    clReleaseEvent(event);
+    timing->seconds += (end - start)*1e-9;
+    ++timing->launches;
+  }
+  return CL_SUCCESS;
+}
+
+/* create a kernel of a program built for the sizes of this convolution */
+static cl_kernel create_kernel(struct gimc_cl *cl, const char *filename, const char *name,
+  size_t width, size_t height, const struct gimc_bank *bank, cl_int *err){
+  const struct kernel_spec spec = {bank->width,bank->height,width,height,bank->num_filters};
+  cl_program program = program_cache_build(cl->programs,filename,&spec);
+  if(program == NULL){
+    *err = CL_BUILD_PROGRAM_FAILURE;
+    return NULL;
+  }
+
+  cl_kernel kernel = program_cache_kernel(cl->programs,program,name,err);
+  if(*err){
+    print_error("clCreateKernel()",*err);
+  }
+  return kernel;
+}
+
+/* scratch buffer index of name, of at least bytes, kept for as long as cl
+ * engines run in order on cl->commands, so a later convolution only writes
+ * it once earlier ones are done with it. the buffer is retained for the
+ * caller, who releases it as one from clCreateBuffer
+ */
+static cl_mem scratch_buffer(struct gimc_cl *cl, const char *name, unsigned int index, size_t bytes, cl_int *err){
+  struct engine_scratch *entry = cl->scratch;
+  while(entry && (entry->index != index || strcmp(entry->name,name))){
+    entry = entry->next;
+  }
+  if(entry == NULL){
+    entry = calloc(1,sizeof(struct engine_scratch));
+    entry->name = name;
+    entry->index = index;
+    entry->next = cl->scratch;
+    cl->scratch = entry;
+  }
+  if(entry->buffer == NULL || entry->bytes < bytes){
+    /* the old buffer goes once the queue is done with it */
+    release_buffer(entry->buffer);
+    entry->buffer = clCreateBuffer(cl->context,CL_MEM_READ_WRITE,bytes,NULL,err);
+    entry->bytes = bytes;
+    if(*err){
+      entry->buffer = NULL;
+      return NULL;
+    }
+  }
+  *err = clRetainMemObject(entry->buffer);
+  return entry->buffer;
+}
+
+static cl_int convolve_base(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  cl_int err;
+  cl_kernel kernel = create_kernel(cl,"base.cl","convolve2d",width,height,bank,&err);
+  if(err){
+    return err;
+  }
+
+  const unsigned int image_width = width;
+  const unsigned int image_height = height;
+  const cl_ulong filter_width = bank->width;
+  const cl_ulong filter_height = bank->height;
+  err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+  err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(kernel,2,sizeof(cl_mem),&result);
+  err |= clSetKernelArg(kernel,3,sizeof(unsigned int),&image_width);
+  err |= clSetKernelArg(kernel,4,sizeof(unsigned int),&image_height);
+  err |= clSetKernelArg(kernel,5,sizeof(cl_ulong),&filter_width);
+  err |= clSetKernelArg(kernel,6,sizeof(cl_ulong),&filter_height);
+  err |= clSetKernelArg(kernel,7,sizeof(unsigned int),&bank->num_filters);
+
+  const size_t global[2] = {width*height, bank->num_filters};
+  if(!err){
+    err = enqueue_kernel(cl,kernel,"convolve2d",2,NULL,global,NULL,timing);
+  }
+  clReleaseKernel(kernel);
+  return err;
+}
+
+static cl_int convolve_lwf(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  cl_int err;
+  cl_kernel kernel = create_kernel(cl,"lwfilter.cl","convolve2d",width,height,bank,&err);
+  if(err){
+    return err;
+  }
+
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+  err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(kernel,2,sizeof(cl_mem),&result);
+  err |= clSetKernelArg(kernel,3,sizeof(cl_ulong),&image_width);
+  err |= clSetKernelArg(kernel,4,sizeof(cl_ulong),&image_height);
+  err |= clSetKernelArg(kernel,5,sizeof(unsigned int),&bank->width);
+  err |= clSetKernelArg(kernel,6,sizeof(unsigned int),&bank->height);
+  err |= clSetKernelArg(kernel,7,sizeof(unsigned int),&bank->num_filters);
+
+  const size_t global[2] = {width*height, bank->num_filters};
+  if(!err){
+    err = enqueue_kernel(cl,kernel,"convolve2d",2,NULL,global,NULL,timing);
+  }
+  clReleaseKernel(kernel);
+  return err;
+}
+
+static cl_int convolve_lwf_local(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  cl_int err;
+  cl_kernel kernel = create_kernel(cl,"lwfilter_local.cl","convolve2d",width,height,bank,&err);
+  if(err){
+    return err;
+  }
+
+  /* size of local work groups */
+  const size_t local_size = 4;
+  const size_t filter_len = (size_t)bank->width*bank->width;
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+  err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(kernel,2,sizeof(cl_mem),&result);
+  err |= clSetKernelArg(kernel,3,sizeof(float)*local_size,NULL); /* scratch */
+  err |= clSetKernelArg(kernel,4,sizeof(float)*filter_len,NULL); /* fwork */
+  err |= clSetKernelArg(kernel,5,sizeof(cl_ulong),&image_width);
+  err |= clSetKernelArg(kernel,6,sizeof(cl_ulong),&image_height);
+  err |= clSetKernelArg(kernel,7,sizeof(unsigned int),&bank->width);
+  err |= clSetKernelArg(kernel,8,sizeof(unsigned int),&bank->num_filters);
+
+  const size_t global[3] = {width*height, bank->num_filters, local_size};
+  const size_t local[3] = {1,1,local_size};
+  if(!err){
+    err = enqueue_kernel(cl,kernel,"convolve2d",3,NULL,global,local,timing);
+  }
+  clReleaseKernel(kernel);
+  return err;
+}
+
+static cl_int convolve_lwf_partials(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  cl_int err;
+  cl_kernel kernel = create_kernel(cl,"lwfilter_partials.cl","convolve2d",width,height,bank,&err);
+  if(err){
+    return err;
+  }
+  cl_kernel kernel_reduce = create_kernel(cl,"lwfilter_partials.cl","convolve2d_reduce",width,height,bank,&err);
+  if(err){
+    clReleaseKernel(kernel);
+    return err;
+  }
+
+  const size_t image_size = width*height;
+  const size_t filter_len = (size_t)bank->width*bank->width;
+  const size_t local_size = next_multiple(bank->width,32);
+
+  /* get the number of total work groups */
+  const size_t global_filter_len = next_multiple(filter_len,local_size);
+  const cl_ulong workgroups_per_pixel = global_filter_len/local_size;
+  /* can't allocate the entire memory for reducing partial sums, way too large for some image_size's
+   * and device memory is limited (1.949GiB for the GTX 960 this is being developed for)
+   * and memory which can be allocated on device is even lower than that
+   * so we divide kernel execution to execute seperate workloads of pixels
+   * whose partial sums fit in what the budget leaves to scratch
+   */
+  struct gimc_budget budget;
+  gimc_budget_device(cl,0,&budget);
+  const size_t scratch = cl->scratch_bytes ? cl->scratch_bytes : budget.max_alloc;
+  const size_t psum_per_pixel = workgroups_per_pixel*bank->num_filters;
+  size_t workload_size = scratch/sizeof(float)/psum_per_pixel;
+  if(workload_size == 0){
+    workload_size = 1;
+  }
+  const size_t workload_total = (image_size + workload_size - 1)/workload_size;
+  const size_t psum_len = (image_size < workload_size ? image_size : workload_size)*psum_per_pixel;
+  cl_mem psum = scratch_buffer(cl,"psum",0,sizeof(float)*psum_len,&err);
+  if(err){
+    print_error("clCreateBuffer() psum",err);
+    clReleaseKernel(kernel);
+    clReleaseKernel(kernel_reduce);
+    return err;
+  }
+
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+  err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(kernel,2,sizeof(float)*local_size,NULL); /* scratch */
+  err |= clSetKernelArg(kernel,3,sizeof(cl_mem),&psum);
+  err |= clSetKernelArg(kernel,4,sizeof(cl_ulong),&image_width);
+  err |= clSetKernelArg(kernel,5,sizeof(cl_ulong),&image_height);
+  err |= clSetKernelArg(kernel,6,sizeof(unsigned int),&bank->width);
+  err |= clSetKernelArg(kernel,7,sizeof(unsigned int),&bank->width);
+  err |= clSetKernelArg(kernel,8,sizeof(unsigned int),&bank->num_filters);
+
+  /* set arguments for reduction kernel */
+  err |= clSetKernelArg(kernel_reduce,0,sizeof(cl_mem),&psum);
+  err |= clSetKernelArg(kernel_reduce,1,sizeof(cl_mem),&result);
+  err |= clSetKernelArg(kernel_reduce,2,sizeof(cl_ulong),&image_width);
+  err |= clSetKernelArg(kernel_reduce,3,sizeof(cl_ulong),&image_height);
+  err |= clSetKernelArg(kernel_reduce,4,sizeof(cl_ulong),&workgroups_per_pixel);
+
+  const size_t convolve_local[3] = {1,1,local_size};
+  for(size_t i = 0; i < workload_total && !err; ++i){
+    const size_t start = i*workload_size;
+    const size_t pixels = image_size - start < workload_size ? image_size - start : workload_size;
+    const size_t convolve_offset[3] = {start,0,0};
+    const size_t convolve_global[3] = {pixels, bank->num_filters, global_filter_len};
+    err = enqueue_kernel(cl,kernel,"convolve2d",3,convolve_offset,convolve_global,convolve_local,timing);
+    if(err){
+      break;
+    }
+
+    /* perform reduction step */
+    const size_t reduce_offset[2] = {start,0};
+    const size_t reduce_global[2] = {pixels,bank->num_filters};
+    err = enqueue_kernel(cl,kernel_reduce,"convolve2d_reduce",2,reduce_offset,reduce_global,NULL,timing);
+  }
+
+  clReleaseMemObject(psum);
+  clReleaseKernel(kernel);
+  clReleaseKernel(kernel_reduce);
+  return err;
+}
+
+static cl_int convolve_lwf_fused(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  cl_int err;
+  cl_kernel kernel = create_kernel(cl,"lwfilter_fused.cl","convolve2d",width,height,bank,&err);
+  if(err){
+    return err;
+  }
+
+  const size_t filter_len = (size_t)bank->width*bank->width;
+
+  /* lanes splitting the taps of a pixel, a power of two no larger than needed */
+  size_t lanes = 32;
+  while(lanes > 1 && lanes/2 >= filter_len){
+    lanes /= 2;
+  }
+  /* pixels covered by each work group */
+  size_t block = 256/lanes;
+
+  /* shrink the work group until it fits on the device */
+  size_t max_group_size;
+  clGetKernelWorkGroupInfo(kernel,cl->device,CL_KERNEL_WORK_GROUP_SIZE,sizeof(size_t),&max_group_size,NULL);
+  while(lanes > max_group_size){
+    lanes /= 2;
+  }
+  while(block > 1 && lanes*block > max_group_size){
+    block /= 2;
+  }
+
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+  err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(kernel,2,sizeof(cl_mem),&result);
+  err |= clSetKernelArg(kernel,3,sizeof(float)*lanes*block,NULL); /* scratch */
+  err |= clSetKernelArg(kernel,4,sizeof(float)*filter_len,NULL); /* fwork */
+  err |= clSetKernelArg(kernel,5,sizeof(cl_ulong),&image_width);
+  err |= clSetKernelArg(kernel,6,sizeof(cl_ulong),&image_height);
+  err |= clSetKernelArg(kernel,7,sizeof(unsigned int),&bank->width);
+  err |= clSetKernelArg(kernel,8,sizeof(unsigned int),&bank->num_filters);
+
+  const size_t global[3] = {lanes, next_multiple(width*height,block), bank->num_filters};
+  const size_t local[3] = {lanes, block, 1};
+  if(!err){
+    err = enqueue_kernel(cl,kernel,"convolve2d",3,NULL,global,local,timing);
+  }
+  clReleaseKernel(kernel);
+  return err;
+}
+
+static cl_int convolve_baked(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  cl_int err;
+  const size_t bank_len = (size_t)bank->width*bank->width*bank->num_filters;
+
+  /* generate and build a program with the bank baked in */
+  char program_name[64];
+  snprintf(program_name,sizeof(program_name),"kgen_%016llx_%u_%u",
+    (unsigned long long)gimc_hash64(bank->weights,sizeof(float)*bank_len,0),bank->num_filters,bank->width);
+  char *kernel_source = kgen_cl_source(bank->weights,bank->num_filters,bank->width);
+  cl_program program = program_cache_build_source(cl->programs,program_name,kernel_source);
+  free(kernel_source);
+  if(program == NULL){
+    return CL_BUILD_PROGRAM_FAILURE;
+  }
+
+  cl_kernel kernel = program_cache_kernel(cl->programs,program,"convolve2d_baked",&err);
+  if(err){
+    print_error("clCreateKernel() convolve2d_baked",err);
+    return err;
+  }
+
+  /* no filter buffer as the weights are in the program */
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+  err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&result);
+  err |= clSetKernelArg(kernel,2,sizeof(cl_ulong),&image_width);
+  err |= clSetKernelArg(kernel,3,sizeof(cl_ulong),&image_height);
+
+  const size_t global[2] = {width*height, bank->num_filters};
+  if(!err){
+    err = enqueue_kernel(cl,kernel,"convolve2d_baked",2,NULL,global,NULL,timing);
+  }
+  clReleaseKernel(kernel);
+  return err;
+}
+
+/* create a kernel of sat.cl, which takes every size as an argument */
+static cl_kernel create_sat_kernel(struct gimc_cl *cl, const char *name, cl_int *err){
+  cl_program program = program_cache_build(cl->programs,"sat.cl",NULL);
+  if(program == NULL){
+    *err = CL_BUILD_PROGRAM_FAILURE;
+    return NULL;
+  }
+
+  cl_kernel kernel = program_cache_kernel(cl->programs,program,name,err);
+  if(*err){
+    print_error("clCreateKernel()",*err);
+  }
+  return kernel;
+}
+
+static cl_int convolve_sat(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  cl_int err = CL_SUCCESS;
+  const size_t filter_len = (size_t)bank->width*bank->width;
+
+  /* every filter is planned once, the planes between passes need room for the widest padding */
+  struct engine_plans *resident = bank->plans;
+  const unsigned int passes = sat_passes();
+  if(resident->sat == NULL || resident->sat_passes != passes){
+    free(resident->sat);
+    resident->sat = malloc(sizeof(struct sat_plan)*(bank->num_filters ? bank->num_filters : 1));
+    resident->sat_passes = passes;
+    for(unsigned int f = 0; f < bank->num_filters; ++f){
+      sat_plan_filter(&bank->weights[f*filter_len],bank->width,passes,&resident->sat[f]);
+    }
+  }
+  const struct sat_plan *plans = resident->sat;
+  int approximate = 0;
+  size_t max_padding = 0;
+  for(unsigned int f = 0; f < bank->num_filters; ++f){
+    approximate |= !plans[f].exact;
+    if(sat_plan_padding(&plans[f]) > max_padding){
+      max_padding = sat_plan_padding(&plans[f]);
+    }
+  }
+  const size_t table_size = (width + 2*max_padding)*(height + 2*max_padding);
+
+  cl_kernel rows = create_sat_kernel(cl,"integral_rows",&err);
+  cl_kernel rows_plane = err ? NULL : create_sat_kernel(cl,"integral_rows_plane",&err);
+  cl_kernel cols = err ? NULL : create_sat_kernel(cl,"integral_cols",&err);
+  cl_kernel box_pass = err ? NULL : create_sat_kernel(cl,"box_pass",&err);
+  cl_kernel box_result = err ? NULL : create_sat_kernel(cl,"box_result",&err);
+  cl_mem sat = NULL, plane = NULL;
+  if(!err){
+    sat = scratch_buffer(cl,"sat",0,sizeof(cl_long)*table_size,&err);
+  }
+  if(!err && approximate){
+    plane = scratch_buffer(cl,"sat plane",0,sizeof(float)*table_size,&err);
+  }
+  if(err){
+    print_error("setting up sat engine",err);
+  }
+
+  /* arguments which are the same for every pass */
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  if(!err){
+    err = clSetKernelArg(rows,0,sizeof(cl_mem),&image);
+    err |= clSetKernelArg(rows,1,sizeof(cl_mem),&sat);
+    err |= clSetKernelArg(rows,2,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(rows,3,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(rows_plane,0,sizeof(cl_mem),&plane);
+    err |= clSetKernelArg(rows_plane,1,sizeof(cl_mem),&sat);
+    err |= clSetKernelArg(cols,0,sizeof(cl_mem),&sat);
+    err |= clSetKernelArg(box_pass,0,sizeof(cl_mem),&sat);
+    err |= clSetKernelArg(box_pass,1,sizeof(cl_mem),&plane);
+    err |= clSetKernelArg(box_result,0,sizeof(cl_mem),&sat);
+    err |= clSetKernelArg(box_result,1,sizeof(cl_mem),&result);
+    err |= clSetKernelArg(box_result,4,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(box_result,5,sizeof(cl_ulong),&image_height);
+    if(err){
+      print_error("clSetKernelArg() sat",err);
+    }
+  }
+
+  for(unsigned int f = 0; f < bank->num_filters && !err; ++f){
+    /* the first table is of the image, later ones of planes padded on every side */
+    const cl_long padding = sat_plan_padding(&plans[f]);
+    const cl_ulong plane_width = width + 2*padding;
+    const cl_ulong plane_height = height + 2*padding;
+    for(unsigned int p = 0; p < plans[f].passes && !err; ++p){
+      const cl_ulong table_width = p == 0 ? image_width : plane_width;
+      const cl_ulong table_height = p == 0 ? image_height : plane_height;
+      const size_t rows_global[1] = {table_height};
+      const size_t cols_global[1] = {table_width};
+      if(p > 0){
+        err = clSetKernelArg(rows_plane,2,sizeof(cl_ulong),&table_width);
+        err |= clSetKernelArg(rows_plane,3,sizeof(cl_ulong),&table_height);
+      }
+      err |= clSetKernelArg(cols,1,sizeof(cl_ulong),&table_width);
+      err |= clSetKernelArg(cols,2,sizeof(cl_ulong),&table_height);
+      if(err){
+        print_error("clSetKernelArg() integral",err);
+        break;
+      }
+      err = enqueue_kernel(cl,p == 0 ? rows : rows_plane,"integral_rows",1,NULL,rows_global,NULL,timing);
+      if(!err){
+        err = enqueue_kernel(cl,cols,"integral_cols",1,NULL,cols_global,NULL,timing);
+      }
+      if(err){
+        break;
+      }
+
+      /* pixel x,y of a plane or of the result is centered on x+offset,y+offset of the table */
+      const struct sat_box *box = &plans[f].boxes[p];
+      const int last = p == plans[f].passes - 1;
+      const cl_long offset = last ? (p == 0 ? 0 : padding) : (p == 0 ? -padding : 0);
+      cl_kernel kernel = last ? box_result : box_pass;
+      err = clSetKernelArg(kernel,2,sizeof(cl_ulong),&table_width);
+      err |= clSetKernelArg(kernel,3,sizeof(cl_ulong),&table_height);
+      if(!last){
+        err |= clSetKernelArg(kernel,4,sizeof(cl_ulong),&plane_width);
+        err |= clSetKernelArg(kernel,5,sizeof(cl_ulong),&plane_height);
+      }
+      err |= clSetKernelArg(kernel,6,sizeof(cl_long),&offset);
+      err |= clSetKernelArg(kernel,7,sizeof(unsigned int),&box->radius);
+      err |= clSetKernelArg(kernel,8,sizeof(float),&box->inner);
+      err |= clSetKernelArg(kernel,9,sizeof(float),&box->edge);
+      err |= clSetKernelArg(kernel,10,sizeof(float),&box->corner);
+      if(last){
+        err |= clSetKernelArg(kernel,11,sizeof(unsigned int),&f);
+      }
+      if(err){
+        print_error("clSetKernelArg() box",err);
+        break;
+      }
+      const size_t box_global[2] = {last ? width : plane_width, last ? height : plane_height};
+      err = enqueue_kernel(cl,kernel,last ? "box_result" : "box_pass",2,NULL,box_global,NULL,timing);
+    }
+  }
+
+  /* buffers are released once the queue is done with them */
+  if(sat){
+    clReleaseMemObject(sat);
+  }
+  if(plane){
+    clReleaseMemObject(plane);
+  }
+  cl_kernel kernels[5] = {rows, rows_plane, cols, box_pass, box_result};
+  for(int i = 0; i < 5; ++i){
+    if(kernels[i]){
+      clReleaseKernel(kernels[i]);
+    }
+  }
+  return err;
+}
+
+/* cells kept around every level, LEVEL_MARGIN in multirate.cl */
+#define LEVEL_MARGIN 2
+
+/* plan every filter of a bank for target, their shrunken weights go in one buffer */
+static cl_int multirate_resident(struct gimc_cl *cl, const struct gimc_bank *bank, double target){
+  struct engine_plans *resident = bank->plans;
+  const size_t filter_len = (size_t)bank->width*bank->width;
+  multirate_release(resident,bank->num_filters);
+  resident->multirate = malloc(sizeof(struct multirate_plan)*(bank->num_filters ? bank->num_filters : 1));
+  resident->multirate_offsets = malloc(sizeof(cl_uint)*(bank->num_filters ? bank->num_filters : 1));
+  resident->multirate_target = target;
+  size_t weights_len = 0;
+  for(unsigned int f = 0; f < bank->num_filters; ++f){
+    multirate_plan_filter(&bank->weights[f*filter_len],bank->width,target,&resident->multirate[f]);
+    resident->multirate_offsets[f] = weights_len;
+    weights_len += (size_t)resident->multirate[f].width*resident->multirate[f].width;
+  }
+  float *weights = malloc(sizeof(float)*(weights_len ? weights_len : 1));
+  for(unsigned int f = 0; f < bank->num_filters; ++f){
+    const struct multirate_plan *plan = &resident->multirate[f];
+    memcpy(&weights[resident->multirate_offsets[f]],plan->weights,sizeof(float)*plan->width*plan->width);
+  }
+
+  cl_int err;
+  resident->multirate_weights = clCreateBuffer(cl->context,CL_MEM_READ_ONLY,sizeof(float)*(weights_len ? weights_len : 1),NULL,&err);
+  if(!err){
+    err = clEnqueueWriteBuffer(cl->commands,resident->multirate_weights,CL_TRUE,0,sizeof(float)*weights_len,weights,0,NULL,
+      trace_event("write multirate filters"));
+  }
+  free(weights);
+  if(err){
+    /* planned again by the next convolution */
+    multirate_release(resident,bank->num_filters);
+  }
+  return err;
+}
+
+static cl_int convolve_multirate(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  cl_int err = CL_SUCCESS;
+  struct engine_plans *resident = bank->plans;
+  const double target = multirate_target();
+  if(resident->multirate == NULL || resident->multirate_target != target){
+    err = multirate_resident(cl,bank,target);
+  }
+  const struct multirate_plan *plans = resident->multirate;
+  const cl_uint *offsets = resident->multirate_offsets;
+  cl_mem d_weights = resident->multirate_weights;
+  unsigned int max_factor = 1, min_factor = MULTIRATE_MAX_FACTOR;
+  for(unsigned int f = 0; f < bank->num_filters && !err; ++f){
+    max_factor = plans[f].factor > max_factor ? plans[f].factor : max_factor;
+    min_factor = plans[f].factor < min_factor ? plans[f].factor : min_factor;
+  }
+
+  /* sizes of the levels, the first is the image */
+  unsigned int num_levels = 1;
+  while((1u << (num_levels - 1)) < max_factor){
+    ++num_levels;
+  }
+  size_t level_width[8], level_height[8];
+  cl_mem levels[8] = {NULL};
+  level_width[0] = width;
+  level_height[0] = height;
+  for(unsigned int l = 1; l < num_levels; ++l){
+    level_width[l] = (level_width[l - 1] + 1)/2;
+    level_height[l] = (level_height[l - 1] + 1)/2;
+  }
+
+  cl_program program = program_cache_build(cl->programs,"multirate.cl",NULL);
+  cl_kernel from_image = NULL, decimate = NULL, convolve = NULL, upsample = NULL;
+  cl_mem filtered = NULL;
+  if(program == NULL){
+    err = CL_BUILD_PROGRAM_FAILURE;
+  }
+  if(!err){
+    from_image = program_cache_kernel(cl->programs,program,"level_from_image",&err);
+  }
+  if(!err){
+    decimate = program_cache_kernel(cl->programs,program,"decimate",&err);
+  }
+  if(!err){
+    convolve = program_cache_kernel(cl->programs,program,"convolve_level",&err);
+  }
+  if(!err){
+    upsample = program_cache_kernel(cl->programs,program,"upsample",&err);
+  }
+  for(unsigned int l = 0; l < num_levels && !err; ++l){
+    const size_t stored = (level_width[l] + 2*LEVEL_MARGIN)*(level_height[l] + 2*LEVEL_MARGIN);
+    levels[l] = scratch_buffer(cl,"multirate level",l,sizeof(float)*stored,&err);
+  }
+  if(!err){
+    /* the finest level used is the largest */
+    unsigned int l = 0;
+    while((1u << l) < min_factor){
+      ++l;
+    }
+    filtered = scratch_buffer(cl,"multirate filtered",0,sizeof(float)*(level_width[l] + 2)*(level_height[l] + 2),&err);
+  }
+  if(err){
+    print_error("setting up multirate engine",err);
+  }
+
+  /* the pyramid is built once for every filter */
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  if(!err){
+    err = clSetKernelArg(from_image,0,sizeof(cl_mem),&image);
+    err |= clSetKernelArg(from_image,1,sizeof(cl_mem),&levels[0]);
+    err |= clSetKernelArg(from_image,2,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(from_image,3,sizeof(cl_ulong),&image_height);
+    if(err){
+      print_error("clSetKernelArg() level_from_image",err);
+    }
+  }
+  if(!err){
+    const size_t global[2] = {width + 2*LEVEL_MARGIN, height + 2*LEVEL_MARGIN};
+    err = enqueue_kernel(cl,from_image,"level_from_image",2,NULL,global,NULL,timing);
+  }
+  for(unsigned int l = 1; l < num_levels && !err; ++l){
+    const cl_ulong sizes[4] = {level_width[l - 1], level_height[l - 1], level_width[l], level_height[l]};
+    err = clSetKernelArg(decimate,0,sizeof(cl_mem),&levels[l - 1]);
+    err |= clSetKernelArg(decimate,1,sizeof(cl_mem),&levels[l]);
+    for(int i = 0; i < 4; ++i){
+      err |= clSetKernelArg(decimate,2 + i,sizeof(cl_ulong),&sizes[i]);
+    }
+    if(err){
+      print_error("clSetKernelArg() decimate",err);
+      break;
+    }
+    const size_t global[2] = {level_width[l] + 2*LEVEL_MARGIN, level_height[l] + 2*LEVEL_MARGIN};
+    err = enqueue_kernel(cl,decimate,"decimate",2,NULL,global,NULL,timing);
+  }
+
+  /* each filter on its level, then back to full resolution */
+  for(unsigned int f = 0; f < bank->num_filters && !err; ++f){
+    unsigned int l = 0;
+    while((1u << l) < plans[f].factor){
+      ++l;
+    }
+    const cl_ulong sizes[2] = {level_width[l], level_height[l]};
+    err = clSetKernelArg(convolve,0,sizeof(cl_mem),&levels[l]);
+    err |= clSetKernelArg(convolve,1,sizeof(cl_mem),&d_weights);
+    err |= clSetKernelArg(convolve,2,sizeof(cl_mem),&filtered);
+    err |= clSetKernelArg(convolve,3,sizeof(cl_ulong),&sizes[0]);
+    err |= clSetKernelArg(convolve,4,sizeof(cl_ulong),&sizes[1]);
+    err |= clSetKernelArg(convolve,5,sizeof(unsigned int),&plans[f].width);
+    err |= clSetKernelArg(convolve,6,sizeof(unsigned int),&offsets[f]);
+    err |= clSetKernelArg(upsample,0,sizeof(cl_mem),&filtered);
+    err |= clSetKernelArg(upsample,1,sizeof(cl_mem),&result);
+    err |= clSetKernelArg(upsample,2,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(upsample,3,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(upsample,4,sizeof(cl_ulong),&sizes[0]);
+    err |= clSetKernelArg(upsample,5,sizeof(unsigned int),&plans[f].factor);
+    err |= clSetKernelArg(upsample,6,sizeof(unsigned int),&f);
+    if(err){
+      print_error("clSetKernelArg() multirate",err);
+      break;
+    }
+    const size_t convolve_global[2] = {level_width[l] + 2, level_height[l] + 2};
+    err = enqueue_kernel(cl,convolve,"convolve_level",2,NULL,convolve_global,NULL,timing);
+    if(!err){
+      const size_t upsample_global[2] = {width, height};
+      err = enqueue_kernel(cl,upsample,"upsample",2,NULL,upsample_global,NULL,timing);
+    }
+  }
+
+  /* buffers are released once the queue is done with them */
+  for(unsigned int l = 0; l < num_levels; ++l){
+    if(levels[l]){
+      clReleaseMemObject(levels[l]);
+    }
+  }
+  if(filtered){
+    clReleaseMemObject(filtered);
+  }
+  cl_kernel kernels[4] = {from_image, decimate, convolve, upsample};
+  for(int i = 0; i < 4; ++i){
+    if(kernels[i]){
+      clReleaseKernel(kernels[i]);
+    }
+  }
+  return err;
+}
+
+static cl_int convolve_steerable(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  const struct filter_steerable *steer = &bank->steerable;
+  if(steer->num_sigmas == 0 || filter_steerable_count(steer) != bank->num_filters){
+    return convolve_lwf(cl,image,width,height,bank,result,timing);
+  }
+
+  /* the basis covers the highest order in the bank */
+  cl_uint num_orders = 0;
+  for(unsigned int o = 0; o < FILTER_STEER_ORDERS; ++o){
+    if(steer->orientations[o]){
+      num_orders = o + 1;
+    }
+  }
+  const cl_uint num_basis = num_orders*(num_orders + 1)/2;
+  const cl_uint per_sigma = bank->num_filters/steer->num_sigmas;
+
+  /* 1d kernels of every sigma, and the coefficients every sigma shares,
+   * uploaded once for the bank
+   */
+  struct engine_plans *resident = bank->plans;
+  const size_t kernels_len = (size_t)FILTER_STEER_ORDERS*bank->width;
+  cl_int err = CL_SUCCESS;
+  if(resident->steer_kernels == NULL){
+    float *kernels = malloc(sizeof(float)*kernels_len*steer->num_sigmas);
+    for(unsigned int s = 0; s < steer->num_sigmas; ++s){
+      filter_Gauss1d_derivatives(&kernels[s*kernels_len],bank->width,filter_Gauss2dbank_sigma(s,steer->num_sigmas));
+    }
+    float *coefficients = malloc(sizeof(float)*FILTER_STEER_BASIS*per_sigma);
+    for(unsigned int f = 0; f < per_sigma; ++f){
+      filter_steerable_coefficients(steer,f,&coefficients[f*FILTER_STEER_BASIS]);
+    }
+    resident->steer_coefficients = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+      sizeof(float)*FILTER_STEER_BASIS*per_sigma,coefficients,&err);
+    if(!err){
+      resident->steer_kernels = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+        sizeof(float)*kernels_len*steer->num_sigmas,kernels,&err);
+    }
+    if(err){
+      release_buffer(resident->steer_coefficients);
+      resident->steer_coefficients = NULL;
+    }
+    free(kernels);
+    free(coefficients);
+  }
+
+  cl_program program = program_cache_build(cl->programs,"steerable.cl",NULL);
+  cl_kernel rows_kernel = NULL, columns_kernel = NULL, steer_kernel = NULL;
+  cl_mem d_kernels = resident->steer_kernels, d_coefficients = resident->steer_coefficients, rows = NULL, basis = NULL;
+  const size_t image_size = width*height;
+  if(!err && program == NULL){
+    err = CL_BUILD_PROGRAM_FAILURE;
+  }
+  if(!err){
+    rows_kernel = program_cache_kernel(cl->programs,program,"steer_rows",&err);
+  }
+  if(!err){
+    columns_kernel = program_cache_kernel(cl->programs,program,"steer_columns",&err);
+  }
+  if(!err){
+    steer_kernel = program_cache_kernel(cl->programs,program,"steer",&err);
+  }
+  if(!err){
+    rows = scratch_buffer(cl,"steer rows",0,sizeof(float)*num_orders*image_size,&err);
+  }
+  if(!err){
+    basis = scratch_buffer(cl,"steer basis",0,sizeof(float)*num_basis*image_size,&err);
+  }
+  if(err){
+    print_error("setting up steerable engine",err);
+  }
+
+  /* the basis of a sigma costs the same however many orientations it steers to */
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  const size_t global[2] = {width, height};
+  for(unsigned int s = 0; s < steer->num_sigmas && !err; ++s){
+    const cl_uint kernels_offset = kernels_len*s;
+    const cl_uint first_filter = s*per_sigma;
+    err = clSetKernelArg(rows_kernel,0,sizeof(cl_mem),&image);
+    err |= clSetKernelArg(rows_kernel,1,sizeof(cl_mem),&d_kernels);
+    err |= clSetKernelArg(rows_kernel,2,sizeof(cl_mem),&rows);
+    err |= clSetKernelArg(rows_kernel,3,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(rows_kernel,4,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(rows_kernel,5,sizeof(unsigned int),&bank->width);
+    err |= clSetKernelArg(rows_kernel,6,sizeof(cl_uint),&kernels_offset);
+    err |= clSetKernelArg(rows_kernel,7,sizeof(cl_uint),&num_orders);
+    err |= clSetKernelArg(columns_kernel,0,sizeof(cl_mem),&rows);
+    err |= clSetKernelArg(columns_kernel,1,sizeof(cl_mem),&d_kernels);
+    err |= clSetKernelArg(columns_kernel,2,sizeof(cl_mem),&basis);
+    err |= clSetKernelArg(columns_kernel,3,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(columns_kernel,4,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(columns_kernel,5,sizeof(unsigned int),&bank->width);
+    err |= clSetKernelArg(columns_kernel,6,sizeof(cl_uint),&kernels_offset);
+    err |= clSetKernelArg(columns_kernel,7,sizeof(cl_uint),&num_basis);
+    err |= clSetKernelArg(steer_kernel,0,sizeof(cl_mem),&basis);
+    err |= clSetKernelArg(steer_kernel,1,sizeof(cl_mem),&d_coefficients);
+    err |= clSetKernelArg(steer_kernel,2,sizeof(cl_mem),&result);
+    err |= clSetKernelArg(steer_kernel,3,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(steer_kernel,4,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(steer_kernel,5,sizeof(cl_uint),&num_basis);
+    err |= clSetKernelArg(steer_kernel,6,sizeof(cl_uint),&per_sigma);
+    err |= clSetKernelArg(steer_kernel,7,sizeof(cl_uint),&first_filter);
+    if(err){
+      print_error("clSetKernelArg() steerable",err);
+    }
+    if(!err){
+      err = enqueue_kernel(cl,rows_kernel,"steer_rows",2,NULL,global,NULL,timing);
+    }
+    if(!err){
+      err = enqueue_kernel(cl,columns_kernel,"steer_columns",2,NULL,global,NULL,timing);
+    }
+    if(!err){
+      err = enqueue_kernel(cl,steer_kernel,"steer",2,NULL,global,NULL,timing);
+    }
+  }
+
+  /* buffers are released once the queue is done with them */
+  cl_mem buffers[2] = {rows, basis};
+  for(int i = 0; i < 2; ++i){
+    if(buffers[i]){
+      clReleaseMemObject(buffers[i]);
+    }
+  }
+  cl_kernel created[3] = {rows_kernel, columns_kernel, steer_kernel};
+  for(int i = 0; i < 3; ++i){
+    if(created[i]){
+      clReleaseKernel(created[i]);
+    }
+  }
+  return err;
+}
+
+static cl_int convolve_winograd(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  struct winograd_transform transform;
+  if(winograd_transform(bank->width,&transform)){
+    return convolve_lwf(cl,image,width,height,bank,result,timing);
+  }
+
+  /* filters are transformed once on the host and kept with the bank, tiles on the device */
+  struct engine_plans *resident = bank->plans;
+  cl_int err = CL_SUCCESS;
+  if(resident->winograd_filters == NULL){
+    const size_t cells = (size_t)transform.n*transform.n;
+    const size_t filter_len = (size_t)bank->width*bank->width;
+    float *filters = malloc(sizeof(float)*cells*bank->num_filters);
+    for(unsigned int f = 0; f < bank->num_filters; ++f){
+      winograd_filter(&transform,&bank->weights[f*filter_len],&filters[f*cells]);
+    }
+    float transforms[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE + WINOGRAD_M*WINOGRAD_MAX_TILE];
+    memcpy(transforms,transform.bt,sizeof(float)*cells);
+    memcpy(&transforms[cells],transform.at,sizeof(float)*transform.m*transform.n);
+    resident->winograd_transforms = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+      sizeof(float)*(cells + transform.m*transform.n),transforms,&err);
+    if(!err){
+      resident->winograd_filters = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+        sizeof(float)*cells*bank->num_filters,filters,&err);
+    }
+    if(err){
+      release_buffer(resident->winograd_transforms);
+      resident->winograd_transforms = NULL;
+    }
+    free(filters);
+  }
+
+  cl_mem d_filters = resident->winograd_filters, d_transforms = resident->winograd_transforms;
+  cl_kernel kernel = NULL;
+  if(!err){
+    kernel = create_kernel(cl,"winograd.cl","winograd",width,height,bank,&err);
+  }
+  if(err){
+    print_error("setting up winograd engine",err);
+  }
+
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  if(!err){
+    err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+    err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&d_filters);
+    err |= clSetKernelArg(kernel,2,sizeof(cl_mem),&d_transforms);
+    err |= clSetKernelArg(kernel,3,sizeof(cl_mem),&result);
+    err |= clSetKernelArg(kernel,4,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(kernel,5,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(kernel,6,sizeof(unsigned int),&bank->width);
+    err |= clSetKernelArg(kernel,7,sizeof(unsigned int),&bank->num_filters);
+    if(err){
+      print_error("clSetKernelArg() winograd",err);
+    }
+  }
+  if(!err){
+    /* a work item per block of outputs */
+    const size_t global[2] = {(width + transform.m - 1)/transform.m, (height + transform.m - 1)/transform.m};
+    err = enqueue_kernel(cl,kernel,"winograd",2,NULL,global,NULL,timing);
+  }
+
+  if(kernel){
+    clReleaseKernel(kernel);
+  }
+  return err;
+}
+
+static cl_int convolve_atrous(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  if(bank->dilations == NULL){
+    return convolve_lwf(cl,image,width,height,bank,result,timing);
+  }
+
+  struct engine_plans *resident = bank->plans;
+  cl_int err;
+  cl_kernel kernel = create_kernel(cl,"atrous.cl","dilated",width,height,bank,&err);
+  if(!err && resident->dilations == NULL){
+    resident->dilations = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+      sizeof(cl_uint)*bank->num_filters,bank->dilations,&err);
+    if(err){
+      resident->dilations = NULL;
+      print_error("clCreateBuffer() dilations",err);
+    }
+  }
+  cl_mem d_dilations = resident->dilations;
+
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  if(!err){
+    err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+    err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&bank->filters);
+    err |= clSetKernelArg(kernel,2,sizeof(cl_mem),&d_dilations);
+    err |= clSetKernelArg(kernel,3,sizeof(cl_mem),&result);
+    err |= clSetKernelArg(kernel,4,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(kernel,5,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(kernel,6,sizeof(unsigned int),&bank->width);
+    err |= clSetKernelArg(kernel,7,sizeof(unsigned int),&bank->num_filters);
+    if(err){
+      print_error("clSetKernelArg() dilated",err);
+    }
+  }
+  if(!err){
+    const size_t global[2] = {width*height, bank->num_filters};
+    err = enqueue_kernel(cl,kernel,"dilated",2,NULL,global,NULL,timing);
+  }
+
+  if(kernel){
+    clReleaseKernel(kernel);
+  }
+  return err;
+}
+
+static cl_int convolve_sparse(struct gimc_cl *cl, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  /* taps are listed on the host and kept with the bank until the threshold changes */
+  struct engine_plans *resident = bank->plans;
+  const double threshold = sparse_threshold();
+  cl_int err = CL_SUCCESS;
+  if(resident->sparse_taps == NULL || resident->sparse_threshold != threshold){
+    struct sparse_bank sparse;
+    sparse_from_bank(bank->weights,bank->num_filters,bank->width,threshold,&sparse);
+    release_buffer(resident->sparse_starts);
+    release_buffer(resident->sparse_taps);
+    resident->sparse_threshold = threshold;
+    resident->sparse_starts = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+      sizeof(cl_uint)*(bank->num_filters + 1),sparse.starts,&err);
+    /* a bank of zeros keeps no taps, but a buffer can't be empty */
+    resident->sparse_taps = err ? NULL : clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+      sizeof(struct sparse_tap)*(sparse.num_taps ? sparse.num_taps : 1),sparse.taps,&err);
+    sparse_release(&sparse);
+  }
+
+  cl_mem d_starts = resident->sparse_starts, d_taps = resident->sparse_taps;
+  cl_kernel kernel = NULL;
+  if(!err){
+    kernel = create_kernel(cl,"sparse.cl","sparse",width,height,bank,&err);
+  }
+  if(err){
+    print_error("setting up sparse engine",err);
+  }
+
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  if(!err){
+    err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+    err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&d_starts);
+    err |= clSetKernelArg(kernel,2,sizeof(cl_mem),&d_taps);
+    err |= clSetKernelArg(kernel,3,sizeof(cl_mem),&result);
+    err |= clSetKernelArg(kernel,4,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(kernel,5,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(kernel,6,sizeof(unsigned int),&bank->num_filters);
+    if(err){
+      print_error("clSetKernelArg() sparse",err);
+    }
+  }
+  if(!err){
+    const size_t global[2] = {width*height, bank->num_filters};
+    err = enqueue_kernel(cl,kernel,"sparse",2,NULL,global,NULL,timing);
+  }
+
+  if(kernel){
+    clReleaseKernel(kernel);
+  }
+  return err;
+}
+
+/* a dilated bank on an engine which doesn't space out taps, as the dense
+ * bank of filter_dilate_bank, uploaded once and kept with the bank
+ */
+static cl_int convolve_dense(struct gimc_cl *cl, enum engine_id engine, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, const struct gimc_epilogue *epilogue, cl_mem result, struct engine_timing *timing){
+  struct engine_plans *resident = bank->plans;
+  if(resident->dense == NULL){
+    const unsigned int dense_width = filter_dilated_width(bank->dilations,bank->num_filters,bank->width);
+    float *weights = malloc(sizeof(float)*dense_width*dense_width*bank->num_filters);
+    filter_dilate_bank(weights,dense_width,bank->weights,bank->dilations,bank->num_filters,bank->width);
+    resident->dense = malloc(sizeof(struct gimc_bank));
+    cl_int err = gimc_bank_upload(cl,resident->dense,weights,bank->num_filters,dense_width);
+    free(weights);
+    if(err){
+      print_error("uploading dense bank",err);
+      gimc_bank_release(resident->dense);
+      free(resident->dense);
+      resident->dense = NULL;
+      return err;
+    }
+  }
+  return engine_convolve_epilogue(cl,engine,image,width,height,resident->dense,epilogue,result,timing);
+}
+
+/* an adaptive bank on an engine, a launch per bucket. a bucket of the
+ * first planes writes to result, the others to scratch and are copied to
+ * the planes of their filters
+ */
+static cl_int convolve_buckets(struct gimc_cl *cl, enum engine_id engine, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  const size_t image_size = width*height;
+  unsigned int longest = 0;
+  for(unsigned int b = 0; b < bank->num_buckets; ++b){
+    const struct gimc_bucket *bucket = &bank->buckets[b];
+    const unsigned int count = bucket->bank.num_filters;
+    if(bucket->filters[count - 1] != count - 1 && count > longest){
+      longest = count;
+    }
+  }
+
+  cl_int err = CL_SUCCESS;
+  cl_mem scratch = NULL;
+  if(longest){
+    scratch = scratch_buffer(cl,"bucket",0,sizeof(uint8_t)*image_size*longest,&err);
+    if(err){
+      print_error("clCreateBuffer() bucket",err);
+      return err;
+    }
+  }
+  for(unsigned int b = 0; b < bank->num_buckets && !err; ++b){
+    const struct gimc_bucket *bucket = &bank->buckets[b];
+    const unsigned int count = bucket->bank.num_filters;
+    const int in_place = bucket->filters[count - 1] == count - 1;
+    err = engine_convolve(cl,engine,image,width,height,gimc_bucket_bank(bucket,engine),in_place ? result : scratch,timing);
+
+    /* a copy per run of consecutive filters */
+    for(unsigned int first = 0; first < count && !err && !in_place;){
+      unsigned int run = 1;
+      while(first + run < count && bucket->filters[first + run] == bucket->filters[first] + run){
+        ++run;
+      }
+      err = clEnqueueCopyBuffer(cl->commands,scratch,result,sizeof(uint8_t)*first*image_size,
+        sizeof(uint8_t)*bucket->filters[first]*image_size,sizeof(uint8_t)*run*image_size,0,NULL,trace_event("copy bucket"));
+      if(err){
+        print_error("clEnqueueCopyBuffer() bucket",err);
+      }
+      first += run;
+    }
+  }
+  if(scratch){
+    clReleaseMemObject(scratch);
+  }
+  return err;
+}
+
+/* smooth lines of length pixels along apart, the lines across apart */
+static cl_int atrous_pass(struct gimc_cl *cl, cl_kernel smooth, cl_mem src, cl_mem dst, size_t length, size_t lines,
+  size_t along, size_t across, cl_ulong step, struct engine_timing *timing){
+  const cl_ulong args[5] = {length, lines, along, across, step};
+  cl_int err = clSetKernelArg(smooth,0,sizeof(cl_mem),&src);
+  err |= clSetKernelArg(smooth,1,sizeof(cl_mem),&dst);
+  for(int i = 0; i < 5; ++i){
+    err |= clSetKernelArg(smooth,2 + i,sizeof(cl_ulong),&args[i]);
+  }
+  if(err){
+    print_error("clSetKernelArg() atrous_smooth",err);
+    return err;
+  }
+  const size_t global[2] = {length, lines};
+  return enqueue_kernel(cl,smooth,"atrous_smooth",2,NULL,global,NULL,timing);
+}
+
+cl_int engine_wavelet(struct gimc_cl *cl, cl_mem image, size_t width, size_t height, unsigned int levels,
+  cl_mem result, struct engine_timing *timing){
+  if(levels == 0 || levels > ATROUS_MAX_LEVELS){
+    fprintf(stderr,"There can be 1 to %d wavelet levels, not %u\n",ATROUS_MAX_LEVELS,levels);
+    return CL_INVALID_VALUE;
+  }
+  cl_program program = program_cache_build(cl->programs,"atrous.cl",NULL);
+  if(program == NULL){
+    return CL_BUILD_PROGRAM_FAILURE;
+  }
+
+  /* two smoothings and the rows pass between them stay on the device */
+  const size_t image_size = width*height;
+  cl_int err;
+  cl_kernel load = NULL, smooth = NULL, detail = NULL;
+  cl_mem fine = NULL, coarse = NULL, rows = NULL;
+  load = program_cache_kernel(cl->programs,program,"atrous_load",&err);
+  if(!err){
+    smooth = program_cache_kernel(cl->programs,program,"atrous_smooth",&err);
+  }
+  if(!err){
+    detail = program_cache_kernel(cl->programs,program,"atrous_detail",&err);
+  }
+  if(!err){
+    fine = scratch_buffer(cl,"wavelet fine",0,sizeof(float)*image_size,&err);
+  }
+  if(!err){
+    coarse = scratch_buffer(cl,"wavelet coarse",0,sizeof(float)*image_size,&err);
+  }
+  if(!err){
+    rows = scratch_buffer(cl,"wavelet rows",0,sizeof(float)*image_size,&err);
+  }
+  if(err){
+    print_error("setting up wavelet decomposition",err);
+  }
+
+  const cl_ulong size = image_size;
+  const size_t global[1] = {image_size};
+  if(!err){
+    err = clSetKernelArg(load,0,sizeof(cl_mem),&image);
+    err |= clSetKernelArg(load,1,sizeof(cl_mem),&fine);
+    err |= clSetKernelArg(load,2,sizeof(cl_ulong),&size);
+    if(err){
+      print_error("clSetKernelArg() atrous_load",err);
+    }else{
+      err = enqueue_kernel(cl,load,"atrous_load",1,NULL,global,NULL,timing);
+    }
+  }
+
+  /* the coarse smoothing of a level is the fine one of the next */
+  cl_ulong step = 1;
+  for(unsigned int level = 0; level <= levels && !err; ++level){
+    const cl_uint residual = level == levels;
+    if(!residual){
+      err = atrous_pass(cl,smooth,fine,rows,width,height,1,width,step,timing);
+      if(!err){
+        err = atrous_pass(cl,smooth,rows,coarse,height,width,width,1,step,timing);
+      }
+    }
+    if(!err){
+      const cl_ulong offset = level*image_size;
+      err = clSetKernelArg(detail,0,sizeof(cl_mem),&fine);
+      err |= clSetKernelArg(detail,1,sizeof(cl_mem),residual ? &fine : &coarse);
+      err |= clSetKernelArg(detail,2,sizeof(cl_mem),&result);
+      err |= clSetKernelArg(detail,3,sizeof(cl_ulong),&size);
+      err |= clSetKernelArg(detail,4,sizeof(cl_ulong),&offset);
+      err |= clSetKernelArg(detail,5,sizeof(cl_uint),&residual);
+      if(err){
+        print_error("clSetKernelArg() atrous_detail",err);
+      }else{
+        err = enqueue_kernel(cl,detail,"atrous_detail",1,NULL,global,NULL,timing);
+      }
+    }
+    cl_mem swap = fine;
+    fine = coarse;
+    coarse = swap;
+    step *= 2;
+  }
+
+  cl_mem buffers[3] = {fine, coarse, rows};
+  for(int i = 0; i < 3; ++i){
+    if(buffers[i]){
+      clReleaseMemObject(buffers[i]);
+    }
+  }
+  cl_kernel created[3] = {load, smooth, detail};
+  for(int i = 0; i < 3; ++i){
+    if(created[i]){
+      clReleaseKernel(created[i]);
+    }
+  }
+  return err;
+}
+
+/* the two passes of van Herk/Gil-Werman along lines of length pixels */
+static cl_int vhgw_pass(struct gimc_cl *cl, cl_kernel blocks, cl_kernel windows, enum rank_op op, cl_mem src, cl_mem dst,
+  cl_ulong offset, cl_mem prefix, cl_mem suffix, cl_ulong length, cl_ulong lines, cl_ulong along, cl_ulong across,
+  cl_uint radius, struct engine_timing *timing){
+  const cl_uint rank_op = op;
+  cl_int err = clSetKernelArg(blocks,0,sizeof(cl_mem),&src);
+  err |= clSetKernelArg(blocks,1,sizeof(cl_mem),&prefix);
+  err |= clSetKernelArg(blocks,2,sizeof(cl_mem),&suffix);
+  err |= clSetKernelArg(blocks,3,sizeof(cl_ulong),&length);
+  err |= clSetKernelArg(blocks,4,sizeof(cl_ulong),&lines);
+  err |= clSetKernelArg(blocks,5,sizeof(cl_ulong),&along);
+  err |= clSetKernelArg(blocks,6,sizeof(cl_ulong),&across);
+  err |= clSetKernelArg(blocks,7,sizeof(cl_uint),&radius);
+  err |= clSetKernelArg(blocks,8,sizeof(cl_uint),&rank_op);
+  err |= clSetKernelArg(windows,0,sizeof(cl_mem),&prefix);
+  err |= clSetKernelArg(windows,1,sizeof(cl_mem),&suffix);
+  err |= clSetKernelArg(windows,2,sizeof(cl_mem),&dst);
+  err |= clSetKernelArg(windows,3,sizeof(cl_ulong),&length);
+  err |= clSetKernelArg(windows,4,sizeof(cl_ulong),&lines);
+  err |= clSetKernelArg(windows,5,sizeof(cl_ulong),&along);
+  err |= clSetKernelArg(windows,6,sizeof(cl_ulong),&across);
+  err |= clSetKernelArg(windows,7,sizeof(cl_uint),&radius);
+  err |= clSetKernelArg(windows,8,sizeof(cl_uint),&rank_op);
+  err |= clSetKernelArg(windows,9,sizeof(cl_ulong),&offset);
+  if(err){
+    print_error("clSetKernelArg() vhgw",err);
+    return err;
+  }
+  const size_t window = 2*(size_t)radius + 1;
+  const size_t blocks_global[2] = {(length + 2*radius + window - 1)/window, lines};
+  err = enqueue_kernel(cl,blocks,"vhgw_blocks",2,NULL,blocks_global,NULL,timing);
+  if(!err){
+    const size_t windows_global[2] = {length, lines};
+    err = enqueue_kernel(cl,windows,"vhgw_window",2,NULL,windows_global,NULL,timing);
+  }
+  return err;
+}
+
+static cl_int convolve_rank(struct gimc_cl *cl, enum rank_op op, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  const size_t image_size = width*height;
+  const size_t filter_len = (size_t)bank->width*bank->width;
+
+  /* scratch for the widest window of the bank */
+  size_t scratch_len = 0;
+  size_t window_len = 0;
+  for(unsigned int f = 0; f < bank->num_filters; ++f){
+    const unsigned int radius = rank_radius(&bank->weights[f*filter_len],bank->width);
+    if(op == RANK_MEDIAN){
+      if(radius > RANK_MEDIAN_MAX_RADIUS){
+        fprintf(stderr,"The median takes windows of up to %u pixels\n",2*RANK_MEDIAN_MAX_RADIUS + 1);
+        return CL_INVALID_VALUE;
+      }
+      const size_t strip = rank_median_strip(radius);
+      const size_t band = strip*RANK_MEDIAN_BAND;
+      const size_t items = ((width + strip - 1)/strip)*((height + band - 1)/band);
+      scratch_len = items*(strip + 2*radius)*256 > scratch_len ? items*(strip + 2*radius)*256 : scratch_len;
+      window_len = items*256 > window_len ? items*256 : window_len;
+    }else{
+      const size_t rows = height*(width + 2*radius);
+      const size_t columns = width*(height + 2*radius);
+      const size_t len = rows > columns ? rows : columns;
+      scratch_len = len > scratch_len ? len : scratch_len;
+    }
+  }
+
+  cl_int err = CL_SUCCESS;
+  cl_program program = program_cache_build(cl->programs,"rank.cl",NULL);
+  cl_kernel blocks = NULL, windows = NULL, median = NULL;
+  cl_mem prefix = NULL, suffix = NULL, rows = NULL, counts = NULL;
+  if(program == NULL){
+    err = CL_BUILD_PROGRAM_FAILURE;
+  }
+  if(!err && op == RANK_MEDIAN){
+    median = program_cache_kernel(cl->programs,program,"median_strips",&err);
+    if(!err){
+      prefix = scratch_buffer(cl,"rank prefix",0,scratch_len,&err);
+    }
+    if(!err){
+      counts = scratch_buffer(cl,"rank counts",0,sizeof(cl_uint)*window_len,&err);
+    }
+  }else if(!err){
+    blocks = program_cache_kernel(cl->programs,program,"vhgw_blocks",&err);
+    if(!err){
+      windows = program_cache_kernel(cl->programs,program,"vhgw_window",&err);
+    }
+    if(!err){
+      prefix = scratch_buffer(cl,"rank prefix",0,scratch_len,&err);
+    }
+    if(!err){
+      suffix = scratch_buffer(cl,"rank suffix",0,scratch_len,&err);
+    }
+    if(!err){
+      rows = scratch_buffer(cl,"rank rows",0,image_size,&err);
+    }
+  }
+  if(err){
+    print_error("setting up rank engine",err);
+  }
+
+  for(unsigned int f = 0; f < bank->num_filters && !err; ++f){
+    const cl_uint radius = rank_radius(&bank->weights[f*filter_len],bank->width);
+    const cl_ulong offset = f*image_size;
+    if(op != RANK_MEDIAN){
+      /* rows, then columns into the plane of the filter */
+      err = vhgw_pass(cl,blocks,windows,op,image,rows,0,prefix,suffix,width,height,1,width,radius,timing);
+      if(!err){
+        err = vhgw_pass(cl,blocks,windows,op,rows,result,offset,prefix,suffix,height,width,width,1,radius,timing);
+      }
+      continue;
+    }
+
+    const cl_uint strip = rank_median_strip(radius);
+    const cl_uint band = strip*RANK_MEDIAN_BAND;
+    const cl_ulong image_width = width;
+    const cl_ulong image_height = height;
+    err = clSetKernelArg(median,0,sizeof(cl_mem),&image);
+    err |= clSetKernelArg(median,1,sizeof(cl_mem),&result);
+    err |= clSetKernelArg(median,2,sizeof(cl_mem),&prefix);
+    err |= clSetKernelArg(median,3,sizeof(cl_mem),&counts);
+    err |= clSetKernelArg(median,4,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(median,5,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(median,6,sizeof(cl_uint),&radius);
+    err |= clSetKernelArg(median,7,sizeof(cl_uint),&strip);
+    err |= clSetKernelArg(median,8,sizeof(cl_uint),&band);
+    err |= clSetKernelArg(median,9,sizeof(cl_ulong),&offset);
+    if(err){
+      print_error("clSetKernelArg() median_strips",err);
+      break;
+    }
+    const size_t global[2] = {(width + strip - 1)/strip, (height + band - 1)/band};
+    err = enqueue_kernel(cl,median,"median_strips",2,NULL,global,NULL,timing);
+  }
+
+  cl_mem buffers[4] = {prefix, suffix, rows, counts};
+  for(int i = 0; i < 4; ++i){
+    if(buffers[i]){
+      clReleaseMemObject(buffers[i]);
+    }
+  }
+  cl_kernel created[3] = {blocks, windows, median};
+  for(int i = 0; i < 3; ++i){
+    if(created[i]){
+      clReleaseKernel(created[i]);
+    }
+  }
+  return err;
+}
+
+cl_int engine_convolve(struct gimc_cl *cl, enum engine_id engine, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, cl_mem result, struct engine_timing *timing){
+  if(bank->dilations && engine != ENGINE_ATROUS){
+    return convolve_dense(cl,engine,image,width,height,bank,NULL,result,timing);
+  }
+  if(bank->widths){
+    return convolve_buckets(cl,engine,image,width,height,bank,result,timing);
+  }
+  switch(engine){
+  case ENGINE_BASE:
+    return convolve_base(cl,image,width,height,bank,result,timing);
+  case ENGINE_LWF:
+    return convolve_lwf(cl,image,width,height,bank,result,timing);
+  case ENGINE_LWF_LOCAL:
+    return convolve_lwf_local(cl,image,width,height,bank,result,timing);
+  case ENGINE_LWF_PARTIALS:
+    return convolve_lwf_partials(cl,image,width,height,bank,result,timing);
+  case ENGINE_LWF_FUSED:
+    return convolve_lwf_fused(cl,image,width,height,bank,result,timing);
+  case ENGINE_BAKED:
+    return convolve_baked(cl,image,width,height,bank,result,timing);
+  case ENGINE_SAT:
+    return convolve_sat(cl,image,width,height,bank,result,timing);
+  case ENGINE_MULTIRATE:
+    return convolve_multirate(cl,image,width,height,bank,result,timing);
+  case ENGINE_STEERABLE:
+    return convolve_steerable(cl,image,width,height,bank,result,timing);
+  case ENGINE_WINOGRAD:
+    return convolve_winograd(cl,image,width,height,bank,result,timing);
+  case ENGINE_ATROUS:
+    return convolve_atrous(cl,image,width,height,bank,result,timing);
+  case ENGINE_SPARSE:
+    return convolve_sparse(cl,image,width,height,bank,result,timing);
+  case ENGINE_ERODE:
+    return convolve_rank(cl,RANK_MIN,image,width,height,bank,result,timing);
+  case ENGINE_DILATE:
+    return convolve_rank(cl,RANK_MAX,image,width,height,bank,result,timing);
+  case ENGINE_MEDIAN:
+    return convolve_rank(cl,RANK_MEDIAN,image,width,height,bank,result,timing);
+  default:
+    return CL_INVALID_VALUE;
+  }
+}
+
+cl_int engine_convolve_epilogue(struct gimc_cl *cl, enum engine_id engine, cl_mem image, size_t width, size_t height,
+  const struct gimc_bank *bank, const struct gimc_epilogue *epilogue, cl_mem result, struct engine_timing *timing){
+  if(epilogue == NULL || epilogue_is_identity(epilogue)){
+    return engine_convolve(cl,engine,image,width,height,bank,result,timing);
+  }
+  if(engine != ENGINE_LWF){
+    fprintf(stderr,"The %s engine has no fused epilogue\n",engine_name(engine));
+    return CL_INVALID_OPERATION;
+  }
+  if(epilogue_planes(epilogue,bank->num_filters) == 0){
+    fprintf(stderr,"The epilogue leaves nothing of %u filters\n",bank->num_filters);
+    return CL_INVALID_VALUE;
+  }
+  if(bank->dilations){
+    return convolve_dense(cl,engine,image,width,height,bank,epilogue,result,timing);
+  }
+
+  cl_int err;
+  cl_kernel kernel = create_kernel(cl,"lwfilter.cl","convolve2d_epilogue",width,height,bank,&err);
+  if(err){
+    return err;
+  }
+
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  err = clSetKernelArg(kernel,0,sizeof(cl_mem),&image);
+  err |= clSetKernelArg(kernel,1,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(kernel,2,sizeof(cl_mem),&result);
+  err |= clSetKernelArg(kernel,3,sizeof(cl_ulong),&image_width);
+  err |= clSetKernelArg(kernel,4,sizeof(cl_ulong),&image_height);
+  err |= clSetKernelArg(kernel,5,sizeof(unsigned int),&bank->width);
+  err |= clSetKernelArg(kernel,6,sizeof(unsigned int),&bank->num_filters);
+  err |= clSetKernelArg(kernel,7,sizeof(cl_uint),&epilogue->difference);
+  err |= clSetKernelArg(kernel,8,sizeof(cl_uint),&epilogue->reduce);
+  err |= clSetKernelArg(kernel,9,sizeof(cl_float),&epilogue->scale);
+  err |= clSetKernelArg(kernel,10,sizeof(cl_float),&epilogue->offset);
+  err |= clSetKernelArg(kernel,11,sizeof(cl_uint),&epilogue->thresholded);
+  err |= clSetKernelArg(kernel,12,sizeof(cl_float),&epilogue->threshold);
+  err |= clSetKernelArg(kernel,13,sizeof(cl_uint),&epilogue->round);
+  if(err){
+    print_error("clSetKernelArg() convolve2d_epilogue",err);
+  }
+
+  const size_t global[1] = {width*height};
+  if(!err){
+    err = enqueue_kernel(cl,kernel,"convolve2d_epilogue",1,NULL,global,NULL,timing);
+  }
+  clReleaseKernel(kernel);
+  return err;
+}
@@ -0,0 +1,199 @@
+/* convolution engines
+ * each engine convolves an image on the device with every filter of a bank
+ * using one of the kernel sources in build/, so that tools can share the
+ * setup and compare engines on the same data
+ */
+
+#ifndef GIMC_ENGINE_H
+#define GIMC_ENGINE_H
+
+#include <stdint.h>
+#define CL_USE_DEPRECATED_OPENCL_1_2_APIS
+#include <CL/cl.h>
+
+#include "clutil.h"
+#include "filter.h"
+
+struct engine_scratch;
+
+/* OpenCL state shared by the engines */
+struct gimc_cl{
+  cl_platform_id platform;
+  cl_device_id device;
+  cl_context context;
+  cl_command_queue commands;
+  struct program_cache *programs;
+  /* device bytes engines may take for scratch buffers, see budget_scratch,
+   * 0 for the largest allocation of gimc_budget_device
+   */
+  size_t scratch_bytes;
+  struct engine_scratch *scratch; /* scratch buffers of the engines, kept across convolutions */
+};
+
+/* set up a context and command queue on the first device of device_type
+ * properties are added to those tracing needs. exits on failure
+ */
+extern void gimc_cl_init(struct gimc_cl *cl,cl_device_type device_type,cl_command_queue_properties properties);
+
+/* release everything created by gimc_cl_init */
+extern void gimc_cl_release(struct gimc_cl *cl);
+
+struct gimc_budget;
+
+/* the memory budget of the device of cl, BUDGET_DEVICE_SHARE of its global
+ * memory, its largest allocation and half the memory of the host, each
+ * limited to megabytes MiB or else GIMC_MEMORY_BUDGET if either is given
+ */
+extern void gimc_budget_device(struct gimc_cl *cl,size_t megabytes,struct gimc_budget *budget);
+
+/* device type for the device option of the tools, 0 for CPU and GPU otherwise */
+extern cl_device_type gimc_device_type(const char *option);
+
+struct gimc_image;
+
+/* a read only device buffer holding the pixels of an image
+ * mapped images are used in place with CL_MEM_USE_HOST_PTR, others are
+ * copied. the image has to outlive the buffer
+ */
+extern cl_mem gimc_image_buffer(struct gimc_cl *cl,const struct gimc_image *image,cl_int *err);
+
+struct gimc_bucket;
+struct engine_plans;
+
+/* a bank of square filters resident on the device
+ * weights holds a host copy laid out as filter_Gauss2dbank lays it out
+ */
+struct gimc_bank{
+  cl_mem filters;
+  float *weights;
+  unsigned int num_filters;
+  unsigned int width;
+  unsigned int height; /* width, but for the bucket of rectangular filters of an adaptive bank */
+  struct filter_steerable steerable; /* all zero unless made by gimc_bank_steerable */
+  unsigned int *dilations; /* tap spacing of every filter, NULL unless made by gimc_bank_dilated */
+  /* support of every filter and a resident bank of the filters of each
+   * shape, NULL unless made by gimc_bank_adaptive
+   */
+  unsigned int *widths;
+  unsigned int *heights;
+  struct gimc_bucket *buckets;
+  unsigned int num_buckets;
+  /* what the engines derive from the filters, made on their first
+   * convolution and kept with the bank
+   */
+  struct engine_plans *plans;
+};
+
+/* the filters of a bank which share a width and height, cropped to them */
+struct gimc_bucket{
+  struct gimc_bank bank;
+  /* rectangles also padded to the square of their larger side, for the
+   * engines which take no filter height
+   */
+  struct gimc_bank square;
+  unsigned int *filters; /* their indices in the whole bank, ascending */
+};
+
+/* upload a bank of num_filters filters of width*width from the host */
+extern cl_int gimc_bank_upload(struct gimc_cl *cl,struct gimc_bank *bank,const float *weights,unsigned int num_filters,unsigned int width);
+
+/* create a bank of normalized Gaussians on the device with the
+ * filter_Gauss2dbank and filter_normalize kernels
+ */
+extern cl_int gimc_bank_Gauss2d(struct gimc_cl *cl,struct gimc_bank *bank,unsigned int num_filters,unsigned int width);
+
+/* create a bank of oriented derivatives of Gaussian with
+ * filter_steerable_bank and upload it, the steerable engine runs it from
+ * its basis
+ */
+extern cl_int gimc_bank_steerable(struct gimc_cl *cl,struct gimc_bank *bank,const struct filter_steerable *steer,unsigned int width);
+
+/* upload a bank whose filter i has its taps dilations[i] pixels apart
+ * the atrous engine runs it as it is and the others as its dense
+ * equivalent, see filter_dilate_bank
+ */
+extern cl_int gimc_bank_dilated(struct gimc_cl *cl,struct gimc_bank *bank,const float *weights,const unsigned int *dilations,
+  unsigned int num_filters,unsigned int width);
+
+/* upload a bank whose filter i only has weights within the centered
+ * widths[i]*heights[i], both odd, see filter_adaptive_widths and
+ * bankfile_widths. heights may be NULL for squares. the filters of each
+ * shape are also uploaded cropped to it, in order of first appearance,
+ * and engines run a launch per shape into the planes of its filters.
+ * base and lwf take the height of a rectangular shape, the other engines
+ * run it padded to a square
+ */
+extern cl_int gimc_bank_adaptive(struct gimc_cl *cl,struct gimc_bank *bank,const float *weights,const unsigned int *widths,
+  const unsigned int *heights,unsigned int num_filters,unsigned int width);
+
+/* release the device and host copies of a bank */
+extern void gimc_bank_release(struct gimc_bank *bank);
+
+enum engine_id{
+  ENGINE_BASE, /* base.cl, one work item per pixel and filter, constant memory */
+  ENGINE_LWF, /* lwfilter.cl, one work item per pixel and filter */
+  ENGINE_LWF_LOCAL, /* lwfilter_local.cl, taps split in chunks across a work group */
+  ENGINE_LWF_PARTIALS, /* lwfilter_partials.cl, one work item per tap, reduced by a 2nd kernel */
+  ENGINE_LWF_FUSED, /* lwfilter_fused.cl, taps split across lanes and reduced in local memory */
+  ENGINE_BAKED, /* kgen generated source with the weights as literals */
+  ENGINE_SAT, /* sat.cl, summed area tables, exact for boxes and approximate otherwise, see sat.h */
+  ENGINE_MULTIRATE, /* multirate.cl, wide filters on decimated images, see multirate.h */
+  ENGINE_STEERABLE, /* steerable.cl, banks steered from a separable basis, others as lwf */
+  ENGINE_WINOGRAD, /* winograd.cl, minimal filtering of 3x3 and 5x5 filters, others as lwf, see winograd.h */
+  ENGINE_ATROUS, /* atrous.cl, dilated banks with their taps spread out, others as lwf */
+  ENGINE_SPARSE, /* sparse.cl, only the nonzero taps of every filter, see sparse.h */
+  /* nonlinear engines, the window of a filter is its support, see rank.h */
+  ENGINE_ERODE, /* rank.cl, minimum by van Herk/Gil-Werman */
+  ENGINE_DILATE, /* rank.cl, maximum by van Herk/Gil-Werman */
+  ENGINE_MEDIAN, /* rank.cl, median by sliding histograms */
+  NUM_ENGINES
+};
+
+/* nonzero for engines which convolve, zero for the rank filters */
+extern int engine_is_linear(enum engine_id engine);
+
+/* the bank of a bucket an engine runs, its rectangles on base and lwf and
+ * their squares on the others
+ */
+extern const struct gimc_bank *gimc_bucket_bank(const struct gimc_bucket *bucket,enum engine_id engine);
+
+/* short name of an engine, as used by the tools */
+extern const char *engine_name(enum engine_id engine);
+
+/* engine with the given name, or NUM_ENGINES if there is none */
+extern enum engine_id engine_from_name(const char *name);
+
+/* time spent in the kernels of an engine
+ * collecting it waits for every launch and takes a queue with
+ * CL_QUEUE_PROFILING_ENABLE
+ */
+struct engine_timing{
+  double seconds;
+  unsigned int launches;
+};
+
+/* convolve the width*height image in image with every filter in bank
+ * result receives num_filters planes of width*height pixels
+ * timing may be NULL, otherwise kernel times are added to it
+ * returns CL_SUCCESS or the error of the failing call
+ */
+extern cl_int engine_convolve(struct gimc_cl *cl,enum engine_id engine,cl_mem image,size_t width,size_t height,
+  const struct gimc_bank *bank,cl_mem result,struct engine_timing *timing);
+
+/* the à trous wavelet decomposition of the width*height image in image, see
+ * atrous.h. smoothings stay on the device from one level to the next and
+ * result receives levels+1 planes of width*height pixels
+ */
+extern cl_int engine_wavelet(struct gimc_cl *cl,cl_mem image,size_t width,size_t height,unsigned int levels,
+  cl_mem result,struct engine_timing *timing);
+
+struct gimc_epilogue;
+
+/* engine_convolve followed by an epilogue fused into the convolution, see
+ * epilogue.h. result receives epilogue_planes planes. an epilogue which
+ * changes nothing, or NULL, runs engine_convolve, others only run on lwf
+ */
+extern cl_int engine_convolve_epilogue(struct gimc_cl *cl,enum engine_id engine,cl_mem image,size_t width,size_t height,
+  const struct gimc_bank *bank,const struct gimc_epilogue *epilogue,cl_mem result,struct engine_timing *timing);
+
+#endif
@@ -0,0 +1,108 @@
+#include "epilogue.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void epilogue_identity(struct gimc_epilogue *epilogue){
+  memset(epilogue,0,sizeof(struct gimc_epilogue));
+  epilogue->reduce = EPILOGUE_KEEP;
+  epilogue->scale = 1.0f;
+  epilogue->offset = 0.0f;
+}
+
+int epilogue_is_identity(const struct gimc_epilogue *epilogue){
+  return !epilogue->difference && epilogue->reduce == EPILOGUE_KEEP && epilogue->scale == 1.0f &&
+    epilogue->offset == 0.0f && !epilogue->thresholded && !epilogue->round;
+}
+
+int epilogue_parse(const char *text, struct gimc_epilogue *epilogue){
+  epilogue_identity(epilogue);
+  while(*text){
+    const size_t len = strcspn(text,",");
+    char stage[64];
+    if(len >= sizeof(stage)){
+      return 1;
+    }
+    memcpy(stage,text,len);
+    stage[len] = '\0';
+    text += text[len] ? len + 1 : len;
+
+    char *end = NULL;
+    if(strcmp(stage,"dog") == 0){
+      epilogue->difference = 1;
+    }else if(strcmp(stage,"max") == 0){
+      epilogue->reduce = EPILOGUE_MAX;
+    }else if(strcmp(stage,"min") == 0){
+      epilogue->reduce = EPILOGUE_MIN;
+    }else if(strcmp(stage,"argmax") == 0){
+      epilogue->reduce = EPILOGUE_ARGMAX;
+    }else if(strcmp(stage,"round") == 0){
+      epilogue->round = 1;
+    }else if(strncmp(stage,"scale=",6) == 0){
+      epilogue->scale = strtof(stage + 6,&end);
+    }else if(strncmp(stage,"offset=",7) == 0){
+      epilogue->offset = strtof(stage + 7,&end);
+    }else if(strncmp(stage,"threshold=",10) == 0){
+      epilogue->thresholded = 1;
+      epilogue->threshold = strtof(stage + 10,&end);
+    }else{
+      return 1;
+    }
+    /* numbers have to take up the rest of their stage */
+    if(end && *end){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+unsigned int epilogue_planes(const struct gimc_epilogue *epilogue, unsigned int num_filters){
+  const unsigned int planes = epilogue->difference ? (num_filters > 0 ? num_filters - 1 : 0) : num_filters;
+  if(epilogue->reduce != EPILOGUE_KEEP){
+    return planes > 0 ? 1 : 0;
+  }
+  return planes;
+}
+
+/* the last stages of a value, as epilogue_output in lwfilter.cl */
+static uint8_t epilogue_output(const struct gimc_epilogue *epilogue, float value){
+  value = epilogue->scale*value + epilogue->offset;
+  if(epilogue->thresholded){
+    return value >= epilogue->threshold ? 255 : 0;
+  }
+  if(epilogue->round){
+    value = nearbyintf(value);
+  }
+  return value <= 0.0f ? 0 : value >= 255.0f ? 255 : (uint8_t)value;
+}
+
+void epilogue_apply(const struct gimc_epilogue *epilogue, const float *sums, unsigned int num_filters,
+  uint8_t *out, size_t plane_stride){
+  const unsigned int planes = epilogue->difference ? num_filters - 1 : num_filters;
+  float best = 0.0f;
+  unsigned int best_plane = 0;
+  for(unsigned int p = 0; p < planes; ++p){
+    const float value = epilogue->difference ? sums[p] - sums[p + 1] : sums[p];
+    switch(epilogue->reduce){
+    case EPILOGUE_MAX:
+    case EPILOGUE_ARGMAX:
+      if(p == 0 || value > best){
+        best = value;
+        best_plane = p;
+      }
+      break;
+    case EPILOGUE_MIN:
+      if(p == 0 || value < best){
+        best = value;
+      }
+      break;
+    case EPILOGUE_KEEP:
+    default:
+      out[p*plane_stride] = epilogue_output(epilogue,value);
+      break;
+    }
+  }
+  if(planes > 0 && epilogue->reduce != EPILOGUE_KEEP){
+    out[0] = epilogue_output(epilogue,epilogue->reduce == EPILOGUE_ARGMAX ? (float)best_plane : best);
+  }
+}
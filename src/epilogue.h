@@ -0,0 +1,59 @@
+/* epilogues reduce the planes of a bank before they leave the device
+ * a fused kernel convolves a pixel with every filter of the bank, then in
+ * turn takes differences of adjacent filters (differences of Gaussians for
+ * a Gaussian bank), reduces what is left across the bank, maps values
+ * through scale and offset and thresholds or rounds them to 8 bits. only
+ * the planes left are written, so reductions write and read back
+ * num_filters times less
+ */
+
+#ifndef GIMC_EPILOGUE_H
+#define GIMC_EPILOGUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* reductions across the bank */
+enum epilogue_reduce{
+  EPILOGUE_KEEP, /* every plane */
+  EPILOGUE_MAX, /* largest value */
+  EPILOGUE_MIN, /* smallest value */
+  EPILOGUE_ARGMAX, /* index of the first largest value */
+  NUM_EPILOGUE_REDUCE
+};
+
+/* what the fused kernel does with the sums of a pixel, fixed width fields
+ * so an epilogue can be hashed
+ */
+struct gimc_epilogue{
+  uint32_t difference; /* nonzero for plane f minus plane f+1 */
+  uint32_t reduce; /* enum epilogue_reduce */
+  float scale;
+  float offset;
+  uint32_t thresholded; /* nonzero for 255 where values reach threshold and 0 elsewhere */
+  float threshold;
+  uint32_t round; /* nonzero rounds to nearest, otherwise truncates, both saturate */
+};
+
+/* the epilogue which keeps every plane as engine_convolve writes it */
+extern void epilogue_identity(struct gimc_epilogue *epilogue);
+
+/* nonzero if an epilogue changes nothing */
+extern int epilogue_is_identity(const struct gimc_epilogue *epilogue);
+
+/* read an epilogue from comma separated stages, any of dog, max, min,
+ * argmax, scale=S, offset=O, threshold=T and round
+ * returns nonzero if a stage is unknown
+ */
+extern int epilogue_parse(const char *text,struct gimc_epilogue *epilogue);
+
+/* planes an epilogue leaves of a bank of num_filters, 0 if it can't run */
+extern unsigned int epilogue_planes(const struct gimc_epilogue *epilogue,unsigned int num_filters);
+
+/* apply an epilogue to the num_filters sums of a pixel
+ * out: epilogue_planes values, plane_stride apart
+ */
+extern void epilogue_apply(const struct gimc_epilogue *epilogue,const float *sums,unsigned int num_filters,
+  uint8_t *out,size_t plane_stride);
+
+#endif
@@ -1,5 +1,6 @@
 #define _USE_MATH_DEFINES //compatibility
 #include <math.h>
+#include <stdlib.h>
 #include "filter.h"
 
 /* guassian function */
@@ -9,13 +10,158 @@ static float Gaussian(float x, float y, float sigma);
  * use sigma to vary the gaussians
  */
 void filter_Gauss2dbank(float *bank,unsigned int num_filters, unsigned int filter_width){
-  float step = num_filters > 3 ? 10.0/num_filters : 1.0;
   for(unsigned int i = 0; i < num_filters; ++i){
-    filter_Gauss2d(&bank[i*filter_width],filter_width,i*step);
+    filter_Gauss2d(&bank[i*filter_width*filter_width],filter_width,filter_Gauss2dbank_sigma(i,num_filters));
   }
 }
 
+void filter_box_bank(float *bank, unsigned int num_filters, unsigned int filter_width){
+  const unsigned int center = (filter_width - 1)/2;
+  for(unsigned int i = 0; i < num_filters; ++i){
+    float *filter = &bank[i*filter_width*filter_width];
+    const unsigned int radius = (i + 1)*center/num_filters;
+    const float weight = 1.0f/((2*radius + 1)*(2*radius + 1));
+    for(unsigned int y = 0; y < filter_width; ++y){
+      for(unsigned int x = 0; x < filter_width; ++x){
+        const int inside = y + radius >= center && y <= center + radius && x + radius >= center && x <= center + radius;
+        filter[y*filter_width + x] = inside ? weight : 0.0f;
+      }
+    }
+  }
+}
+
+unsigned int filter_Gauss_radius(float sigma, double epsilon){
+  if(sigma <= 0.0f){
+    return 0;
+  }
+  /* the square of radius r holds the square of the mass of a 1d Gaussian
+   * within r+1/2, as the cells of a filter sample it
+   */
+  unsigned int radius = 0;
+  for(;;){
+    const double inside = erf((radius + 0.5)/(sigma*M_SQRT2));
+    if(1.0 - inside*inside <= epsilon){
+      return radius;
+    }
+    ++radius;
+  }
+}
+
+unsigned int filter_bucket_width(unsigned int width){
+  if(width <= 3){
+    return width <= 1 ? 1 : 3;
+  }
+  for(unsigned int power = 4;; power *= 2){
+    if(power + 1 >= width){
+      return power + 1;
+    }
+    if(3*power/2 + 1 >= width){
+      return 3*power/2 + 1;
+    }
+  }
+}
+
+unsigned int filter_adaptive_widths(unsigned int *widths, unsigned int num_filters, double epsilon, unsigned int max_width){
+  unsigned int widest = 1;
+  for(unsigned int i = 0; i < num_filters; ++i){
+    const unsigned int radius = filter_Gauss_radius(filter_Gauss2dbank_sigma(i,num_filters),epsilon);
+    unsigned int width = filter_bucket_width(2*radius + 1);
+    if(max_width && width > max_width){
+      width = max_width;
+    }
+    widths[i] = width;
+    widest = width > widest ? width : widest;
+  }
+  return widest;
+}
+
+void filter_Gauss2dbank_adaptive(float *bank, const unsigned int *widths, unsigned int num_filters, unsigned int filter_width){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  float *own = malloc(sizeof(float)*filter_len);
+  for(unsigned int i = 0; i < num_filters; ++i){
+    const unsigned int width = widths[i];
+    filter_Gauss2d(own,width,filter_Gauss2dbank_sigma(i,num_filters));
+    /* centered in the width of the bank */
+    filter_dilate_bank(&bank[i*filter_len],filter_width,own,NULL,1,width);
+  }
+  free(own);
+}
+
+size_t filter_pack_bank(float *packed, size_t *offsets, const float *bank, const unsigned int *widths,
+  const unsigned int *heights, unsigned int num_filters, unsigned int filter_width){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  size_t offset = 0;
+  for(unsigned int i = 0; i < num_filters; ++i){
+    const unsigned int width = widths[i];
+    const unsigned int height = heights ? heights[i] : width;
+    const unsigned int left = (filter_width - width)/2;
+    const unsigned int top = (filter_width - height)/2;
+    offsets[i] = offset;
+    for(unsigned int y = 0; y < height; ++y){
+      for(unsigned int x = 0; x < width; ++x){
+        packed[offset++] = bank[i*filter_len + (size_t)(top + y)*filter_width + left + x];
+      }
+    }
+  }
+  return offset;
+}
+
+void filter_atrous_bank(float *bank, unsigned int *dilations, unsigned int num_filters, unsigned int filter_width){
+  unsigned int dilation = 1;
+  for(unsigned int i = 0; i < num_filters; ++i){
+    filter_Gauss2d(&bank[i*filter_width*filter_width],filter_width,(filter_width - 1)/4.0f);
+    dilations[i] = dilation;
+    if(dilation < FILTER_MAX_DILATION){
+      dilation *= 2;
+    }
+  }
+}
+
+unsigned int filter_dilated_width(const unsigned int *dilations, unsigned int num_filters, unsigned int filter_width){
+  unsigned int width = filter_width;
+  for(unsigned int i = 0; dilations && i < num_filters; ++i){
+    const unsigned int dilated = (filter_width - 1)*dilations[i] + 1;
+    width = dilated > width ? dilated : width;
+  }
+  return width;
+}
+
+void filter_dilate_bank(float *dense, unsigned int dense_width, const float *bank, const unsigned int *dilations,
+  unsigned int num_filters, unsigned int filter_width){
+  const size_t dense_len = (size_t)dense_width*dense_width;
+  const unsigned int radius = (filter_width - 1)/2;
+  const unsigned int center = (dense_width - 1)/2;
+  for(unsigned int i = 0; i < num_filters; ++i){
+    float *filter = &dense[i*dense_len];
+    const unsigned int step = dilations ? dilations[i] : 1;
+    for(size_t c = 0; c < dense_len; ++c){
+      filter[c] = 0.0f;
+    }
+    for(unsigned int y = 0; y < filter_width; ++y){
+      for(unsigned int x = 0; x < filter_width; ++x){
+        const size_t row = center + (size_t)y*step - (size_t)radius*step;
+        const size_t col = center + (size_t)x*step - (size_t)radius*step;
+        filter[row*dense_width + col] = bank[(i*filter_width + y)*filter_width + x];
+      }
+    }
+  }
+}
+
+/* the filter_Gauss2dbank kernels in build/ use the same schedule */
+float filter_Gauss2dbank_sigma(unsigned int filter, unsigned int num_filters){
+  return (filter + 1) * 25.0f/num_filters;
+}
+
 void filter_Gauss2d(float *filter, unsigned int n, float sigma){
+  /* a Gaussian with no spread is an impulse */
+  if(sigma <= 0.0f){
+    for(unsigned int i = 0; i < n*n; ++i){
+      filter[i] = 0.0f;
+    }
+    filter[(n*n-1)/2] = 1.0f;
+    return;
+  }
+
   const float coefficient = (1.0/(2*M_PI*sigma*sigma));
   const int offset = (n-1) / 2;
   float sum = 0.0;
@@ -36,6 +182,103 @@ void filter_Gauss2d(float *filter, unsigned int n, float sigma){
   }
 }
 
+const unsigned int FILTER_BASIS_X[FILTER_STEER_BASIS] = {0, 1, 0, 2, 1, 0};
+const unsigned int FILTER_BASIS_Y[FILTER_STEER_BASIS] = {0, 0, 1, 0, 1, 2};
+
+unsigned int filter_steerable_count(const struct filter_steerable *steer){
+  unsigned int per_sigma = 0;
+  for(unsigned int o = 0; o < FILTER_STEER_ORDERS; ++o){
+    per_sigma += steer->orientations[o];
+  }
+  return steer->num_sigmas*per_sigma;
+}
+
+void filter_Gauss1d_derivatives(float *kernels, unsigned int n, float sigma){
+  const int offset = (n-1) / 2;
+  for(unsigned int i = 0; i < FILTER_STEER_ORDERS*n; ++i){
+    kernels[i] = 0.0f;
+  }
+  /* derivatives of an impulse are left zero */
+  if(sigma <= 0.0f){
+    kernels[offset] = 1.0f;
+    return;
+  }
+
+  float sum = 0.0f;
+  for(unsigned int i = 0; i < n; ++i){
+    kernels[i] = Gaussian((int)i - offset,0,sigma);
+    sum += kernels[i];
+  }
+  float second = 0.0f;
+  for(unsigned int i = 0; i < n; ++i){
+    const float x = ((int)i - offset)/sigma;
+    kernels[i] /= sum;
+    kernels[n + i] = -x*kernels[i];
+    kernels[2*n + i] = (x*x - 1.0f)*kernels[i];
+    second += kernels[2*n + i];
+  }
+
+  /* truncated second derivatives respond to flat images, take that out */
+  for(unsigned int i = 0; i < n; ++i){
+    kernels[2*n + i] -= second*kernels[i];
+  }
+}
+
+void filter_steerable_coefficients(const struct filter_steerable *steer, unsigned int filter, float *coefficients){
+  for(unsigned int b = 0; b < FILTER_STEER_BASIS; ++b){
+    coefficients[b] = 0.0f;
+  }
+  unsigned int order = 0;
+  while(order + 1 < FILTER_STEER_ORDERS && filter >= steer->orientations[order]){
+    filter -= steer->orientations[order++];
+  }
+
+  /* the derivative along (cos, sin) of the angle */
+  const double turn = order == 1 ? 2*M_PI : M_PI;
+  const double angle = turn*filter/steer->orientations[order];
+  const double c = cos(angle);
+  const double s = sin(angle);
+  switch(order){
+  case 0:
+    coefficients[0] = 1.0f;
+    break;
+  case 1:
+    coefficients[1] = c;
+    coefficients[2] = s;
+    break;
+  default:
+    coefficients[3] = c*c;
+    coefficients[4] = 2*c*s;
+    coefficients[5] = s*s;
+    break;
+  }
+}
+
+void filter_steerable_bank(float *bank, const struct filter_steerable *steer, unsigned int filter_width){
+  const unsigned int per_sigma = filter_steerable_count(steer)/(steer->num_sigmas ? steer->num_sigmas : 1);
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  float *kernels = malloc(sizeof(float)*FILTER_STEER_ORDERS*filter_width);
+  for(unsigned int s = 0; s < steer->num_sigmas; ++s){
+    filter_Gauss1d_derivatives(kernels,filter_width,filter_Gauss2dbank_sigma(s,steer->num_sigmas));
+    for(unsigned int f = 0; f < per_sigma; ++f){
+      float coefficients[FILTER_STEER_BASIS];
+      filter_steerable_coefficients(steer,f,coefficients);
+      float *filter = &bank[(s*per_sigma + f)*filter_len];
+      /* row i is y, column j is x */
+      for(unsigned int i = 0; i < filter_width; ++i){
+        for(unsigned int j = 0; j < filter_width; ++j){
+          float weight = 0.0f;
+          for(unsigned int b = 0; b < FILTER_STEER_BASIS; ++b){
+            weight += coefficients[b]*kernels[FILTER_BASIS_X[b]*filter_width + j]*kernels[FILTER_BASIS_Y[b]*filter_width + i];
+          }
+          filter[i*filter_width + j] = weight;
+        }
+      }
+    }
+  }
+  free(kernels);
+}
+
 float Gaussian(float x, float y, float sigma){
   return exp(-(x*x + y*y)/(2*sigma*sigma));
 }
@@ -11,6 +11,76 @@
  */
 extern void filter_Gauss2dbank(float *bank,unsigned int num_filters, unsigned int filter_width);
 
+/* standard deviation of a filter in a bank made by filter_Gauss2dbank
+ * sigmas are evenly spaced up to 25 with the widest filter last
+ */
+extern float filter_Gauss2dbank_sigma(unsigned int filter,unsigned int num_filters);
+
+/* create a bank of centered mean filters of growing size
+ * the box of filter i has a radius of (i+1)*r/num_filters within the
+ * radius r of filter_width, and is zero outside. linear engines average
+ * over the box and rank engines take it as their window, see rank.h
+ */
+extern void filter_box_bank(float *bank,unsigned int num_filters,unsigned int filter_width);
+
+/* adaptive banks give every filter its own support, as wide as its
+ * Gaussian needs to hold all but FILTER_ADAPTIVE_EPSILON of its weight and
+ * rounded up to a size bucket, so engines launch once per bucket instead of
+ * once per width. buckets are the odd widths 2^k+1 and 3*2^k+1
+ */
+#define FILTER_ADAPTIVE_EPSILON 1e-3
+
+/* radius of the square holding all but epsilon of a Gaussian */
+extern unsigned int filter_Gauss_radius(float sigma,double epsilon);
+
+/* smallest bucket at least width */
+extern unsigned int filter_bucket_width(unsigned int width);
+
+/* widths of the filters of an adaptive bank with the filter_Gauss2dbank
+ * schedule, none over max_width unless it is 0. returns the widest
+ */
+extern unsigned int filter_adaptive_widths(unsigned int *widths,unsigned int num_filters,double epsilon,unsigned int max_width);
+
+/* create an adaptive bank of Gaussians laid out as in filter_Gauss2dbank
+ * at filter_width, at least the widest of widths. each filter is
+ * normalized over its own width, centered and zero around it
+ */
+extern void filter_Gauss2dbank_adaptive(float *bank,const unsigned int *widths,unsigned int num_filters,unsigned int filter_width);
+
+/* the filters of a bank of filter_width cropped to widths[i]*heights[i],
+ * centered, and packed one after the other, filter i at offsets[i]. heights
+ * may be NULL for squares. returns the packed length
+ */
+extern size_t filter_pack_bank(float *packed,size_t *offsets,const float *bank,const unsigned int *widths,
+  const unsigned int *heights,unsigned int num_filters,unsigned int filter_width);
+
+/* dilated banks space the taps of filter i dilations[i] pixels apart, so
+ * a filter of filter_width reaches as far as a dense one of
+ * (filter_width-1)*dilations[i]+1. dilations of filter_atrous_bank stop at
+ * FILTER_MAX_DILATION
+ */
+#define FILTER_MAX_DILATION 1024
+
+/* create a bank of Gaussians for dilated convolution
+ * filter i is the normalized Gaussian of filter_width and sigma
+ * (filter_width-1)/4 with a dilation of 2^i, so every filter covers twice
+ * the scale of the one before for the same number of taps
+ * dilations: num_filters
+ */
+extern void filter_atrous_bank(float *bank,unsigned int *dilations,unsigned int num_filters,unsigned int filter_width);
+
+/* width of the dense equivalent of a dilated bank, that of its widest
+ * filter, or filter_width if dilations is NULL
+ */
+extern unsigned int filter_dilated_width(const unsigned int *dilations,unsigned int num_filters,unsigned int filter_width);
+
+/* the dense equivalent of a dilated bank, the taps of every filter spread
+ * out with zeros between them and centered in dense_width*dense_width
+ * cells, dense_width at least filter_dilated_width
+ */
+extern void filter_dilate_bank(float *dense,unsigned int dense_width,const float *bank,const unsigned int *dilations,
+  unsigned int num_filters,unsigned int filter_width);
+
 /* create a 2d Gaussian
  * filter: array to put Guassian into
  * n: side lengths of kernel
@@ -19,5 +89,44 @@ extern void filter_Gauss2dbank(float *bank,unsigned int num_filters, unsigned in
  */
 extern void filter_Gauss2d(float *filter, unsigned int n, float sigma);
 
+/* derivatives of Gaussian up to the second steer with a basis of the 6
+ * separable filters G, Gx, Gy, Gxx, Gxy and Gyy, each the product of 1d
+ * kernels of order FILTER_BASIS_X[b] along x and FILTER_BASIS_Y[b] along y
+ */
+#define FILTER_STEER_ORDERS 3
+#define FILTER_STEER_BASIS 6
+extern const unsigned int FILTER_BASIS_X[FILTER_STEER_BASIS];
+extern const unsigned int FILTER_BASIS_Y[FILTER_STEER_BASIS];
+
+/* a bank of oriented derivatives of Gaussian
+ * for every sigma of the filter_Gauss2dbank schedule there are
+ * orientations[o] filters of order o, turned evenly over a full turn for
+ * the first derivative and half a turn for the second, where their
+ * negations repeat. filters are grouped by sigma, then order
+ */
+struct filter_steerable{
+  unsigned int num_sigmas;
+  unsigned int orientations[FILTER_STEER_ORDERS];
+};
+
+/* number of filters in a steerable bank */
+extern unsigned int filter_steerable_count(const struct filter_steerable *steer);
+
+/* the 1d Gaussian of n taps with unit sum and its derivatives, scaled by
+ * sigma and sigma^2 so responses are comparable across sigmas
+ * kernels: FILTER_STEER_ORDERS*n, order after order
+ */
+extern void filter_Gauss1d_derivatives(float *kernels, unsigned int n, float sigma);
+
+/* weights of the basis filters making up filter of a sigma's group
+ * coefficients: FILTER_STEER_BASIS
+ */
+extern void filter_steerable_coefficients(const struct filter_steerable *steer,unsigned int filter,float *coefficients);
+
+/* create a steerable bank as 2d filters of width filter_width
+ * bank: filter_steerable_count(steer) filters laid out as in filter_Gauss2dbank
+ */
+extern void filter_steerable_bank(float *bank,const struct filter_steerable *steer,unsigned int filter_width);
+
 
 #endif
@@ -0,0 +1,145 @@
+#include "frames.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* y4m header tags are at most this long */
+#define TAG_LEN 64
+
+/* read a space separated tag of a header line into tag
+ * returns the character after it, ' ' or '\n', or EOF
+ */
+static int read_tag(FILE *file, char *tag){
+  int c;
+  size_t len = 0;
+  while((c = fgetc(file)) != EOF && c != ' ' && c != '\n'){
+    if(len < TAG_LEN - 1){
+      tag[len++] = c;
+    }
+  }
+  tag[len] = '\0';
+  return c;
+}
+
+int frame_reader_open(struct frame_reader *reader, FILE *file, size_t width, size_t height){
+  reader->file = file;
+  reader->width = width;
+  reader->height = height;
+  reader->skip = 0;
+  reader->num_pending = 0;
+  strcpy(reader->rate,"30:1");
+
+  /* a y4m stream announces itself */
+  const char magic[] = "YUV4MPEG2";
+  int c;
+  while(reader->num_pending < sizeof(magic) - 1 && (c = fgetc(file)) != EOF){
+    reader->pending[reader->num_pending++] = c;
+    if(c != magic[reader->num_pending - 1]){
+      break;
+    }
+  }
+  if(reader->num_pending < sizeof(magic) - 1 || memcmp(reader->pending,magic,reader->num_pending) != 0){
+    /* raw frames, what was read starts the first frame */
+    reader->y4m = 0;
+    if(width == 0 || height == 0){
+      fprintf(stderr,"Raw frames need their size\n");
+      return 1;
+    }
+    return 0;
+  }
+
+  reader->y4m = 1;
+  reader->num_pending = 0;
+  char colorspace[TAG_LEN] = "420";
+  char tag[TAG_LEN];
+  c = fgetc(file);
+  while(c == ' '){
+    c = read_tag(file,tag);
+    switch(tag[0]){
+    case 'W':
+      reader->width = strtoul(tag + 1,NULL,10);
+      break;
+    case 'H':
+      reader->height = strtoul(tag + 1,NULL,10);
+      break;
+    case 'F':
+      snprintf(reader->rate,sizeof(reader->rate),"%s",tag + 1);
+      break;
+    case 'C':
+      snprintf(colorspace,sizeof(colorspace),"%s",tag + 1);
+      break;
+    default:
+      break;
+    }
+  }
+  if(c != '\n' || reader->width == 0 || reader->height == 0){
+    fprintf(stderr,"Error reading y4m header\n");
+    return 1;
+  }
+
+  /* chroma planes which follow the luma plane */
+  const size_t half_width = (reader->width + 1)/2;
+  const size_t half_height = (reader->height + 1)/2;
+  if(strncmp(colorspace,"mono",4) == 0){
+    reader->skip = 0;
+  }else if(strncmp(colorspace,"444",3) == 0){
+    reader->skip = 2*reader->width*reader->height;
+  }else if(strncmp(colorspace,"422",3) == 0){
+    reader->skip = 2*half_width*reader->height;
+  }else if(strncmp(colorspace,"420",3) == 0){
+    reader->skip = 2*half_width*half_height;
+  }else{
+    fprintf(stderr,"Unsupported y4m colorspace %s\n",colorspace);
+    return 1;
+  }
+  return 0;
+}
+
+int frame_reader_next(struct frame_reader *reader, uint8_t *frame){
+  FILE *file = reader->file;
+  if(reader->y4m){
+    /* FRAME and optional parameters up to the end of the line */
+    char tag[TAG_LEN];
+    int c = read_tag(file,tag);
+    if(c == EOF || strcmp(tag,"FRAME") != 0){
+      return 0;
+    }
+    while(c != '\n' && c != EOF){
+      c = fgetc(file);
+    }
+  }
+
+  const size_t frame_size = reader->width*reader->height;
+  size_t got = reader->num_pending < frame_size ? reader->num_pending : frame_size;
+  memcpy(frame,reader->pending,got);
+  /* frames smaller than what was read for the header take several reads */
+  reader->num_pending -= got;
+  memmove(reader->pending,reader->pending + got,reader->num_pending);
+  if(fread(frame + got,1,frame_size - got,file) != frame_size - got){
+    return 0;
+  }
+
+  /* streams may be pipes, so read past the chroma rather than seek */
+  uint8_t chroma[4096];
+  for(size_t left = reader->skip; left > 0;){
+    const size_t n = left < sizeof(chroma) ? left : sizeof(chroma);
+    if(fread(chroma,1,n,file) != n){
+      return 0;
+    }
+    left -= n;
+  }
+  return 1;
+}
+
+void frame_writer_open(FILE *file, int y4m, size_t width, size_t height, const char *rate){
+  if(y4m){
+    fprintf(file,"YUV4MPEG2 W%zu H%zu F%s Ip A1:1 Cmono\n",width,height,rate ? rate : "30:1");
+  }
+}
+
+int frame_writer_put(FILE *file, int y4m, const uint8_t *frame, size_t frame_size){
+  if(y4m && fputs("FRAME\n",file) == EOF){
+    return 1;
+  }
+  return fwrite(frame,1,frame_size,file) != frame_size;
+}
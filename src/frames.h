@@ -0,0 +1,45 @@
+/* reading and writing sequences of greyscale frames
+ * YUV4MPEG2 (y4m) streams keep their luma plane, chroma is skipped.
+ * raw streams are frames of width*height bytes back to back, their size
+ * has to be given. frames are top down, as in mapped images
+ */
+
+#ifndef GIMC_FRAMES_H
+#define GIMC_FRAMES_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+struct frame_reader{
+  FILE *file;
+  int y4m; /* nonzero for a y4m stream, zero for raw frames */
+  size_t width;
+  size_t height;
+  size_t skip; /* bytes after the luma plane of each frame */
+  char rate[32]; /* frame rate of a y4m stream, e.g. 30:1 */
+  uint8_t pending[16]; /* start of the first raw frame, read looking for a y4m header */
+  size_t num_pending;
+};
+
+/* start reading frames from file
+ * a stream starting with YUV4MPEG2 is read as y4m, anything else as raw
+ * frames of width*height, in which case width and height must not be 0
+ * returns nonzero if the stream can't be read
+ */
+extern int frame_reader_open(struct frame_reader *reader,FILE *file,size_t width,size_t height);
+
+/* read the next frame into width*height bytes of frame
+ * returns 1 for a frame and 0 at the end of the stream or on error
+ */
+extern int frame_reader_next(struct frame_reader *reader,uint8_t *frame);
+
+/* start writing frames of width*height to file, as y4m with a mono
+ * colorspace if y4m is nonzero and raw otherwise
+ * rate: frame rate for the y4m header, may be NULL
+ */
+extern void frame_writer_open(FILE *file,int y4m,size_t width,size_t height,const char *rate);
+
+/* write a frame, returns nonzero on error */
+extern int frame_writer_put(FILE *file,int y4m,const uint8_t *frame,size_t frame_size);
+
+#endif
@@ -0,0 +1,95 @@
+/* single front end of the engines
+ * takes named options instead of the positions of the nconv tools, and by
+ * default picks the fastest engine for the image, bank and device, see
+ * choose.h. every other option is that of the tools
+ */
+
+/* standard headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project headers */
+#include "tool.h"
+
+/* in the order of enum tool_bank */
+static const char *bank_names[] = {"gauss", "device", "steerable", "box", "atrous", "adaptive", "file"};
+#define NUM_BANK_NAMES (sizeof(bank_names)/sizeof(bank_names[0]))
+
+static void usage(const char *program){
+  printf("Usage: %s --image=FILE [--device=cpu|gpu] [--filters=N] [--width=W]\n",program);
+  printf("  [--engine=auto|base|lwf|...] [--bank=gauss|device|steerable|box|atrous|adaptive]\n");
+  printf("  [--bank-file=FILE]\n");
+  printf("  [--tuning=FILE] [--benchmark=0|1] and the options of the nconv tools\n");
+}
+
+int main(int argc, char **argv){
+  const char *image_path = NULL;
+  const char *device = "1";
+  const char *filters = "8";
+  const char *width = "49";
+  enum engine_id engine = TOOL_ENGINE_AUTO;
+  int bank_source = -1;
+
+  /* the tool sees its positions then the options left */
+  char **tool_argv = malloc(sizeof(char *)*(argc + 5));
+  int tool_argc = 5;
+  for(int i = 1; i < argc; ++i){
+    if(strncmp(argv[i],"--image=",8) == 0){
+      image_path = argv[i] + 8;
+    }else if(strncmp(argv[i],"--device=",9) == 0){
+      if(strcmp(argv[i] + 9,"cpu") != 0 && strcmp(argv[i] + 9,"gpu") != 0){
+        fprintf(stderr,"Unknown device %s\n",argv[i] + 9);
+        return -1;
+      }
+      device = strcmp(argv[i] + 9,"cpu") == 0 ? "0" : "1";
+    }else if(strncmp(argv[i],"--filters=",10) == 0){
+      filters = argv[i] + 10;
+    }else if(strncmp(argv[i],"--width=",8) == 0){
+      width = argv[i] + 8;
+    }else if(strncmp(argv[i],"--engine=",9) == 0){
+      engine = strcmp(argv[i] + 9,"auto") == 0 ? TOOL_ENGINE_AUTO : engine_from_name(argv[i] + 9);
+      if(engine == NUM_ENGINES && strcmp(argv[i] + 9,"auto") != 0){
+        fprintf(stderr,"Unknown engine %s\n",argv[i] + 9);
+        return -1;
+      }
+    }else if(strncmp(argv[i],"--bank=",7) == 0){
+      for(size_t b = 0; b < NUM_BANK_NAMES; ++b){
+        if(strcmp(argv[i] + 7,bank_names[b]) == 0){
+          bank_source = b;
+        }
+      }
+      if(bank_source < 0){
+        fprintf(stderr,"Unknown bank %s\n",argv[i] + 7);
+        return -1;
+      }
+    }else if(strncmp(argv[i],"--bank-file=",12) == 0){
+      /* the tool reads the file */
+      bank_source = TOOL_BANK_FILE;
+      tool_argv[tool_argc++] = argv[i];
+    }else if(strcmp(argv[i],"--help") == 0){
+      usage(argv[0]);
+      return 0;
+    }else{
+      tool_argv[tool_argc++] = argv[i];
+    }
+  }
+  if(image_path == NULL){
+    usage(argv[0]);
+    return -1;
+  }
+  tool_argv[0] = argv[0];
+  tool_argv[1] = (char *)image_path;
+  tool_argv[2] = (char *)device;
+  tool_argv[3] = (char *)filters;
+  tool_argv[4] = (char *)width;
+  tool_argv[tool_argc] = NULL;
+
+  /* the rank engines take boxes, the others Gaussians */
+  if(bank_source < 0){
+    bank_source = engine != TOOL_ENGINE_AUTO && !engine_is_linear(engine) ? TOOL_BANK_BOX : TOOL_BANK_HOST;
+  }
+  const int status = tool_main(tool_argc,tool_argv,engine,bank_source);
+  free(tool_argv);
+  return status;
+}
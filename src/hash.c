@@ -0,0 +1,54 @@
+#include "hash.h"
+#include <string.h>
+
+/* multipliers of the 64 bit murmur and xxhash finalizers */
+#define PRIME1 0x9e3779b185ebca87ull
+#define PRIME2 0xc2b2ae3d27d4eb4full
+#define PRIME3 0xff51afd7ed558ccdull
+
+static uint64_t rotate(uint64_t x, int bits){
+  return (x << bits) | (x >> (64 - bits));
+}
+
+/* mix one word into a lane */
+static uint64_t round64(uint64_t lane, uint64_t word){
+  lane += word*PRIME2;
+  return rotate(lane,31)*PRIME1;
+}
+
+static uint64_t finalize(uint64_t hash){
+  hash ^= hash >> 33;
+  hash *= PRIME3;
+  hash ^= hash >> 33;
+  hash *= PRIME2;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+uint64_t gimc_hash64(const void *data, size_t len, uint64_t seed){
+  const unsigned char *bytes = data;
+
+  /* four independent lanes over 32 byte blocks keep the multipliers busy */
+  uint64_t lanes[4] = {seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1};
+  size_t i = 0;
+  for(; i + 32 <= len; i += 32){
+    for(int l = 0; l < 4; ++l){
+      uint64_t word;
+      memcpy(&word,bytes + i + 8*l,8);
+      lanes[l] = round64(lanes[l],word);
+    }
+  }
+  uint64_t hash = rotate(lanes[0],1) + rotate(lanes[1],7) + rotate(lanes[2],12) + rotate(lanes[3],18);
+  hash += len;
+
+  /* the tail, a word then a byte at a time */
+  for(; i + 8 <= len; i += 8){
+    uint64_t word;
+    memcpy(&word,bytes + i,8);
+    hash = rotate(hash ^ round64(0,word),27)*PRIME1 + PRIME3;
+  }
+  for(; i < len; ++i){
+    hash = rotate(hash ^ (bytes[i]*PRIME1),11)*PRIME2;
+  }
+  return finalize(hash);
+}
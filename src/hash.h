@@ -0,0 +1,12 @@
+/* fast non cryptographic hashing of pixels and coefficients */
+
+#ifndef GIMC_HASH_H
+#define GIMC_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 64 bit hash of len bytes of data, seed chains hashes of several parts */
+extern uint64_t gimc_hash64(const void *data,size_t len,uint64_t seed);
+
+#endif
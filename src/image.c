@@ -1,19 +1,246 @@
+#define _DEFAULT_SOURCE
 #include "image.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+/* mappings at least this large ask for transparent huge pages */
+#define HUGE_PAGE_SIZE (2 << 20)
+
+/* extension of a filename including the dot, "" if it has none */
+static const char *extension(const char *filename){
+  const char *dot = strrchr(filename,'.');
+  const char *slash = strrchr(filename,'/');
+  return dot && (slash == NULL || dot > slash) ? dot : "";
+}
+
+/* map a whole file read only, returns NULL on failure */
+static void *map_file(const char *filename, size_t *size){
+  int fd = open(filename,O_RDONLY);
+  if(fd < 0){
+    perror(filename);
+    return NULL;
+  }
+  struct stat st;
+  if(fstat(fd,&st) != 0 || st.st_size == 0){
+    fprintf(stderr,"%s: empty or unreadable file\n",filename);
+    close(fd);
+    return NULL;
+  }
+  *size = st.st_size;
+  void *mapping = mmap(NULL,*size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(mapping == MAP_FAILED){
+    perror(filename);
+    return NULL;
+  }
+
+  /* every pixel is read, so read ahead and use huge pages where the kernel can */
+  madvise(mapping,*size,MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+  if(*size >= HUGE_PAGE_SIZE){
+    madvise(mapping,*size,MADV_HUGEPAGE);
+  }
+#endif
+  return mapping;
+}
+
+/* skip whitespace and comments of a PGM header */
+static size_t pgm_skip(const char *header, size_t pos, size_t size){
+  while(pos < size){
+    if(header[pos] == '#'){
+      while(pos < size && header[pos] != '\n'){
+        ++pos;
+      }
+    }else if(header[pos] == ' ' || header[pos] == '\t' || header[pos] == '\n' || header[pos] == '\r'){
+      ++pos;
+    }else{
+      break;
+    }
+  }
+  return pos;
+}
+
+/* read a PGM header number */
+static size_t pgm_number(const char *header, size_t *pos, size_t size){
+  size_t value = 0;
+  *pos = pgm_skip(header,*pos,size);
+  while(*pos < size && header[*pos] >= '0' && header[*pos] <= '9'){
+    value = value*10 + (header[(*pos)++] - '0');
+  }
+  return value;
+}
+
+/* offset of the pixels of a binary 8 bit PGM, 0 if it is not one */
+static size_t parse_pgm(const char *data, size_t size, size_t *width, size_t *height){
+  if(size < 2 || data[0] != 'P' || data[1] != '5'){
+    return 0;
+  }
+  size_t pos = 2;
+  *width = pgm_number(data,&pos,size);
+  *height = pgm_number(data,&pos,size);
+  const size_t maxval = pgm_number(data,&pos,size);
+  /* a single whitespace character ends the header */
+  ++pos;
+  if(maxval == 0 || maxval > 255){
+    return 0;
+  }
+  return pos;
+}
+
+/* offset of the data of a 2d uint8 array, or 3d with one plane, 0 otherwise */
+static size_t parse_npy(const char *data, size_t size, size_t *width, size_t *height){
+  if(size < 10 || memcmp(data,"\x93NUMPY",6) != 0){
+    return 0;
+  }
+  /* version 1 has a 2 byte header length, later versions 4 bytes */
+  const unsigned char *bytes = (const unsigned char *)data;
+  size_t header_len, offset;
+  if(bytes[6] == 1){
+    header_len = bytes[8] | bytes[9] << 8;
+    offset = 10;
+  }else{
+    if(size < 12){
+      return 0;
+    }
+    header_len = bytes[8] | bytes[9] << 8 | (size_t)bytes[10] << 16 | (size_t)bytes[11] << 24;
+    offset = 12;
+  }
+  if(offset + header_len > size){
+    return 0;
+  }
+
+  char header[1024];
+  if(header_len >= sizeof(header)){
+    return 0;
+  }
+  memcpy(header,data + offset,header_len);
+  header[header_len] = '\0';
+
+  if(strstr(header,"u1'") == NULL || strstr(header,"'fortran_order': False") == NULL){
+    return 0;
+  }
+  const char *shape = strstr(header,"'shape': (");
+  if(shape == NULL){
+    return 0;
+  }
+  unsigned long dims[3];
+  const int num_dims = sscanf(shape,"'shape': (%lu, %lu, %lu",&dims[0],&dims[1],&dims[2]);
+  if(num_dims == 2){
+    *height = dims[0];
+    *width = dims[1];
+  }else if(num_dims == 3 && dims[0] == 1){
+    *height = dims[1];
+    *width = dims[2];
+  }else{
+    return 0;
+  }
+  return offset + header_len;
+}
+
+/* sizes of a raw frame from a name ending in _WIDTHxHEIGHT.raw */
+static int parse_raw_name(const char *filename, size_t *width, size_t *height){
+  const char *underscore = strrchr(filename,'_');
+  unsigned long w, h;
+  char end[8];
+  if(underscore == NULL || sscanf(underscore,"_%lux%lu%7s",&w,&h,end) != 3 || strcmp(end,".raw") != 0){
+    return 1;
+  }
+  *width = w;
+  *height = h;
+  return 0;
+}
+
+/* map a PGM, npy or raw file, returns nonzero if the format is not one of them */
+static int map_image(struct gimc_image *image, const char *filename){
+  const char *ext = extension(filename);
+  const int pgm = strcmp(ext,".pgm") == 0;
+  const int npy = strcmp(ext,".npy") == 0;
+  const int raw = strcmp(ext,".raw") == 0;
+  if(!pgm && !npy && !raw){
+    return 1;
+  }
+
+  size_t offset = 0;
+  if(raw && parse_raw_name(filename,&image->width,&image->height)){
+    fprintf(stderr,"%s: raw frames have to be named NAME_WIDTHxHEIGHT.raw\n",filename);
+    exit(EXIT_FAILURE);
+  }
+
+  trace_begin("map");
+  image->mapping = map_file(filename,&image->mapping_size);
+  trace_end();
+  if(image->mapping == NULL){
+    exit(EXIT_FAILURE);
+  }
+  if(pgm){
+    offset = parse_pgm(image->mapping,image->mapping_size,&image->width,&image->height);
+  }else if(npy){
+    offset = parse_npy(image->mapping,image->mapping_size,&image->width,&image->height);
+  }
+  if((!raw && offset == 0) || offset + image->width*image->height > image->mapping_size ||
+    image->width == 0 || image->height == 0){
+    fprintf(stderr,"%s: not an 8 bit greyscale image or truncated\n",filename);
+    exit(EXIT_FAILURE);
+  }
+
+  image->bitmap = NULL;
+  image->bits = (uint8_t *)image->mapping + offset;
+  image->top_down = 1;
+  return 0;
+}
+
 void gimc_image_load(struct gimc_image *image,const char * filename){
   FIBITMAP *bitmap;
+  image->mapping = NULL;
+  image->packed = NULL;
+
+  if(map_image(image,filename) == 0){
+    return;
+  }
 
   /* load image and convert to greyscale */
   const FREE_IMAGE_FORMAT fif = FreeImage_GetFIFFromFilename(filename);
+  trace_begin("decode");
   bitmap = FreeImage_Load(fif, filename,0);
+  trace_end();
+  if(bitmap == NULL){
+    fprintf(stderr,"%s: could not be loaded\n",filename);
+    exit(EXIT_FAILURE);
+  }
+  trace_begin("greyscale");
   image->bitmap = FreeImage_ConvertToGreyscale(bitmap);
   FreeImage_Unload(bitmap);
+  trace_end();
 
   image->width = FreeImage_GetWidth(image->bitmap);
   image->height = FreeImage_GetHeight(image->bitmap);
   image->bits = FreeImage_GetBits(image->bitmap);
+  image->top_down = 0;
+
+  /* scanlines are padded to 4 bytes, the engines expect them packed */
+  const size_t pitch = FreeImage_GetPitch(image->bitmap);
+  if(pitch != image->width){
+    image->packed = malloc(image->width*image->height);
+    for(size_t y = 0; y < image->height; ++y){
+      memcpy(&image->packed[y*image->width],&image->bits[y*pitch],image->width);
+    }
+    image->bits = image->packed;
+  }
 }
 
 void gimc_image_unload(struct gimc_image *image){
-  FreeImage_Unload(image->bitmap);
+  if(image->mapping){
+    munmap(image->mapping,image->mapping_size);
+  }else{
+    FreeImage_Unload(image->bitmap);
+  }
+  free(image->packed);
 }
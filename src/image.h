@@ -5,13 +5,22 @@
 #include <FreeImage.h>
 
 struct gimc_image{
-  FIBITMAP *bitmap;
-  uint8_t *bits;
+  FIBITMAP *bitmap; /* NULL when the file is mapped */
+  uint8_t *bits; /* width*height pixels, rows without padding */
   size_t width;
   size_t height;
+  int top_down; /* rows run from the top, FreeImage bitmaps run from the bottom */
+  void *mapping; /* mapped file, bits points into it */
+  size_t mapping_size;
+  uint8_t *packed; /* bits of a bitmap whose rows are padded, NULL otherwise */
 };
 
-/* load an image file into a gimc_image struct */
+/* load an image file into a gimc_image struct
+ * binary PGM (.pgm), uint8 numpy arrays (.npy) and raw frames named
+ * NAME_WIDTHxHEIGHT.raw are mapped read only and used in place,
+ * other formats are decoded by FreeImage and converted to greyscale.
+ * exits on failure
+ */
 extern void gimc_image_load(struct gimc_image *image,const char * filename);
 
 /* free resources used by image */
@@ -0,0 +1,206 @@
+#include "incremental.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+/* flags of a tile in gimc_incremental.dirty */
+#define TILE_CHANGED 1
+#define TILE_COMPUTE 2
+
+cl_int gimc_incremental_create(struct gimc_incremental *inc, struct gimc_cl *cl, const struct gimc_bank *bank,
+  size_t width, size_t height, size_t tile){
+  cl_int err;
+  memset(inc,0,sizeof(struct gimc_incremental));
+  inc->cl = cl;
+  inc->bank = bank;
+  inc->width = width;
+  inc->height = height;
+  inc->tile = tile ? tile : INCREMENTAL_TILE;
+  inc->tiles_x = (width + inc->tile - 1)/inc->tile;
+  inc->tiles_y = (height + inc->tile - 1)/inc->tile;
+  inc->dirty = malloc(inc->tiles_x*inc->tiles_y);
+
+  const size_t image_size = width*height;
+  inc->image = clCreateBuffer(cl->context,CL_MEM_READ_ONLY,image_size,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() incremental image",err);
+    return err;
+  }
+  inc->result = clCreateBuffer(cl->context,CL_MEM_READ_WRITE,image_size*bank->num_filters,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() incremental result",err);
+    return err;
+  }
+
+  const struct kernel_spec spec = {bank->width,bank->height,width,height,bank->num_filters};
+  cl_program program = program_cache_build(cl->programs,"lwfilter.cl",&spec);
+  if(program == NULL){
+    return CL_BUILD_PROGRAM_FAILURE;
+  }
+  inc->kernel = clCreateKernel(program,"convolve2d_rect",&err);
+  if(err){
+    print_error("clCreateKernel() convolve2d_rect",err);
+    return err;
+  }
+
+  /* only the rectangle changes between launches */
+  const cl_ulong image_width = width;
+  const cl_ulong image_height = height;
+  err = clSetKernelArg(inc->kernel,0,sizeof(cl_mem),&inc->image);
+  err |= clSetKernelArg(inc->kernel,1,sizeof(cl_mem),&bank->filters);
+  err |= clSetKernelArg(inc->kernel,2,sizeof(cl_mem),&inc->result);
+  err |= clSetKernelArg(inc->kernel,3,sizeof(cl_ulong),&image_width);
+  err |= clSetKernelArg(inc->kernel,4,sizeof(cl_ulong),&image_height);
+  err |= clSetKernelArg(inc->kernel,5,sizeof(unsigned int),&bank->width);
+  err |= clSetKernelArg(inc->kernel,6,sizeof(unsigned int),&bank->num_filters);
+  if(err){
+    print_error("clSetKernelArg() convolve2d_rect",err);
+  }
+  return err;
+}
+
+/* recompute the results of a rectangle of pixels */
+static cl_int compute_rect(struct gimc_incremental *inc, size_t x, size_t y, size_t width, size_t height,
+  struct incremental_stats *stats){
+  const size_t offset[3] = {x, y, 0};
+  const size_t global[3] = {width, height, inc->bank->num_filters};
+  cl_int err = clEnqueueNDRangeKernel(inc->cl->commands,inc->kernel,3,offset,global,NULL,0,NULL,trace_event("convolve2d_rect"));
+  if(err){
+    print_error("clEnqueueNDRangeKernel() convolve2d_rect",err);
+  }
+  if(stats){
+    ++stats->launches;
+  }
+  return err;
+}
+
+cl_int gimc_incremental_update(struct gimc_incremental *inc, const uint8_t *image, struct incremental_stats *stats){
+  cl_int err;
+  const size_t width = inc->width;
+  const size_t height = inc->height;
+  const size_t tile = inc->tile;
+  if(stats){
+    memset(stats,0,sizeof(struct incremental_stats));
+  }
+
+  /* everything is new the first time */
+  if(inc->previous == NULL){
+    inc->previous = malloc(width*height);
+    memcpy(inc->previous,image,width*height);
+    err = clEnqueueWriteBuffer(inc->cl->commands,inc->image,CL_FALSE,0,width*height,inc->previous,0,NULL,trace_event("write image"));
+    if(err){
+      print_error("clEnqueueWriteBuffer() incremental image",err);
+      return err;
+    }
+    if(stats){
+      stats->changed_tiles = stats->computed_tiles = inc->tiles_x*inc->tiles_y;
+    }
+    return compute_rect(inc,0,0,width,height,stats);
+  }
+
+  /* uploads of the last update read from previous */
+  clFinish(inc->cl->commands);
+
+  /* find the tiles which changed and upload them */
+  trace_begin("diff");
+  memset(inc->dirty,0,inc->tiles_x*inc->tiles_y);
+  for(size_t ty = 0; ty < inc->tiles_y; ++ty){
+    const size_t y0 = ty*tile;
+    const size_t rows = y0 + tile < height ? tile : height - y0;
+    for(size_t tx = 0; tx < inc->tiles_x; ++tx){
+      const size_t x0 = tx*tile;
+      const size_t cols = x0 + tile < width ? tile : width - x0;
+
+      int changed = 0;
+      for(size_t y = y0; y < y0 + rows; ++y){
+        if(memcmp(&inc->previous[y*width + x0],&image[y*width + x0],cols) != 0){
+          changed = 1;
+          break;
+        }
+      }
+      if(!changed){
+        continue;
+      }
+
+      for(size_t y = y0; y < y0 + rows; ++y){
+        memcpy(&inc->previous[y*width + x0],&image[y*width + x0],cols);
+      }
+      const size_t origin[3] = {x0, y0, 0};
+      const size_t region[3] = {cols, rows, 1};
+      err = clEnqueueWriteBufferRect(inc->cl->commands,inc->image,CL_FALSE,origin,origin,region,
+        width,0,width,0,inc->previous,0,NULL,trace_event("write tile"));
+      if(err){
+        print_error("clEnqueueWriteBufferRect() tile",err);
+        trace_end();
+        return err;
+      }
+      inc->dirty[ty*inc->tiles_x + tx] = TILE_CHANGED;
+      if(stats){
+        ++stats->changed_tiles;
+      }
+    }
+  }
+  trace_end();
+
+  /* a changed pixel moves results up to a filter radius away */
+  const size_t radius = (inc->bank->width - 1)/2;
+  const size_t reach = (radius + tile - 1)/tile;
+  for(size_t ty = 0; ty < inc->tiles_y; ++ty){
+    for(size_t tx = 0; tx < inc->tiles_x; ++tx){
+      if(!(inc->dirty[ty*inc->tiles_x + tx] & TILE_CHANGED)){
+        continue;
+      }
+      const size_t y_first = ty > reach ? ty - reach : 0;
+      const size_t y_last = ty + reach < inc->tiles_y - 1 ? ty + reach : inc->tiles_y - 1;
+      const size_t x_first = tx > reach ? tx - reach : 0;
+      const size_t x_last = tx + reach < inc->tiles_x - 1 ? tx + reach : inc->tiles_x - 1;
+      for(size_t y = y_first; y <= y_last; ++y){
+        for(size_t x = x_first; x <= x_last; ++x){
+          inc->dirty[y*inc->tiles_x + x] |= TILE_COMPUTE;
+        }
+      }
+    }
+  }
+
+  /* recompute runs of dirty tiles along each row of tiles */
+  for(size_t ty = 0; ty < inc->tiles_y; ++ty){
+    const size_t y0 = ty*tile;
+    const size_t rows = y0 + tile < height ? tile : height - y0;
+    size_t tx = 0;
+    while(tx < inc->tiles_x){
+      if(!(inc->dirty[ty*inc->tiles_x + tx] & TILE_COMPUTE)){
+        ++tx;
+        continue;
+      }
+      const size_t run = tx;
+      while(tx < inc->tiles_x && (inc->dirty[ty*inc->tiles_x + tx] & TILE_COMPUTE)){
+        ++tx;
+      }
+      const size_t x0 = run*tile;
+      const size_t x1 = tx*tile < width ? tx*tile : width;
+      if(stats){
+        stats->computed_tiles += tx - run;
+      }
+      err = compute_rect(inc,x0,y0,x1 - x0,rows,stats);
+      if(err){
+        return err;
+      }
+    }
+  }
+  return CL_SUCCESS;
+}
+
+void gimc_incremental_release(struct gimc_incremental *inc){
+  if(inc->kernel){
+    clReleaseKernel(inc->kernel);
+  }
+  if(inc->image){
+    clReleaseMemObject(inc->image);
+  }
+  if(inc->result){
+    clReleaseMemObject(inc->result);
+  }
+  free(inc->previous);
+  free(inc->dirty);
+}
@@ -0,0 +1,55 @@
+/* incremental convolution
+ * the image and results stay on the device between updates. each update
+ * compares the new image with the last one tile by tile, uploads the tiles
+ * which changed and recomputes only the result tiles within reach of the
+ * filters, so small edits cost in proportion to their size.
+ * results are those of the lwf engine, from convolve2d_rect in lwfilter.cl
+ */
+
+#ifndef GIMC_INCREMENTAL_H
+#define GIMC_INCREMENTAL_H
+
+#include "engine.h"
+
+/* default side length of a tile in pixels */
+#define INCREMENTAL_TILE 32
+
+struct gimc_incremental{
+  struct gimc_cl *cl;
+  const struct gimc_bank *bank;
+  size_t width;
+  size_t height;
+  size_t tile;
+  size_t tiles_x;
+  size_t tiles_y;
+  cl_mem image; /* the image as of the last update */
+  cl_mem result; /* num_filters planes of width*height, kept up to date */
+  uint8_t *previous; /* host copy of image, NULL before the first update */
+  unsigned char *dirty; /* per tile scratch */
+  cl_kernel kernel;
+};
+
+/* what an update did */
+struct incremental_stats{
+  size_t changed_tiles; /* image tiles which differed */
+  size_t computed_tiles; /* result tiles recomputed */
+  unsigned int launches;
+};
+
+/* set up incremental convolution of width*height images with bank
+ * tile: side length of tiles, 0 for INCREMENTAL_TILE
+ * bank has to outlive inc. returns CL_SUCCESS or the failing error
+ */
+extern cl_int gimc_incremental_create(struct gimc_incremental *inc,struct gimc_cl *cl,const struct gimc_bank *bank,
+  size_t width,size_t height,size_t tile);
+
+/* bring inc->result up to date with image, width*height pixels
+ * the first update convolves everything
+ * stats may be NULL. the update is enqueued on cl->commands
+ */
+extern cl_int gimc_incremental_update(struct gimc_incremental *inc,const uint8_t *image,struct incremental_stats *stats);
+
+/* release the buffers of inc */
+extern void gimc_incremental_release(struct gimc_incremental *inc);
+
+#endif
@@ -0,0 +1,219 @@
+#define _POSIX_C_SOURCE 200809L /* open_memstream */
+#include "kgen.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* a weight of a filter together with every tap it applies to */
+struct weight_group{
+  float weight;
+  unsigned int num_taps;
+  int *dy; /* tap offsets from the centre pixel */
+  int *dx;
+};
+
+/* the two languages only differ in a few spellings */
+enum kgen_lang{
+  KGEN_CL,
+  KGEN_C
+};
+
+/* split a filter into groups of taps with bit identical weights
+ * convolution uses the filter backwards, so the tap at offset (dy,dx)
+ * from the centre pixel is weighted by the cell at (radius-dy,radius-dx).
+ * taps with zero weight are dropped. returns the number of groups
+ */
+static unsigned int group_weights(const float *filter, unsigned int filter_width, struct weight_group **groups_out){
+  const int radius = (filter_width - 1)/2;
+  const unsigned int filter_len = filter_width*filter_width;
+  struct weight_group *groups = malloc(sizeof(struct weight_group)*filter_len);
+  unsigned int num_groups = 0;
+
+  /* taps are visited in row order so each group lists them in row order */
+  for(int dy = -radius; dy <= radius; ++dy){
+    for(int dx = -radius; dx <= radius; ++dx){
+      const float weight = filter[(radius-dy)*filter_width + (radius-dx)];
+      if(weight == 0.0f){
+        continue;
+      }
+
+      unsigned int g;
+      for(g = 0; g < num_groups; ++g){
+        if(memcmp(&groups[g].weight,&weight,sizeof(float)) == 0){
+          break;
+        }
+      }
+      if(g == num_groups){
+        groups[g].weight = weight;
+        groups[g].num_taps = 0;
+        groups[g].dy = malloc(sizeof(int)*filter_len);
+        groups[g].dx = malloc(sizeof(int)*filter_len);
+        ++num_groups;
+      }
+      groups[g].dy[groups[g].num_taps] = dy;
+      groups[g].dx[groups[g].num_taps] = dx;
+      ++groups[g].num_taps;
+    }
+  }
+
+  *groups_out = groups;
+  return num_groups;
+}
+
+static void free_groups(struct weight_group *groups, unsigned int num_groups){
+  for(unsigned int g = 0; g < num_groups; ++g){
+    free(groups[g].dy);
+    free(groups[g].dx);
+  }
+  free(groups);
+}
+
+unsigned int kgen_multiplies(const float *filter, unsigned int filter_width){
+  struct weight_group *groups;
+  const unsigned int num_groups = group_weights(filter,filter_width,&groups);
+  free_groups(groups,num_groups);
+  return num_groups;
+}
+
+/* write the body of a function computing one filter at an interior pixel
+ * TAP(dy,dx) has to be defined by the surrounding code
+ */
+static void write_folded_sum(FILE *out, const float *filter, unsigned int filter_width){
+  struct weight_group *groups;
+  const unsigned int num_groups = group_weights(filter,filter_width,&groups);
+
+  fprintf(out,"  float sum = 0.0f;\n");
+  for(unsigned int g = 0; g < num_groups; ++g){
+    fprintf(out,"  sum += %.8ef*(",groups[g].weight);
+    for(unsigned int t = 0; t < groups[g].num_taps; ++t){
+      fprintf(out,"%sTAP(%d,%d)",t == 0 ? "" : "+",groups[g].dy[t],groups[g].dx[t]);
+    }
+    fprintf(out,");\n");
+  }
+  fprintf(out,"  return sum;\n");
+
+  free_groups(groups,num_groups);
+}
+
+/* write the filter as a table, used near the borders where taps need bounds checks */
+static void write_table(FILE *out, enum kgen_lang lang, unsigned int f, const float *filter, unsigned int filter_width){
+  const unsigned int filter_len = filter_width*filter_width;
+  fprintf(out,"%s float filter_%u[%u] = {",lang == KGEN_CL ? "__constant" : "static const",f,filter_len);
+  for(unsigned int i = 0; i < filter_len; ++i){
+    fprintf(out,"%s%.8ef",i % 8 == 0 ? "\n  " : " ",filter[i]);
+    if(i != filter_len - 1){
+      fprintf(out,",");
+    }
+  }
+  fprintf(out,"\n};\n\n");
+}
+
+static void write_source(FILE *out, enum kgen_lang lang, const float *bank, unsigned int num_filters, unsigned int filter_width){
+  const unsigned int filter_len = filter_width*filter_width;
+  const int radius = (filter_width - 1)/2;
+  const char *image_type = lang == KGEN_CL ? "__global const unsigned char" : "const unsigned char";
+  const char *table_type = lang == KGEN_CL ? "__constant float" : "const float";
+  const char *size_type = lang == KGEN_CL ? "unsigned long" : "size_t";
+  const char *qualifier = lang == KGEN_CL ? "" : "static ";
+
+  fprintf(out,"/* generated by kgen: %u filters of width %u with baked in weights\n",num_filters,filter_width);
+  fprintf(out," * taps sharing a weight are summed before being multiplied\n");
+  fprintf(out," */\n\n");
+  if(lang == KGEN_C){
+    fprintf(out,"#include <stddef.h>\n\n");
+  }
+  fprintf(out,"#define FILTER_W %u\n",filter_width);
+  fprintf(out,"#define RADIUS %d\n",radius);
+  fprintf(out,"#define NUM_FILTERS %u\n\n",num_filters);
+
+  /* border path, bounds checked loop over the filter table */
+  fprintf(out,"%sfloat convolve_border(%s *image,%s *filter,int px,int py,%s image_width,%s image_height){\n",
+    qualifier,image_type,table_type,size_type,size_type);
+  fprintf(out,"  float sum = 0.0f;\n");
+  fprintf(out,"  for(int fy = 0; fy < FILTER_W; ++fy){\n");
+  fprintf(out,"    const int row = py - RADIUS + fy;\n");
+  fprintf(out,"    for(int fx = 0; fx < FILTER_W; ++fx){\n");
+  fprintf(out,"      const int col = px - RADIUS + fx;\n");
+  fprintf(out,"      if(row >= 0 && row < (int)image_height && col >= 0 && col < (int)image_width){\n");
+  fprintf(out,"        sum += image[row*image_width + col]*filter[%u - (fy*FILTER_W + fx)];\n",filter_len - 1);
+  fprintf(out,"      }\n");
+  fprintf(out,"    }\n");
+  fprintf(out,"  }\n");
+  fprintf(out,"  return sum;\n");
+  fprintf(out,"}\n\n");
+
+  /* interior path, every tap is in bounds so loads are unchecked */
+  fprintf(out,"#define TAP(dy,dx) image[centre + (dy)*(long)image_width + (dx)]\n\n");
+  for(unsigned int f = 0; f < num_filters; ++f){
+    const float *filter = &bank[f*filter_len];
+    write_table(out,lang,f,filter,filter_width);
+    fprintf(out,"%sfloat convolve_%u(%s *image,long centre,%s image_width){\n",qualifier,f,image_type,size_type);
+    write_folded_sum(out,filter,filter_width);
+    fprintf(out,"}\n\n");
+  }
+  fprintf(out,"#undef TAP\n\n");
+
+  /* dispatch on the filter index */
+  fprintf(out,"%sfloat convolve_filter(%s *image,unsigned int fid,int px,int py,%s image_width,%s image_height){\n",
+    qualifier,image_type,size_type,size_type);
+  fprintf(out,"  const int interior = px >= RADIUS && py >= RADIUS &&\n");
+  fprintf(out,"    px < (int)image_width - RADIUS && py < (int)image_height - RADIUS;\n");
+  fprintf(out,"  const long centre = py*(long)image_width + px;\n");
+  fprintf(out,"  switch(fid){\n");
+  for(unsigned int f = 0; f < num_filters; ++f){
+    fprintf(out,"  case %u:\n",f);
+    fprintf(out,"    return interior ? convolve_%u(image,centre,image_width) : convolve_border(image,filter_%u,px,py,image_width,image_height);\n",f,f);
+  }
+  fprintf(out,"  }\n");
+  fprintf(out,"  return 0.0f;\n");
+  fprintf(out,"}\n\n");
+
+  if(lang == KGEN_CL){
+    fprintf(out,"__kernel\n");
+    fprintf(out,"void convolve2d_baked(__global const unsigned char *image,\n");
+    fprintf(out,"  __global unsigned char *result,\n");
+    fprintf(out,"  unsigned long image_width,\n");
+    fprintf(out,"  unsigned long image_height)\n");
+    fprintf(out,"{\n");
+    fprintf(out,"  const unsigned int pixel = get_global_id(0);\n");
+    fprintf(out,"  const unsigned int fid = get_global_id(1);\n");
+    fprintf(out,"  const unsigned long image_size = image_width*image_height;\n\n");
+    fprintf(out,"  if(pixel < image_size && fid < NUM_FILTERS){\n");
+    fprintf(out,"    const int px = pixel %% image_width;\n");
+    fprintf(out,"    const int py = pixel / image_width;\n");
+    fprintf(out,"    result[pixel + fid*image_size] = convert_uchar_sat(convolve_filter(image,fid,px,py,image_width,image_height));\n");
+    fprintf(out,"  }\n");
+    fprintf(out,"}\n");
+  }else{
+    fprintf(out,"void kgen_convolve2d(const unsigned char *image,unsigned char *result,size_t image_width,size_t image_height){\n");
+    fprintf(out,"  const size_t image_size = image_width*image_height;\n");
+    fprintf(out,"  for(unsigned int fid = 0; fid < NUM_FILTERS; ++fid){\n");
+    fprintf(out,"    for(int py = 0; py < (int)image_height; ++py){\n");
+    fprintf(out,"      for(int px = 0; px < (int)image_width; ++px){\n");
+    fprintf(out,"        const float sum = convolve_filter(image,fid,px,py,image_width,image_height);\n");
+    fprintf(out,"        result[py*image_width + px + fid*image_size] = sum <= 0.0f ? 0 : sum >= 255.0f ? 255 : sum;\n");
+    fprintf(out,"      }\n");
+    fprintf(out,"    }\n");
+    fprintf(out,"  }\n");
+    fprintf(out,"}\n");
+  }
+}
+
+void kgen_write_cl(FILE *out, const float *bank, unsigned int num_filters, unsigned int filter_width){
+  write_source(out,KGEN_CL,bank,num_filters,filter_width);
+}
+
+void kgen_write_c(FILE *out, const float *bank, unsigned int num_filters, unsigned int filter_width){
+  write_source(out,KGEN_C,bank,num_filters,filter_width);
+}
+
+char *kgen_cl_source(const float *bank, unsigned int num_filters, unsigned int filter_width){
+  char *source = NULL;
+  size_t len;
+  FILE *out = open_memstream(&source,&len);
+  if(out == NULL){
+    return NULL;
+  }
+  kgen_write_cl(out,bank,num_filters,filter_width);
+  fclose(out);
+  return source;
+}
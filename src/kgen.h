@@ -0,0 +1,37 @@
+/* code generation of convolution kernels for a fixed filter bank
+ * the weights of the bank are written into the code as literals and
+ * taps which share a weight are summed before a single multiply
+ */
+
+#ifndef GIMC_KGEN_H
+#define GIMC_KGEN_H
+
+#include <stdio.h>
+
+/* write OpenCL source for a bank
+ * the source defines the kernel convolve2d_baked(image,result,image_width,image_height)
+ * which is launched over {image_size, num_filters} like convolve2d
+ * bank: filters laid out as in filter_Gauss2dbank
+ * num_filters: number of filters in bank
+ * filter_width: side length of each filter, assumed to be odd
+ */
+extern void kgen_write_cl(FILE *out,const float *bank,unsigned int num_filters,unsigned int filter_width);
+
+/* write C source for a bank
+ * the source defines kgen_convolve2d(image,result,image_width,image_height)
+ * which writes num_filters results of image_width*image_height each
+ * results of either are truncated and clamped as in native_convolve2d
+ */
+extern void kgen_write_c(FILE *out,const float *bank,unsigned int num_filters,unsigned int filter_width);
+
+/* OpenCL source for a bank as a string, see kgen_write_cl
+ * the string is malloc'd and has to be freed with free
+ */
+extern char *kgen_cl_source(const float *bank,unsigned int num_filters,unsigned int filter_width);
+
+/* count the distinct non zero weights of a filter
+ * this is the number of multiplies the generated code performs per pixel
+ */
+extern unsigned int kgen_multiplies(const float *filter,unsigned int filter_width);
+
+#endif
@@ -0,0 +1,48 @@
+/* writes coefficient baked OpenCL and C kernels for a Gaussian filter bank
+ * see kgen.h for the layout of the generated code
+ */
+
+/* standard headers */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* project headers */
+#include "filter.h"
+#include "kgen.h"
+
+int main(int argc, char **argv){
+  if(argc < 5){
+    printf("Usage: %s [Number of Filters] [Size of Filters] [OpenCL Output] [C Output]\n",argv[0]);
+    return -1;
+  }
+
+  const unsigned int num_filters = atoi(argv[1]);
+  const unsigned int filter_width = atoi(argv[2]);
+  const unsigned int filter_len = filter_width*filter_width;
+  float *bank = malloc(sizeof(float)*filter_len*num_filters);
+  filter_Gauss2dbank(bank,num_filters,filter_width);
+
+  FILE *out = fopen(argv[3],"w");
+  if(!out){
+    fprintf(stderr,"Failed to open %s\n",argv[3]);
+    exit(EXIT_FAILURE);
+  }
+  kgen_write_cl(out,bank,num_filters,filter_width);
+  fclose(out);
+
+  out = fopen(argv[4],"w");
+  if(!out){
+    fprintf(stderr,"Failed to open %s\n",argv[4]);
+    exit(EXIT_FAILURE);
+  }
+  kgen_write_c(out,bank,num_filters,filter_width);
+  fclose(out);
+
+  /* report the savings of folding taps which share a weight */
+  for(unsigned int i = 0; i < num_filters; ++i){
+    printf("filter %u: %u taps, %u multiplies\n",i,filter_len,kgen_multiplies(&bank[i*filter_len],filter_width));
+  }
+
+  free(bank);
+  return 0;
+}
@@ -0,0 +1,289 @@
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "kgen.h"
+#include "multirate.h"
+#include "sat.h"
+#include "sparse.h"
+#include "winograd.h"
+
+/* size of the buffers copied to measure bandwidth */
+#define BANDWIDTH_BYTES (1 << 26)
+#define BANDWIDTH_REPEATS 5
+
+/* time the best of a few device to device copies */
+static double measure_bandwidth(struct gimc_cl *cl, size_t bytes){
+  cl_int err;
+  cl_mem src = clCreateBuffer(cl->context,CL_MEM_READ_WRITE,bytes,NULL,&err);
+  cl_mem dst = clCreateBuffer(cl->context,CL_MEM_READ_WRITE,bytes,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() bandwidth",err);
+    return 0.0;
+  }
+
+  /* the first copy also faults the buffers in */
+  double best = 0.0;
+  for(int i = 0; i <= BANDWIDTH_REPEATS; ++i){
+    cl_event event;
+    err = clEnqueueCopyBuffer(cl->commands,src,dst,0,0,bytes,0,NULL,&event);
+    if(err){
+      print_error("clEnqueueCopyBuffer() bandwidth",err);
+      break;
+    }
+    cl_ulong start, end;
+    clWaitForEvents(1,&event);
+    clGetEventProfilingInfo(event,CL_PROFILING_COMMAND_START,sizeof(cl_ulong),&start,NULL);
+    clGetEventProfilingInfo(event,CL_PROFILING_COMMAND_END,sizeof(cl_ulong),&end,NULL);
+    clReleaseEvent(event);
+
+    /* a copy reads and writes every byte */
+    const double gbps = end > start ? 2.0*bytes/(end - start) : 0.0;
+    if(i > 0 && gbps > best){
+      best = gbps;
+    }
+  }
+
+  clReleaseMemObject(src);
+  clReleaseMemObject(dst);
+  return best;
+}
+
+void metrics_device_peaks(struct gimc_cl *cl, struct device_peaks *peaks){
+  cl_device_type type;
+  cl_uint vector_width;
+  cl_ulong max_alloc;
+  memset(peaks,0,sizeof(struct device_peaks));
+  clGetDeviceInfo(cl->device,CL_DEVICE_NAME,sizeof(peaks->name),peaks->name,NULL);
+  clGetDeviceInfo(cl->device,CL_DEVICE_MAX_COMPUTE_UNITS,sizeof(cl_uint),&peaks->compute_units,NULL);
+  clGetDeviceInfo(cl->device,CL_DEVICE_MAX_CLOCK_FREQUENCY,sizeof(cl_uint),&peaks->clock_mhz,NULL);
+  clGetDeviceInfo(cl->device,CL_DEVICE_TYPE,sizeof(cl_device_type),&type,NULL);
+  clGetDeviceInfo(cl->device,CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT,sizeof(cl_uint),&vector_width,NULL);
+  clGetDeviceInfo(cl->device,CL_DEVICE_MAX_MEM_ALLOC_SIZE,sizeof(cl_ulong),&max_alloc,NULL);
+
+  /* OpenCL doesn't report lanes per compute unit, assume two vector FMA
+   * pipes for a CPU core and a 64 wide SIMD for a GPU compute unit
+   */
+  peaks->lanes = type & CL_DEVICE_TYPE_CPU ? 2*(vector_width ? vector_width : 1) : 64;
+
+  /* a multiply-add is two operations */
+  peaks->gflops = 2.0*peaks->lanes*peaks->compute_units*peaks->clock_mhz*1e-3;
+  const char *override = getenv("GIMC_PEAK_GFLOPS");
+  if(override){
+    peaks->gflops = atof(override);
+  }
+
+  override = getenv("GIMC_PEAK_GBPS");
+  if(override){
+    peaks->gbps = atof(override);
+  }else{
+    peaks->gbps = measure_bandwidth(cl,max_alloc < BANDWIDTH_BYTES ? max_alloc : BANDWIDTH_BYTES);
+  }
+}
+
+void metrics_engine_work(enum engine_id engine, size_t width, size_t height, const struct gimc_bank *bank, struct engine_work *work){
+  if(bank->widths){
+    /* an adaptive bank runs a launch per bucket */
+    memset(work,0,sizeof(struct engine_work));
+    for(unsigned int b = 0; b < bank->num_buckets; ++b){
+      struct engine_work part;
+      metrics_engine_work(engine,width,height,gimc_bucket_bank(&bank->buckets[b],engine),&part);
+      work->flops += part.flops;
+      work->bytes += part.bytes;
+    }
+    return;
+  }
+  const double pixels = (double)width*height;
+  const double outputs = pixels*bank->num_filters;
+  const double taps = (double)bank->width*bank->height;
+
+  /* every tap is a multiply and an add, results are a byte each */
+  work->flops = 2.0*taps*outputs;
+  work->bytes = outputs;
+
+  struct winograd_transform transform;
+  switch(engine){
+  case ENGINE_WINOGRAD:
+    if(winograd_transform(bank->width,&transform) == 0){
+      /* per block, two passes of n^3 for the transformed tile, then per
+       * filter n^2 multiplies and the passes of m*n^2 and m^2*n back.
+       * a block reads its tile and the cells of every filter
+       */
+      const double m = transform.m;
+      const double n = transform.n;
+      const double blocks = (double)((width + transform.m - 1)/transform.m)*((height + transform.m - 1)/transform.m);
+      work->flops = blocks*(4.0*n*n*n + bank->num_filters*(n*n + 2.0*(m*n*n + m*m*n)));
+      work->bytes += blocks*(n*n*sizeof(uint8_t) + bank->num_filters*n*n*sizeof(float));
+    }else{
+      /* others run as lwf */
+      work->bytes += taps*outputs*(sizeof(uint8_t) + sizeof(float));
+    }
+    break;
+  case ENGINE_SPARSE:{
+    /* only the kept taps, each reading a pixel and a whole tap */
+    struct sparse_bank sparse;
+    sparse_from_bank(bank->weights,bank->num_filters,bank->width,sparse_threshold(),&sparse);
+    work->flops = 2.0*sparse.num_taps*pixels;
+    work->bytes += sparse.num_taps*pixels*(sizeof(uint8_t) + sizeof(struct sparse_tap));
+    sparse_release(&sparse);
+    break;
+  }
+  case ENGINE_ERODE:
+  case ENGINE_DILATE:
+    /* per axis, a comparison from each end of a block reading the line
+     * twice and writing both extremes, then one per window reading them
+     * and writing the line. comparisons are counted as operations
+     */
+    work->flops = 2*3.0*outputs;
+    work->bytes = 2*7.0*outputs*sizeof(uint8_t);
+    break;
+  case ENGINE_MEDIAN:
+    /* per pixel, a column histogram added to the window and another taken
+     * away, then half of the window scanned on average for the median
+     */
+    work->flops = (2*256.0 + 128.0)*outputs;
+    work->bytes = outputs*(2*256*sizeof(uint8_t) + 2*256*sizeof(cl_uint) + 128*sizeof(cl_uint) + sizeof(uint8_t));
+    break;
+  case ENGINE_STEERABLE:
+    if(bank->steerable.num_sigmas){
+      /* per sigma, a row pass of every order, a column pass of every basis
+       * filter reading the row planes, then every filter of the sigma from
+       * the basis at its pixel. only the last depends on the orientations
+       */
+      const struct filter_steerable *steer = &bank->steerable;
+      unsigned int orders = 0;
+      for(unsigned int o = 0; o < FILTER_STEER_ORDERS; ++o){
+        orders = steer->orientations[o] ? o + 1 : orders;
+      }
+      const double basis = orders*(orders + 1)/2;
+      const double per_sigma = bank->num_filters/steer->num_sigmas;
+      const double width = bank->width;
+      work->flops = steer->num_sigmas*pixels*(2.0*orders*width + 2.0*basis*width + 2.0*basis*per_sigma);
+      work->bytes += steer->num_sigmas*pixels*(width*(sizeof(uint8_t) + orders*sizeof(float)) + orders*sizeof(float));
+      work->bytes += steer->num_sigmas*pixels*(basis*width*2*sizeof(float) + basis*sizeof(float));
+      work->bytes += steer->num_sigmas*pixels*(basis + per_sigma*basis)*sizeof(float);
+      break;
+    }
+    /* fall through - others run as lwf */
+  case ENGINE_BASE:
+  case ENGINE_LWF:
+  case ENGINE_LWF_LOCAL:
+  case ENGINE_ATROUS: /* a dilated filter takes the taps of its width */
+    /* every tap reads a pixel and a weight, local only stages the weights
+     * of a single pixel so it loads as many
+     */
+    work->bytes += taps*outputs*(sizeof(uint8_t) + sizeof(float));
+    break;
+  case ENGINE_LWF_PARTIALS:{
+    /* as above, plus a float per work group written and read back */
+    const size_t filter_len = (size_t)bank->width*bank->width;
+    const size_t local_size = next_multiple(bank->width,32);
+    const double groups = next_multiple(filter_len,local_size)/local_size;
+    work->bytes += taps*outputs*(sizeof(uint8_t) + sizeof(float));
+    work->bytes += 2.0*groups*outputs*sizeof(float);
+    break;
+  }
+  case ENGINE_LWF_FUSED:{
+    /* weights are loaded once per work group, mirrors convolve_lwf_fused
+     * before the group is shrunk to fit the device
+     */
+    size_t lanes = 32;
+    while(lanes > 1 && lanes/2 >= taps){
+      lanes /= 2;
+    }
+    const double block = 256/lanes;
+    work->bytes += taps*outputs*sizeof(uint8_t);
+    work->bytes += taps*outputs/block*sizeof(float);
+    break;
+  }
+  case ENGINE_BAKED:{
+    /* weights are literals, taps sharing one are added before a multiply */
+    double multiplies = 0.0;
+    for(unsigned int f = 0; f < bank->num_filters; ++f){
+      multiplies += kgen_multiplies(&bank->weights[(size_t)f*bank->width*bank->width],bank->width);
+    }
+    work->flops = (taps + multiplies/bank->num_filters)*outputs;
+    work->bytes += taps*outputs*sizeof(uint8_t);
+    break;
+  }
+  case ENGINE_SAT:{
+    /* a pass scans rows and columns of a table of 64 bit sums, reading and
+     * writing each word, then reads 16 words and writes a float or a byte
+     * per pixel. nothing depends on the filter width
+     */
+    work->flops = 0.0;
+    work->bytes = 0.0;
+    const size_t filter_len = (size_t)bank->width*bank->width;
+    for(unsigned int f = 0; f < bank->num_filters; ++f){
+      struct sat_plan plan;
+      sat_plan_filter(&bank->weights[f*filter_len],bank->width,sat_passes(),&plan);
+      const double padding = sat_plan_padding(&plan);
+      const double plane = (width + 2*padding)*(height + 2*padding);
+      for(unsigned int p = 0; p < plan.passes; ++p){
+        const double table = p == 0 ? pixels : plane;
+        const int last = p == plan.passes - 1;
+        const double boxed = last ? pixels : plane;
+        const double corners = plan.exact ? 4 : 16;
+        work->flops += 2.0*table + (corners + 6.0)*boxed;
+        work->bytes += table*((p == 0 ? sizeof(uint8_t) : sizeof(float)) + 3*sizeof(int64_t));
+        work->bytes += boxed*(corners*sizeof(int64_t) + (last ? sizeof(uint8_t) : sizeof(float)));
+      }
+    }
+    break;
+  }
+  case ENGINE_MULTIRATE:{
+    /* the image becomes a float level, each further level reads 16 cells
+     * of the one before per cell. every filter then runs its shrunken taps
+     * over its level and is interpolated from 4 cells per pixel
+     */
+    const size_t filter_len = (size_t)bank->width*bank->width;
+    const double target = multirate_target();
+    unsigned int max_factor = 1;
+    work->flops = 0.0;
+    work->bytes = pixels*(sizeof(uint8_t) + sizeof(float));
+    for(unsigned int f = 0; f < bank->num_filters; ++f){
+      struct multirate_plan plan;
+      multirate_plan_filter(&bank->weights[f*filter_len],bank->width,target,&plan);
+      const double cells = pixels/((double)plan.factor*plan.factor);
+      const double coarse_taps = (double)plan.width*plan.width;
+      work->flops += 2.0*coarse_taps*cells + 8.0*pixels;
+      work->bytes += coarse_taps*cells*2*sizeof(float) + cells*sizeof(float);
+      work->bytes += pixels*(4*sizeof(float) + sizeof(uint8_t));
+      max_factor = plan.factor > max_factor ? plan.factor : max_factor;
+      multirate_plan_release(&plan);
+    }
+    for(unsigned int factor = 2; factor <= max_factor; factor *= 2){
+      const double cells = pixels/((double)factor*factor);
+      work->flops += 2.0*20*cells;
+      work->bytes += cells*17*sizeof(float);
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void metrics_print_header(FILE *out, const struct device_peaks *peaks){
+  fprintf(out,"# device: %s\n",peaks->name);
+  fprintf(out,"# compute units: %u, clock: %u MHz, lanes per unit: %u\n",
+    peaks->compute_units,peaks->clock_mhz,peaks->lanes);
+  fprintf(out,"# peak: %.1f GFLOP/s, %.1f GB/s, ridge point: %.2f FLOP/B\n",
+    peaks->gflops,peaks->gbps,peaks->gbps > 0.0 ? peaks->gflops/peaks->gbps : 0.0);
+  fprintf(out,"%-14s %12s %12s %10s %10s %12s %10s %8s\n",
+    "engine","seconds","GFLOP/s","GB/s","FLOP/B","attainable","of roof","bound");
+}
+
+void metrics_print(FILE *out, const char *name, const struct engine_work *work, double seconds, const struct device_peaks *peaks){
+  const double gflops = seconds > 0.0 ? work->flops/seconds*1e-9 : 0.0;
+  const double gbps = seconds > 0.0 ? work->bytes/seconds*1e-9 : 0.0;
+  const double intensity = work->flops/work->bytes;
+
+  /* the roofline, performance is capped by compute or by bandwidth*intensity */
+  const double memory_roof = intensity*peaks->gbps;
+  const double attainable = memory_roof < peaks->gflops ? memory_roof : peaks->gflops;
+  fprintf(out,"%-14s %12.6f %12.2f %10.2f %10.2f %12.2f %9.1f%% %8s\n",
+    name,seconds,gflops,gbps,intensity,attainable,
+    attainable > 0.0 ? 100.0*gflops/attainable : 0.0,
+    memory_roof < peaks->gflops ? "memory" : "compute");
+}
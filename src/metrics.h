@@ -0,0 +1,43 @@
+/* roofline metrics
+ * the work an engine does is modelled from the image size, the bank and
+ * the access pattern of its kernels, and compared against device peaks
+ */
+
+#ifndef GIMC_METRICS_H
+#define GIMC_METRICS_H
+
+#include <stdio.h>
+
+#include "engine.h"
+
+/* what a device can attain */
+struct device_peaks{
+  char name[128];
+  cl_uint compute_units;
+  cl_uint clock_mhz;
+  cl_uint lanes; /* single precision lanes per compute unit assumed for the peak */
+  double gflops; /* estimated from the device properties or GIMC_PEAK_GFLOPS */
+  double gbps; /* measured with a buffer copy or GIMC_PEAK_GBPS */
+};
+
+/* query the device of cl and measure its global memory bandwidth
+ * the queue of cl has to have profiling enabled
+ */
+extern void metrics_device_peaks(struct gimc_cl *cl,struct device_peaks *peaks);
+
+/* work done by one convolution of an engine */
+struct engine_work{
+  double flops;
+  double bytes; /* requested from global memory, before any caching */
+};
+
+/* model the work of convolving a width*height image with bank */
+extern void metrics_engine_work(enum engine_id engine,size_t width,size_t height,const struct gimc_bank *bank,struct engine_work *work);
+
+/* print the peaks and the header of the table of engines */
+extern void metrics_print_header(FILE *out,const struct device_peaks *peaks);
+
+/* print achieved and attainable performance of an engine which took seconds */
+extern void metrics_print(FILE *out,const char *name,const struct engine_work *work,double seconds,const struct device_peaks *peaks);
+
+#endif
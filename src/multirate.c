@@ -0,0 +1,315 @@
+#include "multirate.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+double multirate_target(void){
+  const char *target = getenv("GIMC_MULTIRATE_ERROR");
+  return target ? atof(target) : MULTIRATE_ERROR;
+}
+
+/* coarse cell i0 before fine pixel x and the weight of the cell after it,
+ * the center of coarse cell i is at fine i*factor + (factor-1)/2
+ */
+static void upsample_position(long x, unsigned int factor, long *i0, double *alpha){
+  const double t = (x + 0.5)/factor - 0.5;
+  *i0 = floor(t);
+  *alpha = t - *i0;
+}
+
+/* split weights at offsets -r..r linearly between the cells at multiples
+ * of factor, giving coarse weights at offsets -coarse_r..coarse_r
+ */
+static void shrink_1d(const double *weights, long r, unsigned int factor, double *coarse, long coarse_r){
+  memset(coarse,0,sizeof(double)*(2*coarse_r + 1));
+  for(long d = -r; d <= r; ++d){
+    const double t = (double)d/factor;
+    const long u = floor(t);
+    const double alpha = t - u;
+    coarse[u + coarse_r] += (1.0 - alpha)*weights[d + r];
+    if(alpha > 0.0){
+      coarse[u + 1 + coarse_r] += alpha*weights[d + r];
+    }
+  }
+}
+
+/* a signal along one axis, cells first..first+len-1 */
+struct signal{
+  long first;
+  long len;
+  double *values;
+};
+
+static double signal_at(const struct signal *s, long i){
+  return i >= s->first && i < s->first + s->len ? s->values[i - s->first] : 0.0;
+}
+
+/* the level of factor for a pixel of 1 at fine position p, decimated as
+ * the decimate kernel does: cell i of the next level is (1,3,3,1)/8 of
+ * cells 2i-1..2i+2
+ */
+static void level_of_pixel(long p, unsigned int factor, struct signal *level){
+  level->first = p;
+  level->len = 1;
+  level->values = malloc(sizeof(double));
+  level->values[0] = 1.0;
+  for(unsigned int f = 1; f < factor; f *= 2){
+    const double taps[4] = {0.125, 0.375, 0.375, 0.125};
+    const long first = (long)floor((level->first - 2)/2.0);
+    const long last = (long)floor((level->first + level->len)/2.0);
+    double *values = malloc(sizeof(double)*(last - first + 1));
+    for(long i = first; i <= last; ++i){
+      double sum = 0.0;
+      for(int a = 0; a < 4; ++a){
+        sum += taps[a]*signal_at(level,2*i - 1 + a);
+      }
+      values[i - first] = sum;
+    }
+    free(level->values);
+    level->first = first;
+    level->len = last - first + 1;
+    level->values = values;
+  }
+}
+
+/* pixels x covered by the response of the engine to a pixel at p, whose
+ * filtered level spans cells first..last
+ */
+static void response_range(long p, long r, unsigned int factor, long first, long last, long *x0, long *x1){
+  *x0 = (first - 1)*(long)factor;
+  *x1 = (last + 2)*(long)factor;
+  if(p - r < *x0){
+    *x0 = p - r;
+  }
+  if(p + r > *x1){
+    *x1 = p + r;
+  }
+}
+
+/* worst sum of absolute differences over the positions of a pixel in a
+ * block between the response of the engine along one axis and weights
+ */
+static double error_1d(const double *weights, long r, unsigned int factor, const double *coarse, long coarse_r){
+  double worst = 0.0;
+  for(long p = 0; p < (long)factor; ++p){
+    struct signal level;
+    level_of_pixel(p,factor,&level);
+
+    /* the filtered level, cell i sees cell i+u with coarse weight u */
+    struct signal filtered = {level.first - coarse_r, level.len + 2*coarse_r, NULL};
+    filtered.values = calloc(filtered.len,sizeof(double));
+    for(long i = 0; i < filtered.len; ++i){
+      for(long u = -coarse_r; u <= coarse_r; ++u){
+        filtered.values[i] += coarse[u + coarse_r]*signal_at(&level,filtered.first + i + u);
+      }
+    }
+
+    /* the pixel at p weighs pixel x of the result by weights[p-x] */
+    long x0, x1;
+    response_range(p,r,factor,filtered.first,filtered.first + filtered.len - 1,&x0,&x1);
+    double error = 0.0;
+    for(long x = x0; x <= x1; ++x){
+      long i0;
+      double alpha;
+      upsample_position(x,factor,&i0,&alpha);
+      const double response = (1.0 - alpha)*signal_at(&filtered,i0) + alpha*signal_at(&filtered,i0 + 1);
+      const long d = p - x;
+      error += fabs(response - (labs(d) <= r ? weights[d + r] : 0.0));
+    }
+    if(error > worst){
+      worst = error;
+    }
+    free(level.values);
+    free(filtered.values);
+  }
+  return worst;
+}
+
+/* error_1d of a filter which isn't separable, levels are */
+static double error_2d(const double *weights, long r, unsigned int factor, const double *coarse, long coarse_r){
+  const long width = 2*r + 1;
+  const long coarse_width = 2*coarse_r + 1;
+  double worst = 0.0;
+  for(long py = 0; py < (long)factor; ++py){
+    for(long px = 0; px < (long)factor; ++px){
+      struct signal level_x, level_y;
+      level_of_pixel(px,factor,&level_x);
+      level_of_pixel(py,factor,&level_y);
+
+      /* filter along x for every row of the filter, then along y */
+      const long first_x = level_x.first - coarse_r, len_x = level_x.len + 2*coarse_r;
+      const long first_y = level_y.first - coarse_r, len_y = level_y.len + 2*coarse_r;
+      double *along_x = calloc(len_x*coarse_width,sizeof(double));
+      for(long v = 0; v < coarse_width; ++v){
+        for(long i = 0; i < len_x; ++i){
+          for(long u = -coarse_r; u <= coarse_r; ++u){
+            along_x[v*len_x + i] += coarse[v*coarse_width + u + coarse_r]*signal_at(&level_x,first_x + i + u);
+          }
+        }
+      }
+      double *filtered = calloc(len_x*len_y,sizeof(double));
+      for(long j = 0; j < len_y; ++j){
+        for(long v = -coarse_r; v <= coarse_r; ++v){
+          const double weight = signal_at(&level_y,first_y + j + v);
+          for(long i = 0; weight != 0.0 && i < len_x; ++i){
+            filtered[j*len_x + i] += weight*along_x[(v + coarse_r)*len_x + i];
+          }
+        }
+      }
+
+      long x0, x1, y0, y1;
+      response_range(px,r,factor,first_x,first_x + len_x - 1,&x0,&x1);
+      response_range(py,r,factor,first_y,first_y + len_y - 1,&y0,&y1);
+      double error = 0.0;
+      for(long y = y0; y <= y1; ++y){
+        long j0;
+        double beta;
+        upsample_position(y,factor,&j0,&beta);
+        for(long x = x0; x <= x1; ++x){
+          long i0;
+          double alpha;
+          upsample_position(x,factor,&i0,&alpha);
+          double response = 0.0;
+          for(long j = j0; j <= j0 + 1; ++j){
+            for(long i = i0; i <= i0 + 1; ++i){
+              if(i >= first_x && i < first_x + len_x && j >= first_y && j < first_y + len_y){
+                response += (j == j0 ? 1.0 - beta : beta)*(i == i0 ? 1.0 - alpha : alpha)*
+                  filtered[(j - first_y)*len_x + i - first_x];
+              }
+            }
+          }
+          const long dx = px - x, dy = py - y;
+          const double weight = labs(dx) <= r && labs(dy) <= r ? weights[(dy + r)*width + dx + r] : 0.0;
+          error += fabs(response - weight);
+        }
+      }
+      if(error > worst){
+        worst = error;
+      }
+      free(level_x.values);
+      free(level_y.values);
+      free(along_x);
+      free(filtered);
+    }
+  }
+  return worst;
+}
+
+static double sum_abs(const double *weights, size_t len){
+  double sum = 0.0;
+  for(size_t i = 0; i < len; ++i){
+    sum += fabs(weights[i]);
+  }
+  return sum;
+}
+
+void multirate_plan_factor(const float *filter, unsigned int width, unsigned int factor, struct multirate_plan *plan){
+  const long r = (width - 1)/2;
+  const long coarse_r = (r + factor - 1)/factor;
+  const size_t filter_len = (size_t)width*width;
+  const size_t coarse_width = 2*coarse_r + 1;
+
+  /* filters are applied backwards, reversing them gives the weight of each offset */
+  double *weights = malloc(sizeof(double)*filter_len);
+  for(size_t i = 0; i < filter_len; ++i){
+    weights[i] = filter[filter_len - 1 - i];
+  }
+
+  /* marginals, whose product is the filter if it is separable */
+  double *columns = calloc(width,sizeof(double));
+  double *rows = calloc(width,sizeof(double));
+  double sum = 0.0, largest = 0.0;
+  for(long y = 0; y < (long)width; ++y){
+    for(long x = 0; x < (long)width; ++x){
+      const double weight = weights[y*width + x];
+      columns[x] += weight;
+      rows[y] += weight;
+      sum += weight;
+      largest = fmax(largest,fabs(weight));
+    }
+  }
+  int separable = sum != 0.0;
+  for(size_t i = 0; i < filter_len && separable; ++i){
+    separable = fabs(weights[i]*sum - columns[i % width]*rows[i / width]) <= 1e-5*largest*fabs(sum);
+  }
+
+  /* shrink the marginals or the whole filter */
+  double *coarse = malloc(sizeof(double)*coarse_width*coarse_width);
+  if(separable){
+    double *coarse_columns = malloc(sizeof(double)*coarse_width);
+    double *coarse_rows = malloc(sizeof(double)*coarse_width);
+    shrink_1d(columns,r,factor,coarse_columns,coarse_r);
+    shrink_1d(rows,r,factor,coarse_rows,coarse_r);
+    for(size_t v = 0; v < coarse_width; ++v){
+      for(size_t u = 0; u < coarse_width; ++u){
+        coarse[v*coarse_width + u] = coarse_columns[u]*coarse_rows[v]/sum;
+      }
+    }
+
+    /* the response is the product of those along each axis, so
+     * |ex*ey - cx*cy| <= |ex - cx|*|ey| + |cx|*|ey - cy|
+     */
+    const double error_x = error_1d(columns,r,factor,coarse_columns,coarse_r);
+    const double error_y = error_1d(rows,r,factor,coarse_rows,coarse_r);
+    const double l1_x = sum_abs(columns,width), l1_y = sum_abs(rows,width);
+    plan->error = (error_x*(l1_y + error_y) + l1_x*error_y)/fabs(sum);
+    free(coarse_columns);
+    free(coarse_rows);
+  }else{
+    double *row = malloc(sizeof(double)*width);
+    double *shrunk_rows = malloc(sizeof(double)*coarse_width*width);
+    double *column = malloc(sizeof(double)*width);
+    double *shrunk = malloc(sizeof(double)*coarse_width);
+    for(size_t y = 0; y < width; ++y){
+      memcpy(row,&weights[y*width],sizeof(double)*width);
+      shrink_1d(row,r,factor,&shrunk_rows[y*coarse_width],coarse_r);
+    }
+    for(size_t u = 0; u < coarse_width; ++u){
+      for(size_t y = 0; y < width; ++y){
+        column[y] = shrunk_rows[y*coarse_width + u];
+      }
+      shrink_1d(column,r,factor,shrunk,coarse_r);
+      for(size_t v = 0; v < coarse_width; ++v){
+        coarse[v*coarse_width + u] = shrunk[v];
+      }
+    }
+    plan->error = error_2d(weights,r,factor,coarse,coarse_r);
+    free(row);
+    free(shrunk_rows);
+    free(column);
+    free(shrunk);
+  }
+
+  plan->factor = factor;
+  plan->width = coarse_width;
+  plan->weights = malloc(sizeof(float)*coarse_width*coarse_width);
+  for(size_t i = 0; i < coarse_width*coarse_width; ++i){
+    plan->weights[i] = coarse[i];
+  }
+  free(weights);
+  free(columns);
+  free(rows);
+  free(coarse);
+}
+
+void multirate_plan_filter(const float *filter, unsigned int width, double target, struct multirate_plan *plan){
+  /* full resolution is exact, keep doubling while the error allows and the
+   * filter is wider than a block
+   */
+  multirate_plan_factor(filter,width,1,plan);
+  for(unsigned int factor = 2; factor <= MULTIRATE_MAX_FACTOR && factor < width; factor *= 2){
+    struct multirate_plan coarser;
+    multirate_plan_factor(filter,width,factor,&coarser);
+    if(coarser.error > target){
+      multirate_plan_release(&coarser);
+      break;
+    }
+    multirate_plan_release(plan);
+    *plan = coarser;
+  }
+}
+
+void multirate_plan_release(struct multirate_plan *plan){
+  free(plan->weights);
+  plan->weights = NULL;
+}
@@ -0,0 +1,45 @@
+/* multi-rate convolution
+ * wide filters carry little at high frequencies, so the multirate engine
+ * convolves a decimated copy of the image with a shrunken filter and
+ * upsamples the result, which costs factor^2 less. levels are a pyramid
+ * filtered with (1,3,3,1)/8 and decimated by 2, built once and shared by
+ * every filter. a filter is shrunk by splitting each weight linearly
+ * between the nearest cells of the coarse grid, and results are
+ * interpolated bilinearly. plans are made on the host from the weights
+ */
+
+#ifndef GIMC_MULTIRATE_H
+#define GIMC_MULTIRATE_H
+
+/* decimation factors are powers of two up to this */
+#define MULTIRATE_MAX_FACTOR 16
+
+/* default accuracy target, see multirate_plan.error */
+#define MULTIRATE_ERROR 0.02
+
+/* how the multirate engine runs one filter */
+struct multirate_plan{
+  unsigned int factor; /* decimation, 1 for full resolution */
+  unsigned int width; /* of the shrunken filter */
+  float *weights; /* width*width, not backwards: cell (v,u) weighs the pixel at offset (u-r,v-r) */
+  /* bound of the sum of absolute differences between the response of the
+   * engine to a pixel, in any position within a block, and the filter.
+   * results are within 255*error+1 of full resolution
+   */
+  double error;
+};
+
+/* accuracy target, from GIMC_MULTIRATE_ERROR or MULTIRATE_ERROR */
+extern double multirate_target(void);
+
+/* plan a width*width filter laid out as in filter_Gauss2dbank, with the
+ * largest factor whose error is within target
+ */
+extern void multirate_plan_filter(const float *filter,unsigned int width,double target,struct multirate_plan *plan);
+
+/* plan a filter at a given factor */
+extern void multirate_plan_factor(const float *filter,unsigned int width,unsigned int factor,struct multirate_plan *plan);
+
+extern void multirate_plan_release(struct multirate_plan *plan);
+
+#endif
@@ -0,0 +1,68 @@
+#include "native.h"
+#include <stdlib.h>
+
+#include "epilogue.h"
+
+/* sum of the pixel at px,py with the filter whose last cell is last */
+static float native_sum(const uint8_t *image, size_t image_width, size_t image_height,
+  const float *last, long width, long height, size_t px, size_t py){
+  const long cornerx = (long)px - (width - 1)/2;
+  const long cornery = (long)py - (height - 1)/2;
+
+  /* same summation order as lwfilter.cl */
+  float sum = 0;
+  for(long fy = 0; fy < height; ++fy){
+    const long row = cornery + fy;
+    if(row < 0 || row >= (long)image_height){
+      continue;
+    }
+    for(long fx = 0; fx < width; ++fx){
+      const long col = cornerx + fx;
+      if(col < 0 || col >= (long)image_width){
+        continue;
+      }
+      sum += image[row*image_width + col]*last[-(fy*width + fx)];
+    }
+  }
+  return sum;
+}
+
+void native_convolve2d(const uint8_t *image, size_t image_width, size_t image_height,
+  const float *bank, unsigned int num_filters, unsigned int filter_width, uint8_t *result){
+  native_convolve2d_rect(image,image_width,image_height,bank,num_filters,filter_width,filter_width,result);
+}
+
+void native_convolve2d_rect(const uint8_t *image, size_t image_width, size_t image_height,
+  const float *bank, unsigned int num_filters, unsigned int filter_width, unsigned int filter_height, uint8_t *result){
+  const size_t image_size = image_width*image_height;
+  const size_t filter_len = (size_t)filter_width*filter_height;
+
+  for(unsigned int fid = 0; fid < num_filters; ++fid){
+    /* convolution uses the filter backwards, so index it from its last cell */
+    const float *last = &bank[(fid + 1)*filter_len - 1];
+    for(size_t py = 0; py < image_height; ++py){
+      for(size_t px = 0; px < image_width; ++px){
+        const float sum = native_sum(image,image_width,image_height,last,filter_width,filter_height,px,py);
+        /* derivative filters go negative */
+        result[fid*image_size + py*image_width + px] = sum <= 0.0f ? 0 : sum >= 255.0f ? 255 : sum;
+      }
+    }
+  }
+}
+
+void native_convolve2d_epilogue(const uint8_t *image, size_t image_width, size_t image_height,
+  const float *bank, unsigned int num_filters, unsigned int filter_width, const struct gimc_epilogue *epilogue, uint8_t *result){
+  const size_t image_size = image_width*image_height;
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  float *sums = malloc(sizeof(float)*num_filters);
+
+  for(size_t py = 0; py < image_height; ++py){
+    for(size_t px = 0; px < image_width; ++px){
+      for(unsigned int fid = 0; fid < num_filters; ++fid){
+        sums[fid] = native_sum(image,image_width,image_height,&bank[(fid + 1)*filter_len - 1],filter_width,filter_width,px,py);
+      }
+      epilogue_apply(epilogue,sums,num_filters,&result[py*image_width + px],image_size);
+    }
+  }
+  free(sums);
+}
@@ -0,0 +1,36 @@
+/* scalar convolution on the host
+ * follows the conventions of the convolve2d kernels: filters are applied
+ * backwards, pixels outside the image are zero and results are truncated
+ * to 8 bits, clamped to 0..255. it is the reference the engines are tested
+ * against
+ */
+
+#ifndef GIMC_NATIVE_H
+#define GIMC_NATIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* convolve a grayscale image with every filter of a bank
+ * image: image_width*image_height pixels
+ * bank: filters laid out as in filter_Gauss2dbank
+ * result: num_filters planes of image_width*image_height pixels
+ */
+extern void native_convolve2d(const uint8_t *image,size_t image_width,size_t image_height,
+  const float *bank,unsigned int num_filters,unsigned int filter_width,uint8_t *result);
+
+/* native_convolve2d with filters of filter_width*filter_height, both odd,
+ * as the buckets of rectangular filters of an adaptive bank run
+ */
+extern void native_convolve2d_rect(const uint8_t *image,size_t image_width,size_t image_height,
+  const float *bank,unsigned int num_filters,unsigned int filter_width,unsigned int filter_height,uint8_t *result);
+
+struct gimc_epilogue;
+
+/* native_convolve2d followed by an epilogue on the sums of each pixel
+ * result: epilogue_planes planes of image_width*image_height pixels
+ */
+extern void native_convolve2d_epilogue(const uint8_t *image,size_t image_width,size_t image_height,
+  const float *bank,unsigned int num_filters,unsigned int filter_width,const struct gimc_epilogue *epilogue,uint8_t *result);
+
+#endif
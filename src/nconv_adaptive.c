@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * adaptive - every Gaussian of the bank only as wide as it needs, filters
+ * of the same bucketed width run in one launch
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_LWF,TOOL_BANK_ADAPTIVE);
+}
@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * atrous - dilated convolution, filter i of the bank is a small Gaussian
+ * with its taps 2^i pixels apart, so coarse scales take as few taps as fine
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_ATROUS,TOOL_BANK_ATROUS);
+}
@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * baked - the weights of the filter bank are generated into the kernel source
+ * as literals, taps sharing a weight are summed before one multiply
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_BAKED,TOOL_BANK_HOST);
+}
@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * dilate - maximum over the box of each filter of filter_box_bank, three
+ * comparisons per pixel along each axis for any width
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_DILATE,TOOL_BANK_BOX);
+}
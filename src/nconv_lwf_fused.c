@@ -0,0 +1,13 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * lwf - local work filtering: ie. maximizes work threads taking advantage of local work groups
+ * fused - the taps of a pixel are reduced within its work group so each
+ * result is produced in a single pass, without a partial sums buffer
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_LWF_FUSED,TOOL_BANK_DEVICE);
+}
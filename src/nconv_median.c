@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * median - median over the box of each filter of filter_box_bank, from
+ * sliding histograms whose cost doesn't grow with the width
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_MEDIAN,TOOL_BANK_BOX);
+}
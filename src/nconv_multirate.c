@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * multirate - wide filters run on a decimated copy of the image with a
+ * shrunken filter and are interpolated back, within an accuracy target
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_MULTIRATE,TOOL_BANK_HOST);
+}
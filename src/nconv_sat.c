@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * sat - summed area tables, every box costs four lookups whatever its size,
+ * Gaussians are approximated by repeated extended boxes
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_SAT,TOOL_BANK_HOST);
+}
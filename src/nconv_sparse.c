@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * sparse - only the nonzero taps of every filter, and with
+ * GIMC_SPARSE_THRESHOLD those above a share of its largest weight
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_SPARSE,TOOL_BANK_HOST);
+}
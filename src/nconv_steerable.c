@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * steerable - oriented derivatives of Gaussian steered from a separable basis,
+ * one pass per sigma whatever the number of orientations
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_STEERABLE,TOOL_BANK_STEERABLE);
+}
@@ -0,0 +1,12 @@
+/* augmented nconv
+ * performs n convolutions based on command line arguments
+ * winograd - minimal filtering of 3x3 and 5x5 filters, a tile transformed
+ * once for the bank, other widths as lwf
+ */
+
+/* project headers */
+#include "tool.h"
+
+int main(int argc, char **argv){
+  return tool_main(argc,argv,ENGINE_WINOGRAD,TOOL_BANK_HOST);
+}
@@ -0,0 +1,393 @@
+#define _POSIX_C_SOURCE 200809L
+#include "output.h"
+
+/* standard headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* system headers */
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* external library headers */
+#include <FreeImage.h>
+
+static const char *format_names[NUM_OUTPUT_FORMATS] = {
+  "jpg",
+  "png",
+  "pgm",
+  "raw",
+  "tif",
+  "npy"
+};
+
+/* a plane waiting to be written */
+struct output_job{
+  unsigned int filter;
+  const uint8_t *plane;
+  struct output_job *next;
+};
+
+struct output_writer{
+  char *prefix;
+  enum output_format format;
+  size_t width;
+  size_t height;
+  int top_down;
+  unsigned int num_filters;
+
+  pthread_t *threads;
+  unsigned int num_threads;
+
+  /* queue of jobs and counts, guarded by lock */
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t done;
+  struct output_job *head;
+  struct output_job *tail;
+  unsigned int submitted;
+  unsigned int finished;
+  unsigned char *written; /* per filter, nonzero once its plane is no longer needed */
+  int failures;
+  int stopping;
+
+  /* OUTPUT_NPY: the array file, planes are written in place */
+  int fd;
+  off_t data_offset;
+
+  /* OUTPUT_TIFF: pages must be appended in order, converted bitmaps wait
+   * in pages until the pages before them are in, guarded by pages_lock
+   */
+  FIMULTIBITMAP *multi;
+  FIBITMAP **pages;
+  unsigned int next_page;
+  pthread_mutex_t pages_lock;
+};
+
+const char *output_format_name(enum output_format format){
+  return format < NUM_OUTPUT_FORMATS ? format_names[format] : "unknown";
+}
+
+enum output_format output_format_from_name(const char *name){
+  for(int i = 0; i < NUM_OUTPUT_FORMATS; ++i){
+    if(strcmp(name,format_names[i]) == 0){
+      return i;
+    }
+  }
+  /* common alternative spellings */
+  if(strcmp(name,"jpeg") == 0){
+    return OUTPUT_JPEG;
+  }
+  if(strcmp(name,"tiff") == 0){
+    return OUTPUT_TIFF;
+  }
+  return NUM_OUTPUT_FORMATS;
+}
+
+/* a plane with the top row first, freed with release_upright */
+static const uint8_t *upright_plane(struct output_writer *writer, const uint8_t *plane){
+  const size_t width = writer->width;
+  const size_t height = writer->height;
+  if(writer->top_down){
+    return plane;
+  }
+  uint8_t *flipped = malloc(width*height);
+  for(size_t y = 0; y < height; ++y){
+    memcpy(&flipped[y*width],&plane[(height - 1 - y)*width],width);
+  }
+  return flipped;
+}
+
+static void release_upright(struct output_writer *writer, const uint8_t *upright){
+  if(!writer->top_down){
+    free((uint8_t *)upright);
+  }
+}
+
+/* wrap a plane in a greyscale bitmap */
+static FIBITMAP *plane_bitmap(struct output_writer *writer, const uint8_t *plane){
+  return FreeImage_ConvertFromRawBits((BYTE *)plane,writer->width,writer->height,writer->width,8,0,0,0,writer->top_down);
+}
+
+/* write one plane, returns 0 on success */
+static int write_plane(struct output_writer *writer, unsigned int filter, const uint8_t *plane){
+  const size_t plane_size = writer->width*writer->height;
+  char filename[4096];
+  if(writer->format == OUTPUT_RAW){
+    /* raw frames carry their size in the name so they can be loaded again */
+    snprintf(filename,sizeof(filename),"%s_%03u_%zux%zu.raw",writer->prefix,filter,writer->width,writer->height);
+  }else{
+    snprintf(filename,sizeof(filename),"%s_%03u.%s",writer->prefix,filter,format_names[writer->format]);
+  }
+
+  switch(writer->format){
+  case OUTPUT_JPEG:
+  case OUTPUT_PNG:{
+    FIBITMAP *bitmap = plane_bitmap(writer,plane);
+    const BOOL saved = bitmap != NULL &&
+      (writer->format == OUTPUT_JPEG ? FreeImage_Save(FIF_JPEG,bitmap,filename,JPEG_DEFAULT)
+                                     : FreeImage_Save(FIF_PNG,bitmap,filename,PNG_Z_BEST_SPEED));
+    FreeImage_Unload(bitmap);
+    return !saved;
+  }
+  case OUTPUT_PGM:
+  case OUTPUT_RAW:{
+    FILE *file = fopen(filename,"wb");
+    if(file == NULL){
+      perror(filename);
+      return 1;
+    }
+    if(writer->format == OUTPUT_PGM){
+      fprintf(file,"P5\n%zu %zu\n255\n",writer->width,writer->height);
+    }
+    const uint8_t *upright = upright_plane(writer,plane);
+    const size_t written = fwrite(upright,1,plane_size,file);
+    release_upright(writer,upright);
+    return (fclose(file) != 0) | (written != plane_size);
+  }
+  case OUTPUT_TIFF:{
+    FIBITMAP *bitmap = plane_bitmap(writer,plane);
+    if(bitmap == NULL){
+      return 1;
+    }
+    /* append this page and any after it which are already converted */
+    pthread_mutex_lock(&writer->pages_lock);
+    writer->pages[filter] = bitmap;
+    while(writer->next_page < writer->num_filters && writer->pages[writer->next_page]){
+      FreeImage_AppendPage(writer->multi,writer->pages[writer->next_page]);
+      FreeImage_Unload(writer->pages[writer->next_page]);
+      writer->pages[writer->next_page] = NULL;
+      ++writer->next_page;
+    }
+    pthread_mutex_unlock(&writer->pages_lock);
+    return 0;
+  }
+  case OUTPUT_NPY:{
+    const uint8_t *upright = upright_plane(writer,plane);
+    const off_t offset = writer->data_offset + (off_t)filter*plane_size;
+    size_t written = 0;
+    while(written < plane_size){
+      const ssize_t n = pwrite(writer->fd,upright + written,plane_size - written,offset + written);
+      if(n <= 0){
+        perror("pwrite() npy");
+        break;
+      }
+      written += n;
+    }
+    release_upright(writer,upright);
+    return written != plane_size;
+  }
+  default:
+    return 1;
+  }
+}
+
+static void *worker(void *data){
+  struct output_writer *writer = data;
+
+  pthread_mutex_lock(&writer->lock);
+  for(;;){
+    while(writer->head == NULL && !writer->stopping){
+      pthread_cond_wait(&writer->work,&writer->lock);
+    }
+    if(writer->head == NULL){
+      break;
+    }
+    struct output_job *job = writer->head;
+    writer->head = job->next;
+    if(writer->head == NULL){
+      writer->tail = NULL;
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    const int failed = job->plane == NULL || write_plane(writer,job->filter,job->plane);
+    if(failed){
+      fprintf(stderr,"Error writing the result of filter %u\n",job->filter);
+    }
+    const unsigned int filter = job->filter;
+    free(job);
+
+    pthread_mutex_lock(&writer->lock);
+    writer->failures += failed;
+    writer->written[filter] = 1;
+    ++writer->finished;
+    pthread_cond_broadcast(&writer->done);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+
+/* create the array file and write its header
+ * the header is padded so the data starts on a 64 byte boundary
+ */
+static int open_npy(struct output_writer *writer, const char *filename){
+  char header[256];
+  int len = snprintf(header,sizeof(header),
+    "{'descr': '|u1', 'fortran_order': False, 'shape': (%u, %zu, %zu), }",
+    writer->num_filters,writer->height,writer->width);
+  const int total = (10 + len + 1 + 63)/64*64;
+  while(10 + len + 1 < total){
+    header[len++] = ' ';
+  }
+  header[len++] = '\n';
+
+  unsigned char preamble[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0};
+  preamble[8] = len & 0xff;
+  preamble[9] = len >> 8;
+
+  writer->fd = open(filename,O_WRONLY | O_CREAT | O_TRUNC,0644);
+  if(writer->fd < 0){
+    perror(filename);
+    return 1;
+  }
+  writer->data_offset = total;
+  const off_t size = total + (off_t)writer->num_filters*writer->width*writer->height;
+  if(write(writer->fd,preamble,10) != 10 || write(writer->fd,header,len) != len || ftruncate(writer->fd,size) != 0){
+    perror(filename);
+    close(writer->fd);
+    return 1;
+  }
+  return 0;
+}
+
+struct output_writer *output_writer_create(const char *prefix, enum output_format format,
+  size_t width, size_t height, int top_down, unsigned int num_filters, unsigned int num_threads){
+  if(format >= NUM_OUTPUT_FORMATS){
+    return NULL;
+  }
+
+  struct output_writer *writer = calloc(1,sizeof(struct output_writer));
+  writer->prefix = strdup(prefix);
+  writer->format = format;
+  writer->width = width;
+  writer->height = height;
+  writer->top_down = top_down;
+  writer->num_filters = num_filters;
+  writer->written = calloc(num_filters,1);
+  writer->fd = -1;
+
+  /* formats with a single file for the bank */
+  char filename[4096];
+  snprintf(filename,sizeof(filename),"%s.%s",prefix,format_names[format]);
+  if(format == OUTPUT_NPY && open_npy(writer,filename)){
+    free(writer->written);
+    free(writer->prefix);
+    free(writer);
+    return NULL;
+  }
+  if(format == OUTPUT_TIFF){
+    writer->multi = FreeImage_OpenMultiBitmap(FIF_TIFF,filename,TRUE,FALSE,FALSE,0);
+    if(writer->multi == NULL){
+      fprintf(stderr,"Error creating %s\n",filename);
+      free(writer->written);
+      free(writer->prefix);
+      free(writer);
+      return NULL;
+    }
+    writer->pages = calloc(num_filters,sizeof(FIBITMAP *));
+  }
+
+  pthread_mutex_init(&writer->lock,NULL);
+  pthread_mutex_init(&writer->pages_lock,NULL);
+  pthread_cond_init(&writer->work,NULL);
+  pthread_cond_init(&writer->done,NULL);
+
+  if(num_threads == 0){
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = online > 0 ? online : 1;
+  }
+  if(num_threads > num_filters){
+    num_threads = num_filters > 0 ? num_filters : 1;
+  }
+  writer->threads = malloc(sizeof(pthread_t)*num_threads);
+  for(unsigned int i = 0; i < num_threads; ++i){
+    if(pthread_create(&writer->threads[writer->num_threads],NULL,worker,writer) == 0){
+      ++writer->num_threads;
+    }
+  }
+  if(writer->num_threads == 0){
+    /* no threads, so planes are written as they are submitted */
+    fprintf(stderr,"Error starting output threads, writing serially\n");
+  }
+  return writer;
+}
+
+void output_writer_submit(struct output_writer *writer, unsigned int filter, const uint8_t *plane){
+  if(writer->num_threads == 0){
+    const int failed = plane == NULL || write_plane(writer,filter,plane);
+    pthread_mutex_lock(&writer->lock);
+    writer->failures += failed;
+    writer->written[filter] = 1;
+    ++writer->submitted;
+    ++writer->finished;
+    pthread_cond_broadcast(&writer->done);
+    pthread_mutex_unlock(&writer->lock);
+    return;
+  }
+
+  struct output_job *job = malloc(sizeof(struct output_job));
+  job->filter = filter;
+  job->plane = plane;
+  job->next = NULL;
+
+  pthread_mutex_lock(&writer->lock);
+  if(writer->tail){
+    writer->tail->next = job;
+  }else{
+    writer->head = job;
+  }
+  writer->tail = job;
+  ++writer->submitted;
+  pthread_cond_signal(&writer->work);
+  pthread_mutex_unlock(&writer->lock);
+}
+
+void output_writer_wait(struct output_writer *writer, unsigned int first, unsigned int count){
+  pthread_mutex_lock(&writer->lock);
+  for(unsigned int i = first; i < first + count && i < writer->num_filters; ++i){
+    while(!writer->written[i]){
+      pthread_cond_wait(&writer->done,&writer->lock);
+    }
+  }
+  pthread_mutex_unlock(&writer->lock);
+}
+
+int output_writer_finish(struct output_writer *writer){
+  /* planes may still be submitted from event callbacks */
+  pthread_mutex_lock(&writer->lock);
+  while(writer->finished < writer->num_filters){
+    pthread_cond_wait(&writer->done,&writer->lock);
+  }
+  writer->stopping = 1;
+  pthread_cond_broadcast(&writer->work);
+  pthread_mutex_unlock(&writer->lock);
+
+  for(unsigned int i = 0; i < writer->num_threads; ++i){
+    pthread_join(writer->threads[i],NULL);
+  }
+
+  int failures = writer->failures;
+  if(writer->format == OUTPUT_TIFF){
+    /* pages after a failed one were never appended */
+    for(unsigned int i = writer->next_page; i < writer->num_filters; ++i){
+      FreeImage_Unload(writer->pages[i]);
+    }
+    failures += !FreeImage_CloseMultiBitmap(writer->multi,0);
+    free(writer->pages);
+  }
+  if(writer->fd >= 0){
+    failures += close(writer->fd) != 0;
+  }
+
+  pthread_mutex_destroy(&writer->lock);
+  pthread_mutex_destroy(&writer->pages_lock);
+  pthread_cond_destroy(&writer->work);
+  pthread_cond_destroy(&writer->done);
+  free(writer->threads);
+  free(writer->written);
+  free(writer->prefix);
+  free(writer);
+  return failures;
+}
@@ -0,0 +1,57 @@
+/* writing the results of a filter bank
+ * planes are encoded by a pool of threads as they are handed over, so
+ * encoding overlaps with reading back the remaining planes.
+ * planes keep the row order of the image they came from, files are
+ * written upright either way
+ */
+
+#ifndef GIMC_OUTPUT_H
+#define GIMC_OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum output_format{
+  OUTPUT_JPEG, /* prefix_NNN.jpg per filter */
+  OUTPUT_PNG, /* prefix_NNN.png per filter */
+  OUTPUT_PGM, /* prefix_NNN.pgm per filter, binary greymap */
+  OUTPUT_RAW, /* prefix_NNN_WIDTHxHEIGHT.raw per filter, rows of bytes without a header */
+  OUTPUT_TIFF, /* prefix.tif with a page per filter */
+  OUTPUT_NPY, /* prefix.npy, a num_filters*height*width uint8 array which can be mapped */
+  NUM_OUTPUT_FORMATS
+};
+
+/* name of a format as given on the command line, which is also its extension */
+extern const char *output_format_name(enum output_format format);
+
+/* format with the given name, or NUM_OUTPUT_FORMATS if there is none */
+extern enum output_format output_format_from_name(const char *name);
+
+struct output_writer;
+
+/* start writing num_filters planes of width*height pixels
+ * top_down: nonzero if the first row of a plane is the top one, as in
+ * mapped images, zero for the bottom one first as in FreeImage bitmaps
+ * num_threads: encoding threads, 0 for one per online processor
+ * returns NULL if the output could not be created
+ */
+extern struct output_writer *output_writer_create(const char *prefix,enum output_format format,
+  size_t width,size_t height,int top_down,unsigned int num_filters,unsigned int num_threads);
+
+/* queue the plane of a filter for writing, the plane has to stay valid
+ * until output_writer_wait or output_writer_finish returns. a NULL plane marks the filter as
+ * failed. may be called from any thread, e.g. an OpenCL event callback
+ */
+extern void output_writer_submit(struct output_writer *writer,unsigned int filter,const uint8_t *plane);
+
+/* wait until the planes of filters first to first+count have been
+ * submitted and written, after which their memory may be reused
+ */
+extern void output_writer_wait(struct output_writer *writer,unsigned int first,unsigned int count);
+
+/* wait until every filter has been submitted and written, then free writer
+ * returns the number of planes which failed
+ */
+extern int output_writer_finish(struct output_writer *writer);
+
+#endif
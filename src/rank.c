@@ -0,0 +1,154 @@
+#include "rank.h"
+#include <stdlib.h>
+#include <string.h>
+
+unsigned int rank_radius(const float *filter, unsigned int width){
+  const long center = (width - 1)/2;
+  unsigned int radius = 0;
+  for(long y = 0; y < (long)width; ++y){
+    for(long x = 0; x < (long)width; ++x){
+      if(filter[y*width + x] != 0.0f){
+        const long dy = labs(y - center);
+        const long dx = labs(x - center);
+        const unsigned int reach = dx > dy ? dx : dy;
+        radius = reach > radius ? reach : radius;
+      }
+    }
+  }
+  return radius;
+}
+
+unsigned int rank_median_strip(unsigned int radius){
+  return 2*radius + 1 > RANK_MEDIAN_STRIP ? 2*radius + 1 : RANK_MEDIAN_STRIP;
+}
+
+static uint8_t pick(enum rank_op op, uint8_t a, uint8_t b){
+  return op == RANK_MAX ? (a > b ? a : b) : (a < b ? a : b);
+}
+
+/* minimum or maximum of every window of a line of length pixels stride
+ * apart. positions of the line are padded by radius on both ends with the
+ * identity of op, blocks of the window width start at padded position 0
+ */
+static void vhgw_line(enum rank_op op, const uint8_t *src, size_t length, size_t stride, unsigned int radius,
+  uint8_t *prefix, uint8_t *suffix, uint8_t *dst, size_t dst_stride){
+  const size_t window = 2*(size_t)radius + 1;
+  const size_t padded = length + 2*(size_t)radius;
+  const uint8_t identity = op == RANK_MAX ? 0 : 255;
+  for(size_t start = 0; start < padded; start += window){
+    const size_t end = start + window < padded ? start + window : padded;
+    for(size_t p = start; p < end; ++p){
+      const uint8_t value = p < radius || p - radius >= length ? identity : src[(p - radius)*stride];
+      prefix[p] = p == start ? value : pick(op,prefix[p - 1],value);
+    }
+    for(size_t p = end; p-- > start;){
+      const uint8_t value = p < radius || p - radius >= length ? identity : src[(p - radius)*stride];
+      suffix[p] = p + 1 == end ? value : pick(op,suffix[p + 1],value);
+    }
+  }
+  /* the window of x is padded positions x to x+2*radius */
+  for(size_t x = 0; x < length; ++x){
+    dst[x*dst_stride] = pick(op,suffix[x],prefix[x + 2*(size_t)radius]);
+  }
+}
+
+static void vhgw2d(enum rank_op op, const uint8_t *image, size_t image_width, size_t image_height,
+  unsigned int radius, uint8_t *result){
+  const size_t longest = image_width > image_height ? image_width : image_height;
+  uint8_t *prefix = malloc(longest + 2*(size_t)radius);
+  uint8_t *suffix = malloc(longest + 2*(size_t)radius);
+  uint8_t *rows = malloc(image_width*image_height);
+  for(size_t y = 0; y < image_height; ++y){
+    vhgw_line(op,&image[y*image_width],image_width,1,radius,prefix,suffix,&rows[y*image_width],1);
+  }
+  for(size_t x = 0; x < image_width; ++x){
+    vhgw_line(op,&rows[x],image_height,image_width,radius,prefix,suffix,&result[x],image_width);
+  }
+  free(prefix);
+  free(suffix);
+  free(rows);
+}
+
+static void median2d(const uint8_t *image, size_t image_width, size_t image_height, unsigned int radius,
+  uint8_t *result){
+  const long r = radius;
+  const long width = image_width;
+  const long height = image_height;
+  uint16_t *columns = calloc(image_width*256,sizeof(uint16_t));
+  uint32_t window[256];
+
+  for(long y = 0; y < height; ++y){
+    /* slide the column histograms down to rows y-r to y+r */
+    if(y == 0){
+      for(long row = 0; row <= r && row < height; ++row){
+        for(long x = 0; x < width; ++x){
+          ++columns[x*256 + image[row*width + x]];
+        }
+      }
+    }else{
+      const long removed = y - r - 1;
+      const long added = y + r;
+      for(long x = 0; x < width; ++x){
+        if(removed >= 0){
+          --columns[x*256 + image[removed*width + x]];
+        }
+        if(added < height){
+          ++columns[x*256 + image[added*width + x]];
+        }
+      }
+    }
+    const long rows = (y + r < height ? y + r : height - 1) - (y - r > 0 ? y - r : 0) + 1;
+
+    /* then the window along the row */
+    memset(window,0,sizeof(window));
+    for(long x = 0; x <= r && x < width; ++x){
+      for(int v = 0; v < 256; ++v){
+        window[v] += columns[x*256 + v];
+      }
+    }
+    for(long x = 0; x < width; ++x){
+      if(x > 0){
+        const long removed = x - r - 1;
+        const long added = x + r;
+        for(int v = 0; v < 256; ++v){
+          window[v] += (added < width ? columns[added*256 + v] : 0u) - (removed >= 0 ? columns[removed*256 + v] : 0u);
+        }
+      }
+      const long cols = (x + r < width ? x + r : width - 1) - (x - r > 0 ? x - r : 0) + 1;
+      const uint32_t rank = (uint32_t)(rows*cols - 1)/2;
+      uint32_t seen = 0;
+      int v = 0;
+      while((seen += window[v]) <= rank){
+        ++v;
+      }
+      result[y*width + x] = v;
+    }
+  }
+  free(columns);
+}
+
+int rank_filter2d(enum rank_op op, const uint8_t *image, size_t image_width, size_t image_height,
+  unsigned int radius, uint8_t *result){
+  if(op == RANK_MEDIAN){
+    if(radius > RANK_MEDIAN_MAX_RADIUS){
+      return 1;
+    }
+    median2d(image,image_width,image_height,radius,result);
+    return 0;
+  }
+  vhgw2d(op,image,image_width,image_height,radius,result);
+  return 0;
+}
+
+int native_rank2d(enum rank_op op, const uint8_t *image, size_t image_width, size_t image_height,
+  const float *bank, unsigned int num_filters, unsigned int filter_width, uint8_t *result){
+  const size_t image_size = image_width*image_height;
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  for(unsigned int f = 0; f < num_filters; ++f){
+    const unsigned int radius = rank_radius(&bank[f*filter_len],filter_width);
+    if(rank_filter2d(op,image,image_width,image_height,radius,&result[f*image_size])){
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+/* rank filters: minimum, maximum and median over square windows
+ * these are nonlinear and ignore the weights of a bank, the window of a
+ * filter is the smallest centered square holding its nonzero weights.
+ * pixels outside the image are left out of a window rather than zero.
+ * minimum and maximum are separable and take three comparisons per pixel
+ * along each axis for any window (van Herk, Gil and Werman): a line is cut
+ * into blocks of the window width, running extremes are taken from both
+ * ends of every block and a window, which spans at most two blocks, is the
+ * extreme of the two which meet in it. the median keeps a histogram of
+ * every column of the window, slid down the rows, and a histogram of the
+ * window, slid along a row by adding one column's and removing another's,
+ * so its cost doesn't grow with the window either (Perreault and Hebert)
+ */
+
+#ifndef GIMC_RANK_H
+#define GIMC_RANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum rank_op{
+  RANK_MIN, /* erosion by a flat square */
+  RANK_MAX, /* dilation by a flat square */
+  RANK_MEDIAN, /* lower median of the pixels in the window */
+  NUM_RANK_OPS
+};
+
+/* column histograms of the median count bytes, so the window is at most
+ * 2*RANK_MEDIAN_MAX_RADIUS+1 = 255 pixels high
+ */
+#define RANK_MEDIAN_MAX_RADIUS 127
+
+/* the median runs in strips of at least this many columns, and of as many
+ * as the window is wide, so building the histograms of a strip costs a
+ * bounded share of every pixel
+ */
+#define RANK_MEDIAN_STRIP 32
+
+/* strips are this many times as high as they are wide */
+#define RANK_MEDIAN_BAND 8
+
+/* radius of the window of a width*width filter */
+extern unsigned int rank_radius(const float *filter,unsigned int width);
+
+/* width of the strips of the median for a radius */
+extern unsigned int rank_median_strip(unsigned int radius);
+
+/* filter an image with a window of 2*radius+1 pixels square into result
+ * returns nonzero for a median of a radius over RANK_MEDIAN_MAX_RADIUS
+ */
+extern int rank_filter2d(enum rank_op op,const uint8_t *image,size_t image_width,size_t image_height,
+  unsigned int radius,uint8_t *result);
+
+/* rank_filter2d with the window of every filter of a bank laid out as in
+ * filter_Gauss2dbank, a plane per filter
+ */
+extern int native_rank2d(enum rank_op op,const uint8_t *image,size_t image_width,size_t image_height,
+  const float *bank,unsigned int num_filters,unsigned int filter_width,uint8_t *result);
+
+#endif
@@ -0,0 +1,317 @@
+#include "roi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+#include "trace.h"
+
+cl_int gimc_roi_create(struct gimc_roi *roi, struct gimc_cl *cl, const struct gimc_bank *bank, const uint8_t *image,
+  size_t width, size_t height, size_t tile, size_t cache_bytes){
+  cl_int err;
+  memset(roi,0,sizeof(struct gimc_roi));
+  roi->cl = cl;
+  roi->image = image;
+  roi->width = width;
+  roi->height = height;
+  roi->num_filters = bank->num_filters;
+  roi->filter_width = filter_dilated_width(bank->dilations,bank->num_filters,bank->width);
+  const size_t filter_len = (size_t)roi->filter_width*roi->filter_width;
+  roi->weights = malloc(sizeof(float)*filter_len*bank->num_filters);
+  filter_dilate_bank(roi->weights,roi->filter_width,bank->weights,bank->dilations,bank->num_filters,bank->width);
+
+  roi->tile = tile ? tile : ROI_TILE;
+  roi->tiles_x = (width + roi->tile - 1)/roi->tile;
+  roi->tiles_y = (height + roi->tile - 1)/roi->tile;
+  roi->entries = calloc(roi->tiles_x*roi->tiles_y*bank->num_filters,sizeof(struct roi_entry));
+  roi->max_tiles = (cache_bytes ? cache_bytes : (size_t)ROI_CACHE_MB << 20)/(roi->tile*roi->tile);
+  roi->needed = malloc(bank->num_filters);
+
+  /* windows differ from one request to the next, so the program isn't specialized */
+  cl_program program = program_cache_build(cl->programs,"lwfilter.cl",NULL);
+  if(program == NULL){
+    return CL_BUILD_PROGRAM_FAILURE;
+  }
+  roi->kernel = clCreateKernel(program,"convolve2d_rect",&err);
+  if(err){
+    print_error("clCreateKernel() convolve2d_rect",err);
+  }
+  return err;
+}
+
+static struct roi_entry *entry_of(struct gimc_roi *roi, size_t tx, size_t ty, unsigned int filter){
+  return &roi->entries[(ty*roi->tiles_x + tx)*roi->num_filters + filter];
+}
+
+/* nonzero if a tile lacks a needed filter */
+static int tile_missing(struct gimc_roi *roi, size_t tx, size_t ty){
+  for(unsigned int f = 0; f < roi->num_filters; ++f){
+    if(roi->needed[f] && entry_of(roi,tx,ty,f)->plane == NULL){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* drop the least recently used tiles of earlier requests until the cache fits */
+static void evict(struct gimc_roi *roi){
+  const size_t num_entries = roi->tiles_x*roi->tiles_y*roi->num_filters;
+  while(roi->cached_tiles > roi->max_tiles){
+    struct roi_entry *oldest = NULL;
+    for(size_t i = 0; i < num_entries; ++i){
+      struct roi_entry *entry = &roi->entries[i];
+      if(entry->plane && entry->used < roi->requests && (oldest == NULL || entry->used < oldest->used)){
+        oldest = entry;
+      }
+    }
+    if(oldest == NULL){
+      /* everything left belongs to this request */
+      return;
+    }
+    free(oldest->plane);
+    oldest->plane = NULL;
+    --roi->cached_tiles;
+  }
+}
+
+/* compute the missing tiles of the needed filters between tiles tx0,ty0
+ * and tx1,ty1 inclusive, from one upload of their bounding box and halo
+ */
+static cl_int compute_tiles(struct gimc_roi *roi, size_t tx0, size_t ty0, size_t tx1, size_t ty1,
+  struct roi_stats *stats){
+  struct gimc_cl *cl = roi->cl;
+  const size_t tile = roi->tile;
+  const size_t filter_len = (size_t)roi->filter_width*roi->filter_width;
+  const size_t radius = (roi->filter_width - 1)/2;
+  const size_t x0 = tx0*tile;
+  const size_t y0 = ty0*tile;
+  const size_t x1 = (tx1 + 1)*tile < roi->width ? (tx1 + 1)*tile : roi->width;
+  const size_t y1 = (ty1 + 1)*tile < roi->height ? (ty1 + 1)*tile : roi->height;
+
+  /* the window of the image the box reaches, zero beyond the image as everywhere */
+  const size_t wx0 = x0 > radius ? x0 - radius : 0;
+  const size_t wy0 = y0 > radius ? y0 - radius : 0;
+  const size_t wx1 = x1 + radius < roi->width ? x1 + radius : roi->width;
+  const size_t wy1 = y1 + radius < roi->height ? y1 + radius : roi->height;
+  const size_t window_width = wx1 - wx0;
+  const size_t window_height = wy1 - wy0;
+  const size_t window_size = window_width*window_height;
+
+  /* the needed filters, in order */
+  unsigned int num_needed = 0;
+  float *weights = malloc(sizeof(float)*filter_len*roi->num_filters);
+  unsigned int *needed = malloc(sizeof(unsigned int)*roi->num_filters);
+  for(unsigned int f = 0; f < roi->num_filters; ++f){
+    if(roi->needed[f]){
+      memcpy(&weights[num_needed*filter_len],&roi->weights[f*filter_len],sizeof(float)*filter_len);
+      needed[num_needed++] = f;
+    }
+  }
+
+  cl_int err;
+  cl_mem window = NULL, filters = NULL, result = NULL;
+  window = clCreateBuffer(cl->context,CL_MEM_READ_ONLY,window_size,NULL,&err);
+  if(!err){
+    filters = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,sizeof(float)*filter_len*num_needed,weights,&err);
+  }
+  if(!err){
+    result = clCreateBuffer(cl->context,CL_MEM_READ_WRITE,window_size*num_needed,NULL,&err);
+  }
+  if(err){
+    print_error("setting up region of interest",err);
+  }
+  if(!err){
+    const size_t host_origin[3] = {wx0, wy0, 0};
+    const size_t buffer_origin[3] = {0, 0, 0};
+    const size_t region[3] = {window_width, window_height, 1};
+    err = clEnqueueWriteBufferRect(cl->commands,window,CL_FALSE,buffer_origin,host_origin,region,
+      window_width,0,roi->width,0,roi->image,0,NULL,trace_event("write window"));
+    if(err){
+      print_error("clEnqueueWriteBufferRect() window",err);
+    }else if(stats){
+      stats->uploaded_bytes += window_size;
+    }
+  }
+
+  const cl_ulong image_width = window_width;
+  const cl_ulong image_height = window_height;
+  if(!err){
+    err = clSetKernelArg(roi->kernel,0,sizeof(cl_mem),&window);
+    err |= clSetKernelArg(roi->kernel,1,sizeof(cl_mem),&filters);
+    err |= clSetKernelArg(roi->kernel,2,sizeof(cl_mem),&result);
+    err |= clSetKernelArg(roi->kernel,3,sizeof(cl_ulong),&image_width);
+    err |= clSetKernelArg(roi->kernel,4,sizeof(cl_ulong),&image_height);
+    err |= clSetKernelArg(roi->kernel,5,sizeof(unsigned int),&roi->filter_width);
+    err |= clSetKernelArg(roi->kernel,6,sizeof(unsigned int),&num_needed);
+    if(err){
+      print_error("clSetKernelArg() convolve2d_rect",err);
+    }
+  }
+
+  /* runs of missing tiles along each row of tiles, offset into the window */
+  for(size_t ty = ty0; ty <= ty1 && !err; ++ty){
+    const size_t rows = (ty + 1)*tile < roi->height ? tile : roi->height - ty*tile;
+    size_t tx = tx0;
+    while(tx <= tx1 && !err){
+      if(!tile_missing(roi,tx,ty)){
+        ++tx;
+        continue;
+      }
+      const size_t run = tx;
+      while(tx <= tx1 && tile_missing(roi,tx,ty)){
+        ++tx;
+      }
+      const size_t run_x1 = tx*tile < roi->width ? tx*tile : roi->width;
+      const size_t offset[3] = {run*tile - wx0, ty*tile - wy0, 0};
+      const size_t global[3] = {run_x1 - run*tile, rows, num_needed};
+      err = clEnqueueNDRangeKernel(cl->commands,roi->kernel,3,offset,global,NULL,0,NULL,trace_event("convolve2d_rect"));
+      if(err){
+        print_error("clEnqueueNDRangeKernel() convolve2d_rect",err);
+      }else if(stats){
+        ++stats->launches;
+      }
+    }
+  }
+
+  /* read the box back and split it into tiles */
+  const size_t box_width = x1 - x0;
+  const size_t box_height = y1 - y0;
+  uint8_t *box = malloc(box_width*box_height*num_needed);
+  for(unsigned int n = 0; n < num_needed && !err; ++n){
+    const size_t buffer_origin[3] = {x0 - wx0, y0 - wy0 + n*window_height, 0};
+    const size_t host_origin[3] = {0, 0, 0};
+    const size_t region[3] = {box_width, box_height, 1};
+    err = clEnqueueReadBufferRect(cl->commands,result,n + 1 == num_needed,buffer_origin,host_origin,region,
+      window_width,0,box_width,0,&box[n*box_width*box_height],0,NULL,trace_event("read window"));
+    if(err){
+      print_error("clEnqueueReadBufferRect() window",err);
+    }
+  }
+  for(size_t ty = ty0; ty <= ty1 && !err; ++ty){
+    for(size_t tx = tx0; tx <= tx1; ++tx){
+      const size_t cols = (tx + 1)*tile < roi->width ? tile : roi->width - tx*tile;
+      const size_t rows = (ty + 1)*tile < roi->height ? tile : roi->height - ty*tile;
+      for(unsigned int n = 0; n < num_needed; ++n){
+        struct roi_entry *entry = entry_of(roi,tx,ty,needed[n]);
+        if(entry->plane){
+          continue;
+        }
+        entry->plane = malloc(tile*tile);
+        entry->used = roi->requests;
+        ++roi->cached_tiles;
+        const uint8_t *source = &box[n*box_width*box_height + (ty*tile - y0)*box_width + tx*tile - x0];
+        for(size_t y = 0; y < rows; ++y){
+          memcpy(&entry->plane[y*tile],&source[y*box_width],cols);
+        }
+        if(stats){
+          ++stats->computed_tiles;
+        }
+      }
+    }
+  }
+
+  if(window){
+    clReleaseMemObject(window);
+  }
+  if(filters){
+    clReleaseMemObject(filters);
+  }
+  if(result){
+    clReleaseMemObject(result);
+  }
+  free(box);
+  free(weights);
+  free(needed);
+  return err;
+}
+
+cl_int gimc_roi_request(struct gimc_roi *roi, const struct gimc_rect *rect, const unsigned int *filters,
+  unsigned int num_filters, uint8_t *result, struct roi_stats *stats){
+  if(stats){
+    memset(stats,0,sizeof(struct roi_stats));
+  }
+  if(rect->width == 0 || rect->height == 0 || rect->x + rect->width > roi->width || rect->y + rect->height > roi->height){
+    fprintf(stderr,"Region %zux%zu at %zu,%zu is outside the %zux%zu image\n",
+      rect->width,rect->height,rect->x,rect->y,roi->width,roi->height);
+    return CL_INVALID_VALUE;
+  }
+  memset(roi->needed,0,roi->num_filters);
+  for(unsigned int i = 0; i < num_filters; ++i){
+    const unsigned int f = filters ? filters[i] : i;
+    if(f >= roi->num_filters){
+      fprintf(stderr,"There is no filter %u in a bank of %u\n",f,roi->num_filters);
+      return CL_INVALID_VALUE;
+    }
+    roi->needed[f] = 1;
+  }
+  ++roi->requests;
+
+  /* the tiles of the rectangle, and the box of those missing a filter */
+  const size_t tile = roi->tile;
+  const size_t tx0 = rect->x/tile;
+  const size_t ty0 = rect->y/tile;
+  const size_t tx1 = (rect->x + rect->width - 1)/tile;
+  const size_t ty1 = (rect->y + rect->height - 1)/tile;
+  size_t mx0 = tx1 + 1, my0 = ty1 + 1, mx1 = 0, my1 = 0;
+  for(size_t ty = ty0; ty <= ty1; ++ty){
+    for(size_t tx = tx0; tx <= tx1; ++tx){
+      for(unsigned int f = 0; f < roi->num_filters; ++f){
+        struct roi_entry *entry = entry_of(roi,tx,ty,f);
+        if(!roi->needed[f]){
+          continue;
+        }
+        if(entry->plane){
+          entry->used = roi->requests;
+          if(stats){
+            ++stats->hit_tiles;
+          }
+          continue;
+        }
+        mx0 = tx < mx0 ? tx : mx0;
+        my0 = ty < my0 ? ty : my0;
+        mx1 = tx > mx1 ? tx : mx1;
+        my1 = ty > my1 ? ty : my1;
+      }
+    }
+  }
+  if(mx0 <= mx1){
+    cl_int err = compute_tiles(roi,mx0,my0,mx1,my1,stats);
+    if(err){
+      return err;
+    }
+  }
+
+  /* copy the rectangle out of the tiles */
+  trace_begin("assemble");
+  const size_t plane_size = rect->width*rect->height;
+  for(unsigned int i = 0; i < num_filters; ++i){
+    const unsigned int f = filters ? filters[i] : i;
+    for(size_t y = rect->y; y < rect->y + rect->height; ++y){
+      size_t x = rect->x;
+      while(x < rect->x + rect->width){
+        const size_t tx = x/tile;
+        const size_t end = (tx + 1)*tile < rect->x + rect->width ? (tx + 1)*tile : rect->x + rect->width;
+        const struct roi_entry *entry = entry_of(roi,tx,y/tile,f);
+        memcpy(&result[i*plane_size + (y - rect->y)*rect->width + x - rect->x],&entry->plane[(y % tile)*tile + x % tile],end - x);
+        x = end;
+      }
+    }
+  }
+  trace_end();
+
+  evict(roi);
+  return CL_SUCCESS;
+}
+
+void gimc_roi_release(struct gimc_roi *roi){
+  const size_t num_entries = roi->tiles_x*roi->tiles_y*roi->num_filters;
+  for(size_t i = 0; roi->entries && i < num_entries; ++i){
+    free(roi->entries[i].plane);
+  }
+  if(roi->kernel){
+    clReleaseKernel(roi->kernel);
+  }
+  free(roi->entries);
+  free(roi->weights);
+  free(roi->needed);
+}
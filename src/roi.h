@@ -0,0 +1,85 @@
+/* region of interest evaluation
+ * viewers only need the part of a large image which is on screen. a request
+ * names a rectangle of the results and some of the filters. only the
+ * rectangle and the halo its filters reach are uploaded, and
+ * convolve2d_rect in lwfilter.cl runs over it with a global offset.
+ * results are kept on the host in tiles, so a request which overlaps
+ * earlier ones, as pans and zooms do, only computes the tiles it hasn't
+ * seen. the least recently used tiles go once the cache is full.
+ * results are those of the lwf engine, and dilated banks those of their
+ * dense equivalent
+ */
+
+#ifndef GIMC_ROI_H
+#define GIMC_ROI_H
+
+#include "engine.h"
+
+/* default side length of a tile in pixels */
+#define ROI_TILE 256
+
+/* default size of the tile cache in MiB */
+#define ROI_CACHE_MB 256
+
+/* a rectangle of pixels, rows counted as in the image buffer */
+struct gimc_rect{
+  size_t x;
+  size_t y;
+  size_t width;
+  size_t height;
+};
+
+/* what a request did, counting a tile once per filter */
+struct roi_stats{
+  size_t hit_tiles; /* served from the cache */
+  size_t computed_tiles;
+  size_t uploaded_bytes; /* of the image */
+  unsigned int launches;
+};
+
+/* a tile of a filter, NULL until computed */
+struct roi_entry{
+  uint8_t *plane; /* tile*tile pixels, rows tile apart */
+  unsigned long used; /* request which last used it */
+};
+
+struct gimc_roi{
+  struct gimc_cl *cl;
+  const uint8_t *image;
+  size_t width;
+  size_t height;
+  float *weights; /* host copy of the bank, dense if it is dilated */
+  unsigned int num_filters;
+  unsigned int filter_width;
+  size_t tile;
+  size_t tiles_x;
+  size_t tiles_y;
+  struct roi_entry *entries; /* per tile and filter, filters of a tile together */
+  size_t max_tiles;
+  size_t cached_tiles;
+  unsigned long requests;
+  unsigned char *needed; /* per filter scratch */
+  cl_kernel kernel;
+};
+
+/* set up requests on a width*height image with bank
+ * image stays on the host and has to outlive roi, the bank may be released
+ * tile: side length of tiles, 0 for ROI_TILE
+ * cache_bytes: room for tiles, 0 for ROI_CACHE_MB
+ * returns CL_SUCCESS or the failing error
+ */
+extern cl_int gimc_roi_create(struct gimc_roi *roi,struct gimc_cl *cl,const struct gimc_bank *bank,const uint8_t *image,
+  size_t width,size_t height,size_t tile,size_t cache_bytes);
+
+/* the results of num_filters filters of the bank over rect
+ * filters: indices in the bank, NULL for the first num_filters
+ * result: num_filters planes of rect->width*rect->height pixels
+ * stats may be NULL. returns once result is filled
+ */
+extern cl_int gimc_roi_request(struct gimc_roi *roi,const struct gimc_rect *rect,const unsigned int *filters,
+  unsigned int num_filters,uint8_t *result,struct roi_stats *stats);
+
+/* release the tiles and kernel of roi */
+extern void gimc_roi_release(struct gimc_roi *roi);
+
+#endif
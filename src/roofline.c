@@ -0,0 +1,143 @@
+/* benchmark of every engine on one image and bank
+ * prints achieved GFLOP/s and GB/s of each engine next to what the device
+ * can attain at the engine's arithmetic intensity, for a roofline plot
+ * followed by the width specialized host instances of cpu.h
+ */
+
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+
+/* standard headers */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* project headers */
+#include "cpu.h"
+#include "image.h"
+#include "engine.h"
+#include "filter.h"
+#include "metrics.h"
+#include "multirate.h"
+#include "sat.h"
+#include "trace.h"
+
+static double now(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char **argv){
+  trace_init(&argc,argv);
+  if(argc < 5){
+    printf("Usage: %s [Image File] [Device Option] [Number of Filters] [Size of Filters] [Repeats]\n",argv[0]);
+    return -1;
+  }
+
+  const cl_device_type device_type = gimc_device_type(argv[2]);
+  const unsigned int num_filters = atoi(argv[3]);
+  const unsigned int filter_width = atoi(argv[4]);
+  const unsigned int repeats = argc > 5 ? atoi(argv[5]) : 3;
+
+  /* get the image */
+  struct gimc_image image;
+  trace_begin("load");
+  gimc_image_load(&image,argv[1]);
+  trace_end();
+  const size_t image_size = image.width*image.height;
+
+  /* kernels are timed with events */
+  struct gimc_cl cl;
+  gimc_cl_init(&cl,device_type,CL_QUEUE_PROFILING_ENABLE);
+
+  struct device_peaks peaks;
+  metrics_device_peaks(&cl,&peaks);
+
+  cl_int err;
+  float *h_filter = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+  filter_Gauss2dbank(h_filter,num_filters,filter_width);
+  struct gimc_bank bank;
+  err = gimc_bank_upload(&cl,&bank,h_filter,num_filters,filter_width);
+  free(h_filter);
+
+  cl_mem d_image = gimc_image_buffer(&cl,&image,&err);
+  if(err){
+    exit(EXIT_FAILURE);
+  }
+  cl_mem d_result = clCreateBuffer(cl.context,CL_MEM_WRITE_ONLY,sizeof(uint8_t)*image_size*num_filters,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer()",err);
+    exit(EXIT_FAILURE);
+  }
+  clFinish(cl.commands);
+
+  printf("# image: %lux%lu, filters: %u of width %u\n",
+    (unsigned long)image.width,(unsigned long)image.height,num_filters,filter_width);
+  metrics_print_header(stdout,&peaks);
+
+  /* the sat engine approximates all but boxes, report how closely */
+  for(unsigned int f = 0; f < num_filters; ++f){
+    struct sat_plan plan;
+    sat_plan_filter(&bank.weights[(size_t)f*filter_width*filter_width],filter_width,sat_passes(),&plan);
+    if(plan.exact){
+      printf("# sat filter %u: box, exact\n",f);
+    }else{
+      printf("# sat filter %u: %u passes of radius %u, error %.4f, at most %.1f grey levels\n",
+        f,plan.passes,plan.boxes[0].radius,plan.error,255.0*plan.error);
+    }
+  }
+
+  /* and the multirate engine decimates as far as its accuracy target allows */
+  for(unsigned int f = 0; f < num_filters; ++f){
+    struct multirate_plan plan;
+    multirate_plan_filter(&bank.weights[(size_t)f*filter_width*filter_width],filter_width,multirate_target(),&plan);
+    printf("# multirate filter %u: factor %u, width %u, error %.4f, at most %.1f grey levels\n",
+      f,plan.factor,plan.width,plan.error,255.0*plan.error);
+    multirate_plan_release(&plan);
+  }
+
+  for(int e = 0; e < NUM_ENGINES; ++e){
+    /* the first run builds the program and is not counted */
+    err = engine_convolve(&cl,e,d_image,image.width,image.height,&bank,d_result,NULL);
+    clFinish(cl.commands);
+    if(err){
+      printf("%-14s failed with code %d\n",engine_name(e),err);
+      continue;
+    }
+
+    struct engine_timing timing = {0.0,0};
+    for(unsigned int r = 0; r < repeats && !err; ++r){
+      err = engine_convolve(&cl,e,d_image,image.width,image.height,&bank,d_result,&timing);
+    }
+
+    struct engine_work work;
+    metrics_engine_work(e,image.width,image.height,&bank,&work);
+    metrics_print(stdout,engine_name(e),&work,timing.seconds/repeats,&peaks);
+  }
+
+  /* the host instances take the taps of base from the host's caches, on
+   * a CPU device they share its peaks
+   */
+  uint8_t *h_result = malloc(sizeof(uint8_t)*image_size*num_filters);
+  trace_begin("cpu");
+  const double start = now();
+  for(unsigned int r = 0; r < repeats; ++r){
+    cpu_convolve2d(image.bits,image.width,image.height,bank.weights,num_filters,filter_width,h_result);
+  }
+  const double seconds = now() - start;
+  trace_end();
+  free(h_result);
+  struct engine_work work;
+  metrics_engine_work(ENGINE_BASE,image.width,image.height,&bank,&work);
+  metrics_print(stdout,cpu_is_specialized(filter_width) ? "cpu" : "cpu_generic",&work,seconds/repeats,&peaks);
+
+  trace_finish();
+
+  clReleaseMemObject(d_image);
+  clReleaseMemObject(d_result);
+  gimc_bank_release(&bank);
+  gimc_cl_release(&cl);
+  gimc_image_unload(&image);
+  return 0;
+}
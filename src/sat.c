@@ -0,0 +1,127 @@
+#include "sat.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+unsigned int sat_passes(void){
+  const char *passes = getenv("GIMC_SAT_PASSES");
+  return passes ? atoi(passes) : SAT_PASSES;
+}
+
+unsigned int sat_plan_padding(const struct sat_plan *plan){
+  unsigned int padding = 0;
+  for(unsigned int p = 0; p + 1 < plan->passes; ++p){
+    padding += plan->boxes[p].radius + 1;
+  }
+  return padding;
+}
+
+void sat_extended_box(double variance, struct sat_box *box){
+  /* the widest plain box with at most the variance, then the weight of the
+   * cells just outside it which makes up the rest
+   */
+  const unsigned int r = floor(0.5*sqrt(12.0*variance + 1.0) - 0.5);
+  const double alpha = (2*r + 1)*(r*(r + 1.0) - 3.0*variance)/(6.0*(variance - (r + 1.0)*(r + 1.0)));
+  const double inner = 1.0/(2.0*alpha + 2*r + 1);
+  const double outer = alpha*inner;
+  box->radius = r;
+  box->inner = inner*inner;
+  box->edge = inner*outer;
+  box->corner = outer*outer;
+}
+
+/* the 1d weights of a box, which are the square roots of the 2d ones */
+static void box_weights(const struct sat_box *box, double *inner, double *outer){
+  *inner = sqrt(box->inner);
+  *outer = *inner > 0.0 ? box->edge / *inner : 0.0;
+}
+
+/* sum of absolute differences between the boxes of a plan applied in turn and filter */
+static double plan_error(const struct sat_plan *plan, const float *filter, unsigned int width, double scale){
+  /* the 1d kernel of the passes, grown one box at a time */
+  size_t reach = 0;
+  for(unsigned int p = 0; p < plan->passes; ++p){
+    reach += plan->boxes[p].radius + 1;
+  }
+  const size_t len = 2*reach + 1;
+  double *kernel = calloc(len,sizeof(double));
+  double *next = malloc(sizeof(double)*len);
+  kernel[reach] = 1.0;
+  for(unsigned int p = 0; p < plan->passes; ++p){
+    double inner, outer;
+    box_weights(&plan->boxes[p],&inner,&outer);
+    const long r = plan->boxes[p].radius;
+    memset(next,0,sizeof(double)*len);
+    for(long i = 0; i < (long)len; ++i){
+      for(long d = -r - 1; d <= r + 1; ++d){
+        if(i + d >= 0 && i + d < (long)len){
+          next[i + d] += kernel[i]*(labs(d) > r ? outer : inner);
+        }
+      }
+    }
+    memcpy(kernel,next,sizeof(double)*len);
+  }
+
+  /* filters are applied backwards, so offset (dx,dy) weighs cell (r-dy,r-dx) */
+  const long radius = (width - 1)/2;
+  const long extent = (long)reach > radius ? (long)reach : radius;
+  double error = 0.0;
+  for(long dy = -extent; dy <= extent; ++dy){
+    for(long dx = -extent; dx <= extent; ++dx){
+      double approximation = 0.0;
+      if(labs(dx) <= (long)reach && labs(dy) <= (long)reach){
+        approximation = scale*kernel[reach + dy]*kernel[reach + dx];
+      }
+      double weight = 0.0;
+      if(labs(dx) <= radius && labs(dy) <= radius){
+        weight = filter[(radius - dy)*width + radius - dx];
+      }
+      error += fabs(approximation - weight);
+    }
+  }
+  free(kernel);
+  free(next);
+  return error;
+}
+
+void sat_plan_filter(const float *filter, unsigned int width, unsigned int passes, struct sat_plan *plan){
+  const size_t filter_len = (size_t)width*width;
+  memset(plan,0,sizeof(struct sat_plan));
+
+  /* box and mean filters are a single sum over the filter's square */
+  size_t i = 1;
+  while(i < filter_len && filter[i] == filter[0]){
+    ++i;
+  }
+  if(i == filter_len){
+    plan->exact = 1;
+    plan->passes = 1;
+    plan->boxes[0].radius = (width - 1)/2;
+    plan->boxes[0].inner = filter[0];
+    return;
+  }
+
+  /* otherwise match the variance of the filter about its center */
+  const long radius = (width - 1)/2;
+  double sum = 0.0, variance = 0.0;
+  for(long y = -radius; y <= radius; ++y){
+    for(long x = -radius; x <= radius; ++x){
+      const double weight = filter[(y + radius)*width + x + radius];
+      sum += weight;
+      variance += weight*(x*x + y*y)*0.5;
+    }
+  }
+  variance = sum != 0.0 ? variance/sum : 0.0;
+
+  plan->passes = passes < SAT_MIN_PASSES ? SAT_MIN_PASSES : passes > SAT_MAX_PASSES ? SAT_MAX_PASSES : passes;
+  for(unsigned int p = 0; p < plan->passes; ++p){
+    sat_extended_box(variance/plan->passes,&plan->boxes[p]);
+  }
+  plan->error = plan_error(plan,filter,width,sum);
+
+  /* the last pass carries the filter's gain */
+  struct sat_box *last = &plan->boxes[plan->passes - 1];
+  last->inner *= sum;
+  last->edge *= sum;
+  last->corner *= sum;
+}
@@ -0,0 +1,53 @@
+/* filtering with summed area tables
+ * a box of any size sums to four lookups in the integral image, so the
+ * sat engine costs the same for every filter width. box and mean filters
+ * are exact, other filters are approximated by repeated extended boxes
+ * with the variance of the filter, which is close for Gaussians
+ * (Gwosdek et al., theoretical foundations of Gaussian convolution by
+ * extended box filtering). plans are made on the host from the weights
+ */
+
+#ifndef GIMC_SAT_H
+#define GIMC_SAT_H
+
+/* passes of the Gaussian approximation, more are closer and slower */
+#define SAT_MIN_PASSES 3
+#define SAT_MAX_PASSES 5
+#define SAT_PASSES 3
+
+/* a 2d extended box, the product of two 1d boxes whose radius+1 cells
+ * are weighted outer and whose others are weighted inner
+ */
+struct sat_box{
+  unsigned int radius;
+  float inner; /* weight of the (2*radius+1)^2 square */
+  float edge; /* weight of the cells next to its sides */
+  float corner; /* weight of the cells next to its corners */
+};
+
+/* how the sat engine runs one filter */
+struct sat_plan{
+  int exact; /* nonzero for box filters, which take one pass */
+  unsigned int passes;
+  struct sat_box boxes[SAT_MAX_PASSES];
+  double error; /* sum of absolute differences from the filter's weights */
+};
+
+/* pixels the planes between the passes of a plan extend past the image
+ * on each side, the reach of every pass but the last
+ */
+extern unsigned int sat_plan_padding(const struct sat_plan *plan);
+
+/* passes to use, from GIMC_SAT_PASSES or SAT_PASSES */
+extern unsigned int sat_passes(void);
+
+/* plan filtering with a width*width filter laid out as in filter_Gauss2dbank
+ * filters which aren't boxes are approximated in passes passes, clamped
+ * to SAT_MIN_PASSES..SAT_MAX_PASSES
+ */
+extern void sat_plan_filter(const float *filter,unsigned int width,unsigned int passes,struct sat_plan *plan);
+
+/* extended box with the given variance along each axis and unit sum */
+extern void sat_extended_box(double variance,struct sat_box *box);
+
+#endif
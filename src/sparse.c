@@ -0,0 +1,100 @@
+#include "sparse.h"
+#include <math.h>
+#include <stdlib.h>
+
+double sparse_threshold(void){
+  const char *threshold = getenv("GIMC_SPARSE_THRESHOLD");
+  return threshold ? atof(threshold) : SPARSE_THRESHOLD;
+}
+
+void sparse_from_bank(const float *bank, unsigned int num_filters, unsigned int filter_width, double threshold,
+  struct sparse_bank *sparse){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  const int radius = (filter_width - 1)/2;
+  sparse->num_filters = num_filters;
+  sparse->width = filter_width;
+  sparse->starts = malloc(sizeof(unsigned int)*(num_filters + 1));
+  const size_t bank_len = filter_len*num_filters;
+  sparse->taps = malloc(sizeof(struct sparse_tap)*(bank_len > 0 ? bank_len : 1));
+  sparse->errors = malloc(sizeof(double)*(num_filters ? num_filters : 1));
+  sparse->num_taps = 0;
+
+  for(unsigned int f = 0; f < num_filters; ++f){
+    /* convolution uses the filter backwards, so index it from its last cell */
+    const float *last = &bank[(f + 1)*filter_len - 1];
+    double largest = 0.0;
+    for(size_t i = 0; i < filter_len; ++i){
+      largest = fabs(last[-(long)i]) > largest ? fabs(last[-(long)i]) : largest;
+    }
+    const double cutoff = threshold*largest;
+    sparse->starts[f] = sparse->num_taps;
+    sparse->errors[f] = 0.0;
+    for(unsigned int fy = 0; fy < filter_width; ++fy){
+      for(unsigned int fx = 0; fx < filter_width; ++fx){
+        const float weight = last[-(long)(fy*filter_width + fx)];
+        if(weight == 0.0f || fabs(weight) <= cutoff){
+          sparse->errors[f] += fabs(weight);
+          continue;
+        }
+        struct sparse_tap *tap = &sparse->taps[sparse->num_taps++];
+        tap->dy = (int)fy - radius;
+        tap->dx = (int)fx - radius;
+        tap->weight = weight;
+      }
+    }
+  }
+  sparse->starts[num_filters] = sparse->num_taps;
+}
+
+void sparse_release(struct sparse_bank *sparse){
+  free(sparse->starts);
+  free(sparse->taps);
+  free(sparse->errors);
+}
+
+double sparse_max_error(const struct sparse_bank *sparse){
+  double error = 0.0;
+  for(unsigned int f = 0; f < sparse->num_filters; ++f){
+    error = sparse->errors[f] > error ? sparse->errors[f] : error;
+  }
+  return error;
+}
+
+void sparse_convolve2d(const uint8_t *image, size_t image_width, size_t image_height,
+  const struct sparse_bank *sparse, uint8_t *result){
+  const size_t image_size = image_width*image_height;
+  float *sums = malloc(sizeof(float)*(image_width ? image_width : 1));
+
+  for(unsigned int f = 0; f < sparse->num_filters; ++f){
+    const struct sparse_tap *first = &sparse->taps[sparse->starts[f]];
+    const struct sparse_tap *end = &sparse->taps[sparse->starts[f + 1]];
+    for(size_t py = 0; py < image_height; ++py){
+      /* a tap at a time over the row, each pixel still sums its taps in
+       * order, and the columns a tap reaches within the image are clipped
+       * once instead of checked per pixel
+       */
+      for(size_t px = 0; px < image_width; ++px){
+        sums[px] = 0.0f;
+      }
+      for(const struct sparse_tap *tap = first; tap < end; ++tap){
+        const long row = (long)py + tap->dy;
+        if(row < 0 || row >= (long)image_height){
+          continue;
+        }
+        const long begin = tap->dx < 0 ? -tap->dx : 0;
+        const long stop = tap->dx > 0 ? (long)image_width - tap->dx : (long)image_width;
+        const uint8_t *source = &image[row*image_width];
+        const float weight = tap->weight;
+        for(long px = begin; px < stop; ++px){
+          sums[px] += source[px + tap->dx]*weight;
+        }
+      }
+      uint8_t *out = &result[f*image_size + py*image_width];
+      for(size_t px = 0; px < image_width; ++px){
+        /* derivative filters go negative */
+        out[px] = sums[px] <= 0.0f ? 0 : sums[px] >= 255.0f ? 255 : sums[px];
+      }
+    }
+  }
+  free(sums);
+}
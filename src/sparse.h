@@ -0,0 +1,62 @@
+/* sparse taps
+ * line detectors, rings and the tails of Gaussians are mostly zeros, yet a
+ * dense filter takes all width*width taps. a sparse bank keeps a list of
+ * (dy, dx, weight) per filter with its zero taps left out, and those whose
+ * weight is within threshold of the largest of the filter, in row order so
+ * a pixel reads the image a row at a time. convolving takes as many taps
+ * as are kept, whatever the width
+ */
+
+#ifndef GIMC_SPARSE_H
+#define GIMC_SPARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* default threshold, see sparse_from_bank. zero only drops zero taps, so
+ * results are those of the dense filters
+ */
+#define SPARSE_THRESHOLD 0.0
+
+/* a tap of a filter, at offset (dx,dy) of the pixel it is summed for */
+struct sparse_tap{
+  int32_t dy;
+  int32_t dx;
+  float weight;
+};
+
+struct sparse_bank{
+  unsigned int num_filters;
+  unsigned int width; /* of the dense filters */
+  unsigned int *starts; /* num_filters+1, the taps of filter f are starts[f] to starts[f+1] */
+  struct sparse_tap *taps;
+  size_t num_taps;
+  /* sum of the absolute weights dropped from every filter. results are
+   * within 255*error+1 of the dense filter
+   */
+  double *errors;
+};
+
+/* threshold, from GIMC_SPARSE_THRESHOLD or SPARSE_THRESHOLD */
+extern double sparse_threshold(void);
+
+/* the taps of a bank laid out as in filter_Gauss2dbank, leaving out those
+ * whose absolute weight is at most threshold times the largest of their
+ * filter
+ */
+extern void sparse_from_bank(const float *bank,unsigned int num_filters,unsigned int filter_width,double threshold,
+  struct sparse_bank *sparse);
+
+extern void sparse_release(struct sparse_bank *sparse);
+
+/* largest error of the filters of a bank */
+extern double sparse_max_error(const struct sparse_bank *sparse);
+
+/* native_convolve2d with the taps of a sparse bank, summed in the same
+ * order, so results are those of native_convolve2d when no weight but
+ * zeros was dropped
+ */
+extern void sparse_convolve2d(const uint8_t *image,size_t image_width,size_t image_height,
+  const struct sparse_bank *sparse,uint8_t *result);
+
+#endif
@@ -0,0 +1,270 @@
+/* streaming convolution of frame sequences
+ * frames are read from a y4m or raw stream, convolved with a bank which
+ * stays on the device and written to stdout, with the planes of the filters
+ * stacked top to bottom in each output frame.
+ * a ring of device buffers pipelines the work on three queues: while one
+ * frame is convolved the next is uploaded and the previous downloaded.
+ * the kernels, scratch buffers and plans of the engine stay resident from
+ * one frame to the next
+ */
+
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+
+/* standard headers */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* project headers */
+#include "engine.h"
+#include "filter.h"
+#include "frames.h"
+#include "trace.h"
+
+#define DEFAULT_RING 3
+
+/* a frame in flight */
+struct slot{
+  uint8_t *frame;
+  uint8_t *result;
+  cl_mem d_frame;
+  cl_mem d_result;
+  cl_event downloaded;
+  uint64_t start; /* when the frame was read */
+  int busy;
+};
+
+struct stream_stats{
+  unsigned long frames;
+  double latency_sum;
+  double latency_max;
+};
+
+static uint64_t now(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+/* wait for the frame in a slot and write its result */
+static int retire(struct slot *slot, int y4m, size_t result_size, struct stream_stats *stats){
+  cl_int err = clWaitForEvents(1,&slot->downloaded);
+  clReleaseEvent(slot->downloaded);
+  slot->busy = 0;
+  if(err){
+    print_error("clWaitForEvents() download",err);
+    return 1;
+  }
+  if(frame_writer_put(stdout,y4m,slot->result,result_size)){
+    perror("writing frame");
+    return 1;
+  }
+
+  const double latency = (now() - slot->start)*1e-9;
+  stats->latency_sum += latency;
+  if(latency > stats->latency_max){
+    stats->latency_max = latency;
+  }
+  ++stats->frames;
+  return 0;
+}
+
+int main(int argc, char **argv){
+  trace_init(&argc,argv);
+
+  /* options */
+  size_t raw_width = 0, raw_height = 0;
+  unsigned int ring_size = DEFAULT_RING;
+  int kept = 1;
+  for(int i = 1; i < argc; ++i){
+    unsigned long w, h;
+    if(sscanf(argv[i],"--size=%lux%lu",&w,&h) == 2){
+      raw_width = w;
+      raw_height = h;
+    }else if(strncmp(argv[i],"--ring=",7) == 0){
+      ring_size = atoi(argv[i] + 7);
+    }else{
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
+  if(argc < 5 || ring_size == 0){
+    fprintf(stderr,"Usage: %s [Device Option] [Engine] [Number of Filters] [Size of Filters] [Input File=-]\n",argv[0]);
+    fprintf(stderr,"  [--size=WIDTHxHEIGHT for raw frames] [--ring=%d]\n",DEFAULT_RING);
+    fprintf(stderr,"  results are written to stdout, y4m for y4m input and raw otherwise\n");
+    return -1;
+  }
+
+  const cl_device_type device_type = gimc_device_type(argv[1]);
+  const enum engine_id engine = engine_from_name(argv[2]);
+  if(engine == NUM_ENGINES){
+    fprintf(stderr,"Unknown engine %s\n",argv[2]);
+    return -1;
+  }
+  const unsigned int num_filters = atoi(argv[3]);
+  const unsigned int filter_width = atoi(argv[4]);
+
+  FILE *input = stdin;
+  if(argc > 5 && strcmp(argv[5],"-") != 0){
+    input = fopen(argv[5],"rb");
+    if(input == NULL){
+      perror(argv[5]);
+      return EXIT_FAILURE;
+    }
+  }
+  struct frame_reader reader;
+  if(frame_reader_open(&reader,input,raw_width,raw_height)){
+    return EXIT_FAILURE;
+  }
+  const size_t width = reader.width;
+  const size_t height = reader.height;
+  const size_t frame_size = width*height;
+  const size_t result_size = frame_size*num_filters;
+
+  /* convolutions run on the queue of the engines, transfers on their own */
+  struct gimc_cl cl;
+  gimc_cl_init(&cl,device_type,0);
+  cl_int err;
+  cl_command_queue upload = clCreateCommandQueue(cl.context,cl.device,trace_queue_properties(),&err);
+  cl_command_queue download = clCreateCommandQueue(cl.context,cl.device,trace_queue_properties(),&err);
+  if(err){
+    print_error("clCreateCommandQueue()",err);
+    exit(EXIT_FAILURE);
+  }
+
+  /* the bank is created once and stays resident */
+  float *h_filter = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+  filter_Gauss2dbank(h_filter,num_filters,filter_width);
+  struct gimc_bank bank;
+  err = gimc_bank_upload(&cl,&bank,h_filter,num_filters,filter_width);
+  free(h_filter);
+  if(err){
+    print_error("creating filter bank",err);
+    exit(EXIT_FAILURE);
+  }
+
+  struct slot *ring = calloc(ring_size,sizeof(struct slot));
+  for(unsigned int i = 0; i < ring_size; ++i){
+    ring[i].frame = malloc(frame_size);
+    ring[i].result = malloc(result_size);
+    ring[i].d_frame = clCreateBuffer(cl.context,CL_MEM_READ_ONLY,frame_size,NULL,&err);
+    if(!err){
+      ring[i].d_result = clCreateBuffer(cl.context,CL_MEM_WRITE_ONLY,result_size,NULL,&err);
+    }
+    if(err){
+      print_error("clCreateBuffer() ring",err);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* build the programs before the first frame so it isn't counted */
+  trace_begin("warm up");
+  err = engine_convolve(&cl,engine,ring[0].d_frame,width,height,&bank,ring[0].d_result,NULL);
+  clFinish(cl.commands);
+  trace_end();
+  if(err){
+    exit(EXIT_FAILURE);
+  }
+
+  frame_writer_open(stdout,reader.y4m,width,height*num_filters,reader.rate);
+
+  struct stream_stats stats = {0, 0, 0};
+  const uint64_t start = now();
+  unsigned long next = 0;
+  int failed = 0;
+  for(;; ++next){
+    struct slot *slot = &ring[next % ring_size];
+    /* the slot is free once the frame before it in the ring is written */
+    if(slot->busy && retire(slot,reader.y4m,result_size,&stats)){
+      failed = 1;
+      break;
+    }
+
+    trace_begin("read frame");
+    const int got = frame_reader_next(&reader,slot->frame);
+    trace_end();
+    if(!got){
+      break;
+    }
+    slot->start = now();
+
+    /* transfers are traced as the kernels are, a traced event belongs to
+     * the trace, so the one kept for retire is retained
+     */
+    cl_event uploaded, convolved;
+    cl_event *traced = trace_event("upload frame");
+    err = clEnqueueWriteBuffer(upload,slot->d_frame,CL_FALSE,0,frame_size,slot->frame,0,NULL,traced ? traced : &uploaded);
+    if(!err){
+      uploaded = traced ? *traced : uploaded;
+      err = clEnqueueBarrierWithWaitList(cl.commands,1,&uploaded,NULL);
+      if(!traced){
+        clReleaseEvent(uploaded);
+      }
+    }
+    if(!err){
+      err = engine_convolve(&cl,engine,slot->d_frame,width,height,&bank,slot->d_result,NULL);
+    }
+    if(!err){
+      err = clEnqueueMarkerWithWaitList(cl.commands,0,NULL,&convolved);
+    }
+    if(!err){
+      traced = trace_event("download result");
+      err = clEnqueueReadBuffer(download,slot->d_result,CL_FALSE,0,result_size,slot->result,1,&convolved,
+        traced ? traced : &slot->downloaded);
+      clReleaseEvent(convolved);
+    }
+    if(!err && traced){
+      slot->downloaded = *traced;
+      err = clRetainEvent(slot->downloaded);
+    }
+    if(err){
+      print_error("streaming frame",err);
+      failed = 1;
+      break;
+    }
+    slot->busy = 1;
+
+    /* start the work now rather than when the ring wraps around */
+    clFlush(upload);
+    clFlush(cl.commands);
+    clFlush(download);
+  }
+
+  /* write the frames still in flight, oldest first */
+  for(unsigned int i = 1; i <= ring_size; ++i){
+    struct slot *slot = &ring[(next + i) % ring_size];
+    if(slot->busy && retire(slot,reader.y4m,result_size,&stats)){
+      failed = 1;
+    }
+  }
+  fflush(stdout);
+  const double seconds = (now() - start)*1e-9;
+
+  fprintf(stderr,"%lu frames of %zux%zu, %u filters of width %u, %s engine, ring of %u\n",
+    stats.frames,width,height,num_filters,filter_width,engine_name(engine),ring_size);
+  if(stats.frames > 0){
+    fprintf(stderr,"%.2f frames/s, latency %.2f ms mean, %.2f ms max\n",
+      stats.frames/seconds,stats.latency_sum/stats.frames*1e3,stats.latency_max*1e3);
+  }
+
+  trace_finish();
+
+  for(unsigned int i = 0; i < ring_size; ++i){
+    free(ring[i].frame);
+    free(ring[i].result);
+    clReleaseMemObject(ring[i].d_frame);
+    clReleaseMemObject(ring[i].d_result);
+  }
+  free(ring);
+  gimc_bank_release(&bank);
+  clReleaseCommandQueue(upload);
+  clReleaseCommandQueue(download);
+  gimc_cl_release(&cl);
+  if(input != stdin){
+    fclose(input);
+  }
+  return failed ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,141 @@
+/* dilated banks and the à trous wavelet decomposition: dense equivalents of
+ * dilated filters against spacing the taps out by hand, the first smoothing
+ * against the B3 spline in 2d, and details and residual adding back up to
+ * the image. needs no OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "atrous.h"
+#include "filter.h"
+#include "native.h"
+#include "test_util.h"
+
+/* the dense bank against the dilated taps summed directly */
+static void check_dilated(unsigned int num_filters, unsigned int filter_width, size_t width, size_t height){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  float *bank = malloc(sizeof(float)*filter_len*num_filters);
+  unsigned int *dilations = malloc(sizeof(unsigned int)*num_filters);
+  filter_atrous_bank(bank,dilations,num_filters,filter_width);
+  for(unsigned int f = 0; f < num_filters; ++f){
+    CHECK(dilations[f] == 1u << f,"filter %u has a dilation of %u",f,dilations[f]);
+  }
+  const unsigned int dense_width = filter_dilated_width(dilations,num_filters,filter_width);
+  CHECK(dense_width == (filter_width - 1)*dilations[num_filters - 1] + 1,"dense width %u",dense_width);
+  CHECK(filter_dilated_width(NULL,num_filters,filter_width) == filter_width,"undilated width");
+  float *dense = malloc(sizeof(float)*dense_width*dense_width*num_filters);
+  filter_dilate_bank(dense,dense_width,bank,dilations,num_filters,filter_width);
+
+  uint8_t *image = malloc(width*height);
+  for(size_t i = 0; i < width*height; ++i){
+    image[i] = (uint8_t)((i*37 + (i/width)*11) % 256);
+  }
+  uint8_t *result = malloc(width*height*num_filters);
+  native_convolve2d(image,width,height,dense,num_filters,dense_width,result);
+
+  const long radius = (filter_width - 1)/2;
+  size_t mismatches = 0;
+  for(unsigned int f = 0; f < num_filters; ++f){
+    const float *filter = &bank[f*filter_len];
+    const long step = dilations[f];
+    for(long py = 0; py < (long)height; ++py){
+      for(long px = 0; px < (long)width; ++px){
+        /* applied backwards, zero outside the image */
+        double sum = 0.0;
+        for(long dy = -radius; dy <= radius; ++dy){
+          for(long dx = -radius; dx <= radius; ++dx){
+            const long row = py + dy*step;
+            const long col = px + dx*step;
+            if(row >= 0 && row < (long)height && col >= 0 && col < (long)width){
+              sum += image[row*width + col]*filter[(radius - dy)*filter_width + radius - dx];
+            }
+          }
+        }
+        const int expected = sum > 255.0 ? 255 : (int)sum;
+        mismatches += abs(result[f*width*height + py*width + px] - expected) > 1;
+      }
+    }
+  }
+  CHECK(mismatches == 0,"%u dilated filters of %u on %zux%zu have %zu mismatches",num_filters,filter_width,width,height,mismatches);
+  free(bank);
+  free(dilations);
+  free(dense);
+  free(image);
+  free(result);
+}
+
+static void check_decompose(size_t width, size_t height, unsigned int levels){
+  const size_t image_size = width*height;
+  uint8_t *image = malloc(image_size);
+  /* within 64..191 so no detail saturates */
+  for(size_t i = 0; i < image_size; ++i){
+    image[i] = 64 + (uint8_t)((i*7919 + (i/width)*31) % 128);
+  }
+  uint8_t *planes = malloc(image_size*(levels + 1));
+  CHECK(atrous_decompose(image,width,height,levels,planes) == 0,"%u levels refused",levels);
+
+  /* each plane is rounded once */
+  size_t mismatches = 0;
+  for(size_t i = 0; i < image_size; ++i){
+    int sum = planes[levels*image_size + i];
+    for(unsigned int l = 0; l < levels; ++l){
+      sum += planes[l*image_size + i] - ATROUS_DETAIL_OFFSET;
+    }
+    mismatches += fabs((double)sum - image[i]) > 0.5*(levels + 1);
+  }
+  CHECK(mismatches == 0,"%u levels on %zux%zu add up wrong at %zu pixels",levels,width,height,mismatches);
+
+  /* a single level smooths with the B3 spline in 2d, mirrored at the borders */
+  CHECK(atrous_decompose(image,width,height,1,planes) == 0,"1 level refused");
+  mismatches = 0;
+  for(long y = 0; y < (long)height; ++y){
+    for(long x = 0; x < (long)width; ++x){
+      double sum = 0.0;
+      for(long i = 0; i < ATROUS_TAPS; ++i){
+        for(long j = 0; j < ATROUS_TAPS; ++j){
+          const long row = atrous_mirror(y + i - ATROUS_TAPS/2,height);
+          const long col = atrous_mirror(x + j - ATROUS_TAPS/2,width);
+          sum += ATROUS_B3[i]*ATROUS_B3[j]*image[row*width + col];
+        }
+      }
+      mismatches += fabs(planes[image_size + y*width + x] - sum) > 0.5 + 1e-3;
+    }
+  }
+  CHECK(mismatches == 0,"smoothing of %zux%zu is wrong at %zu pixels",width,height,mismatches);
+  free(image);
+  free(planes);
+}
+
+int main(void){
+  check_dilated(4,3,37,23);
+  check_dilated(3,5,20,41);
+  check_dilated(1,1,5,3);
+
+  const size_t sizes[][2] = {{1,1}, {2,7}, {17,31}, {64,40}};
+  for(size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s){
+    for(unsigned int levels = 1; levels <= 6; levels += 5){
+      check_decompose(sizes[s][0],sizes[s][1],levels);
+    }
+  }
+
+  /* flat images have no detail at any level */
+  uint8_t flat[9*5];
+  uint8_t planes[9*5*5];
+  memset(flat,77,sizeof(flat));
+  atrous_decompose(flat,9,5,4,planes);
+  int flat_ok = 1;
+  for(size_t i = 0; i < sizeof(planes); ++i){
+    flat_ok &= planes[i] == (i < 4*sizeof(flat) ? ATROUS_DETAIL_OFFSET : 77);
+  }
+  CHECK(flat_ok,"a flat image has details");
+
+  CHECK(atrous_mirror(-1,5) == 1 && atrous_mirror(5,5) == 3 && atrous_mirror(-9,5) == 1 && atrous_mirror(12,5) == 4,"mirror");
+  CHECK(atrous_mirror(7,1) == 0,"mirror of a single pixel");
+  CHECK(atrous_decompose(flat,9,5,0,planes) != 0 && atrous_decompose(flat,9,5,ATROUS_MAX_LEVELS + 1,planes) != 0,
+    "levels out of range");
+
+  return test_status();
+}
@@ -0,0 +1,262 @@
+/* bank files: writing and mapping them back, the shapes and flags of
+ * their filters in the rectangles engines run, and files which are not
+ * valid. needs no OpenCL
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bankfile.h"
+#include "filter.h"
+#include "native.h"
+#include "test_util.h"
+
+#define PATH "test_bankfile.gbank"
+
+/* a filter of a bank at width in the square of side at x,y from its center */
+static float at(const float *bank, unsigned int filter, unsigned int width, int x, int y){
+  const int center = (width - 1)/2;
+  return bank[(size_t)filter*width*width + (center + y)*width + center + x];
+}
+
+static void check_shapes(void){
+  /* a dense 3x3, a separable 5x1 row, an even 4x2 without its mean and a
+   * separable 1x7 column normalized
+   */
+  const struct bankfile_record records[4] = {
+    {3, 3, 0, 0},
+    {5, 1, BANKFILE_SEPARABLE, 0},
+    {4, 2, BANKFILE_ZERO_MEAN, 0},
+    {1, 7, BANKFILE_SEPARABLE | BANKFILE_NORMALIZE, 0}
+  };
+  float weights[9 + 6 + 8 + 8];
+  for(int i = 0; i < 9; ++i){
+    weights[i] = i + 1;
+  }
+  const float row[6] = {1, 2, 3, 2, 1, 2};
+  memcpy(&weights[9],row,sizeof(row));
+  for(int i = 0; i < 8; ++i){
+    weights[15 + i] = i;
+  }
+  weights[23] = 1;
+  for(int i = 0; i < 7; ++i){
+    weights[24 + i] = i < 3 ? 1 : 2;
+  }
+  CHECK(bankfile_write(PATH,records,4,weights) == 0,"writing " PATH);
+
+  struct bankfile file;
+  if(bankfile_open(&file,PATH)){
+    CHECK(0,"mapping " PATH);
+    return;
+  }
+  CHECK(file.num_filters == 4 && file.num_weights == 31,"%u filters and %zu weights",file.num_filters,file.num_weights);
+  CHECK(file.records[2].offset == 15 && file.records[3].offset == 23,"offsets %u and %u",file.records[2].offset,file.records[3].offset);
+
+  unsigned int widths[4], heights[4];
+  const unsigned int widest = bankfile_widths(&file,widths,heights);
+  CHECK(widest == 7 && widths[0] == 3 && widths[1] == 5 && widths[2] == 5 && widths[3] == 1,"widths %u %u %u %u, widest %u",
+    widths[0],widths[1],widths[2],widths[3],widest);
+  CHECK(heights[0] == 3 && heights[1] == 1 && heights[2] == 3 && heights[3] == 7,"heights %u %u %u %u",
+    heights[0],heights[1],heights[2],heights[3]);
+  float bank[4*7*7];
+  bankfile_bank(&file,bank,widest);
+
+  double total[4] = {0, 0, 0, 0};
+  for(unsigned int f = 0; f < 4; ++f){
+    for(int i = 0; i < 49; ++i){
+      total[f] += bank[f*49 + i];
+    }
+  }
+  CHECK(at(bank,0,7,-1,-1) == 1 && at(bank,0,7,1,1) == 9 && total[0] == 45,"dense 3x3 misplaced");
+  CHECK(at(bank,1,7,-2,0) == 2 && at(bank,1,7,0,0) == 6 && total[1] == 18 && at(bank,1,7,0,1) == 0,"separable row misplaced");
+  /* 4x2 in a square of 5 sits at columns -2..1 and rows -1..0 */
+  CHECK(fabs(total[2]) < 1e-5 && fabsf(at(bank,2,7,-2,-1) + 3.5f) < 1e-5f && fabsf(at(bank,2,7,1,0) - 3.5f) < 1e-5f,
+    "zero mean 4x2 sums to %g",total[2]);
+  CHECK(fabs(total[3] - 1.0) < 1e-6 && fabsf(at(bank,3,7,0,-3) - 1.0f/11) < 1e-6f && at(bank,3,7,1,0) == 0,
+    "normalized column sums to %g",total[3]);
+  bankfile_close(&file);
+}
+
+/* a filter without its mean sums to zero, normalizing it scales its
+ * absolute weights to sum to 1
+ */
+static void check_zero_mean_normalized(void){
+  const struct bankfile_record record = {3, 1, BANKFILE_ZERO_MEAN | BANKFILE_NORMALIZE, 0};
+  const float weights[3] = {1, 2, 6};
+  CHECK(bankfile_write(PATH,&record,1,weights) == 0,"writing " PATH);
+  struct bankfile file;
+  if(bankfile_open(&file,PATH)){
+    CHECK(0,"mapping " PATH);
+    return;
+  }
+  float bank[3*3];
+  bankfile_bank(&file,bank,3);
+  double total = 0.0, absolute = 0.0;
+  for(int i = 0; i < 9; ++i){
+    total += bank[i];
+    absolute += fabs(bank[i]);
+  }
+  /* 1, 2, 6 less their mean of 3, over 6 */
+  CHECK(fabs(total) < 1e-6 && fabs(absolute - 1.0) < 1e-6 && fabsf(at(bank,0,3,-1,0) + 1.0f/3) < 1e-6f &&
+    fabsf(at(bank,0,3,1,0) - 0.5f) < 1e-6f,"zero mean row normalized to a sum of %g and %g absolute",total,absolute);
+  bankfile_close(&file);
+}
+
+/* the separable Gaussians Bankgen writes are those of filter_Gauss2dbank_adaptive */
+static void check_gaussians(void){
+  const unsigned int num_filters = 6;
+  unsigned int widths[6];
+  const unsigned int widest = filter_adaptive_widths(widths,num_filters,FILTER_ADAPTIVE_EPSILON,25);
+  struct bankfile_record records[6];
+  float *weights = malloc(sizeof(float)*2*widest*num_filters);
+  size_t offset = 0;
+  for(unsigned int f = 0; f < num_filters; ++f){
+    const float sigma = filter_Gauss2dbank_sigma(f,num_filters);
+    records[f].width = records[f].height = widths[f];
+    records[f].flags = BANKFILE_SEPARABLE | BANKFILE_NORMALIZE;
+    for(unsigned int i = 0; i < widths[f]; ++i){
+      const float x = (float)i - (widths[f] - 1)/2;
+      weights[offset + i] = weights[offset + widths[f] + i] = expf(-x*x/(2*sigma*sigma));
+    }
+    offset += 2*widths[f];
+  }
+  CHECK(bankfile_write(PATH,records,num_filters,weights) == 0,"writing " PATH);
+  free(weights);
+
+  struct bankfile file;
+  if(bankfile_open(&file,PATH)){
+    CHECK(0,"mapping " PATH);
+    return;
+  }
+  unsigned int file_widths[6], file_heights[6];
+  CHECK(bankfile_widths(&file,file_widths,file_heights) == widest,"file is not as wide as the adaptive bank");
+  const size_t len = (size_t)widest*widest*num_filters;
+  float *loaded = malloc(sizeof(float)*len);
+  float *expected = malloc(sizeof(float)*len);
+  bankfile_bank(&file,loaded,widest);
+  filter_Gauss2dbank_adaptive(expected,widths,num_filters,widest);
+  float worst = 0.0f;
+  for(size_t i = 0; i < len; ++i){
+    worst = fmaxf(worst,fabsf(loaded[i] - expected[i]));
+  }
+  CHECK(worst < 1e-6f,"separable Gaussians differ by %g",worst);
+  free(loaded);
+  free(expected);
+  bankfile_close(&file);
+}
+
+/* thin filters run in their rectangles, which give native_convolve2d of
+ * the square of the widest side
+ */
+static void check_rectangles(void){
+  const unsigned int num_filters = 3;
+  const struct bankfile_record records[3] = {
+    {3, 49, 0, 0},
+    {49, 3, BANKFILE_ZERO_MEAN | BANKFILE_NORMALIZE, 0},
+    {5, 5, BANKFILE_NORMALIZE, 0}
+  };
+  float weights[3*49 + 49*3 + 5*5];
+  for(int i = 0; i < 3*49; ++i){
+    /* asymmetric, which catches filters taken forwards */
+    weights[i] = (i % 7 + 1)/64.0f;
+    weights[3*49 + i] = i % 11;
+  }
+  for(int i = 0; i < 5*5; ++i){
+    weights[2*3*49 + i] = i + 1;
+  }
+  CHECK(bankfile_write(PATH,records,num_filters,weights) == 0,"writing " PATH);
+  struct bankfile file;
+  if(bankfile_open(&file,PATH)){
+    CHECK(0,"mapping " PATH);
+    return;
+  }
+  unsigned int widths[3], heights[3];
+  const unsigned int widest = bankfile_widths(&file,widths,heights);
+  CHECK(widest == 49 && widths[0] == 3 && heights[0] == 49 && widths[1] == 49 && heights[1] == 3,
+    "a 3x49 and a 49x3 run in %ux%u and %ux%u, widest %u",widths[0],heights[0],widths[1],heights[1],widest);
+  const size_t filter_len = (size_t)widest*widest;
+  float *bank = malloc(sizeof(float)*filter_len*num_filters);
+  float *packed = malloc(sizeof(float)*filter_len*num_filters);
+  size_t offsets[3];
+  bankfile_bank(&file,bank,widest);
+  filter_pack_bank(packed,offsets,bank,widths,heights,num_filters,widest);
+  bankfile_close(&file);
+
+  const size_t sizes[][2] = {{1,1}, {5,3}, {17,61}, {67,31}};
+  for(size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s){
+    const size_t width = sizes[s][0], height = sizes[s][1];
+    const size_t image_size = width*height;
+    uint8_t *image = malloc(image_size);
+    uint8_t *expected = malloc(image_size*num_filters);
+    uint8_t *result = malloc(image_size);
+    test_image(image,width,height,s % NUM_TEST_PATTERNS,s);
+    native_convolve2d(image,width,height,bank,num_filters,widest,expected);
+    for(unsigned int f = 0; f < num_filters; ++f){
+      native_convolve2d_rect(image,width,height,&packed[offsets[f]],1,widths[f],heights[f],result);
+      size_t mismatches = 0;
+      for(size_t i = 0; i < image_size; ++i){
+        mismatches += result[i] != expected[f*image_size + i];
+      }
+      CHECK(mismatches == 0,"%ux%u filter on %zux%zu has %zu mismatches",widths[f],heights[f],width,height,mismatches);
+    }
+    free(image);
+    free(expected);
+    free(result);
+  }
+  free(bank);
+  free(packed);
+}
+
+/* write raw bytes and expect them to be refused */
+static void check_refused(const void *bytes, size_t size, const char *what){
+  FILE *out = fopen(PATH,"wb");
+  fwrite(bytes,1,size,out);
+  fclose(out);
+  struct bankfile file;
+  const int refused = bankfile_open(&file,PATH) != 0;
+  CHECK(refused,"%s is mapped",what);
+  if(!refused){
+    bankfile_close(&file);
+  }
+}
+
+static void check_invalid(void){
+  uint8_t bytes[16 + 16 + 4*4];
+  memset(bytes,0,sizeof(bytes));
+  memcpy(bytes,BANKFILE_MAGIC,8);
+  const uint32_t one = 1;
+  memcpy(bytes + 8,&one,4);
+  struct bankfile_record record = {2, 2, 0, 0};
+  memcpy(bytes + 16,&record,sizeof(record));
+
+  check_refused(bytes,8,"a short header");
+  check_refused(bytes,16 + 16 + 3*4,"a filter past the end");
+  record.flags = 8;
+  memcpy(bytes + 16,&record,sizeof(record));
+  check_refused(bytes,sizeof(bytes),"an unknown flag");
+  record.flags = 0;
+  record.width = 0;
+  memcpy(bytes + 16,&record,sizeof(record));
+  check_refused(bytes,sizeof(bytes),"an empty filter");
+  record.width = 2;
+  record.offset = 0xffffffffu;
+  memcpy(bytes + 16,&record,sizeof(record));
+  check_refused(bytes,sizeof(bytes),"an offset past the end");
+  record.offset = 0;
+  memcpy(bytes + 16,&record,sizeof(record));
+  bytes[0] = 'X';
+  check_refused(bytes,sizeof(bytes),"a wrong magic");
+}
+
+int main(void){
+  check_shapes();
+  check_zero_mean_normalized();
+  check_gaussians();
+  check_rectangles();
+  check_invalid();
+  remove(PATH);
+
+  return test_status();
+}
@@ -0,0 +1,156 @@
+/* the memory budget planner: plans fit their budget and leave the rest to
+ * scratch, whole images and banks are kept when they fit, bands cover every row once and results
+ * assembled from bands and chunks match the whole result. needs no OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "budget.h"
+#include "filter.h"
+#include "native.h"
+#include "test_util.h"
+
+/* bytes a plan takes on the device and the host, as the tools allocate them */
+static void plan_bytes(const struct budget_plan *plan, size_t width, size_t height, unsigned int num_filters,
+  unsigned int filter_width, size_t *device, size_t *host, size_t *largest){
+  const size_t filter_bytes = sizeof(float)*filter_width*filter_width;
+  size_t band_height = plan->num_bands > 1 ? plan->band_rows + 2*plan->halo : height;
+  band_height = band_height < height ? band_height : height;
+  *largest = band_height*width*plan->chunk_filters;
+  *device = width*height + num_filters*filter_bytes + *largest;
+  if(plan->num_bands > 1){
+    *device += band_height*width;
+  }
+  if(plan->num_chunks > 1){
+    *device += plan->chunk_filters*filter_bytes;
+  }
+  *host = width*height*plan->chunk_filters*(plan->num_chunks > 1 ? 2 : 1);
+}
+
+static void check_plan(const struct gimc_budget *budget, size_t width, size_t height, unsigned int num_filters,
+  unsigned int filter_width, int split_bank, int split_rows){
+  struct budget_plan plan;
+  if(budget_plan(budget,width,height,num_filters,filter_width,split_bank,split_rows,&plan)){
+    CHECK(0,"%u filters of %u on %zux%zu do not fit",num_filters,filter_width,width,height);
+    return;
+  }
+  size_t device, host, largest;
+  plan_bytes(&plan,width,height,num_filters,filter_width,&device,&host,&largest);
+  CHECK(device <= budget->device_bytes,"plan takes %zu of %zu device bytes",device,budget->device_bytes);
+  CHECK(host <= budget->host_bytes,"plan takes %zu of %zu host bytes",host,budget->host_bytes);
+  CHECK(largest <= budget->max_alloc,"plan allocates %zu of %zu",largest,budget->max_alloc);
+  const size_t scratch = budget_scratch(budget,&plan,width,height,num_filters,filter_width);
+  CHECK(device + scratch <= budget->device_bytes && scratch <= budget->max_alloc &&
+    (device + scratch == budget->device_bytes || scratch == budget->max_alloc),
+    "plan takes %zu of %zu device bytes and leaves %zu to scratch",device,budget->device_bytes,scratch);
+  CHECK((size_t)plan.chunk_filters*plan.num_chunks >= num_filters &&
+    (size_t)plan.chunk_filters*(plan.num_chunks - 1) < num_filters,
+    "%u chunks of %u for %u filters",plan.num_chunks,plan.chunk_filters,num_filters);
+  CHECK(split_bank || plan.num_chunks == 1,"bank split into %u chunks",plan.num_chunks);
+  CHECK(split_rows || plan.num_bands == 1,"image split into %zu bands",plan.num_bands);
+
+  /* every row is kept by exactly one band, with the rows the filters reach */
+  size_t next = 0;
+  for(size_t band = 0; band < plan.num_bands; ++band){
+    size_t first, count, convolved, convolved_count;
+    budget_band(&plan,height,band,&first,&count,&convolved,&convolved_count);
+    CHECK(first == next && count > 0,"band %zu keeps %zu rows from %zu",band,count,first);
+    CHECK(convolved + plan.halo >= first || convolved == 0,"band %zu starts %zu rows early",band,first - convolved);
+    const size_t end = convolved + convolved_count;
+    CHECK(end == height || end >= first + count + plan.halo,"band %zu ends at %zu",band,end);
+    next = first + count;
+  }
+  CHECK(next == height,"bands end at row %zu of %zu",next,height);
+}
+
+/* a result assembled chunk by chunk and band by band as the tools do */
+static void check_assembled(size_t width, size_t height, unsigned int num_filters, unsigned int filter_width,
+  size_t room){
+  const size_t image_size = width*height;
+  uint8_t *image = malloc(image_size);
+  for(size_t i = 0; i < image_size; ++i){
+    image[i] = (uint8_t)((i*37 + (i/width)*11) ^ (i >> 3));
+  }
+  float *bank = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+  filter_Gauss2dbank(bank,num_filters,filter_width);
+  uint8_t *whole = malloc(image_size*num_filters);
+  native_convolve2d(image,width,height,bank,num_filters,filter_width,whole);
+
+  /* room past the image and bank for less than a plane */
+  struct gimc_budget budget;
+  budget.device_bytes = image_size + sizeof(float)*filter_width*filter_width*num_filters + room;
+  budget.max_alloc = budget.device_bytes;
+  budget.host_bytes = 2*2*image_size;
+  struct budget_plan plan;
+  if(budget_plan(&budget,width,height,num_filters,filter_width,1,1,&plan)){
+    CHECK(0,"no plan for %zux%zu",width,height);
+    free(image);
+    free(bank);
+    free(whole);
+    return;
+  }
+  CHECK(plan.num_chunks > 1 && plan.num_bands > 1,"plan of %u chunks and %zu bands is not split",plan.num_chunks,plan.num_bands);
+
+  uint8_t *assembled = malloc(image_size*num_filters);
+  uint8_t *band_result = malloc(image_size*plan.chunk_filters);
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  for(unsigned int chunk = 0; chunk < plan.num_chunks; ++chunk){
+    const unsigned int first_filter = chunk*plan.chunk_filters;
+    const unsigned int filters = num_filters - first_filter < plan.chunk_filters ? num_filters - first_filter : plan.chunk_filters;
+    for(size_t band = 0; band < plan.num_bands; ++band){
+      size_t first, count, convolved, convolved_count;
+      budget_band(&plan,height,band,&first,&count,&convolved,&convolved_count);
+      native_convolve2d(&image[convolved*width],width,convolved_count,&bank[first_filter*filter_len],filters,filter_width,band_result);
+      for(unsigned int i = 0; i < filters; ++i){
+        memcpy(&assembled[(first_filter + i)*image_size + first*width],
+          &band_result[i*convolved_count*width + (first - convolved)*width],count*width);
+      }
+    }
+  }
+  CHECK(memcmp(assembled,whole,image_size*num_filters) == 0,
+    "%zux%zu with %u filters of %u differs when assembled from %u chunks and %zu bands",
+    width,height,num_filters,filter_width,plan.num_chunks,plan.num_bands);
+
+  free(image);
+  free(bank);
+  free(whole);
+  free(assembled);
+  free(band_result);
+}
+
+int main(void){
+  /* everything fits in a large budget */
+  struct gimc_budget large = {(size_t)4 << 30,(size_t)1 << 30,(size_t)8 << 30};
+  struct budget_plan plan;
+  CHECK(budget_plan(&large,1024,768,49,15,1,1,&plan) == 0 && plan.num_chunks == 1 && plan.num_bands == 1 && plan.halo == 0,
+    "1024x768 with 49 filters is split in a large budget");
+
+  /* a 50 megapixel image with 49 filters is split into chunks of whole planes */
+  struct gimc_budget gpu = {(size_t)1536 << 20,(size_t)512 << 20,(size_t)1 << 30};
+  CHECK(budget_plan(&gpu,8192,6144,49,49,1,1,&plan) == 0 && plan.num_chunks > 1 && plan.num_bands == 1,
+    "50 megapixels with 49 filters planned as %u chunks and %zu bands",plan.num_chunks,plan.num_bands);
+  check_plan(&gpu,8192,6144,49,49,1,1);
+
+  /* allocations smaller than a band of every filter split the rows */
+  struct gimc_budget small_alloc = {(size_t)1536 << 20,(size_t)64 << 20,(size_t)1 << 30};
+  check_plan(&small_alloc,8192,6144,49,49,1,1);
+
+  /* the whole bank, and whole columns */
+  check_plan(&gpu,4096,3072,49,49,0,1);
+  check_plan(&gpu,4096,3072,49,49,1,0);
+  CHECK(budget_plan(&gpu,8192,6144,49,49,0,0,&plan) != 0,"whole bank and image fit in %zu bytes",gpu.device_bytes);
+
+  /* the host holds two chunks, less than a plane does not fit */
+  struct gimc_budget small_host = {(size_t)4 << 30,(size_t)1 << 30,(size_t)100 << 20};
+  check_plan(&small_host,4096,4096,49,9,1,1);
+  CHECK(budget_plan(&small_host,16384,16384,4,9,1,1,&plan) != 0,"a plane larger than the host budget fits");
+
+  /* assembled results are exact at the borders of bands */
+  check_assembled(61,97,5,7,5000);
+  check_assembled(40,64,4,1,2000);
+  check_assembled(33,200,3,15,6000);
+
+  return test_status();
+}
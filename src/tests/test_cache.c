@@ -0,0 +1,136 @@
+/* the result cache returns what was stored under a key, nothing for other
+ * keys, and evicts the least recently used results past its size. results
+ * of approximate engines are not served to exact ones
+ */
+
+#define _DEFAULT_SOURCE /* mkdtemp */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "hash.h"
+#include "tool.h"
+#include "test_util.h"
+
+static struct result_key make_key(uint64_t image){
+  struct result_key key;
+  memset(&key,0,sizeof(key));
+  key.image = image;
+  key.bank = 42;
+  key.width = 64;
+  key.height = 32;
+  key.num_filters = 2;
+  key.filter_width = 7;
+  key.border = CACHE_BORDER_ZERO;
+  key.output = CACHE_OUTPUT_U8;
+  return key;
+}
+
+int main(void){
+  char directory[] = "/tmp/gimc_cache_XXXXXX";
+  if(mkdtemp(directory) == NULL){
+    perror("mkdtemp");
+    return EXIT_FAILURE;
+  }
+
+  /* room for two results of 64*32*2 bytes and their headers */
+  const size_t result_size = 64*32*2;
+  struct result_cache *cache = result_cache_open(directory,2*(result_size + 64));
+  CHECK(cache != NULL,"opening %s",directory);
+
+  uint8_t *planes = malloc(result_size);
+  for(size_t i = 0; i < result_size; ++i){
+    planes[i] = i*7;
+  }
+
+  /* hashes tell apart inputs which differ in one byte */
+  const uint64_t hash = gimc_hash64(planes,result_size,0);
+  planes[result_size/2] ^= 1;
+  CHECK(gimc_hash64(planes,result_size,0) != hash,"hash missed a changed byte");
+  planes[result_size/2] ^= 1;
+  CHECK(gimc_hash64(planes,result_size,0) == hash,"hash is not deterministic");
+
+  struct result_key key = make_key(hash);
+  struct cached_result cached;
+  CHECK(result_cache_lookup(cache,&key,&cached) != 0,"hit in an empty cache");
+  CHECK(result_cache_store(cache,&key,planes) == 0,"storing");
+  CHECK(result_cache_lookup(cache,&key,&cached) == 0,"miss after storing");
+  if(test_failures == 0){
+    CHECK(memcmp(cached.planes,planes,result_size) == 0,"cached planes differ");
+    result_cache_release(&cached);
+  }
+
+  struct result_key other = key;
+  other.filter_width = 9;
+  CHECK(result_cache_lookup(cache,&other,&cached) != 0,"hit for another filter width");
+  other = key;
+  other.top_down = 1;
+  CHECK(result_cache_lookup(cache,&other,&cached) != 0,"hit for another row order");
+
+  /* a third result evicts the oldest. modification times have a resolution
+   * of a second, so age the first one explicitly
+   */
+  sleep(1);
+  struct result_key second = make_key(hash + 1);
+  struct result_key third = make_key(hash + 2);
+  result_cache_store(cache,&second,planes);
+  sleep(1);
+  result_cache_store(cache,&third,planes);
+  CHECK(result_cache_lookup(cache,&key,&cached) != 0,"oldest result was not evicted");
+  CHECK(result_cache_lookup(cache,&third,&cached) == 0,"newest result was evicted");
+  if(test_failures == 0){
+    result_cache_release(&cached);
+  }
+
+  /* exact engines share results, approximate ones keep theirs apart and
+   * apart from themselves at another accuracy
+   */
+  struct result_key exact = make_key(hash + 3);
+  tool_key_engine(&exact,ENGINE_LWF_FUSED);
+  other = make_key(hash + 3);
+  CHECK(memcmp(&exact,&other,sizeof(other)) == 0,"exact engines have keys of their own");
+  struct result_key approximate = exact;
+  tool_key_engine(&approximate,ENGINE_SAT);
+  CHECK(result_cache_store(cache,&approximate,planes) == 0,"storing approximate");
+  CHECK(result_cache_lookup(cache,&exact,&cached) != 0,"approximate result served to an exact engine");
+  CHECK(result_cache_lookup(cache,&approximate,&cached) == 0,"approximate result missed");
+  if(test_failures == 0){
+    result_cache_release(&cached);
+  }
+  setenv("GIMC_SAT_PASSES","1",1);
+  other = exact;
+  tool_key_engine(&other,ENGINE_SAT);
+  CHECK(result_cache_lookup(cache,&other,&cached) != 0,"approximate result served at another accuracy");
+  unsetenv("GIMC_SAT_PASSES");
+  other = exact;
+  tool_key_engine(&other,ENGINE_MULTIRATE);
+  CHECK(memcmp(&other,&exact,sizeof(other)) != 0 && memcmp(&other,&approximate,sizeof(other)) != 0,
+    "multirate shares a key");
+  approximate = other;
+  setenv("GIMC_MULTIRATE_ERROR","0.001",1);
+  other = exact;
+  tool_key_engine(&other,ENGINE_MULTIRATE);
+  CHECK(memcmp(&other,&approximate,sizeof(other)) != 0,"multirate key ignores its target");
+  unsetenv("GIMC_MULTIRATE_ERROR");
+  other = exact;
+  tool_key_engine(&other,ENGINE_SPARSE);
+  CHECK(memcmp(&other,&exact,sizeof(other)) == 0,"sparse taps without a threshold have a key of their own");
+  setenv("GIMC_SPARSE_THRESHOLD","0.01",1);
+  tool_key_engine(&other,ENGINE_SPARSE);
+  CHECK(memcmp(&other,&exact,sizeof(other)) != 0,"sparse key ignores its threshold");
+  unsetenv("GIMC_SPARSE_THRESHOLD");
+
+  result_cache_close(cache);
+  free(planes);
+
+  /* clean up, the directory only holds cache files */
+  char command[256];
+  snprintf(command,sizeof(command),"rm -rf %s",directory);
+  if(system(command) != 0){
+    fprintf(stderr,"could not remove %s\n",directory);
+  }
+
+  return test_status();
+}
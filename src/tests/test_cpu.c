@@ -0,0 +1,71 @@
+/* the width specialized host instances against native_convolve2d, on the
+ * widths with an instance and around them. needs no OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "filter.h"
+#include "native.h"
+#include "test_util.h"
+
+static const char *accumulator_names[NUM_CPU_ACCUMULATORS] = {"float", "double"};
+
+/* float sums take the taps in the order of the reference and match it,
+ * double ones round apart by up to a level
+ */
+static const int tolerances[NUM_CPU_ACCUMULATORS] = {0, 1};
+
+static void check_width(unsigned int filter_width, size_t width, size_t height, unsigned int seed){
+  const unsigned int num_filters = 3;
+  const size_t image_size = width*height;
+  uint8_t *image = malloc(image_size);
+  float *bank = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+  uint8_t *expected = malloc(image_size*num_filters);
+  uint8_t *result = malloc(image_size*num_filters);
+  test_image(image,width,height,seed % NUM_TEST_PATTERNS,seed);
+  filter_Gauss2dbank(bank,num_filters,filter_width);
+  /* an asymmetric filter catches taps taken forwards */
+  for(unsigned int i = 0; i < filter_width*filter_width; ++i){
+    bank[2*filter_width*filter_width + i] = (i % 3)/(float)(filter_width*filter_width);
+  }
+  native_convolve2d(image,width,height,bank,num_filters,filter_width,expected);
+
+  for(int a = 0; a < NUM_CPU_ACCUMULATORS; ++a){
+    memset(result,0,image_size*num_filters);
+    cpu_convolve2d_accumulate(a,image,width,height,bank,num_filters,filter_width,result);
+    size_t mismatches = 0;
+    for(size_t i = 0; i < image_size*num_filters; ++i){
+      mismatches += abs(result[i] - expected[i]) > tolerances[a];
+    }
+    CHECK(mismatches == 0,"%s sums of width %u on %zux%zu have %zu mismatches",
+      accumulator_names[a],filter_width,width,height,mismatches);
+  }
+  free(image);
+  free(bank);
+  free(expected);
+  free(result);
+}
+
+int main(void){
+  /* both tiles, with and without a partial one at the end of a row */
+  const size_t sizes[][2] = {{1,1}, {5,3}, {3,5}, {CPU_TILE_NARROW,7}, {17,31}, {CPU_TILE_WIDE - 1,9}, {CPU_TILE_WIDE,5},
+    {CPU_TILE_WIDE + 1,9}, {131,67}};
+  const unsigned int widths[] = {1, 2, 3, 4, 5, 9, 25, 49, 51};
+  unsigned int seed = 0;
+  for(size_t w = 0; w < sizeof(widths)/sizeof(widths[0]); ++w){
+    for(size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s){
+      check_width(widths[w],sizes[s][0],sizes[s][1],seed++);
+    }
+  }
+
+  /* every width of the sweep has an instance, others fall back */
+  for(unsigned int width = CPU_MIN_WIDTH; width <= CPU_MAX_WIDTH; width += 2){
+    CHECK(cpu_is_specialized(width),"width %u has no instance",width);
+  }
+  CHECK(!cpu_is_specialized(1) && !cpu_is_specialized(4) && !cpu_is_specialized(CPU_MAX_WIDTH + 2),"widths outside the sweep");
+
+  return test_status();
+}
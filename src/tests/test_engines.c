@@ -0,0 +1,565 @@
+/* golden reference tests of the engines
+ * every engine runs on the CPU OpenCL device over several image sizes,
+ * filter widths and banks, and its results have to be within TOLERANCE
+ * of native_convolve2d. the device Gaussian bank is checked against the
+ * host one. the sat and multirate engines approximate filters, their
+ * results are held to the bounds their plans give, and those of sparse to
+ * the weights it drops. banks of derivatives of Gaussian, whose results
+ * go negative and have to saturate, run on every linear engine, and
+ * epilogues only on lwf. the rank engines have to match native_rank2d.
+ * dilated banks run on atrous and, as their dense equivalent, on lwf, and
+ * the wavelet decomposition has to be within one of atrous_decompose
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "atrous.h"
+#include "choose.h"
+#include "epilogue.h"
+#include "multirate.h"
+#include "native.h"
+#include "rank.h"
+#include "sat.h"
+#include "sparse.h"
+#include "filter.h"
+#include "trace.h"
+#include "test_util.h"
+
+/* engines sum in different orders, which can move a truncated result by one */
+#define TOLERANCE 1
+
+enum test_bank{
+  BANK_GAUSS, /* filter_Gauss2dbank with one filter */
+  BANK_GAUSS_MANY, /* filter_Gauss2dbank with four filters */
+  BANK_TAPS, /* impulses in the first, center and last cells */
+  BANK_BOX, /* a box filter */
+  BANK_STEERED, /* steered_gauss made by gimc_bank_steerable */
+  NUM_TEST_BANKS
+};
+
+static const char *bank_names[NUM_TEST_BANKS] = {"gauss", "gauss x4", "taps", "box", "steered"};
+
+/* Gaussians as the steerable engine runs them, from its basis */
+static const struct filter_steerable steered_gauss = {2, {1, 0, 0}};
+
+static unsigned int make_bank(float *bank, enum test_bank kind, unsigned int filter_width){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  switch(kind){
+  case BANK_GAUSS:
+    filter_Gauss2dbank(bank,1,filter_width);
+    return 1;
+  case BANK_GAUSS_MANY:
+    filter_Gauss2dbank(bank,4,filter_width);
+    return 4;
+  case BANK_TAPS:
+    memset(bank,0,sizeof(float)*3*filter_len);
+    bank[0] = 1.0f;
+    bank[filter_len + (filter_len - 1)/2] = 1.0f;
+    bank[3*filter_len - 1] = 1.0f;
+    return 3;
+  case BANK_STEERED:
+    filter_steerable_bank(bank,&steered_gauss,filter_width);
+    return filter_steerable_count(&steered_gauss);
+  case BANK_BOX:
+  default:
+    for(size_t i = 0; i < filter_len; ++i){
+      bank[i] = 1.0f/filter_len;
+    }
+    return 1;
+  }
+}
+
+/* largest difference allowed from the reference
+ * an approximation differing from a filter by a sum of absolute weights e
+ * moves an 8 bit result by at most 255*e
+ */
+static int tolerance_of(enum engine_id engine, const struct gimc_bank *bank){
+  if(!engine_is_linear(engine)){
+    return 0;
+  }
+  int tolerance = TOLERANCE;
+  const size_t filter_len = (size_t)bank->width*bank->width;
+  for(unsigned int f = 0; f < bank->num_filters; ++f){
+    int bound = TOLERANCE;
+    if(engine == ENGINE_SAT){
+      struct sat_plan plan;
+      sat_plan_filter(&bank->weights[f*filter_len],bank->width,sat_passes(),&plan);
+      /* passes round to fixed point in between */
+      bound = plan.exact ? TOLERANCE : TOLERANCE + 1 + (int)ceil(255.0*plan.error);
+    }else if(engine == ENGINE_MULTIRATE){
+      struct multirate_plan plan;
+      multirate_plan_filter(&bank->weights[f*filter_len],bank->width,multirate_target(),&plan);
+      bound = TOLERANCE + (int)ceil(255.0*plan.error);
+      multirate_plan_release(&plan);
+    }else if(engine == ENGINE_SPARSE){
+      struct sparse_bank sparse;
+      sparse_from_bank(&bank->weights[f*filter_len],1,bank->width,sparse_threshold(),&sparse);
+      bound = TOLERANCE + (int)ceil(255.0*sparse.errors[0]);
+      sparse_release(&sparse);
+    }
+    if(bound > tolerance){
+      tolerance = bound;
+    }
+  }
+  return tolerance;
+}
+
+/* compare an engine against the reference, returns the number of failures */
+static int check_engine(struct gimc_cl *cl, enum engine_id engine, const uint8_t *image, size_t width, size_t height,
+  const struct gimc_bank *bank, const uint8_t *expected, const char *bank_name){
+  const int tolerance = tolerance_of(engine,bank);
+  const size_t image_size = width*height;
+  uint8_t *result = malloc(image_size*bank->num_filters);
+  memset(result,0,image_size*bank->num_filters);
+
+  cl_int err = test_convolve(cl,engine,image,width,height,bank,result,NULL);
+  if(err){
+    fprintf(stderr,"FAIL %s: %s %ux%u on %zux%zu, error %d\n",
+      engine_name(engine),bank_name,bank->width,bank->width,width,height,err);
+    free(result);
+    return 1;
+  }
+
+  size_t mismatches = 0;
+  size_t first = 0;
+  for(size_t i = 0; i < image_size*bank->num_filters; ++i){
+    if(abs(result[i] - expected[i]) > tolerance){
+      if(mismatches++ == 0){
+        first = i;
+      }
+    }
+  }
+  free(result);
+
+  if(mismatches){
+    const size_t pixel = first % image_size;
+    fprintf(stderr,"FAIL %s: %s %ux%u on %zux%zu, %zu mismatches, first in filter %zu at (%zu,%zu)\n",
+      engine_name(engine),bank_name,bank->width,bank->width,width,height,mismatches,
+      first/image_size,pixel % width,pixel/width);
+    return 1;
+  }
+  return 0;
+}
+
+/* the device and host Gaussian banks have to agree */
+static int check_device_bank(struct gimc_cl *cl, unsigned int num_filters, unsigned int filter_width){
+  const size_t bank_len = (size_t)filter_width*filter_width*num_filters;
+  float *expected = malloc(sizeof(float)*bank_len);
+  filter_Gauss2dbank(expected,num_filters,filter_width);
+
+  struct gimc_bank bank;
+  int failed = 0;
+  cl_int err = gimc_bank_Gauss2d(cl,&bank,num_filters,filter_width);
+  if(err){
+    fprintf(stderr,"FAIL device bank %ux%u x%u, error %d\n",filter_width,filter_width,num_filters,err);
+    failed = 1;
+  }else{
+    for(size_t i = 0; i < bank_len; ++i){
+      if(fabsf(bank.weights[i] - expected[i]) > 1e-5f*expected[i] + 1e-7f){
+        fprintf(stderr,"FAIL device bank %ux%u x%u, weight %zu is %g, expected %g\n",
+          filter_width,filter_width,num_filters,i,bank.weights[i],expected[i]);
+        failed = 1;
+        break;
+      }
+    }
+  }
+  gimc_bank_release(&bank);
+  free(expected);
+  return failed;
+}
+
+/* oriented first and second derivatives, which saturate, on every linear engine */
+static int check_derivatives(struct gimc_cl *cl, unsigned int filter_width, const size_t (*sizes)[2], size_t num_sizes){
+  const struct filter_steerable steer = {2, {0, 8, 4}};
+  struct gimc_bank bank;
+  cl_int err = gimc_bank_steerable(cl,&bank,&steer,filter_width);
+  if(err){
+    fprintf(stderr,"FAIL uploading derivatives %ux%u, error %d\n",filter_width,filter_width,err);
+    return 1;
+  }
+
+  int failures = 0;
+  for(size_t s = 0; s < num_sizes; ++s){
+    const size_t width = sizes[s][0];
+    const size_t height = sizes[s][1];
+    uint8_t *image = malloc(width*height);
+    uint8_t *expected = malloc(width*height*bank.num_filters);
+    test_image(image,width,height,s % NUM_TEST_PATTERNS,filter_width);
+    native_convolve2d(image,width,height,bank.weights,bank.num_filters,filter_width,expected);
+    for(int e = 0; e < NUM_ENGINES; ++e){
+      if(engine_is_linear(e)){
+        failures += check_engine(cl,e,image,width,height,&bank,expected,"derivatives");
+      }
+    }
+    free(image);
+    free(expected);
+  }
+  gimc_bank_release(&bank);
+  return failures;
+}
+
+/* dilated Gaussians against native_convolve2d of their dense equivalent */
+static int check_dilated(struct gimc_cl *cl, unsigned int filter_width){
+  const unsigned int num_filters = 4;
+  const size_t width = 37, height = 23;
+  float *weights = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+  unsigned int dilations[4];
+  filter_atrous_bank(weights,dilations,num_filters,filter_width);
+  const unsigned int dense_width = filter_dilated_width(dilations,num_filters,filter_width);
+  float *dense = malloc(sizeof(float)*dense_width*dense_width*num_filters);
+  filter_dilate_bank(dense,dense_width,weights,dilations,num_filters,filter_width);
+
+  uint8_t *image = malloc(width*height);
+  uint8_t *expected = malloc(width*height*num_filters);
+  test_image(image,width,height,filter_width % NUM_TEST_PATTERNS,filter_width);
+  native_convolve2d(image,width,height,dense,num_filters,dense_width,expected);
+
+  int failures = 0;
+  struct gimc_bank bank;
+  if(gimc_bank_dilated(cl,&bank,weights,dilations,num_filters,filter_width)){
+    fprintf(stderr,"FAIL uploading dilated bank %ux%u\n",filter_width,filter_width);
+    failures = 1;
+  }else{
+    failures += check_engine(cl,ENGINE_ATROUS,image,width,height,&bank,expected,"dilated");
+    failures += check_engine(cl,ENGINE_LWF,image,width,height,&bank,expected,"dilated");
+  }
+  gimc_bank_release(&bank);
+  free(weights);
+  free(dense);
+  free(image);
+  free(expected);
+  return failures;
+}
+
+/* a bank of mixed widths, or of widths by heights, run a bucket at a
+ * time, against native_convolve2d of its zero padded filters on every
+ * engine
+ */
+static int check_mixed(struct gimc_cl *cl, const unsigned int *widths, const unsigned int *heights, unsigned int num_filters,
+  unsigned int filter_width, const char *bank_name){
+  const size_t width = 37, height = 23;
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  float *weights = malloc(sizeof(float)*filter_len*num_filters);
+  if(heights == NULL){
+    filter_Gauss2dbank_adaptive(weights,widths,num_filters,filter_width);
+  }else{
+    /* Gaussians of the whole width cut to their rectangles */
+    filter_Gauss2dbank(weights,num_filters,filter_width);
+    for(unsigned int f = 0; f < num_filters; ++f){
+      const unsigned int left = (filter_width - widths[f])/2;
+      const unsigned int top = (filter_width - heights[f])/2;
+      for(unsigned int y = 0; y < filter_width; ++y){
+        for(unsigned int x = 0; x < filter_width; ++x){
+          if(x < left || x >= left + widths[f] || y < top || y >= top + heights[f]){
+            weights[f*filter_len + y*filter_width + x] = 0.0f;
+          }
+        }
+      }
+    }
+  }
+
+  uint8_t *image = malloc(width*height);
+  uint8_t *expected = malloc(width*height*num_filters);
+  uint8_t *ranked = malloc(width*height*num_filters);
+  test_image(image,width,height,1,filter_width);
+  native_convolve2d(image,width,height,weights,num_filters,filter_width,expected);
+
+  int failures = 0;
+  struct gimc_bank bank;
+  if(gimc_bank_adaptive(cl,&bank,weights,widths,heights,num_filters,filter_width)){
+    fprintf(stderr,"FAIL uploading %s bank %ux%u\n",bank_name,filter_width,filter_width);
+    failures = 1;
+  }else{
+    for(int e = 0; e < NUM_ENGINES; ++e){
+      const uint8_t *reference = expected;
+      if(!engine_is_linear(e)){
+        const enum rank_op op = e == ENGINE_ERODE ? RANK_MIN : e == ENGINE_DILATE ? RANK_MAX : RANK_MEDIAN;
+        native_rank2d(op,image,width,height,weights,num_filters,filter_width,ranked);
+        reference = ranked;
+      }
+      failures += check_engine(cl,e,image,width,height,&bank,reference,bank_name);
+    }
+  }
+  gimc_bank_release(&bank);
+  free(weights);
+  free(image);
+  free(expected);
+  free(ranked);
+  return failures;
+}
+
+/* adaptive widths come in runs, those of bank files in any order and
+ * not necessarily square
+ */
+static int check_adaptive(struct gimc_cl *cl){
+  unsigned int widths[48];
+  const unsigned int filter_width = filter_adaptive_widths(widths,48,FILTER_ADAPTIVE_EPSILON,13);
+  const unsigned int shuffled[7] = {5, 3, 5, 1, 9, 3, 5};
+  const unsigned int thin_widths[5] = {3, 15, 3, 5, 1};
+  const unsigned int thin_heights[5] = {15, 3, 15, 5, 9};
+  return check_mixed(cl,widths,NULL,48,filter_width,"adaptive") + check_mixed(cl,shuffled,NULL,7,9,"shuffled") +
+    check_mixed(cl,thin_widths,thin_heights,5,15,"rectangular");
+}
+
+/* the automatic choice lands on a candidate by every route, and an
+ * epilogue leaves lwf alone
+ */
+static int check_choose(void){
+  const size_t width = 131, height = 67;
+  struct gimc_cl cl;
+  gimc_cl_init(&cl,CL_DEVICE_TYPE_CPU,CL_QUEUE_PROFILING_ENABLE);
+  uint8_t *image = malloc(width*height);
+  test_image(image,width,height,TEST_NOISE,0);
+  cl_int err;
+  cl_mem d_image = clCreateBuffer(cl.context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,width*height,image,&err);
+  struct gimc_bank bank;
+  err |= gimc_bank_Gauss2d(&cl,&bank,4,9);
+  if(err){
+    fprintf(stderr,"FAIL setting up the choice of engine, error %d\n",err);
+    free(image);
+    gimc_cl_release(&cl);
+    return 1;
+  }
+
+  int failures = 0;
+  enum engine_id candidates[NUM_ENGINES];
+  const unsigned int num_candidates = choose_candidates(&cl,width,height,&bank,NULL,candidates);
+  for(int benchmark = 0; benchmark < 2; ++benchmark){
+    struct engine_choice choice;
+    err = choose_engine(&cl,d_image,width,height,&bank,NULL,NULL,benchmark,&choice);
+    int known = 0;
+    for(unsigned int c = 0; c < num_candidates; ++c){
+      known |= candidates[c] == choice.engine;
+    }
+    if(err || !known || choice.source != (benchmark ? CHOOSE_BENCHMARK : CHOOSE_MODEL)){
+      fprintf(stderr,"FAIL choosing by %s: error %d, %s\n",benchmark ? "benchmark" : "model",err,engine_name(choice.engine));
+      ++failures;
+    }
+    /* the roofline can't tell lwf from the engines reading the same taps */
+    for(unsigned int c = 1; c <= choice.ties && !err; ++c){
+      if(choice.candidates[c].engine == ENGINE_LWF){
+        fprintf(stderr,"FAIL choosing by %s: %s over lwf in a tie\n",benchmark ? "benchmark" : "model",
+          engine_name(choice.engine));
+        ++failures;
+      }
+    }
+  }
+  struct gimc_epilogue epilogue;
+  epilogue_parse("dog",&epilogue);
+  struct engine_choice choice;
+  if(choose_engine(&cl,d_image,width,height,&bank,&epilogue,NULL,1,&choice) || choice.engine != ENGINE_LWF){
+    fprintf(stderr,"FAIL choosing for an epilogue: %s\n",engine_name(choice.engine));
+    ++failures;
+  }
+
+  gimc_bank_release(&bank);
+  clReleaseMemObject(d_image);
+  free(image);
+  gimc_cl_release(&cl);
+  return failures;
+}
+
+/* the wavelet decomposition on the device against atrous_decompose */
+static int check_wavelet(struct gimc_cl *cl, const size_t (*sizes)[2], size_t num_sizes){
+  int failures = 0;
+  for(size_t s = 0; s < num_sizes; ++s){
+    const size_t width = sizes[s][0];
+    const size_t height = sizes[s][1];
+    const size_t image_size = width*height;
+    const unsigned int levels = 1 + s % 5;
+    uint8_t *image = malloc(image_size);
+    uint8_t *expected = malloc(image_size*(levels + 1));
+    uint8_t *result = malloc(image_size*(levels + 1));
+    test_image(image,width,height,s % NUM_TEST_PATTERNS,levels);
+    atrous_decompose(image,width,height,levels,expected);
+
+    cl_int err;
+    cl_mem d_image = clCreateBuffer(cl->context,CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,image_size,image,&err);
+    cl_mem d_result = NULL;
+    if(!err){
+      d_result = clCreateBuffer(cl->context,CL_MEM_WRITE_ONLY,image_size*(levels + 1),NULL,&err);
+    }
+    if(!err){
+      err = engine_wavelet(cl,d_image,width,height,levels,d_result,NULL);
+    }
+    if(!err){
+      err = clEnqueueReadBuffer(cl->commands,d_result,CL_TRUE,0,image_size*(levels + 1),result,0,NULL,NULL);
+    }
+    size_t mismatches = 0;
+    for(size_t i = 0; !err && i < image_size*(levels + 1); ++i){
+      mismatches += abs(result[i] - expected[i]) > TOLERANCE;
+    }
+    if(err || mismatches){
+      fprintf(stderr,"FAIL wavelet of %u levels on %zux%zu, error %d, %zu mismatches\n",levels,width,height,err,mismatches);
+      ++failures;
+    }
+    if(d_image){
+      clReleaseMemObject(d_image);
+    }
+    if(d_result){
+      clReleaseMemObject(d_result);
+    }
+    free(image);
+    free(expected);
+    free(result);
+  }
+  return failures;
+}
+
+/* epilogues fused into lwf against native_convolve2d_epilogue
+ * reductions of impulses are exact sums, so argmax and thresholds, which
+ * a rounding error can flip, are only checked on them
+ */
+static int check_epilogues(struct gimc_cl *cl, unsigned int filter_width){
+  const struct{
+    const char *stages;
+    enum test_bank bank;
+  } cases[] = {
+    {"dog,scale=4,offset=128", BANK_GAUSS_MANY},
+    {"max,round", BANK_GAUSS_MANY},
+    {"min,scale=0.5,offset=10", BANK_GAUSS_MANY},
+    {"dog,max", BANK_GAUSS_MANY},
+    {"argmax,scale=64", BANK_TAPS},
+    {"dog,threshold=0.5", BANK_TAPS},
+    {"threshold=100", BANK_TAPS}
+  };
+  const size_t width = 37, height = 23;
+  float *weights = malloc(sizeof(float)*filter_width*filter_width*4);
+  uint8_t *image = malloc(width*height);
+  uint8_t *expected = malloc(width*height*4);
+  uint8_t *result = malloc(width*height*4);
+  int failures = 0;
+
+  for(size_t c = 0; c < sizeof(cases)/sizeof(cases[0]); ++c){
+    struct gimc_epilogue epilogue;
+    if(epilogue_parse(cases[c].stages,&epilogue)){
+      fprintf(stderr,"FAIL parsing epilogue %s\n",cases[c].stages);
+      ++failures;
+      continue;
+    }
+    const unsigned int num_filters = make_bank(weights,cases[c].bank,filter_width);
+    const unsigned int planes = epilogue_planes(&epilogue,num_filters);
+    struct gimc_bank bank;
+    if(gimc_bank_upload(cl,&bank,weights,num_filters,filter_width)){
+      ++failures;
+      continue;
+    }
+
+    test_image(image,width,height,c % NUM_TEST_PATTERNS,filter_width);
+    native_convolve2d_epilogue(image,width,height,weights,num_filters,filter_width,&epilogue,expected);
+    const int tolerance = cases[c].bank == BANK_TAPS ? 0 : TOLERANCE;
+    cl_int err = test_convolve_epilogue(cl,ENGINE_LWF,image,width,height,&bank,&epilogue,result,NULL);
+    size_t mismatches = 0;
+    for(size_t i = 0; !err && i < width*height*planes; ++i){
+      mismatches += abs(result[i] - expected[i]) > tolerance;
+    }
+    if(err || mismatches){
+      fprintf(stderr,"FAIL epilogue %s on %s %ux%u, error %d, %zu mismatches\n",
+        cases[c].stages,bank_names[cases[c].bank],filter_width,filter_width,err,mismatches);
+      ++failures;
+    }
+    gimc_bank_release(&bank);
+  }
+
+  /* engines without a fused epilogue refuse one */
+  struct gimc_epilogue epilogue;
+  epilogue_parse("max",&epilogue);
+  make_bank(weights,BANK_GAUSS_MANY,filter_width);
+  struct gimc_bank bank;
+  if(gimc_bank_upload(cl,&bank,weights,4,filter_width) == CL_SUCCESS){
+    if(test_convolve_epilogue(cl,ENGINE_BASE,image,width,height,&bank,&epilogue,result,NULL) == CL_SUCCESS){
+      fprintf(stderr,"FAIL epilogue on %s\n",engine_name(ENGINE_BASE));
+      ++failures;
+    }
+    gimc_bank_release(&bank);
+  }
+
+  free(weights);
+  free(image);
+  free(expected);
+  free(result);
+  return failures;
+}
+
+int main(int argc, char **argv){
+  trace_init(&argc,argv);
+  if(!test_has_device(CL_DEVICE_TYPE_CPU)){
+    fprintf(stderr,"no CPU OpenCL device, skipping\n");
+    return TEST_SKIP;
+  }
+
+  struct gimc_cl cl;
+  gimc_cl_init(&cl,CL_DEVICE_TYPE_CPU,0);
+
+  /* odd and single row or column images exercise every border case */
+  const size_t sizes[][2] = {{1,1}, {5,3}, {3,5}, {17,31}, {131,67}};
+  const unsigned int widths[] = {1, 3, 5, 7, 49};
+  const size_t num_sizes = sizeof(sizes)/sizeof(sizes[0]);
+  const size_t num_widths = sizeof(widths)/sizeof(widths[0]);
+
+  int failures = 0;
+  unsigned int runs = 0;
+  for(size_t w = 0; w < num_widths; ++w){
+    const unsigned int filter_width = widths[w];
+    failures += check_device_bank(&cl,1,filter_width);
+    failures += check_device_bank(&cl,8,filter_width);
+    failures += check_derivatives(&cl,filter_width,sizes,num_sizes);
+    failures += check_epilogues(&cl,filter_width);
+    if(filter_width <= 7){
+      failures += check_dilated(&cl,filter_width);
+    }
+
+    float *weights = malloc(sizeof(float)*filter_width*filter_width*4);
+    for(int b = 0; b < NUM_TEST_BANKS; ++b){
+      const unsigned int num_filters = make_bank(weights,b,filter_width);
+      struct gimc_bank bank;
+      cl_int err = b == BANK_STEERED ? gimc_bank_steerable(&cl,&bank,&steered_gauss,filter_width) :
+        gimc_bank_upload(&cl,&bank,weights,num_filters,filter_width);
+      if(err){
+        fprintf(stderr,"FAIL uploading %s %ux%u, error %d\n",bank_names[b],filter_width,filter_width,err);
+        ++failures;
+        continue;
+      }
+
+      for(size_t s = 0; s < num_sizes; ++s){
+        const size_t width = sizes[s][0];
+        const size_t height = sizes[s][1];
+        uint8_t *image = malloc(width*height);
+        uint8_t *expected = malloc(width*height*num_filters);
+        uint8_t *ranked = malloc(width*height*num_filters);
+        /* cycle through the patterns rather than running every one */
+        test_image(image,width,height,(w + b + s) % NUM_TEST_PATTERNS,runs);
+        native_convolve2d(image,width,height,weights,num_filters,filter_width,expected);
+
+        for(int e = 0; e < NUM_ENGINES; ++e){
+          const uint8_t *reference = expected;
+          if(!engine_is_linear(e)){
+            const enum rank_op op = e == ENGINE_ERODE ? RANK_MIN : e == ENGINE_DILATE ? RANK_MAX : RANK_MEDIAN;
+            native_rank2d(op,image,width,height,weights,num_filters,filter_width,ranked);
+            reference = ranked;
+          }
+          failures += check_engine(&cl,e,image,width,height,&bank,reference,bank_names[b]);
+          ++runs;
+        }
+        free(image);
+        free(expected);
+        free(ranked);
+      }
+      gimc_bank_release(&bank);
+    }
+    free(weights);
+  }
+
+  failures += check_wavelet(&cl,sizes,num_sizes);
+  failures += check_adaptive(&cl);
+  failures += check_choose();
+
+  trace_finish();
+  gimc_cl_release(&cl);
+
+  printf("%u engine runs, %d failures\n",runs,failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
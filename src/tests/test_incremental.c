@@ -0,0 +1,103 @@
+/* incremental convolution has to match a full convolution after edits
+ * and recompute only near them
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "incremental.h"
+#include "native.h"
+#include "filter.h"
+#include "test_util.h"
+
+/* edit a rectangle of an image */
+static void edit(uint8_t *image, size_t width, size_t x, size_t y, size_t w, size_t h, uint8_t value){
+  for(size_t j = y; j < y + h; ++j){
+    memset(&image[j*width + x],value,w);
+  }
+}
+
+/* compare the resident result with the reference, returns nonzero on mismatch */
+static int check(struct gimc_incremental *inc, const uint8_t *image, const float *weights, const char *step){
+  const size_t size = inc->width*inc->height*inc->bank->num_filters;
+  uint8_t *expected = malloc(size);
+  uint8_t *result = malloc(size);
+  native_convolve2d(image,inc->width,inc->height,weights,inc->bank->num_filters,inc->bank->width,expected);
+  clEnqueueReadBuffer(inc->cl->commands,inc->result,CL_TRUE,0,size,result,0,NULL,NULL);
+
+  size_t mismatches = 0;
+  for(size_t i = 0; i < size; ++i){
+    mismatches += abs(result[i] - expected[i]) > 1;
+  }
+  free(expected);
+  free(result);
+  if(mismatches){
+    fprintf(stderr,"FAIL %s: %zu mismatches\n",step,mismatches);
+  }
+  return mismatches != 0;
+}
+
+int main(void){
+  if(!test_has_device(CL_DEVICE_TYPE_CPU)){
+    fprintf(stderr,"no CPU OpenCL device, skipping\n");
+    return TEST_SKIP;
+  }
+
+  struct gimc_cl cl;
+  gimc_cl_init(&cl,CL_DEVICE_TYPE_CPU,0);
+
+  const size_t width = 301, height = 203;
+  const unsigned int filter_width = 15, num_filters = 2;
+  float *weights = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+  filter_Gauss2dbank(weights,num_filters,filter_width);
+  struct gimc_bank bank;
+  if(gimc_bank_upload(&cl,&bank,weights,num_filters,filter_width)){
+    return EXIT_FAILURE;
+  }
+
+  uint8_t *image = malloc(width*height);
+  test_image(image,width,height,TEST_NOISE,1);
+
+  struct gimc_incremental inc;
+  int failures = 0;
+  struct incremental_stats stats;
+  if(gimc_incremental_create(&inc,&cl,&bank,width,height,32) || gimc_incremental_update(&inc,image,&stats)){
+    fprintf(stderr,"FAIL setting up\n");
+    return EXIT_FAILURE;
+  }
+  failures += check(&inc,image,weights,"first update");
+  const size_t total_tiles = inc.tiles_x*inc.tiles_y;
+
+  /* nothing changed, nothing to do */
+  gimc_incremental_update(&inc,image,&stats);
+  if(stats.computed_tiles != 0){
+    fprintf(stderr,"FAIL unchanged image recomputed %zu tiles\n",stats.computed_tiles);
+    ++failures;
+  }
+
+  /* a small edit in the middle, one at a corner and one across the last partial tiles */
+  const size_t edits[][4] = {{150, 100, 3, 3}, {0, 0, 5, 2}, {290, 190, 11, 13}};
+  for(size_t i = 0; i < sizeof(edits)/sizeof(edits[0]); ++i){
+    edit(image,width,edits[i][0],edits[i][1],edits[i][2],edits[i][3],255 - 40*i);
+    if(gimc_incremental_update(&inc,image,&stats)){
+      fprintf(stderr,"FAIL update %zu\n",i);
+      ++failures;
+      continue;
+    }
+    char step[32];
+    snprintf(step,sizeof(step),"edit %zu",i);
+    failures += check(&inc,image,weights,step);
+    if(stats.computed_tiles == 0 || stats.computed_tiles >= total_tiles){
+      fprintf(stderr,"FAIL edit %zu recomputed %zu of %zu tiles\n",i,stats.computed_tiles,total_tiles);
+      ++failures;
+    }
+  }
+
+  gimc_incremental_release(&inc);
+  gimc_bank_release(&bank);
+  gimc_cl_release(&cl);
+  free(weights);
+  free(image);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,52 @@
+/* the C that Kgen generates for a Gaussian bank against native_convolve2d
+ * built once per bank from the source Kgen writes at build time, with
+ * KGEN_FILTERS and KGEN_WIDTH the bank it was given. needs no OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "filter.h"
+#include "native.h"
+#include "test_util.h"
+
+/* generated, see kgen_write_c */
+extern void kgen_convolve2d(const unsigned char *image,unsigned char *result,size_t image_width,size_t image_height);
+
+/* interior taps are folded by weight before they are multiplied, which
+ * sums in another order than the reference
+ */
+#define TOLERANCE 1
+
+static void check_size(size_t width, size_t height, enum test_pattern pattern, const float *bank){
+  const size_t image_size = width*height;
+  uint8_t *image = malloc(image_size);
+  uint8_t *expected = malloc(image_size*KGEN_FILTERS);
+  uint8_t *result = malloc(image_size*KGEN_FILTERS);
+  test_image(image,width,height,pattern,width*height);
+  native_convolve2d(image,width,height,bank,KGEN_FILTERS,KGEN_WIDTH,expected);
+  kgen_convolve2d(image,result,width,height);
+  size_t mismatches = 0;
+  for(size_t i = 0; i < image_size*KGEN_FILTERS; ++i){
+    mismatches += abs(result[i] - expected[i]) > TOLERANCE;
+  }
+  CHECK(mismatches == 0,"%u filters of width %u on %zux%zu have %zu mismatches",KGEN_FILTERS,KGEN_WIDTH,width,height,
+    mismatches);
+  free(image);
+  free(expected);
+  free(result);
+}
+
+int main(void){
+  float *bank = malloc(sizeof(float)*KGEN_WIDTH*KGEN_WIDTH*KGEN_FILTERS);
+  filter_Gauss2dbank(bank,KGEN_FILTERS,KGEN_WIDTH);
+  /* images narrower than the filter only take the border path */
+  const size_t sizes[][2] = {{1,1}, {5,3}, {17,31}, {131,67}};
+  for(size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s){
+    for(int p = 0; p < NUM_TEST_PATTERNS; ++p){
+      check_size(sizes[s][0],sizes[s][1],p,bank);
+    }
+  }
+  free(bank);
+  return test_status();
+}
@@ -0,0 +1,114 @@
+/* the plans of the multirate engine: full resolution is the filter itself,
+ * shrunken filters keep the gain, errors grow with the factor and wide
+ * Gaussians are decimated within the target. needs no OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "filter.h"
+#include "multirate.h"
+#include "test_util.h"
+
+static double sum_of(const float *weights, size_t len){
+  double sum = 0.0;
+  for(size_t i = 0; i < len; ++i){
+    sum += weights[i];
+  }
+  return sum;
+}
+
+/* a plan at factor 1 is the filter reversed, with no error */
+static void check_full_resolution(const float *filter, unsigned int width){
+  const size_t filter_len = (size_t)width*width;
+  struct multirate_plan plan;
+  multirate_plan_factor(filter,width,1,&plan);
+  CHECK(plan.factor == 1 && plan.width == width,"width %u at factor 1 is %u wide",width,plan.width);
+  CHECK(plan.error < 1e-6,"width %u at factor 1 is off by %g",width,plan.error);
+  for(size_t i = 0; i < filter_len; ++i){
+    CHECK(fabs(plan.weights[i] - filter[filter_len - 1 - i]) < 1e-6,"width %u at factor 1, weight %zu",width,i);
+  }
+  multirate_plan_release(&plan);
+}
+
+/* every factor keeps the sum of the weights, and is no closer than the one before */
+static void check_factors(const float *filter, unsigned int width, const char *name){
+  const double sum = sum_of(filter,(size_t)width*width);
+  double previous = 0.0;
+  for(unsigned int factor = 1; factor <= MULTIRATE_MAX_FACTOR; factor *= 2){
+    struct multirate_plan plan;
+    multirate_plan_factor(filter,width,factor,&plan);
+    const unsigned int radius = (width - 1)/2;
+    CHECK(plan.width == 2*((radius + factor - 1)/factor) + 1,"%s at factor %u is %u wide",name,factor,plan.width);
+    const double shrunk = sum_of(plan.weights,(size_t)plan.width*plan.width);
+    CHECK(fabs(shrunk - sum) < 1e-4*fabs(sum),"%s at factor %u sums to %g, not %g",name,factor,shrunk,sum);
+    CHECK(plan.error >= previous - 1e-9,"%s is closer at factor %u, %g than %g",name,factor,plan.error,previous);
+    previous = plan.error;
+    multirate_plan_release(&plan);
+  }
+}
+
+/* the widest Gaussian of the bank is decimated, the narrowest isn't */
+static void check_gauss(unsigned int num_filters, unsigned int width){
+  const size_t filter_len = (size_t)width*width;
+  float *bank = malloc(sizeof(float)*filter_len*num_filters);
+  filter_Gauss2dbank(bank,num_filters,width);
+  for(unsigned int f = 0; f < num_filters; ++f){
+    const float sigma = filter_Gauss2dbank_sigma(f,num_filters);
+    struct multirate_plan plan;
+    multirate_plan_filter(&bank[f*filter_len],width,MULTIRATE_ERROR,&plan);
+    CHECK(plan.error <= MULTIRATE_ERROR,"Gaussian %g planned off by %g",sigma,plan.error);
+    if(sigma >= 25.0f){
+      CHECK(plan.factor >= 4,"Gaussian %g of width %u only decimated by %u",sigma,width,plan.factor);
+    }
+    multirate_plan_release(&plan);
+
+    /* a looser target never decimates less */
+    struct multirate_plan loose;
+    multirate_plan_filter(&bank[f*filter_len],width,MULTIRATE_ERROR,&plan);
+    multirate_plan_filter(&bank[f*filter_len],width,5*MULTIRATE_ERROR,&loose);
+    CHECK(loose.factor >= plan.factor,"Gaussian %g decimated by %u at a looser target, %u at the default",
+      sigma,loose.factor,plan.factor);
+    multirate_plan_release(&plan);
+    multirate_plan_release(&loose);
+  }
+  check_factors(&bank[(num_filters - 1)*filter_len],width,"Gaussian");
+  check_full_resolution(bank,width);
+  free(bank);
+}
+
+/* a filter whose rows differ in shape takes the 2d path */
+static void check_anisotropic(unsigned int width){
+  const size_t filter_len = (size_t)width*width;
+  float *filter = malloc(sizeof(float)*filter_len);
+  const long r = (width - 1)/2;
+  for(long y = -r; y <= r; ++y){
+    for(long x = -r; x <= r; ++x){
+      const double u = x + 0.5*y;
+      filter[(y + r)*width + x + r] = exp(-(u*u)/(2.0*r*r/4) - (y*y)/(2.0*r*r/16));
+    }
+  }
+  check_full_resolution(filter,width);
+  check_factors(filter,width,"anisotropic");
+  free(filter);
+}
+
+int main(void){
+  float box[9*9];
+  for(size_t i = 0; i < 9*9; ++i){
+    box[i] = 1.0f/(9*9);
+  }
+  check_full_resolution(box,9);
+  check_factors(box,9,"box");
+  check_gauss(4,151);
+  check_anisotropic(21);
+
+  /* a filter no wider than a block is never decimated */
+  struct multirate_plan plan;
+  multirate_plan_filter(box,1,1.0,&plan);
+  CHECK(plan.factor == 1,"width 1 decimated by %u",plan.factor);
+  multirate_plan_release(&plan);
+
+  return test_status();
+}
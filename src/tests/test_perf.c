@@ -0,0 +1,176 @@
+/* performance regression gate
+ * times every engine on the CPU OpenCL device and fails when throughput
+ * falls more than GIMC_PERF_TOLERANCE (a fraction, 0.25 by default) below
+ * the baseline stored for the device
+ * usage: TestPerf [Baseline File] [--update]
+ * --update replaces the baseline of the device with the measurements
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+#include "test_util.h"
+
+/* a baseline line is "engine filter_width throughput device name"
+ * throughput is in millions of filtered pixels per second
+ */
+#define MAX_LINES 1024
+#define LINE_LEN 256
+
+static const unsigned int widths[] = {9, 25};
+#define NUM_WIDTHS (sizeof(widths)/sizeof(widths[0]))
+#define IMAGE_WIDTH 256
+#define IMAGE_HEIGHT 256
+#define NUM_FILTERS 4
+#define REPEATS 3
+
+/* best throughput of an engine over REPEATS runs, after a warm up run
+ * which builds the program, 0 if the engine failed
+ */
+static double measure(struct gimc_cl *cl, enum engine_id engine, const uint8_t *image,
+  const struct gimc_bank *bank, uint8_t *result){
+  double best = 0;
+  for(int i = 0; i <= REPEATS; ++i){
+    struct engine_timing timing = {0, 0};
+    if(test_convolve(cl,engine,image,IMAGE_WIDTH,IMAGE_HEIGHT,bank,result,&timing)){
+      return 0;
+    }
+    const double throughput = IMAGE_WIDTH*IMAGE_HEIGHT*bank->num_filters/timing.seconds*1e-6;
+    if(i > 0 && throughput > best){
+      best = throughput;
+    }
+  }
+  return best;
+}
+
+/* look up the baseline of an engine on a device, 0 if there is none */
+static double baseline_of(char lines[][LINE_LEN], int num_lines, const char *device,
+  enum engine_id engine, unsigned int filter_width){
+  for(int i = 0; i < num_lines; ++i){
+    char name[32], line_device[LINE_LEN];
+    unsigned int width;
+    double throughput;
+    if(sscanf(lines[i],"%31s %u %lf %255[^\n]",name,&width,&throughput,line_device) == 4 &&
+      strcmp(name,engine_name(engine)) == 0 && width == filter_width && strcmp(line_device,device) == 0){
+      return throughput;
+    }
+  }
+  return 0;
+}
+
+/* nonzero if a baseline line belongs to device */
+static int line_of_device(const char *line, const char *device){
+  char name[32], line_device[LINE_LEN];
+  unsigned int width;
+  double throughput;
+  return sscanf(line,"%31s %u %lf %255[^\n]",name,&width,&throughput,line_device) == 4 &&
+    strcmp(line_device,device) == 0;
+}
+
+int main(int argc, char **argv){
+  if(argc < 2){
+    printf("Usage: %s [Baseline File] [--update]\n",argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *baseline_path = argv[1];
+  const int update = argc > 2 && strcmp(argv[2],"--update") == 0;
+  const char *tolerance_env = getenv("GIMC_PERF_TOLERANCE");
+  const double tolerance = tolerance_env ? atof(tolerance_env) : 0.25;
+
+  if(!test_has_device(CL_DEVICE_TYPE_CPU)){
+    fprintf(stderr,"no CPU OpenCL device, skipping\n");
+    return TEST_SKIP;
+  }
+
+  /* read the stored baselines, comments included so an update keeps them */
+  static char lines[MAX_LINES][LINE_LEN];
+  int num_lines = 0;
+  FILE *baseline = fopen(baseline_path,"r");
+  if(baseline){
+    while(num_lines < MAX_LINES && fgets(lines[num_lines],LINE_LEN,baseline)){
+      lines[num_lines][strcspn(lines[num_lines],"\n")] = '\0';
+      ++num_lines;
+    }
+    fclose(baseline);
+  }
+
+  struct gimc_cl cl;
+  gimc_cl_init(&cl,CL_DEVICE_TYPE_CPU,CL_QUEUE_PROFILING_ENABLE);
+  char device[LINE_LEN];
+  clGetDeviceInfo(cl.device,CL_DEVICE_NAME,sizeof(device),device,NULL);
+
+  uint8_t *image = malloc(IMAGE_WIDTH*IMAGE_HEIGHT);
+  uint8_t *result = malloc(IMAGE_WIDTH*IMAGE_HEIGHT*NUM_FILTERS);
+  test_image(image,IMAGE_WIDTH,IMAGE_HEIGHT,TEST_NOISE,0);
+
+  double measured[NUM_WIDTHS][NUM_ENGINES];
+  int failures = 0;
+  int missing = 0;
+  printf("%-14s %5s %12s %12s\n","engine","width","Mpix/s","baseline");
+  for(size_t w = 0; w < NUM_WIDTHS; ++w){
+    float *weights = malloc(sizeof(float)*widths[w]*widths[w]*NUM_FILTERS);
+    filter_Gauss2dbank(weights,NUM_FILTERS,widths[w]);
+    struct gimc_bank bank;
+    if(gimc_bank_upload(&cl,&bank,weights,NUM_FILTERS,widths[w])){
+      fprintf(stderr,"FAIL uploading bank\n");
+      return EXIT_FAILURE;
+    }
+
+    for(int e = 0; e < NUM_ENGINES; ++e){
+      measured[w][e] = measure(&cl,e,image,&bank,result);
+      const double expected = baseline_of(lines,num_lines,device,e,widths[w]);
+      printf("%-14s %5u %12.2f %12.2f",engine_name(e),widths[w],measured[w][e],expected);
+      if(measured[w][e] == 0){
+        printf(" FAIL, engine error\n");
+        ++failures;
+      }else if(expected == 0){
+        printf(" no baseline\n");
+        ++missing;
+      }else if(measured[w][e] < expected*(1 - tolerance)){
+        printf(" FAIL, %.0f%% slower\n",(1 - measured[w][e]/expected)*100);
+        ++failures;
+      }else{
+        printf("\n");
+      }
+    }
+    gimc_bank_release(&bank);
+    free(weights);
+  }
+
+  if(update){
+    /* keep other devices and comments, then write this device */
+    baseline = fopen(baseline_path,"w");
+    if(baseline == NULL){
+      perror(baseline_path);
+      return EXIT_FAILURE;
+    }
+    for(int i = 0; i < num_lines; ++i){
+      if(!line_of_device(lines[i],device)){
+        fprintf(baseline,"%s\n",lines[i]);
+      }
+    }
+    for(size_t w = 0; w < NUM_WIDTHS; ++w){
+      for(int e = 0; e < NUM_ENGINES; ++e){
+        fprintf(baseline,"%s %u %.2f %s\n",engine_name(e),widths[w],measured[w][e],device);
+      }
+    }
+    fclose(baseline);
+    printf("updated baseline of %s in %s\n",device,baseline_path);
+  }
+
+  free(image);
+  free(result);
+  gimc_cl_release(&cl);
+
+  if(failures){
+    return EXIT_FAILURE;
+  }
+  /* nothing to compare against is not a pass */
+  if(missing && !update){
+    fprintf(stderr,"no baseline for %s, run with --update to record one\n",device);
+    return TEST_SKIP;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/* the rank filters: van Herk/Gil-Werman minimum and maximum and the
+ * sliding histogram median against sorting every window, and the windows
+ * of filters. needs no OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+#include "rank.h"
+#include "test_util.h"
+
+static const char *op_names[NUM_RANK_OPS] = {"min", "max", "median"};
+
+static int compare_bytes(const void *a, const void *b){
+  return *(const uint8_t *)a - *(const uint8_t *)b;
+}
+
+/* the pixels of every window inside the image, sorted */
+static uint8_t brute_force(enum rank_op op, const uint8_t *image, long width, long height, long radius,
+  long px, long py, uint8_t *window){
+  size_t count = 0;
+  for(long y = py - radius; y <= py + radius; ++y){
+    for(long x = px - radius; x <= px + radius; ++x){
+      if(y >= 0 && y < height && x >= 0 && x < width){
+        window[count++] = image[y*width + x];
+      }
+    }
+  }
+  qsort(window,count,1,compare_bytes);
+  return op == RANK_MIN ? window[0] : op == RANK_MAX ? window[count - 1] : window[(count - 1)/2];
+}
+
+static void check_op(enum rank_op op, size_t width, size_t height, unsigned int radius, int pattern){
+  const size_t image_size = width*height;
+  uint8_t *image = malloc(image_size);
+  for(size_t i = 0; i < image_size; ++i){
+    /* noise, or few levels so the median sees ties */
+    image[i] = pattern ? (uint8_t)((i*7919 + 13*(i/width)) % 256) : (uint8_t)(((i/width)*3 + i % 5) % 4*60);
+  }
+  uint8_t *result = malloc(image_size);
+  uint8_t *window = malloc((2*radius + 1)*(2*radius + 1));
+  CHECK(rank_filter2d(op,image,width,height,radius,result) == 0,"%s of radius %u refused",op_names[op],radius);
+  size_t mismatches = 0;
+  for(size_t y = 0; y < height; ++y){
+    for(size_t x = 0; x < width; ++x){
+      mismatches += result[y*width + x] != brute_force(op,image,width,height,radius,x,y,window);
+    }
+  }
+  CHECK(mismatches == 0,"%s of radius %u on %zux%zu has %zu mismatches",op_names[op],radius,width,height,mismatches);
+  free(image);
+  free(result);
+  free(window);
+}
+
+int main(void){
+  const size_t sizes[][2] = {{1,1}, {5,3}, {3,5}, {17,31}, {64,40}};
+  const unsigned int radii[] = {0, 1, 2, 3, 9, 24};
+  for(int op = 0; op < NUM_RANK_OPS; ++op){
+    for(size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s){
+      for(size_t r = 0; r < sizeof(radii)/sizeof(radii[0]); ++r){
+        check_op(op,sizes[s][0],sizes[s][1],radii[r],(int)(s + r) % 2);
+      }
+    }
+  }
+
+  uint8_t pixel = 0;
+  CHECK(rank_filter2d(RANK_MEDIAN,&pixel,1,1,RANK_MEDIAN_MAX_RADIUS + 1,&pixel) != 0,"median over 255 rows");
+  CHECK(rank_median_strip(0) == RANK_MEDIAN_STRIP && rank_median_strip(24) >= 49,"strips narrower than windows");
+
+  /* windows of filters: the reach of their nonzero weights */
+  float bank[4*9*9];
+  filter_Gauss2dbank(bank,1,9);
+  CHECK(rank_radius(bank,9) == 4,"Gaussian of 9 has a window of radius %u",rank_radius(bank,9));
+  filter_box_bank(bank,4,9);
+  for(unsigned int f = 0; f < 4; ++f){
+    CHECK(rank_radius(&bank[f*81],9) == f + 1,"box %u of 9 has a window of radius %u",f,rank_radius(&bank[f*81],9));
+  }
+  float taps[9*9];
+  memset(taps,0,sizeof(taps));
+  taps[40] = 1.0f;
+  CHECK(rank_radius(taps,9) == 0,"impulse has a window of radius %u",rank_radius(taps,9));
+  taps[8] = 0.5f;
+  CHECK(rank_radius(taps,9) == 4,"corner tap has a window of radius %u",rank_radius(taps,9));
+
+  return test_status();
+}
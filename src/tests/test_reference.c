@@ -0,0 +1,267 @@
+/* checks the scalar reference the engines are compared against, its
+ * epilogues and the host Gaussian and steerable banks, none needs OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "epilogue.h"
+#include "native.h"
+#include "filter.h"
+#include "test_util.h"
+
+/* pixel of an image, zero outside of it */
+static int pixel_at(const uint8_t *image, size_t width, size_t height, long x, long y){
+  if(x < 0 || y < 0 || x >= (long)width || y >= (long)height){
+    return 0;
+  }
+  return image[y*width + x];
+}
+
+/* a bank of three filters with taps chosen so that results are exact
+ * 0: an impulse in the center
+ * 1: an impulse in the first cell, which the convolution applies to the
+ *    pixel radius below and right of the output pixel
+ * 2: halves in the first and last cells
+ */
+static void check_taps(unsigned int filter_width, size_t width, size_t height){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  const size_t image_size = width*height;
+  const long radius = (filter_width - 1)/2;
+
+  float *bank = calloc(3*filter_len,sizeof(float));
+  bank[(filter_len - 1)/2] = 1.0f;
+  bank[filter_len] = 1.0f;
+  bank[2*filter_len] += 0.5f;
+  bank[3*filter_len - 1] += 0.5f;
+
+  uint8_t *image = malloc(image_size);
+  uint8_t *result = malloc(3*image_size);
+  test_image(image,width,height,TEST_NOISE,filter_width);
+  native_convolve2d(image,width,height,bank,3,filter_width,result);
+
+  for(long y = 0; y < (long)height; ++y){
+    for(long x = 0; x < (long)width; ++x){
+      const size_t i = y*width + x;
+      const int center = image[i];
+      const int shifted = pixel_at(image,width,height,x + radius,y + radius);
+      const int halves = (pixel_at(image,width,height,x - radius,y - radius) + shifted)/2;
+      CHECK(result[i] == center,"impulse %ux%u on %zux%zu at (%ld,%ld): %d, expected %d",
+        filter_width,filter_width,width,height,x,y,result[i],center);
+      CHECK(result[image_size + i] == shifted,"shift %ux%u on %zux%zu at (%ld,%ld): %d, expected %d",
+        filter_width,filter_width,width,height,x,y,result[image_size + i],shifted);
+      CHECK(result[2*image_size + i] == halves,"halves %ux%u on %zux%zu at (%ld,%ld): %d, expected %d",
+        filter_width,filter_width,width,height,x,y,result[2*image_size + i],halves);
+    }
+  }
+
+  free(bank);
+  free(image);
+  free(result);
+}
+
+static void check_bank(unsigned int num_filters, unsigned int filter_width){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  float *bank = malloc(sizeof(float)*filter_len*num_filters);
+  filter_Gauss2dbank(bank,num_filters,filter_width);
+
+  for(unsigned int i = 0; i < num_filters; ++i){
+    const float *filter = &bank[i*filter_len];
+    double sum = 0;
+    for(size_t j = 0; j < filter_len; ++j){
+      sum += filter[j];
+      /* Gaussians are symmetric about their center */
+      CHECK(filter[j] == filter[filter_len - 1 - j],"filter %u of %u, %ux%u is not symmetric",i,num_filters,filter_width,filter_width);
+    }
+    CHECK(fabs(sum - 1.0) < 1e-5,"filter %u of %u, %ux%u sums to %f",i,num_filters,filter_width,filter_width,sum);
+
+    if(i > 0){
+      CHECK(filter_Gauss2dbank_sigma(i,num_filters) > filter_Gauss2dbank_sigma(i - 1,num_filters),
+        "sigma of filter %u of %u does not increase",i,num_filters);
+    }
+  }
+
+  free(bank);
+}
+
+/* oriented derivatives of Gaussian: order 0 is the Gaussian bank,
+ * derivatives sum to zero and are steered the right way round
+ */
+static void check_steerable(unsigned int filter_width){
+  const struct filter_steerable steer = {2, {1, 4, 2}};
+  const unsigned int num_filters = filter_steerable_count(&steer);
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  CHECK(num_filters == 14,"steerable bank of %u filters",num_filters);
+  float *bank = malloc(sizeof(float)*filter_len*num_filters);
+  float *gauss = malloc(sizeof(float)*filter_len*steer.num_sigmas);
+  filter_steerable_bank(bank,&steer,filter_width);
+  filter_Gauss2dbank(gauss,steer.num_sigmas,filter_width);
+
+  for(unsigned int s = 0; s < steer.num_sigmas; ++s){
+    const float *group = &bank[s*7*filter_len];
+    for(size_t j = 0; j < filter_len; ++j){
+      CHECK(fabsf(group[j] - gauss[s*filter_len + j]) < 1e-6f,"steered Gaussian %u, %ux%u, weight %zu is %g, expected %g",
+        s,filter_width,filter_width,j,group[j],gauss[s*filter_len + j]);
+    }
+    for(unsigned int f = 1; f < 7; ++f){
+      double sum = 0.0, size = 0.0;
+      for(size_t j = 0; j < filter_len; ++j){
+        sum += group[f*filter_len + j];
+        size += fabs(group[f*filter_len + j]);
+      }
+      CHECK(fabs(sum) <= 1e-5*size + 1e-6,"derivative %u of sigma %u, %ux%u sums to %g",f,s,filter_width,filter_width,sum);
+    }
+    /* first derivatives half a turn apart are negations, second ones a
+     * quarter turn apart are transposes
+     */
+    for(size_t j = 0; j < filter_len; ++j){
+      const size_t transposed = (j % filter_width)*filter_width + j/filter_width;
+      CHECK(fabsf(group[filter_len + j] + group[3*filter_len + j]) < 1e-6f,"derivative at 0 and pi of sigma %u, weight %zu",s,j);
+      CHECK(fabsf(group[2*filter_len + j] + group[4*filter_len + j]) < 1e-6f,"derivative at pi/2 and 3pi/2 of sigma %u, weight %zu",s,j);
+      CHECK(fabsf(group[5*filter_len + j] - group[6*filter_len + transposed]) < 1e-6f,"second derivative at 0 and pi/2 of sigma %u, weight %zu",s,j);
+    }
+  }
+
+  /* on a step up along x, the derivative at angle 0 is positive and the
+   * one at pi is clamped to 0
+   */
+  if(filter_width > 1){
+    const size_t width = 4*filter_width, height = 3;
+    uint8_t *image = malloc(width*height);
+    uint8_t *result = malloc(width*height*num_filters);
+    for(size_t i = 0; i < width*height; ++i){
+      image[i] = i % width >= width/2 ? 255 : 0;
+    }
+    native_convolve2d(image,width,height,bank,num_filters,filter_width,result);
+    const size_t center = width + width/2;
+    CHECK(result[width*height + center] > 0,"derivative at 0 of %ux%u is 0 on a step",filter_width,filter_width);
+    CHECK(result[3*width*height + center] == 0,"derivative at pi of %ux%u is %d on a step",filter_width,filter_width,
+      result[3*width*height + center]);
+    free(image);
+    free(result);
+  }
+
+  free(bank);
+  free(gauss);
+}
+
+/* adaptive banks: buckets, radii growing with sigma, every filter
+ * normalized over its own width and zero around it, and packing
+ */
+static void check_adaptive(void){
+  const unsigned int buckets[][2] = {{1,1}, {2,3}, {3,3}, {6,7}, {8,9}, {10,13}, {14,17}, {18,25}, {26,33}, {34,49}, {50,65}};
+  for(size_t b = 0; b < sizeof(buckets)/sizeof(buckets[0]); ++b){
+    CHECK(filter_bucket_width(buckets[b][0]) == buckets[b][1],"width %u in bucket %u, expected %u",
+      buckets[b][0],filter_bucket_width(buckets[b][0]),buckets[b][1]);
+  }
+  unsigned int last = 0;
+  for(float sigma = 0.25f; sigma < 30.0f; sigma *= 1.5f){
+    const unsigned int radius = filter_Gauss_radius(sigma,FILTER_ADAPTIVE_EPSILON);
+    CHECK(radius >= last,"radius %u of sigma %g shrinks from %u",radius,sigma,last);
+    CHECK(radius >= sigma && radius <= 5*sigma + 1,"radius %u of sigma %g",radius,sigma);
+    last = radius;
+  }
+  CHECK(filter_Gauss_radius(1.0f,1e-6) > filter_Gauss_radius(1.0f,1e-2),"a tighter epsilon is no wider");
+
+  const unsigned int num_filters = 16;
+  unsigned int widths[16];
+  const unsigned int filter_width = filter_adaptive_widths(widths,num_filters,FILTER_ADAPTIVE_EPSILON,33);
+  CHECK(filter_width == 33 && widths[0] < widths[num_filters - 1],"adaptive widths %u to %u, widest %u",
+    widths[0],widths[num_filters - 1],filter_width);
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  float *bank = malloc(sizeof(float)*filter_len*num_filters);
+  float *packed = malloc(sizeof(float)*filter_len*num_filters);
+  size_t offsets[16];
+  filter_Gauss2dbank_adaptive(bank,widths,num_filters,filter_width);
+  const size_t packed_len = filter_pack_bank(packed,offsets,bank,widths,NULL,num_filters,filter_width);
+
+  size_t offset = 0;
+  for(unsigned int f = 0; f < num_filters; ++f){
+    const float *filter = &bank[f*filter_len];
+    const unsigned int margin = (filter_width - widths[f])/2;
+    double sum = 0.0;
+    int outside = 0;
+    for(unsigned int y = 0; y < filter_width; ++y){
+      for(unsigned int x = 0; x < filter_width; ++x){
+        const float weight = filter[y*filter_width + x];
+        if(y < margin || y >= margin + widths[f] || x < margin || x >= margin + widths[f]){
+          outside += weight != 0.0f;
+        }else{
+          sum += weight;
+          outside += packed[offsets[f] + (y - margin)*widths[f] + x - margin] != weight;
+        }
+      }
+    }
+    CHECK(fabs(sum - 1.0) < 1e-4,"adaptive filter %u of width %u sums to %g",f,widths[f],sum);
+    CHECK(outside == 0,"adaptive filter %u of width %u has %d weights misplaced",f,widths[f],outside);
+    CHECK(offsets[f] == offset,"adaptive filter %u packed at %zu, expected %zu",f,offsets[f],offset);
+    offset += (size_t)widths[f]*widths[f];
+  }
+  CHECK(packed_len == offset,"packed length %zu, expected %zu",packed_len,offset);
+  free(bank);
+  free(packed);
+}
+
+/* stages of epilogues, worked through by hand on the sums of one pixel */
+static void check_epilogues(void){
+  struct gimc_epilogue epilogue;
+  CHECK(epilogue_parse("",&epilogue) == 0 && epilogue_is_identity(&epilogue),"empty epilogue");
+  CHECK(epilogue_parse("dog,magic",&epilogue) != 0,"unknown stage parsed");
+  CHECK(epilogue_parse("scale=2x",&epilogue) != 0,"scale with trailing junk parsed");
+  CHECK(epilogue_parse("dog",&epilogue) == 0 && epilogue_planes(&epilogue,1) == 0,"dog of 1 filter");
+  CHECK(epilogue_planes(&epilogue,8) == 7,"dog of 8 filters leaves %u",epilogue_planes(&epilogue,8));
+
+  const float sums[4] = {100.0f, 60.5f, 70.0f, -20.0f};
+  uint8_t out[4];
+  epilogue_parse("dog,scale=2,offset=1",&epilogue);
+  epilogue_apply(&epilogue,sums,4,out,1);
+  CHECK(out[0] == 80 && out[1] == 0 && out[2] == 181,"dog gives %d %d %d",out[0],out[1],out[2]);
+  epilogue_parse("max,round",&epilogue);
+  epilogue_apply(&epilogue,sums,4,out,1);
+  CHECK(epilogue_planes(&epilogue,4) == 1 && out[0] == 100,"max gives %d",out[0]);
+  epilogue_parse("min",&epilogue);
+  epilogue_apply(&epilogue,sums,4,out,1);
+  CHECK(out[0] == 0,"min gives %d",out[0]);
+  epilogue_parse("argmax,scale=10",&epilogue);
+  epilogue_apply(&epilogue,sums,4,out,1);
+  CHECK(out[0] == 0,"argmax gives %d",out[0]);
+  epilogue_parse("dog,argmax",&epilogue);
+  epilogue_apply(&epilogue,sums,4,out,1);
+  CHECK(out[0] == 2,"argmax of dog gives %d",out[0]);
+  epilogue_parse("offset=0.5,round",&epilogue);
+  epilogue_apply(&epilogue,sums,4,out,1);
+  CHECK(out[1] == 61 && out[2] == 70,"rounding gives %d %d",out[1],out[2]);
+  epilogue_parse("threshold=65",&epilogue);
+  epilogue_apply(&epilogue,sums,4,out,1);
+  CHECK(out[0] == 255 && out[1] == 0 && out[2] == 255 && out[3] == 0,"threshold gives %d %d %d %d",out[0],out[1],out[2],out[3]);
+
+  /* without stages it is the plain reference */
+  uint8_t image[9*7], plain[2*9*7], reduced[2*9*7];
+  float bank[2*5*5];
+  test_image(image,9,7,TEST_NOISE,3);
+  filter_Gauss2dbank(bank,2,5);
+  epilogue_identity(&epilogue);
+  native_convolve2d(image,9,7,bank,2,5,plain);
+  native_convolve2d_epilogue(image,9,7,bank,2,5,&epilogue,reduced);
+  CHECK(memcmp(plain,reduced,sizeof(plain)) == 0,"identity epilogue differs from the reference");
+}
+
+int main(void){
+  check_adaptive();
+  const unsigned int widths[] = {1, 3, 7, 49};
+  const size_t sizes[][2] = {{1,1}, {5,3}, {3,5}, {17,31}, {64,48}};
+
+  for(size_t w = 0; w < sizeof(widths)/sizeof(widths[0]); ++w){
+    for(size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s){
+      check_taps(widths[w],sizes[s][0],sizes[s][1]);
+    }
+    check_bank(1,widths[w]);
+    check_bank(8,widths[w]);
+    check_steerable(widths[w]);
+  }
+  check_epilogues();
+
+  return test_status();
+}
@@ -0,0 +1,126 @@
+/* regions of interest have to match the same pixels of a full convolution,
+ * and overlapping requests only compute the tiles they haven't seen
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roi.h"
+#include "native.h"
+#include "filter.h"
+#include "test_util.h"
+
+/* request a rectangle and compare it with the full reference */
+static void check(struct gimc_roi *roi, const uint8_t *expected, size_t x, size_t y, size_t w, size_t h,
+  const unsigned int *filters, unsigned int num_filters, struct roi_stats *stats, const char *step){
+  const struct gimc_rect rect = {x, y, w, h};
+  uint8_t *result = malloc(w*h*num_filters);
+  if(gimc_roi_request(roi,&rect,filters,num_filters,result,stats)){
+    fprintf(stderr,"FAIL %s: request refused\n",step);
+    ++test_failures;
+    free(result);
+    return;
+  }
+  const size_t image_size = roi->width*roi->height;
+  size_t mismatches = 0;
+  for(unsigned int i = 0; i < num_filters; ++i){
+    const unsigned int f = filters ? filters[i] : i;
+    for(size_t row = 0; row < h; ++row){
+      for(size_t col = 0; col < w; ++col){
+        mismatches += abs(result[i*w*h + row*w + col] - expected[f*image_size + (y + row)*roi->width + x + col]) > 1;
+      }
+    }
+  }
+  if(mismatches){
+    fprintf(stderr,"FAIL %s: %zu mismatches\n",step,mismatches);
+    ++test_failures;
+  }
+  free(result);
+}
+
+int main(void){
+  if(!test_has_device(CL_DEVICE_TYPE_CPU)){
+    fprintf(stderr,"no CPU OpenCL device, skipping\n");
+    return TEST_SKIP;
+  }
+
+  struct gimc_cl cl;
+  gimc_cl_init(&cl,CL_DEVICE_TYPE_CPU,0);
+
+  const size_t width = 301, height = 203;
+  const unsigned int filter_width = 15, num_filters = 3;
+  float *weights = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+  filter_Gauss2dbank(weights,num_filters,filter_width);
+  struct gimc_bank bank;
+  if(gimc_bank_upload(&cl,&bank,weights,num_filters,filter_width)){
+    return EXIT_FAILURE;
+  }
+  uint8_t *image = malloc(width*height);
+  test_image(image,width,height,TEST_NOISE,1);
+  uint8_t *expected = malloc(width*height*num_filters);
+  native_convolve2d(image,width,height,weights,num_filters,filter_width,expected);
+
+  struct gimc_roi roi;
+  struct roi_stats stats;
+  if(gimc_roi_create(&roi,&cl,&bank,image,width,height,32,0)){
+    fprintf(stderr,"FAIL setting up\n");
+    return EXIT_FAILURE;
+  }
+
+  /* a viewport inside the image, then the same one again */
+  check(&roi,expected,40,50,70,45,NULL,num_filters,&stats,"viewport");
+  const size_t first_tiles = stats.computed_tiles;
+  if(first_tiles == 0 || stats.uploaded_bytes >= width*height){
+    fprintf(stderr,"FAIL viewport computed %zu tiles from %zu bytes\n",first_tiles,stats.uploaded_bytes);
+    ++test_failures;
+  }
+  check(&roi,expected,40,50,70,45,NULL,num_filters,&stats,"same viewport");
+  if(stats.computed_tiles != 0 || stats.hit_tiles != first_tiles || stats.launches != 0){
+    fprintf(stderr,"FAIL same viewport computed %zu tiles, %zu hits\n",stats.computed_tiles,stats.hit_tiles);
+    ++test_failures;
+  }
+
+  /* a pan only computes the tiles it uncovers */
+  check(&roi,expected,60,50,70,45,NULL,num_filters,&stats,"pan");
+  if(stats.computed_tiles == 0 || stats.hit_tiles == 0 || stats.computed_tiles >= first_tiles){
+    fprintf(stderr,"FAIL pan computed %zu tiles, %zu hits\n",stats.computed_tiles,stats.hit_tiles);
+    ++test_failures;
+  }
+
+  /* some filters in another order, at the corners and across the last partial tiles */
+  const unsigned int subset[2] = {2, 0};
+  check(&roi,expected,0,0,9,7,subset,2,&stats,"corner");
+  check(&roi,expected,280,190,21,13,subset,2,&stats,"last tiles");
+  check(&roi,expected,0,0,width,height,NULL,num_filters,&stats,"everything");
+
+  /* a cache of a few tiles still serves every request */
+  struct gimc_roi small;
+  if(gimc_roi_create(&small,&cl,&bank,image,width,height,16,3*16*16)){
+    ++test_failures;
+  }else{
+    check(&small,expected,100,20,90,90,NULL,num_filters,&stats,"small cache");
+    check(&small,expected,30,120,50,40,subset + 1,1,&stats,"small cache pan");
+    /* only the tiles of the last request are left */
+    if(small.cached_tiles > stats.computed_tiles + stats.hit_tiles){
+      fprintf(stderr,"FAIL small cache keeps %zu tiles\n",small.cached_tiles);
+      ++test_failures;
+    }
+    gimc_roi_release(&small);
+  }
+
+  const struct gimc_rect outside = {300, 0, 2, 1};
+  uint8_t pixel[2*num_filters];
+  if(gimc_roi_request(&roi,&outside,NULL,num_filters,pixel,NULL) == CL_SUCCESS){
+    fprintf(stderr,"FAIL region outside the image\n");
+    ++test_failures;
+  }
+
+  gimc_roi_release(&roi);
+  gimc_bank_release(&bank);
+  gimc_cl_release(&cl);
+  free(weights);
+  free(image);
+  free(expected);
+  return test_status();
+}
@@ -0,0 +1,94 @@
+/* the plans of the sat engine: extended boxes have the variance asked
+ * for, boxes are exact, and Gaussians wide enough not to be truncated
+ * are approximated more closely with more passes. needs no OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "filter.h"
+#include "sat.h"
+#include "test_util.h"
+
+/* sum and variance of the 1d box an extended box is the product of */
+static void check_extended_box(double variance){
+  struct sat_box box;
+  sat_extended_box(variance,&box);
+  const double inner = sqrt(box.inner);
+  const double outer = box.edge/inner;
+  const long r = box.radius;
+  double sum = 0.0, moment = 0.0;
+  for(long d = -r - 1; d <= r + 1; ++d){
+    const double weight = labs(d) > r ? outer : inner;
+    sum += weight;
+    moment += weight*d*d;
+  }
+  CHECK(fabs(sum - 1.0) < 1e-6,"extended box of variance %g sums to %g",variance,sum);
+  CHECK(fabs(moment - variance) < 1e-4*(1.0 + variance),"extended box of variance %g has %g",variance,moment);
+  CHECK(outer >= 0.0 && outer < inner + 1e-6,"extended box of variance %g weighs its ends %g, inside %g",variance,outer,inner);
+  CHECK(fabs(box.corner - outer*outer) < 1e-6,"corner of extended box of variance %g",variance);
+}
+
+static void check_box(unsigned int width, float weight){
+  const size_t filter_len = (size_t)width*width;
+  float *filter = malloc(sizeof(float)*filter_len);
+  for(size_t i = 0; i < filter_len; ++i){
+    filter[i] = weight;
+  }
+  struct sat_plan plan;
+  sat_plan_filter(filter,width,SAT_PASSES,&plan);
+  CHECK(plan.exact && plan.passes == 1,"box of width %u is not exact",width);
+  CHECK(plan.boxes[0].radius == (width - 1)/2 && plan.boxes[0].inner == weight,"box of width %u",width);
+  CHECK(plan.boxes[0].edge == 0.0f && plan.boxes[0].corner == 0.0f,"box of width %u has outer cells",width);
+  CHECK(sat_plan_padding(&plan) == 0,"box of width %u is padded",width);
+  free(filter);
+}
+
+/* Gaussians of the bank, the widest is 25 and is hardly truncated by 151 */
+static void check_gauss(unsigned int num_filters, unsigned int width){
+  const size_t filter_len = (size_t)width*width;
+  float *bank = malloc(sizeof(float)*filter_len*num_filters);
+  filter_Gauss2dbank(bank,num_filters,width);
+  for(unsigned int f = 0; f < num_filters; ++f){
+    double previous = INFINITY;
+    for(unsigned int passes = SAT_MIN_PASSES; passes <= SAT_MAX_PASSES; ++passes){
+      struct sat_plan plan;
+      sat_plan_filter(&bank[f*filter_len],width,passes,&plan);
+      const float sigma = filter_Gauss2dbank_sigma(f,num_filters);
+      CHECK(!plan.exact && plan.passes == passes,"Gaussian %g planned as %u passes",sigma,plan.passes);
+      CHECK(plan.error < 0.1,"Gaussian %g of width %u in %u passes is off by %g",sigma,width,passes,plan.error);
+      CHECK(plan.error < previous,"Gaussian %g is no closer in %u passes",sigma,passes);
+      previous = plan.error;
+
+      /* the weights of the last pass carry the gain of the filter, here 1 */
+      double total = 1.0;
+      for(unsigned int p = 0; p < passes; ++p){
+        const double inner = sqrt(plan.boxes[p].inner);
+        const double outer = plan.boxes[p].edge/inner;
+        total *= (2*plan.boxes[p].radius + 1)*inner + 2*outer;
+      }
+      CHECK(fabs(total - 1.0) < 1e-4,"Gaussian %g in %u passes sums to %g",sigma,passes,total*total);
+    }
+  }
+
+  /* passes out of range are clamped */
+  struct sat_plan plan;
+  sat_plan_filter(bank,width,1,&plan);
+  CHECK(plan.passes == SAT_MIN_PASSES,"1 pass planned as %u",plan.passes);
+  sat_plan_filter(bank,width,100,&plan);
+  CHECK(plan.passes == SAT_MAX_PASSES,"100 passes planned as %u",plan.passes);
+  free(bank);
+}
+
+int main(void){
+  for(double variance = 0.0; variance < 700.0; variance = variance*1.7 + 0.3){
+    check_extended_box(variance);
+  }
+  check_box(1,1.0f);
+  check_box(7,1.0f/49);
+  check_box(151,1.0f);
+  check_gauss(4,151);
+
+  return test_status();
+}
@@ -0,0 +1,146 @@
+/* sparse taps against native_convolve2d: every nonzero tap is kept in row
+ * order, results of the kept taps match the dense filters and those with
+ * taps dropped stay within the error of the bank. needs no OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "filter.h"
+#include "native.h"
+#include "sparse.h"
+#include "test_util.h"
+
+/* sums take the taps in the order of the reference, but a compiler may
+ * contract them into fused multiply-adds
+ */
+#define TOLERANCE 1
+
+#define NUM_FILTERS 4
+
+/* a Gaussian, a horizontal line, a ring and an empty filter */
+static void make_bank(float *bank, unsigned int filter_width){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  const int radius = (filter_width - 1)/2;
+  filter_Gauss2dbank(bank,1,filter_width);
+  memset(&bank[filter_len],0,sizeof(float)*filter_len*(NUM_FILTERS - 1));
+  for(unsigned int x = 0; x < filter_width; ++x){
+    /* asymmetric, which catches taps taken forwards */
+    bank[filter_len + radius*filter_width + x] = (x + 1.0f)/(filter_width*filter_width);
+  }
+  for(int y = -radius; y <= radius; ++y){
+    for(int x = -radius; x <= radius; ++x){
+      const double r = sqrt((double)x*x + y*y);
+      if(fabs(r - radius) < 0.5){
+        bank[2*filter_len + (y + radius)*filter_width + x + radius] = 1.0f/(4*filter_width);
+      }
+    }
+  }
+}
+
+static size_t mismatches(const uint8_t *result, const uint8_t *expected, size_t size, int tolerance){
+  size_t count = 0;
+  for(size_t i = 0; i < size; ++i){
+    count += abs(result[i] - expected[i]) > tolerance;
+  }
+  return count;
+}
+
+static void check_width(unsigned int filter_width, size_t width, size_t height, unsigned int seed){
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  const size_t image_size = width*height;
+  uint8_t *image = malloc(image_size);
+  float *bank = malloc(sizeof(float)*filter_len*NUM_FILTERS);
+  uint8_t *expected = malloc(image_size*NUM_FILTERS);
+  uint8_t *result = malloc(image_size*NUM_FILTERS);
+  test_image(image,width,height,seed % NUM_TEST_PATTERNS,seed);
+  make_bank(bank,filter_width);
+  native_convolve2d(image,width,height,bank,NUM_FILTERS,filter_width,expected);
+
+  /* every nonzero tap is kept, in row order */
+  struct sparse_bank sparse;
+  sparse_from_bank(bank,NUM_FILTERS,filter_width,0.0,&sparse);
+  for(unsigned int f = 0; f < NUM_FILTERS; ++f){
+    size_t nonzero = 0;
+    for(size_t i = 0; i < filter_len; ++i){
+      nonzero += bank[f*filter_len + i] != 0.0f;
+    }
+    CHECK(sparse.starts[f + 1] - sparse.starts[f] == nonzero && sparse.errors[f] == 0.0,
+      "filter %u of width %u keeps %u of %zu nonzero taps",f,filter_width,sparse.starts[f + 1] - sparse.starts[f],nonzero);
+    for(unsigned int t = sparse.starts[f] + 1; t < sparse.starts[f + 1]; ++t){
+      const struct sparse_tap *tap = &sparse.taps[t];
+      CHECK(tap[-1].dy < tap->dy || (tap[-1].dy == tap->dy && tap[-1].dx < tap->dx),
+        "tap %u of filter %u of width %u out of row order",t,f,filter_width);
+    }
+  }
+  CHECK(sparse.starts[NUM_FILTERS - 1] == sparse.starts[NUM_FILTERS],"the empty filter keeps taps");
+  memset(result,0xff,image_size*NUM_FILTERS);
+  sparse_convolve2d(image,width,height,&sparse,result);
+  const size_t exact = mismatches(result,expected,image_size*NUM_FILTERS,TOLERANCE);
+  CHECK(exact == 0,"nonzero taps of width %u on %zux%zu have %zu mismatches",filter_width,width,height,exact);
+  sparse_release(&sparse);
+
+  /* dropped taps are accounted for */
+  const double threshold = 0.05;
+  sparse_from_bank(bank,NUM_FILTERS,filter_width,threshold,&sparse);
+  for(unsigned int f = 0; f < NUM_FILTERS; ++f){
+    double largest = 0.0, dropped = 0.0;
+    for(size_t i = 0; i < filter_len; ++i){
+      largest = fabs(bank[f*filter_len + i]) > largest ? fabs(bank[f*filter_len + i]) : largest;
+    }
+    for(size_t i = 0; i < filter_len; ++i){
+      dropped += fabs(bank[f*filter_len + i]) <= threshold*largest ? fabs(bank[f*filter_len + i]) : 0.0;
+    }
+    CHECK(fabs(sparse.errors[f] - dropped) < 1e-6,"filter %u of width %u drops %g, not %g",f,filter_width,
+      sparse.errors[f],dropped);
+  }
+  sparse_convolve2d(image,width,height,&sparse,result);
+  const int tolerance = TOLERANCE + (int)ceil(255.0*sparse_max_error(&sparse));
+  const size_t pruned = mismatches(result,expected,image_size*NUM_FILTERS,tolerance);
+  CHECK(pruned == 0,"pruned taps of width %u on %zux%zu have %zu mismatches beyond %d",filter_width,width,height,
+    pruned,tolerance);
+  sparse_release(&sparse);
+
+  free(image);
+  free(bank);
+  free(expected);
+  free(result);
+}
+
+int main(void){
+  const size_t sizes[][2] = {{1,1}, {5,3}, {3,5}, {17,31}, {131,67}};
+  const unsigned int widths[] = {1, 3, 5, 9, 25, 49};
+  unsigned int seed = 0;
+  for(size_t w = 0; w < sizeof(widths)/sizeof(widths[0]); ++w){
+    for(size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s){
+      check_width(widths[w],sizes[s][0],sizes[s][1],seed++);
+    }
+  }
+
+  /* a narrow Gaussian in a wide filter keeps far fewer taps once its tail
+   * is dropped
+   */
+  const unsigned int filter_width = 49;
+  const int radius = filter_width/2;
+  float *bank = malloc(sizeof(float)*filter_width*filter_width);
+  double sum = 0.0;
+  for(int y = -radius; y <= radius; ++y){
+    for(int x = -radius; x <= radius; ++x){
+      bank[(y + radius)*filter_width + x + radius] = exp(-(x*x + y*y)/(2.0*6.0*6.0));
+      sum += bank[(y + radius)*filter_width + x + radius];
+    }
+  }
+  for(unsigned int i = 0; i < filter_width*filter_width; ++i){
+    bank[i] /= sum;
+  }
+  struct sparse_bank sparse;
+  sparse_from_bank(bank,1,filter_width,0.01,&sparse);
+  CHECK(sparse.num_taps < filter_width*filter_width/2 && sparse.errors[0] < 0.05,
+    "tail of a Gaussian of width %u keeps %zu taps and drops %g",filter_width,sparse.num_taps,sparse.errors[0]);
+  sparse_release(&sparse);
+  free(bank);
+
+  return test_status();
+}
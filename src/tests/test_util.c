@@ -0,0 +1,94 @@
+#include "test_util.h"
+#include <stdlib.h>
+
+#include "epilogue.h"
+
+int test_failures = 0;
+
+int test_status(void){
+  if(test_failures){
+    fprintf(stderr,"%d checks failed\n",test_failures);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int test_has_device(cl_device_type device_type){
+  cl_uint num_platforms = 0;
+  if(clGetPlatformIDs(0,NULL,&num_platforms) != CL_SUCCESS || num_platforms == 0){
+    return 0;
+  }
+
+  cl_platform_id platform_ids[16];
+  if(num_platforms > 16){
+    num_platforms = 16;
+  }
+  clGetPlatformIDs(num_platforms,platform_ids,NULL);
+  for(cl_uint i = 0; i < num_platforms; ++i){
+    cl_uint num_devices = 0;
+    if(clGetDeviceIDs(platform_ids[i],device_type,0,NULL,&num_devices) == CL_SUCCESS && num_devices > 0){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void test_image(uint8_t *image, size_t width, size_t height, enum test_pattern pattern, unsigned int seed){
+  uint32_t state = seed*2654435761u + 1;
+  for(size_t y = 0; y < height; ++y){
+    for(size_t x = 0; x < width; ++x){
+      uint8_t value;
+      switch(pattern){
+      case TEST_RAMP:
+        value = (x + y)*255/(width + height);
+        break;
+      case TEST_CHECKER:
+        value = (x + y) % 2 ? 255 : 0;
+        break;
+      case TEST_NOISE:
+      default:
+        /* linear congruential generator, the high bits are the random ones */
+        state = state*1664525u + 1013904223u;
+        value = state >> 24;
+        break;
+      }
+      image[y*width + x] = value;
+    }
+  }
+}
+
+cl_int test_convolve(struct gimc_cl *cl, enum engine_id engine, const uint8_t *image, size_t width, size_t height,
+  const struct gimc_bank *bank, uint8_t *result, struct engine_timing *timing){
+  return test_convolve_epilogue(cl,engine,image,width,height,bank,NULL,result,timing);
+}
+
+cl_int test_convolve_epilogue(struct gimc_cl *cl, enum engine_id engine, const uint8_t *image, size_t width, size_t height,
+  const struct gimc_bank *bank, const struct gimc_epilogue *epilogue, uint8_t *result, struct engine_timing *timing){
+  cl_int err;
+  const size_t image_size = width*height;
+  const size_t result_size = image_size*(epilogue ? epilogue_planes(epilogue,bank->num_filters) : bank->num_filters);
+
+  cl_mem d_image = clCreateBuffer(cl->context,CL_MEM_READ_ONLY,image_size,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() image",err);
+    return err;
+  }
+  cl_mem d_result = clCreateBuffer(cl->context,CL_MEM_WRITE_ONLY,result_size,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() result",err);
+    clReleaseMemObject(d_image);
+    return err;
+  }
+
+  err = clEnqueueWriteBuffer(cl->commands,d_image,CL_FALSE,0,image_size,image,0,NULL,NULL);
+  if(!err){
+    err = engine_convolve_epilogue(cl,engine,d_image,width,height,bank,epilogue,d_result,timing);
+  }
+  if(!err){
+    err = clEnqueueReadBuffer(cl->commands,d_result,CL_TRUE,0,result_size,result,0,NULL,NULL);
+  }
+
+  clReleaseMemObject(d_image);
+  clReleaseMemObject(d_result);
+  return err;
+}
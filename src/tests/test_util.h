@@ -0,0 +1,60 @@
+/* helpers shared by the tests
+ * tests which need OpenCL run on the CPU device and are skipped when
+ * there is none, as CTest is told by TEST_SKIP. host tests count their
+ * failed checks with CHECK
+ */
+
+#ifndef GIMC_TEST_UTIL_H
+#define GIMC_TEST_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "engine.h"
+
+/* exit status of a skipped test, see SKIP_RETURN_CODE in CMakeLists.txt */
+#define TEST_SKIP 77
+
+/* checks failed so far, counted by CHECK */
+extern int test_failures;
+
+/* count a check which fails, saying where and why in printf style */
+#define CHECK(cond, ...) do{ \
+    if(!(cond)){ \
+      fprintf(stderr,"%s:%d: ",__FILE__,__LINE__); \
+      fprintf(stderr,__VA_ARGS__); \
+      fputc('\n',stderr); \
+      ++test_failures; \
+    } \
+  }while(0)
+
+/* exit status of a test, reporting how many checks failed */
+extern int test_status(void);
+
+/* nonzero if there is an OpenCL device of device_type */
+extern int test_has_device(cl_device_type device_type);
+
+/* synthetic images */
+enum test_pattern{
+  TEST_NOISE, /* uniform noise */
+  TEST_RAMP, /* diagonal ramp */
+  TEST_CHECKER, /* 0 and 255 checkerboard, saturates every sum */
+  NUM_TEST_PATTERNS
+};
+
+/* fill a width*height image with a pattern, seed varies the noise */
+extern void test_image(uint8_t *image,size_t width,size_t height,enum test_pattern pattern,unsigned int seed);
+
+/* convolve a host image with an engine and read the result back
+ * result receives num_filters planes of width*height pixels
+ * timing may be NULL, see engine_convolve
+ */
+extern cl_int test_convolve(struct gimc_cl *cl,enum engine_id engine,const uint8_t *image,size_t width,size_t height,
+  const struct gimc_bank *bank,uint8_t *result,struct engine_timing *timing);
+
+/* test_convolve with an epilogue, result receives epilogue_planes planes */
+extern cl_int test_convolve_epilogue(struct gimc_cl *cl,enum engine_id engine,const uint8_t *image,size_t width,size_t height,
+  const struct gimc_bank *bank,const struct gimc_epilogue *epilogue,uint8_t *result,struct engine_timing *timing);
+
+#endif
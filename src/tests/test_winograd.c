@@ -0,0 +1,116 @@
+/* the transforms of the winograd engine: F(4x4, r x r) reproduces the
+ * direct correlation of a tile, native minimal filtering is within
+ * rounding of native_convolve2d and other widths are refused. needs no
+ * OpenCL
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "filter.h"
+#include "native.h"
+#include "winograd.h"
+#include "test_util.h"
+
+/* a block from the transforms against the direct sums of a tile */
+static void check_block(unsigned int width){
+  struct winograd_transform t;
+  if(winograd_transform(width,&t)){
+    CHECK(0,"no transform for width %u",width);
+    return;
+  }
+  CHECK(t.m == WINOGRAD_M && t.n == t.m + width - 1 && t.n <= WINOGRAD_MAX_TILE,"F(%u,%u) has tiles of %u",t.m,width,t.n);
+  /* fewer multiplies per output than taps */
+  CHECK(t.n*t.n < width*width*t.m*t.m/2,"F(%u,%u) takes %u multiplies for %u outputs",t.m,width,t.n*t.n,t.m*t.m);
+
+  const unsigned int n = t.n;
+  float filter[25];
+  float tile[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  for(unsigned int i = 0; i < width*width; ++i){
+    filter[i] = ((int)(i*7 % 11) - 5)/8.0f;
+  }
+  for(unsigned int i = 0; i < n*n; ++i){
+    tile[i] = (float)((i*37 + 11) % 256);
+  }
+  float cells[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  winograd_filter(&t,filter,cells);
+
+  double transformed[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  for(unsigned int i = 0; i < n; ++i){
+    for(unsigned int j = 0; j < n; ++j){
+      double sum = 0.0;
+      for(unsigned int y = 0; y < n; ++y){
+        for(unsigned int x = 0; x < n; ++x){
+          sum += (double)t.bt[i*n + y]*tile[y*n + x]*t.bt[j*n + x];
+        }
+      }
+      transformed[i*n + j] = sum*cells[i*n + j];
+    }
+  }
+  const unsigned int r = width;
+  double worst = 0.0;
+  for(unsigned int i = 0; i < t.m; ++i){
+    for(unsigned int j = 0; j < t.m; ++j){
+      double sum = 0.0;
+      for(unsigned int y = 0; y < n; ++y){
+        for(unsigned int x = 0; x < n; ++x){
+          sum += (double)t.at[i*n + y]*transformed[y*n + x]*t.at[j*n + x];
+        }
+      }
+      /* the filter is used backwards, as by native_convolve2d */
+      double direct = 0.0;
+      for(unsigned int ky = 0; ky < r; ++ky){
+        for(unsigned int kx = 0; kx < r; ++kx){
+          direct += tile[(i + ky)*n + j + kx]*filter[(r - 1 - ky)*r + r - 1 - kx];
+        }
+      }
+      worst = fabs(sum - direct) > worst ? fabs(sum - direct) : worst;
+    }
+  }
+  CHECK(worst < 1e-3,"F(%u,%u) is %g from the direct sums",t.m,width,worst);
+}
+
+static void check_native(size_t width, size_t height, unsigned int filter_width, unsigned int num_filters){
+  const size_t image_size = width*height;
+  uint8_t *image = malloc(image_size);
+  for(size_t i = 0; i < image_size; ++i){
+    image[i] = (uint8_t)((i*7919 + 13*(i/width)) % 256);
+  }
+  float *bank = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+  filter_Gauss2dbank(bank,num_filters,filter_width);
+  uint8_t *expected = malloc(image_size*num_filters);
+  uint8_t *result = malloc(image_size*num_filters);
+  native_convolve2d(image,width,height,bank,num_filters,filter_width,expected);
+  CHECK(winograd_convolve2d(image,width,height,bank,num_filters,filter_width,result) == 0,"width %u refused",filter_width);
+  int worst = 0;
+  for(size_t i = 0; i < image_size*num_filters; ++i){
+    const int difference = abs(expected[i] - result[i]);
+    worst = difference > worst ? difference : worst;
+  }
+  CHECK(worst <= 1,"%zux%zu with %u filters of %u is %d from native_convolve2d",width,height,num_filters,filter_width,worst);
+  free(image);
+  free(bank);
+  free(expected);
+  free(result);
+}
+
+int main(void){
+  check_block(3);
+  check_block(5);
+
+  struct winograd_transform t;
+  const unsigned int refused[] = {1, 2, 4, 7, 49};
+  for(size_t i = 0; i < sizeof(refused)/sizeof(refused[0]); ++i){
+    CHECK(winograd_transform(refused[i],&t) != 0,"transform for width %u",refused[i]);
+  }
+
+  /* partial blocks at the right and bottom */
+  check_native(1,1,3,1);
+  check_native(5,3,3,2);
+  check_native(17,31,5,3);
+  check_native(131,67,3,4);
+  check_native(64,64,5,2);
+
+  return test_status();
+}
@@ -0,0 +1,544 @@
+#include "tool.h"
+
+/* standard headers */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project headers */
+#include "bankfile.h"
+#include "budget.h"
+#include "cache.h"
+#include "choose.h"
+#include "epilogue.h"
+#include "hash.h"
+#include "image.h"
+#include "filter.h"
+#include "multirate.h"
+#include "output.h"
+#include "sat.h"
+#include "sparse.h"
+#include "trace.h"
+
+/* size of the result cache unless GIMC_CACHE_SIZE gives one, in MiB */
+#define DEFAULT_CACHE_MB 1024
+
+/* options for the output, given as --format=, --output=, --threads= and
+ * --epilogue=, for the result cache, given as --cache=DIR or GIMC_CACHE
+ * and --cache-size=MiB or GIMC_CACHE_SIZE, the memory budget, given
+ * as --memory=MiB or GIMC_MEMORY_BUDGET, how TOOL_ENGINE_AUTO picks,
+ * given as --tuning=FILE or GIMC_TUNING and --benchmark=0|1, and the file
+ * of TOOL_BANK_FILE, given as --bank-file=FILE
+ */
+struct tool_output{
+  enum output_format format;
+  const char *prefix;
+  unsigned int threads;
+  struct gimc_epilogue epilogue;
+  const char *cache_dir;
+  size_t cache_bytes;
+  size_t memory_mb;
+  const char *tuning;
+  int benchmark;
+  const char *bank_file;
+};
+
+void tool_key_engine(struct result_key *key, enum engine_id engine){
+  /* rank engines agree with no other, approximate ones only with
+   * themselves at the same accuracy. the exact ones saturate alike, so
+   * share a key for banks which go negative too
+   */
+  double accuracy = 0.0;
+  int approximate = 1;
+  switch(engine){
+  case ENGINE_SAT:
+    accuracy = sat_passes();
+    break;
+  case ENGINE_MULTIRATE:
+    accuracy = multirate_target();
+    break;
+  case ENGINE_SPARSE:
+    /* only exact when it drops nothing but zeros */
+    accuracy = sparse_threshold();
+    approximate = accuracy != 0.0;
+    break;
+  default:
+    approximate = 0;
+    break;
+  }
+  if(!engine_is_linear(engine) || approximate){
+    const char *name = engine_name(engine);
+    key->bank = gimc_hash64(name,strlen(name),key->bank);
+  }
+  if(approximate){
+    key->bank = gimc_hash64(&accuracy,sizeof(accuracy),key->bank);
+  }
+}
+
+/* read the output options, removing them from argv like trace_init
+ * returns nonzero if an option is invalid
+ */
+static int parse_output(int *argc, char **argv, struct tool_output *output){
+  output->format = OUTPUT_JPEG;
+  output->prefix = "gray";
+  output->threads = 0;
+  epilogue_identity(&output->epilogue);
+  output->cache_dir = getenv("GIMC_CACHE");
+  const char *cache_mb = getenv("GIMC_CACHE_SIZE");
+  output->cache_bytes = (size_t)(cache_mb ? atol(cache_mb) : DEFAULT_CACHE_MB) << 20;
+  output->memory_mb = 0;
+  output->tuning = getenv("GIMC_TUNING");
+  output->benchmark = 1;
+  output->bank_file = NULL;
+
+  int kept = 1;
+  for(int i = 1; i < *argc; ++i){
+    if(strncmp(argv[i],"--format=",9) == 0){
+      output->format = output_format_from_name(argv[i] + 9);
+      if(output->format == NUM_OUTPUT_FORMATS){
+        fprintf(stderr,"Unknown output format %s\n",argv[i] + 9);
+        return 1;
+      }
+    }else if(strncmp(argv[i],"--output=",9) == 0){
+      output->prefix = argv[i] + 9;
+    }else if(strncmp(argv[i],"--threads=",10) == 0){
+      output->threads = atoi(argv[i] + 10);
+    }else if(strncmp(argv[i],"--epilogue=",11) == 0){
+      if(epilogue_parse(argv[i] + 11,&output->epilogue)){
+        fprintf(stderr,"Unknown epilogue %s\n",argv[i] + 11);
+        return 1;
+      }
+    }else if(strncmp(argv[i],"--cache=",8) == 0){
+      output->cache_dir = argv[i] + 8;
+    }else if(strncmp(argv[i],"--cache-size=",13) == 0){
+      output->cache_bytes = (size_t)atol(argv[i] + 13) << 20;
+    }else if(strncmp(argv[i],"--memory=",9) == 0){
+      output->memory_mb = atol(argv[i] + 9);
+    }else if(strncmp(argv[i],"--tuning=",9) == 0){
+      output->tuning = argv[i] + 9;
+    }else if(strncmp(argv[i],"--benchmark=",12) == 0){
+      output->benchmark = atoi(argv[i] + 12);
+    }else if(strncmp(argv[i],"--bank-file=",12) == 0){
+      output->bank_file = argv[i] + 12;
+    }else{
+      argv[kept++] = argv[i];
+    }
+  }
+  *argc = kept;
+  argv[kept] = NULL;
+  return 0;
+}
+
+/* a plane being read back, handed to the writer once the read completes */
+struct readback{
+  struct output_writer *writer;
+  unsigned int filter;
+  const uint8_t *plane;
+};
+
+static void CL_CALLBACK readback_complete(cl_event event, cl_int status, void *data){
+  (void)event;
+  struct readback *readback = data;
+  output_writer_submit(readback->writer,readback->filter,status == CL_COMPLETE ? readback->plane : NULL);
+}
+
+/* read count bytes at offset of result into host, handing the plane of
+ * readback to its writer once they arrive unless readback is NULL
+ * returns nonzero if the read could not be enqueued
+ */
+static cl_int read_rows(struct gimc_cl *cl, cl_mem result, size_t offset, size_t count, uint8_t *host,
+  struct readback *readback){
+  cl_event *traced = trace_event("read result");
+  cl_event event;
+  cl_int err = clEnqueueReadBuffer(cl->commands,result,CL_FALSE,offset,sizeof(uint8_t)*count,host,
+    0,NULL,traced ? traced : &event);
+  if(err){
+    print_error("clEnqueueReadBuffer() result",err);
+    return err;
+  }
+  if(traced){
+    event = *traced;
+  }
+  if(readback && clSetEventCallback(event,CL_COMPLETE,readback_complete,readback)){
+    /* write it once it is read instead */
+    clWaitForEvents(1,&event);
+    output_writer_submit(readback->writer,readback->filter,readback->plane);
+  }
+  if(!traced){
+    clReleaseEvent(event);
+  }
+  return CL_SUCCESS;
+}
+
+/* write every plane of a result, returns the number which failed */
+static int write_planes(const struct tool_output *output, const struct gimc_image *image,
+  unsigned int num_filters, const uint8_t *planes){
+  struct output_writer *writer = output_writer_create(output->prefix,output->format,image->width,image->height,image->top_down,
+    num_filters,output->threads);
+  if(writer == NULL){
+    return num_filters;
+  }
+  for(unsigned int i = 0; i < num_filters; ++i){
+    output_writer_submit(writer,i,&planes[i*image->width*image->height]);
+  }
+  return output_writer_finish(writer);
+}
+
+/* steerable bank of num_sigmas sigmas, returns nonzero if GIMC_STEER is invalid */
+static int tool_steerable(unsigned int num_sigmas, struct filter_steerable *steer){
+  const char *orientations = getenv("GIMC_STEER");
+  if(orientations == NULL){
+    orientations = TOOL_STEER;
+  }
+  steer->num_sigmas = num_sigmas;
+  if(sscanf(orientations,"%u,%u,%u",&steer->orientations[0],&steer->orientations[1],&steer->orientations[2]) != 3){
+    fprintf(stderr,"GIMC_STEER %s is not o0,o1,o2\n",orientations);
+    return 1;
+  }
+  return 0;
+}
+
+int tool_main(int argc, char **argv, enum engine_id engine, enum tool_bank bank_source){
+  trace_init(&argc,argv);
+  struct tool_output output;
+  if(parse_output(&argc,argv,&output) || argc < 5){
+    printf("Usage: %s [Image File] [Device Option] [Number of Filters] [Size of Filters]\n",argv[0]);
+    printf("  [--format=jpg|png|pgm|raw|tif|npy] [--output=prefix] [--threads=N]\n");
+    printf("  [--epilogue=dog,max|min|argmax,scale=S,offset=O,threshold=T,round]\n");
+    printf("  [--cache=DIR] [--cache-size=MiB] [--memory=MiB]\n");
+    return -1;
+  }
+
+  const cl_device_type device_type = gimc_device_type(argv[2]);
+
+  /* get the image */
+  char * const image_path = argv[1];
+  struct gimc_image image;
+
+  /* load grayscale of image */
+  trace_begin("load");
+  gimc_image_load(&image,image_path);
+  trace_end();
+
+  /* setup filters and result on host */
+  unsigned int filter_width = atoi(argv[4]);
+  unsigned int num_filters = atoi(argv[3]);
+  const size_t image_size = image.width*image.height;
+  float *h_filter = NULL;
+  unsigned int *dilations = NULL;
+  unsigned int *widths = NULL;
+  unsigned int *heights = NULL;
+  struct filter_steerable steer;
+  if(bank_source == TOOL_BANK_HOST){
+    h_filter = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+    filter_Gauss2dbank(h_filter,num_filters,filter_width);
+  }else if(bank_source == TOOL_BANK_STEERABLE){
+    if(tool_steerable(num_filters,&steer)){
+      return -1;
+    }
+    num_filters = filter_steerable_count(&steer);
+    h_filter = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+    filter_steerable_bank(h_filter,&steer,filter_width);
+  }else if(bank_source == TOOL_BANK_BOX){
+    h_filter = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+    filter_box_bank(h_filter,num_filters,filter_width);
+  }else if(bank_source == TOOL_BANK_ATROUS){
+    h_filter = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+    dilations = malloc(sizeof(unsigned int)*num_filters);
+    filter_atrous_bank(h_filter,dilations,num_filters,filter_width);
+  }else if(bank_source == TOOL_BANK_ADAPTIVE){
+    const char *epsilon = getenv("GIMC_ADAPTIVE_EPSILON");
+    widths = malloc(sizeof(unsigned int)*num_filters);
+    filter_width = filter_adaptive_widths(widths,num_filters,epsilon ? atof(epsilon) : FILTER_ADAPTIVE_EPSILON,filter_width);
+    h_filter = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+    filter_Gauss2dbank_adaptive(h_filter,widths,num_filters,filter_width);
+  }else if(bank_source == TOOL_BANK_FILE){
+    struct bankfile file;
+    if(output.bank_file == NULL){
+      fprintf(stderr,"No --bank-file= given\n");
+      return -1;
+    }
+    if(bankfile_open(&file,output.bank_file)){
+      return -1;
+    }
+    num_filters = file.num_filters;
+    widths = malloc(sizeof(unsigned int)*num_filters);
+    heights = malloc(sizeof(unsigned int)*num_filters);
+    filter_width = bankfile_widths(&file,widths,heights);
+    h_filter = malloc(sizeof(float)*filter_width*filter_width*num_filters);
+    bankfile_bank(&file,h_filter,filter_width);
+    bankfile_close(&file);
+  }
+
+  /* an epilogue may leave fewer planes than filters */
+  const unsigned int num_planes = epilogue_planes(&output.epilogue,num_filters);
+  if(num_planes == 0){
+    fprintf(stderr,"The epilogue leaves nothing of %u filters\n",num_filters);
+    free(h_filter);
+    free(dilations);
+    free(widths);
+    free(heights);
+    gimc_image_unload(&image);
+    return -1;
+  }
+
+  /* a result for the same pixels and bank may be cached */
+  struct result_cache *cache = NULL;
+  struct result_key key;
+  if(output.cache_dir){
+    cache = result_cache_open(output.cache_dir,output.cache_bytes);
+  }
+  if(cache){
+    trace_begin("hash");
+    key.image = gimc_hash64(image.bits,image_size,0);
+    if(h_filter){
+      key.bank = gimc_hash64(h_filter,sizeof(float)*filter_width*filter_width*num_filters,0);
+      if(dilations){
+        key.bank = gimc_hash64(dilations,sizeof(unsigned int)*num_filters,key.bank);
+      }
+    }else{
+      /* the device generates the bank, hash its parameters */
+      const char generator[] = "filter_Gauss2dbank device";
+      key.bank = gimc_hash64(generator,sizeof(generator),0);
+      for(unsigned int i = 0; i < num_filters; ++i){
+        const float sigma = filter_Gauss2dbank_sigma(i,num_filters);
+        key.bank = gimc_hash64(&sigma,sizeof(sigma),key.bank);
+      }
+    }
+    key.width = image.width;
+    key.height = image.height;
+    key.num_filters = num_planes;
+    key.filter_width = filter_width;
+    key.border = CACHE_BORDER_ZERO;
+    key.output = CACHE_OUTPUT_U8;
+    if(!epilogue_is_identity(&output.epilogue)){
+      key.output = CACHE_OUTPUT_EPILOGUE;
+      key.bank = gimc_hash64(&output.epilogue,sizeof(struct gimc_epilogue),key.bank);
+    }
+    tool_key_engine(&key,engine);
+    key.top_down = image.top_down;
+    trace_end();
+
+    struct cached_result cached;
+    if(result_cache_lookup(cache,&key,&cached) == 0){
+      /* no device work at all */
+      trace_begin("encode");
+      const int failures = write_planes(&output,&image,num_planes,cached.planes);
+      trace_end();
+      trace_finish();
+      result_cache_release(&cached);
+      result_cache_close(cache);
+      free(h_filter);
+      free(dilations);
+      free(widths);
+      free(heights);
+      gimc_image_unload(&image);
+      return failures ? EXIT_FAILURE : 0;
+    }
+  }
+
+  struct gimc_cl cl;
+  /* choosing an engine times the candidates with events */
+  gimc_cl_init(&cl,device_type,engine == TOOL_ENGINE_AUTO ? CL_QUEUE_PROFILING_ENABLE : 0);
+
+  /* variable for cl errors */
+  cl_int err;
+
+  struct gimc_bank bank;
+  if(bank_source == TOOL_BANK_STEERABLE){
+    err = gimc_bank_steerable(&cl,&bank,&steer,filter_width);
+    free(h_filter);
+  }else if(dilations){
+    err = gimc_bank_dilated(&cl,&bank,h_filter,dilations,num_filters,filter_width);
+    free(h_filter);
+    free(dilations);
+  }else if(widths){
+    err = gimc_bank_adaptive(&cl,&bank,h_filter,widths,heights,num_filters,filter_width);
+    free(h_filter);
+    free(widths);
+    free(heights);
+  }else if(h_filter){
+    err = gimc_bank_upload(&cl,&bank,h_filter,num_filters,filter_width);
+    free(h_filter);
+  }else{
+    err = gimc_bank_Gauss2d(&cl,&bank,num_filters,filter_width);
+  }
+  if(err){
+    print_error("creating filter bank",err);
+    exit(EXIT_FAILURE);
+  }
+
+  /* results are computed a chunk of filters and a band of rows at a time
+   * within the memory budget, see budget.h. epilogues combine filters and
+   * steerable banks share a basis, so they need the whole bank, and sat and
+   * multirate reach past the filter radius, so they need whole columns.
+   * dilated filters reach as far as their dense equivalents
+   */
+  struct gimc_budget budget;
+  gimc_budget_device(&cl,output.memory_mb,&budget);
+  const int split_bank = epilogue_is_identity(&output.epilogue) && bank.steerable.num_sigmas == 0;
+  const int split_rows = engine != ENGINE_SAT && engine != ENGINE_MULTIRATE;
+  struct budget_plan plan;
+  const unsigned int reach_width = filter_dilated_width(bank.dilations,num_filters,filter_width);
+  if(budget_plan(&budget,image.width,image.height,num_filters,reach_width,split_bank,split_rows,&plan)){
+    fprintf(stderr,"%u filters of width %u on %zux%zu pixels do not fit in the memory budget\n",
+      num_filters,filter_width,image.width,image.height);
+    exit(EXIT_FAILURE);
+  }
+  /* engines take 0 for the whole largest allocation */
+  cl.scratch_bytes = budget_scratch(&budget,&plan,image.width,image.height,num_filters,reach_width);
+  cl.scratch_bytes = cl.scratch_bytes ? cl.scratch_bytes : sizeof(float);
+
+  /* a chunk is written from one host buffer while the next is read into the other */
+  const unsigned int chunk_planes = plan.num_chunks > 1 ? plan.chunk_filters : num_planes;
+  const unsigned int num_buffers = plan.num_chunks > 1 ? 2 : 1;
+  uint8_t *h_result = malloc(sizeof(uint8_t)*image_size*chunk_planes*num_buffers);
+
+  /* set up device memory and load image data */
+  cl_mem d_image = gimc_image_buffer(&cl,&image,&err);
+  if(err){
+    exit(EXIT_FAILURE);
+  }
+
+  /* none of the candidates needs whole columns, so the plan holds */
+  if(engine == TOOL_ENGINE_AUTO){
+    struct engine_choice choice;
+    trace_begin("choose engine");
+    err = choose_engine(&cl,d_image,image.width,image.height,&bank,&output.epilogue,output.tuning,output.benchmark,&choice);
+    trace_end();
+    if(err){
+      exit(EXIT_FAILURE);
+    }
+    choose_log(stderr,&choice);
+    engine = choice.engine;
+  }
+  const size_t band_height = plan.num_bands > 1 ? plan.band_rows + 2*plan.halo : image.height;
+  const size_t band_size = image.width*(band_height < image.height ? band_height : image.height);
+  cl_mem d_band = NULL;
+  if(plan.num_bands > 1){
+    d_band = clCreateBuffer(cl.context,CL_MEM_READ_WRITE,sizeof(uint8_t)*band_size,NULL,&err);
+    if(err){
+      print_error("clCreateBuffer() band",err);
+      exit(EXIT_FAILURE);
+    }
+  }
+  cl_mem d_result = clCreateBuffer(cl.context,CL_MEM_WRITE_ONLY,sizeof(uint8_t)*band_size*chunk_planes,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() result",err);
+    exit(EXIT_FAILURE);
+  }
+
+  struct output_writer *writer = output_writer_create(output.prefix,output.format,image.width,image.height,image.top_down,
+    num_planes,output.threads);
+  if(writer == NULL){
+    exit(EXIT_FAILURE);
+  }
+
+  /* read back plane by plane, each is encoded as soon as its last band arrives */
+  struct readback *readbacks = malloc(sizeof(struct readback)*num_planes);
+  const size_t filter_len = (size_t)filter_width*filter_width;
+  for(unsigned int chunk = 0; chunk < plan.num_chunks; ++chunk){
+    const unsigned int first_filter = chunk*plan.chunk_filters;
+    const unsigned int chunk_filters = num_filters - first_filter < plan.chunk_filters ? num_filters - first_filter : plan.chunk_filters;
+    const unsigned int first_plane = plan.num_chunks > 1 ? first_filter : 0;
+    const unsigned int planes = plan.num_chunks > 1 ? chunk_filters : num_planes;
+    uint8_t *h_chunk = &h_result[(chunk % num_buffers)*chunk_planes*image_size];
+    if(chunk >= num_buffers){
+      /* the planes of the chunk before last are still in this buffer */
+      trace_begin("wait for encoding");
+      output_writer_wait(writer,first_filter - num_buffers*plan.chunk_filters,plan.chunk_filters);
+      trace_end();
+    }
+
+    struct gimc_bank chunk_bank;
+    const struct gimc_bank *run_bank = &bank;
+    if(plan.num_chunks > 1){
+      if(bank.dilations){
+        err = gimc_bank_dilated(&cl,&chunk_bank,&bank.weights[first_filter*filter_len],&bank.dilations[first_filter],chunk_filters,filter_width);
+      }else if(bank.widths){
+        err = gimc_bank_adaptive(&cl,&chunk_bank,&bank.weights[first_filter*filter_len],&bank.widths[first_filter],
+          &bank.heights[first_filter],chunk_filters,filter_width);
+      }else{
+        err = gimc_bank_upload(&cl,&chunk_bank,&bank.weights[first_filter*filter_len],chunk_filters,filter_width);
+      }
+      if(err){
+        print_error("uploading filter chunk",err);
+        exit(EXIT_FAILURE);
+      }
+      run_bank = &chunk_bank;
+    }
+
+    for(size_t band = 0; band < plan.num_bands; ++band){
+      size_t first, count, convolved, convolved_count;
+      budget_band(&plan,image.height,band,&first,&count,&convolved,&convolved_count);
+      cl_mem source = d_image;
+      if(d_band){
+        err = clEnqueueCopyBuffer(cl.commands,d_image,d_band,convolved*image.width,0,sizeof(uint8_t)*convolved_count*image.width,
+          0,NULL,trace_event("copy band"));
+        if(err){
+          print_error("clEnqueueCopyBuffer() band",err);
+          exit(EXIT_FAILURE);
+        }
+        source = d_band;
+      }
+
+      err = engine_convolve_epilogue(&cl,engine,source,image.width,convolved_count,run_bank,&output.epilogue,d_result,NULL);
+      if(err){
+        exit(EXIT_FAILURE);
+      }
+
+      const int last_band = band + 1 == plan.num_bands;
+      for(unsigned int i = 0; i < planes; ++i){
+        struct readback *readback = &readbacks[first_plane + i];
+        readback->writer = writer;
+        readback->filter = first_plane + i;
+        readback->plane = &h_chunk[i*image_size];
+        const size_t offset = i*convolved_count*image.width + (first - convolved)*image.width;
+        if(read_rows(&cl,d_result,offset,count*image.width,&h_chunk[i*image_size + first*image.width],
+            last_band ? readback : NULL)){
+          if(!last_band){
+            exit(EXIT_FAILURE);
+          }
+          output_writer_submit(writer,readback->filter,NULL);
+        }
+      }
+    }
+    /* callbacks only fire once the reads are submitted */
+    clFlush(cl.commands);
+
+    if(plan.num_chunks > 1){
+      gimc_bank_release(&chunk_bank);
+    }
+  }
+  clFinish(cl.commands);
+
+  /* wait for the writer */
+  trace_begin("encode");
+  const int failures = output_writer_finish(writer);
+  trace_end();
+
+  if(cache){
+    trace_begin("cache");
+    /* chunked results were never whole on the host */
+    if(!failures && plan.num_chunks == 1){
+      result_cache_store(cache,&key,h_result);
+    }
+    result_cache_close(cache);
+    trace_end();
+  }
+
+  trace_finish();
+
+  free(readbacks);
+  free(h_result);
+  clReleaseMemObject(d_image);
+  if(d_band){
+    clReleaseMemObject(d_band);
+  }
+  clReleaseMemObject(d_result);
+  gimc_bank_release(&bank);
+  gimc_cl_release(&cl);
+  gimc_image_unload(&image);
+  return failures ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,54 @@
+/* shared main of the command line tools
+ * each tool convolves an image with a bank of filters using one engine
+ * and writes every plane of the result, one per filter or per plane of
+ * the epilogue, in the chosen format on writer threads as the planes are
+ * read back, see output.h
+ */
+
+#ifndef GIMC_TOOL_H
+#define GIMC_TOOL_H
+
+#include "engine.h"
+
+/* where a tool generates its bank */
+enum tool_bank{
+  TOOL_BANK_HOST, /* filter_Gauss2dbank in filter.c, then uploaded */
+  TOOL_BANK_DEVICE, /* filter_Gauss2dbank kernel */
+  TOOL_BANK_STEERABLE, /* filter_steerable_bank, then gimc_bank_steerable */
+  TOOL_BANK_BOX, /* filter_box_bank, the windows of the rank engines */
+  TOOL_BANK_ATROUS, /* filter_atrous_bank, then gimc_bank_dilated */
+  /* filter_Gauss2dbank_adaptive, then gimc_bank_adaptive. the size of
+   * filters caps the widths, 0 for none, and GIMC_ADAPTIVE_EPSILON
+   * overrides FILTER_ADAPTIVE_EPSILON
+   */
+  TOOL_BANK_ADAPTIVE,
+  /* a bank file given by --bank-file=, see bankfile.h, then
+   * gimc_bank_adaptive. the number and size of filters are the file's
+   */
+  TOOL_BANK_FILE
+};
+
+/* orientations of each order of a steerable bank as o0,o1,o2 unless
+ * GIMC_STEER gives them, the number of filters of a tool is its sigmas
+ */
+#define TOOL_STEER "0,8,4"
+
+/* the engine of a tool which picks the fastest for its image, bank and
+ * device at run time, see choose.h
+ */
+#define TOOL_ENGINE_AUTO NUM_ENGINES
+
+struct result_key;
+
+/* tell apart in a key of the result cache the results of engines which
+ * don't agree with the exact ones, the rank engines and the approximate
+ * ones at their accuracy
+ */
+extern void tool_key_engine(struct result_key *key,enum engine_id engine);
+
+/* run a tool taking [Image File] [Device Option] [Number of Filters] [Size of Filters]
+ * returns the exit status of the tool
+ */
+extern int tool_main(int argc,char **argv,enum engine_id engine,enum tool_bank bank_source);
+
+#endif
@@ -0,0 +1,249 @@
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/* a finished or open span of host work */
+struct host_span{
+  char *name;
+  uint64_t begin; /* ns */
+  uint64_t end;
+};
+
+/* an enqueued command and the host time it was enqueued at */
+struct device_span{
+  char *name;
+  cl_event event;
+  uint64_t enqueued; /* ns */
+};
+
+/* the trace is process wide, as are the tools which record it */
+static struct{
+  char *path;
+  struct host_span *host;
+  size_t num_host;
+  size_t max_host;
+  size_t *open; /* stack of open host spans */
+  size_t num_open;
+  struct device_span *device;
+  size_t num_device;
+  size_t max_device;
+} trace;
+
+static int enabled = 0;
+
+static uint64_t now(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+static char *copy_string(const char *str){
+  char *copy = malloc(strlen(str)+1);
+  strcpy(copy,str);
+  return copy;
+}
+
+void trace_init(int *argc, char **argv){
+  const char *path = getenv("GIMC_TRACE");
+
+  /* a flag takes precedence over the environment */
+  for(int i = 1; i < *argc; ++i){
+    if(strncmp(argv[i],"--trace=",8) == 0){
+      path = argv[i] + 8;
+      for(int j = i; j < *argc - 1; ++j){
+        argv[j] = argv[j+1];
+      }
+      --*argc;
+      break;
+    }
+  }
+
+  if(path == NULL || path[0] == '\0'){
+    return;
+  }
+  trace.path = copy_string(path);
+  enabled = 1;
+}
+
+int trace_enabled(void){
+  return enabled;
+}
+
+cl_command_queue_properties trace_queue_properties(void){
+  return enabled ? CL_QUEUE_PROFILING_ENABLE : 0;
+}
+
+void trace_begin(const char *name){
+  if(!enabled){
+    return;
+  }
+
+  if(trace.num_host == trace.max_host){
+    trace.max_host = trace.max_host ? 2*trace.max_host : 64;
+    trace.host = realloc(trace.host,sizeof(struct host_span)*trace.max_host);
+    trace.open = realloc(trace.open,sizeof(size_t)*trace.max_host);
+  }
+  struct host_span *span = &trace.host[trace.num_host];
+  span->name = copy_string(name);
+  span->begin = now();
+  span->end = 0;
+  trace.open[trace.num_open++] = trace.num_host++;
+}
+
+void trace_end(void){
+  if(!enabled || trace.num_open == 0){
+    return;
+  }
+  trace.host[trace.open[--trace.num_open]].end = now();
+}
+
+cl_event *trace_event(const char *name){
+  if(!enabled){
+    return NULL;
+  }
+
+  if(trace.num_device == trace.max_device){
+    trace.max_device = trace.max_device ? 2*trace.max_device : 64;
+    trace.device = realloc(trace.device,sizeof(struct device_span)*trace.max_device);
+  }
+  struct device_span *span = &trace.device[trace.num_device++];
+  span->name = copy_string(name);
+  span->event = NULL;
+  span->enqueued = now();
+  return &span->event;
+}
+
+/* write a string as a JSON string literal */
+static void write_string(FILE *out, const char *str){
+  fputc('"',out);
+  for(; *str; ++str){
+    if(*str == '"' || *str == '\\'){
+      fputc('\\',out);
+    }
+    fputc(*str,out);
+  }
+  fputc('"',out);
+}
+
+/* write a complete event, times in ns relative to the start of the trace */
+static void write_span(FILE *out, int *first, const char *name, int tid, int64_t begin, int64_t end){
+  begin = begin < 0 ? 0 : begin;
+  end = end < begin ? begin : end;
+  fprintf(out,"%s\n  {\"name\":",*first ? "" : ",");
+  write_string(out,name);
+  fprintf(out,",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+    tid,begin/1000.0,(end - begin)/1000.0);
+  *first = 0;
+}
+
+/* tracks the spans are laid out on */
+enum{
+  TRACK_HOST = 1,
+  TRACK_QUEUE = 2,
+  TRACK_DEVICE = 3
+};
+
+void trace_finish(void){
+  if(!enabled){
+    return;
+  }
+  enabled = 0;
+
+  /* close spans which were left open */
+  const uint64_t finish = now();
+  while(trace.num_open > 0){
+    trace.host[trace.open[--trace.num_open]].end = finish;
+  }
+
+  FILE *out = fopen(trace.path,"w");
+  if(!out){
+    fprintf(stderr,"Failed to open trace file %s\n",trace.path);
+  }
+
+  /* the earliest host time is the origin of the trace */
+  uint64_t origin = finish;
+  for(size_t i = 0; i < trace.num_host; ++i){
+    origin = trace.host[i].begin < origin ? trace.host[i].begin : origin;
+  }
+  for(size_t i = 0; i < trace.num_device; ++i){
+    origin = trace.device[i].enqueued < origin ? trace.device[i].enqueued : origin;
+  }
+
+  int first = 1;
+  if(out){
+    fprintf(out,"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    const char *tracks[] = {"host","queue (queued to start)","device"};
+    for(int t = 0; t < 3; ++t){
+      fprintf(out,"%s\n  {\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+        first ? "" : ",",t+1,tracks[t]);
+      first = 0;
+    }
+    for(size_t i = 0; i < trace.num_host; ++i){
+      write_span(out,&first,trace.host[i].name,TRACK_HOST,(int64_t)(trace.host[i].begin - origin),(int64_t)(trace.host[i].end - origin));
+    }
+  }
+
+  /* device timestamps are on the device clock, they are moved onto the
+   * host clock with the offset between enqueueing and queueing the first command
+   */
+  int have_offset = 0;
+  int64_t offset = 0;
+  for(size_t i = 0; i < trace.num_device; ++i){
+    struct device_span *span = &trace.device[i];
+    if(span->event == NULL){
+      continue;
+    }
+
+    cl_ulong queued = 0, submit = 0, start = 0, end = 0;
+    clWaitForEvents(1,&span->event);
+    cl_int err = clGetEventProfilingInfo(span->event,CL_PROFILING_COMMAND_QUEUED,sizeof(cl_ulong),&queued,NULL);
+    err |= clGetEventProfilingInfo(span->event,CL_PROFILING_COMMAND_SUBMIT,sizeof(cl_ulong),&submit,NULL);
+    err |= clGetEventProfilingInfo(span->event,CL_PROFILING_COMMAND_START,sizeof(cl_ulong),&start,NULL);
+    err |= clGetEventProfilingInfo(span->event,CL_PROFILING_COMMAND_END,sizeof(cl_ulong),&end,NULL);
+    clReleaseEvent(span->event);
+    if(err){
+      fprintf(stderr,"Failed to get profiling info for %s, was the queue created with trace_queue_properties()?\n",span->name);
+      continue;
+    }
+
+    if(!have_offset){
+      offset = (int64_t)span->enqueued - (int64_t)queued;
+      have_offset = 1;
+    }
+
+    if(out){
+      const int64_t shift = offset - (int64_t)origin;
+      const int64_t host_queued = (int64_t)queued + shift;
+      const int64_t host_submit = (int64_t)submit + shift;
+      const int64_t host_start = (int64_t)start + shift;
+      const int64_t host_end = (int64_t)end + shift;
+      char waiting[256];
+      snprintf(waiting,sizeof(waiting),"%s (queued)",span->name);
+      write_span(out,&first,waiting,TRACK_QUEUE,host_queued,host_submit);
+      snprintf(waiting,sizeof(waiting),"%s (submitted)",span->name);
+      write_span(out,&first,waiting,TRACK_QUEUE,host_submit,host_start);
+      write_span(out,&first,span->name,TRACK_DEVICE,host_start,host_end);
+    }
+  }
+
+  if(out){
+    fprintf(out,"\n]}\n");
+    fclose(out);
+  }
+
+  for(size_t i = 0; i < trace.num_host; ++i){
+    free(trace.host[i].name);
+  }
+  for(size_t i = 0; i < trace.num_device; ++i){
+    free(trace.device[i].name);
+  }
+  free(trace.host);
+  free(trace.open);
+  free(trace.device);
+  free(trace.path);
+  memset(&trace,0,sizeof(trace));
+}
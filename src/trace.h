@@ -0,0 +1,36 @@
+/* timeline tracing of host and device work, written as Chrome trace JSON
+ * which can be opened in chrome://tracing or Perfetto
+ * tracing is off unless GIMC_TRACE names an output file or a tool is run
+ * with --trace=FILE. when off every call returns immediately
+ */
+
+#ifndef GIMC_TRACE_H
+#define GIMC_TRACE_H
+
+#include <CL/cl.h>
+
+/* turn tracing on if requested
+ * a --trace=FILE argument is removed from argv, argc is updated to match
+ * otherwise the GIMC_TRACE environment variable is used
+ */
+extern void trace_init(int *argc,char **argv);
+
+/* nonzero if tracing is on */
+extern int trace_enabled(void);
+
+/* properties a command queue needs so its commands can be traced */
+extern cl_command_queue_properties trace_queue_properties(void);
+
+/* begin and end a span of host work, spans nest */
+extern void trace_begin(const char *name);
+extern void trace_end(void);
+
+/* an event for an enqueue to fill in, or NULL when tracing is off
+ * pass the result straight as the event argument of a clEnqueue call
+ */
+extern cl_event *trace_event(const char *name);
+
+/* wait for traced commands, write the trace file and stop tracing */
+extern void trace_finish(void);
+
+#endif
@@ -0,0 +1,97 @@
+/* à trous wavelet decomposition of an image
+ * writes the details of every level and the residual smoothing as planes
+ * of the output, see atrous.h
+ */
+
+/* standard headers */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project headers */
+#include "atrous.h"
+#include "engine.h"
+#include "image.h"
+#include "output.h"
+#include "trace.h"
+
+int main(int argc, char **argv){
+  trace_init(&argc,argv);
+
+  /* options */
+  enum output_format format = OUTPUT_JPEG;
+  const char *prefix = "wavelet";
+  int kept = 1;
+  for(int i = 1; i < argc; ++i){
+    if(strncmp(argv[i],"--format=",9) == 0){
+      format = output_format_from_name(argv[i] + 9);
+    }else if(strncmp(argv[i],"--output=",9) == 0){
+      prefix = argv[i] + 9;
+    }else{
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
+  const unsigned int levels = argc > 3 ? atoi(argv[3]) : 0;
+  if(argc < 4 || format == NUM_OUTPUT_FORMATS || levels == 0 || levels > ATROUS_MAX_LEVELS){
+    printf("Usage: %s [Image File] [Device Option] [Levels, 1 to %d]\n",argv[0],ATROUS_MAX_LEVELS);
+    printf("  [--format=jpg|png|pgm|raw|tif|npy] [--output=prefix]\n");
+    printf("  details are offset by %d, the last plane is the residual\n",ATROUS_DETAIL_OFFSET);
+    return -1;
+  }
+
+  const cl_device_type device_type = gimc_device_type(argv[2]);
+  struct gimc_image image;
+  trace_begin("load");
+  gimc_image_load(&image,argv[1]);
+  trace_end();
+  const size_t image_size = image.width*image.height;
+  const unsigned int num_planes = levels + 1;
+
+  struct gimc_cl cl;
+  gimc_cl_init(&cl,device_type,0);
+  cl_int err;
+  cl_mem d_image = gimc_image_buffer(&cl,&image,&err);
+  if(err){
+    exit(EXIT_FAILURE);
+  }
+  cl_mem d_result = clCreateBuffer(cl.context,CL_MEM_WRITE_ONLY,sizeof(uint8_t)*image_size*num_planes,NULL,&err);
+  if(err){
+    print_error("clCreateBuffer() result",err);
+    exit(EXIT_FAILURE);
+  }
+
+  /* every level runs before a single read of all planes */
+  err = engine_wavelet(&cl,d_image,image.width,image.height,levels,d_result,NULL);
+  if(err){
+    exit(EXIT_FAILURE);
+  }
+  uint8_t *h_result = malloc(sizeof(uint8_t)*image_size*num_planes);
+  err = clEnqueueReadBuffer(cl.commands,d_result,CL_TRUE,0,sizeof(uint8_t)*image_size*num_planes,h_result,
+    0,NULL,trace_event("read result"));
+  if(err){
+    print_error("clEnqueueReadBuffer() result",err);
+    exit(EXIT_FAILURE);
+  }
+
+  trace_begin("encode");
+  int failures = num_planes;
+  struct output_writer *writer = output_writer_create(prefix,format,image.width,image.height,image.top_down,num_planes,0);
+  if(writer){
+    for(unsigned int i = 0; i < num_planes; ++i){
+      output_writer_submit(writer,i,&h_result[i*image_size]);
+    }
+    failures = output_writer_finish(writer);
+  }
+  trace_end();
+  trace_finish();
+
+  free(h_result);
+  clReleaseMemObject(d_image);
+  clReleaseMemObject(d_result);
+  gimc_cl_release(&cl);
+  gimc_image_unload(&image);
+  return failures ? EXIT_FAILURE : 0;
+}
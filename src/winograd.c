@@ -0,0 +1,206 @@
+#include "winograd.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* finite points of the Toom-Cook transforms, the last point is infinity */
+static const double points[WINOGRAD_MAX_TILE - 1] = {0.0, 1.0, -1.0, 2.0, -2.0, 0.5, -0.5};
+
+/* invert the n x n matrix a in place by Gauss-Jordan elimination */
+static void invert(double *a, unsigned int n){
+  double inverse[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  for(unsigned int i = 0; i < n*n; ++i){
+    inverse[i] = i/n == i%n;
+  }
+  for(unsigned int col = 0; col < n; ++col){
+    unsigned int pivot = col;
+    for(unsigned int row = col + 1; row < n; ++row){
+      if(fabs(a[row*n + col]) > fabs(a[pivot*n + col])){
+        pivot = row;
+      }
+    }
+    for(unsigned int k = 0; k < n; ++k){
+      double swap = a[col*n + k];
+      a[col*n + k] = a[pivot*n + k];
+      a[pivot*n + k] = swap;
+      swap = inverse[col*n + k];
+      inverse[col*n + k] = inverse[pivot*n + k];
+      inverse[pivot*n + k] = swap;
+    }
+    const double scale = 1.0/a[col*n + col];
+    for(unsigned int k = 0; k < n; ++k){
+      a[col*n + k] *= scale;
+      inverse[col*n + k] *= scale;
+    }
+    for(unsigned int row = 0; row < n; ++row){
+      const double factor = a[row*n + col];
+      if(row == col || factor == 0.0){
+        continue;
+      }
+      for(unsigned int k = 0; k < n; ++k){
+        a[row*n + k] -= factor*a[col*n + k];
+        inverse[row*n + k] -= factor*inverse[col*n + k];
+      }
+    }
+  }
+  memcpy(a,inverse,sizeof(double)*n*n);
+}
+
+/* row j of the evaluation of a polynomial of len coefficients at point j,
+ * the point at infinity takes the leading coefficient
+ */
+static double evaluation(unsigned int j, unsigned int k, unsigned int n, unsigned int len){
+  if(j == n - 1){
+    return k == len - 1;
+  }
+  return pow(points[j],k);
+}
+
+int winograd_transform(unsigned int width, struct winograd_transform *transform){
+  if(width != 3 && width != 5){
+    return 1;
+  }
+  const unsigned int m = WINOGRAD_M;
+  const unsigned int n = m + width - 1;
+  transform->m = m;
+  transform->r = width;
+  transform->n = n;
+
+  /* the product s = g*h of polynomials of r and m coefficients is
+   * interpolated from its values at the points, s = V^-1 (Gg . Ah). a
+   * correlation y = M_g^T d is the transpose, y = A^T (Gg . V^-T d)
+   */
+  double vandermonde[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  for(unsigned int j = 0; j < n; ++j){
+    for(unsigned int k = 0; k < n; ++k){
+      vandermonde[j*n + k] = evaluation(j,k,n,n);
+    }
+  }
+  invert(vandermonde,n);
+  for(unsigned int i = 0; i < n; ++i){
+    for(unsigned int j = 0; j < n; ++j){
+      transform->bt[i*n + j] = vandermonde[j*n + i];
+    }
+  }
+  for(unsigned int i = 0; i < m; ++i){
+    for(unsigned int j = 0; j < n; ++j){
+      transform->at[i*n + j] = evaluation(j,i,n,m);
+    }
+  }
+  for(unsigned int j = 0; j < n; ++j){
+    for(unsigned int k = 0; k < width; ++k){
+      transform->g[j*width + k] = evaluation(j,k,n,width);
+    }
+  }
+  return 0;
+}
+
+void winograd_filter(const struct winograd_transform *transform, const float *filter, float *cells){
+  const unsigned int n = transform->n;
+  const unsigned int r = transform->r;
+  /* the tile is correlated, so the filter is used backwards as in native_sum */
+  double half[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  for(unsigned int i = 0; i < n; ++i){
+    for(unsigned int kx = 0; kx < r; ++kx){
+      double sum = 0.0;
+      for(unsigned int ky = 0; ky < r; ++ky){
+        sum += transform->g[i*r + ky]*filter[(r - 1 - ky)*r + r - 1 - kx];
+      }
+      half[i*r + kx] = sum;
+    }
+  }
+  for(unsigned int i = 0; i < n; ++i){
+    for(unsigned int j = 0; j < n; ++j){
+      double sum = 0.0;
+      for(unsigned int kx = 0; kx < r; ++kx){
+        sum += half[i*r + kx]*transform->g[j*r + kx];
+      }
+      cells[i*n + j] = sum;
+    }
+  }
+}
+
+int winograd_convolve2d(const uint8_t *image, size_t image_width, size_t image_height,
+  const float *bank, unsigned int num_filters, unsigned int filter_width, uint8_t *result){
+  struct winograd_transform transform;
+  if(winograd_transform(filter_width,&transform)){
+    return 1;
+  }
+  const unsigned int m = transform.m;
+  const unsigned int n = transform.n;
+  const size_t cells = (size_t)n*n;
+  const long radius = (filter_width - 1)/2;
+  const size_t image_size = image_width*image_height;
+
+  float *filters = malloc(sizeof(float)*cells*num_filters);
+  for(unsigned int f = 0; f < num_filters; ++f){
+    winograd_filter(&transform,&bank[(size_t)f*filter_width*filter_width],&filters[f*cells]);
+  }
+
+  float tile[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  float half[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  float transformed[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  float product[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE];
+  for(size_t by = 0; by < image_height; by += m){
+    for(size_t bx = 0; bx < image_width; bx += m){
+      for(unsigned int y = 0; y < n; ++y){
+        const long row = (long)by - radius + y;
+        for(unsigned int x = 0; x < n; ++x){
+          const long col = (long)bx - radius + x;
+          const int inside = row >= 0 && row < (long)image_height && col >= 0 && col < (long)image_width;
+          tile[y*n + x] = inside ? image[row*image_width + col] : 0.0f;
+        }
+      }
+
+      /* B^T d B once for the bank */
+      for(unsigned int i = 0; i < n; ++i){
+        for(unsigned int x = 0; x < n; ++x){
+          float sum = 0.0f;
+          for(unsigned int y = 0; y < n; ++y){
+            sum += transform.bt[i*n + y]*tile[y*n + x];
+          }
+          half[i*n + x] = sum;
+        }
+      }
+      for(unsigned int i = 0; i < n; ++i){
+        for(unsigned int j = 0; j < n; ++j){
+          float sum = 0.0f;
+          for(unsigned int x = 0; x < n; ++x){
+            sum += half[i*n + x]*transform.bt[j*n + x];
+          }
+          transformed[i*n + j] = sum;
+        }
+      }
+
+      for(unsigned int f = 0; f < num_filters; ++f){
+        /* the only multiplies which grow with the bank, contiguous so they vectorize */
+        const float *filter = &filters[f*cells];
+        for(size_t c = 0; c < cells; ++c){
+          product[c] = filter[c]*transformed[c];
+        }
+
+        /* A^T (..) A */
+        for(unsigned int i = 0; i < m; ++i){
+          for(unsigned int x = 0; x < n; ++x){
+            float sum = 0.0f;
+            for(unsigned int y = 0; y < n; ++y){
+              sum += transform.at[i*n + y]*product[y*n + x];
+            }
+            half[i*n + x] = sum;
+          }
+        }
+        for(unsigned int i = 0; i < m && by + i < image_height; ++i){
+          for(unsigned int j = 0; j < m && bx + j < image_width; ++j){
+            float sum = 0.0f;
+            for(unsigned int x = 0; x < n; ++x){
+              sum += half[i*n + x]*transform.at[j*n + x];
+            }
+            result[f*image_size + (by + i)*image_width + bx + j] = sum <= 0.0f ? 0 : sum >= 255.0f ? 255 : sum;
+          }
+        }
+      }
+    }
+  }
+  free(filters);
+  return 0;
+}
@@ -0,0 +1,50 @@
+/* Winograd minimal filtering
+ * F(m x m, r x r) computes an m x m block of outputs of an r x r filter
+ * from a tile of (m+r-1)^2 pixels with (m+r-1)^2 multiplies instead of
+ * m^2 r^2 (Lavin and Gray, fast algorithms for convolutional neural
+ * networks). the tile d is transformed to B^T d B, multiplied cellwise by
+ * the transformed filter G g G^T and the block is A^T (..) A. the tile's
+ * transform is shared by every filter of a bank. transforms are the
+ * Toom-Cook ones for the points 0, 1, -1, 2, -2, 1/2, -1/2 and infinity,
+ * built on the host in double precision
+ */
+
+#ifndef GIMC_WINOGRAD_H
+#define GIMC_WINOGRAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* side of the block of outputs of a tile */
+#define WINOGRAD_M 4
+
+/* side of the largest tile, for 5x5 filters */
+#define WINOGRAD_MAX_TILE 8
+
+/* the transforms of F(m x m, r x r), row major */
+struct winograd_transform{
+  unsigned int m; /* block */
+  unsigned int r; /* filter */
+  unsigned int n; /* tile, m + r - 1 */
+  float at[WINOGRAD_M*WINOGRAD_MAX_TILE]; /* A^T, m x n */
+  float bt[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE]; /* B^T, n x n */
+  double g[WINOGRAD_MAX_TILE*WINOGRAD_MAX_TILE]; /* G, n x r */
+};
+
+/* transforms for filters of width, returns nonzero unless width is 3 or 5 */
+extern int winograd_transform(unsigned int width,struct winograd_transform *transform);
+
+/* transform a width*width filter laid out as in filter_Gauss2dbank into
+ * the n*n cells which multiply a transformed tile
+ */
+extern void winograd_filter(const struct winograd_transform *transform,const float *filter,float *cells);
+
+/* native_convolve2d by Winograd minimal filtering for widths 3 and 5, on
+ * whole tiles of the image. results are within float rounding of the
+ * direct sums, so they may differ by one where a sum is an integer
+ * returns nonzero for other widths
+ */
+extern int winograd_convolve2d(const uint8_t *image,size_t image_width,size_t image_height,
+  const float *bank,unsigned int num_filters,unsigned int filter_width,uint8_t *result);
+
+#endif